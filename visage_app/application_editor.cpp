@@ -24,6 +24,8 @@
 #include "client_window_decoration.h"
 #include "visage_graphics/canvas.h"
 #include "visage_graphics/renderer.h"
+#include "visage_utils/profiler.h"
+#include "visage_utils/thread_pool.h"
 #include "visage_windowing/windowing.h"
 #include "window_event_handler.h"
 
@@ -58,7 +60,12 @@ namespace visage {
     canvas_->addRegion(top_level_.region());
     top_level_.addChild(this);
 
-    event_handler_.request_redraw = [this](Frame* frame) { stale_children_.insert(frame); };
+    event_handler_.request_redraw = [this](Frame* frame) {
+      std::lock_guard<std::mutex> lock(stale_children_mutex_);
+      stale_children_.insert(frame);
+      if (window_)
+        window_->requestDraw();
+    };
     event_handler_.request_keyboard_focus = [this](Frame* frame) {
       if (window_event_handler_)
         window_event_handler_->setKeyboardFocus(frame);
@@ -83,6 +90,7 @@ namespace visage {
   }
 
   ApplicationEditor::~ApplicationEditor() {
+    EventManager::instance().removeWakeCallback(this);
     top_level_.setEventHandler(nullptr);
   }
 
@@ -93,6 +101,11 @@ namespace visage {
     return canvas_->screenshot();
   }
 
+  void ApplicationEditor::requestScreenshot(const IBounds& native_bounds,
+                                            ScreenshotCallback callback) {
+    canvas_->requestScreenshot(native_bounds, std::move(callback));
+  }
+
   void ApplicationEditor::setCanvasDetails() {
     canvas_->setDimensions(nativeWidth(), nativeHeight());
 
@@ -101,9 +114,17 @@ namespace visage {
   }
 
   void ApplicationEditor::addToWindow(Window* window) {
+    // The wake callback is removed before window_ changes so it never sees a stale window
+    EventManager::instance().removeWakeCallback(this);
     window_ = window;
 
     Renderer::instance().checkInitialization(window_->initWindow(), window->globalDisplay());
+    if (Renderer::instance().softwareRendering()) {
+      VISAGE_LOG(Renderer::instance().errorMessage());
+      VISAGE_ASSERT(false);
+      return;
+    }
+
     canvas_->pairToWindow(window_->nativeHandle(), window->clientWidth(), window->clientHeight());
     top_level_.setDpiScale(window_->dpiScale());
     top_level_.setNativeBounds(0, 0, window->clientWidth(), window->clientHeight());
@@ -115,6 +136,11 @@ namespace visage {
       EventManager::instance().checkEventTimers();
       drawWindow();
     });
+    window->setNeedsDrawCallback([this] { return needsDraw(); });
+    window->setNextEventCallback([] {
+      return EventManager::instance().millisecondsUntilNextTimer();
+    });
+    EventManager::instance().addWakeCallback(this, [this] { window_->requestDraw(); });
 
     drawWindow();
     drawWindow();
@@ -122,15 +148,20 @@ namespace visage {
   }
 
   void ApplicationEditor::setWindowless(int width, int height) {
+    EventManager::instance().removeWakeCallback(this);
     canvas_->removeFromWindow();
     window_ = nullptr;
-    Renderer::instance().checkInitialization(headlessWindowHandle(), nullptr);
+    if (Renderer::instance().softwareRendering())
+      Renderer::instance().checkInitialization(nullptr, nullptr);
+    else
+      Renderer::instance().checkInitialization(headlessWindowHandle(), nullptr);
     setBounds(0, 0, width, height);
     canvas_->setWindowless(width, height);
     drawWindow();
   }
 
   void ApplicationEditor::removeFromWindow() {
+    EventManager::instance().removeWakeCallback(this);
     window_event_handler_ = nullptr;
     window_ = nullptr;
     canvas_->removeFromWindow();
@@ -146,16 +177,33 @@ namespace visage {
     if (!initialized())
       init();
 
+    Profiler::instance().beginFrame();
     drawStaleChildren();
     canvas_->submit();
+    Profiler::instance().endFrame();
+  }
+
+  bool ApplicationEditor::needsDraw() {
+    {
+      std::lock_guard<std::mutex> lock(stale_children_mutex_);
+      if (!stale_children_.empty())
+        return true;
+    }
+    return EventManager::instance().hasPendingCallbacks() || canvas_->imageAtlas()->decoding() ||
+           canvas_->screenshotsPending();
   }
 
   void ApplicationEditor::drawStaleChildren() {
+    VISAGE_PROFILE_SCOPE("ApplicationEditor::drawStaleChildren");
     drawing_children_.clear();
     std::swap(stale_children_, drawing_children_);
-    for (Frame* child : drawing_children_) {
-      if (child->isDrawing())
-        child->drawToRegion(*canvas_);
+    if (recording_pool_)
+      recordChildrenInParallel();
+    else {
+      for (Frame* child : drawing_children_) {
+        if (child->isDrawing())
+          child->drawToRegion(*canvas_);
+      }
     }
     for (auto it = stale_children_.begin(); it != stale_children_.end();) {
       Frame* child = *it;
@@ -168,4 +216,31 @@ namespace visage {
     }
     drawing_children_.clear();
   }
+
+  void ApplicationEditor::setParallelRecording(bool parallel, int num_threads) {
+    recording_canvases_.clear();
+    recording_pool_ = nullptr;
+    if (parallel && num_threads > 0)
+      recording_pool_ = std::make_unique<ThreadPool>(num_threads);
+    else if (parallel)
+      recording_pool_ = std::make_unique<ThreadPool>();
+  }
+
+  void ApplicationEditor::recordChildrenInParallel() {
+    recording_children_.clear();
+    for (Frame* child : drawing_children_) {
+      if (child->isDrawing() && child->prepareToDraw())
+        recording_children_.push_back(child);
+    }
+
+    while (recording_canvases_.size() < recording_pool_->numThreads())
+      recording_canvases_.push_back(canvas_->createRecordingContext());
+    for (auto& recording_canvas : recording_canvases_)
+      canvas_->syncRecordingContext(recording_canvas.get());
+
+    recording_pool_->parallelFor(recording_children_.size(), [this](int index, int thread) {
+      recording_children_[index]->recordToRegion(*recording_canvases_[thread]);
+    });
+    DeferredGraphicsCalls::flush();
+  }
 }
@@ -23,6 +23,7 @@
 
 #include "visage_ui/frame.h"
 
+#include <mutex>
 #include <set>
 
 namespace visage {
@@ -31,6 +32,7 @@ namespace visage {
   class Window;
   class WindowEventHandler;
   class ClientWindowDecoration;
+  class ThreadPool;
 
   class TopLevelFrame : public Frame {
   public:
@@ -54,6 +56,11 @@ namespace visage {
     ~ApplicationEditor() override;
 
     const Screenshot& takeScreenshot();
+    // Doesn't wait for the GPU; the callback runs from a later drawWindow() call.
+    void requestScreenshot(ScreenshotCallback callback) {
+      requestScreenshot(nativeLocalBounds(), std::move(callback));
+    }
+    void requestScreenshot(const IBounds& native_bounds, ScreenshotCallback callback);
 
     void setCanvasDetails();
 
@@ -61,6 +68,7 @@ namespace visage {
     void setWindowless(int width, int height);
     void removeFromWindow();
     void drawWindow();
+    bool needsDraw();
 
     bool isFixedAspectRatio() const { return fixed_aspect_ratio_ > 0.0f; }
     void setFixedAspectRatio(float aspect_ratio) { fixed_aspect_ratio_ = aspect_ratio; }
@@ -76,6 +84,11 @@ namespace visage {
 
     void drawStaleChildren();
 
+    // Records stale frames into their Regions in parallel. Draw callbacks must then only touch
+    // their own frame and the Canvas they are given. num_threads of 0 uses every core.
+    void setParallelRecording(bool parallel, int num_threads = 0);
+    bool parallelRecording() const { return recording_pool_ != nullptr; }
+
     void setDimensions(float width, float height) { setBounds(x(), y(), width, height); }
     void setNativeDimensions(int width, int height) {
       setNativeBounds(nativeX(), nativeY(), width, height);
@@ -90,6 +103,8 @@ namespace visage {
     }
 
   private:
+    void recordChildrenInParallel();
+
     Window* window_ = nullptr;
     TopLevelFrame top_level_;
     FrameEventHandler event_handler_;
@@ -102,6 +117,11 @@ namespace visage {
 
     std::set<Frame*> stale_children_;
     std::set<Frame*> drawing_children_;
+    std::mutex stale_children_mutex_;
+
+    std::unique_ptr<ThreadPool> recording_pool_;
+    std::vector<std::unique_ptr<Canvas>> recording_canvases_;
+    std::vector<Frame*> recording_children_;
 
     VISAGE_LEAK_CHECKER(ApplicationEditor)
   };
@@ -19,10 +19,12 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "embedded/fonts.h"
 #include "visage/app.h"
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <visage/graphics.h>
 #include <visage/ui.h>
 #include <visage/widgets.h>
 
@@ -106,4 +108,88 @@ TEST_CASE("Screenshot horizontal gradient", "[integration]") {
       REQUIRE(data[index + 3] == 0xff);
     }
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Asynchronous screenshot region", "[integration]") {
+  Color source = 0xff345678;
+  Color destination = 0xff88aacc;
+  ApplicationEditor editor;
+  editor.onDraw() = [&](Canvas& canvas) {
+    canvas.setColor(Brush::horizontal(source, destination));
+    canvas.fill(0, 0, editor.width(), editor.height());
+  };
+
+  editor.setWindowless(10, 5);
+  std::vector<Screenshot> screenshots;
+  for (int i = 0; i < Layer::kScreenshotReadBackRing + 1; ++i) {
+    editor.requestScreenshot({ 2, 1, 6, 3 }, [&screenshots](const Screenshot& screenshot) {
+      screenshots.push_back(screenshot);
+    });
+  }
+
+  for (int i = 0; i < 10 && editor.needsDraw(); ++i)
+    editor.drawWindow();
+
+  REQUIRE(screenshots.size() == Layer::kScreenshotReadBackRing + 1);
+  for (const Screenshot& screenshot : screenshots) {
+    REQUIRE(screenshot.width() == 6);
+    REQUIRE(screenshot.height() == 3);
+    uint8_t* data = screenshot.data();
+    for (int x = 0; x < 6; ++x) {
+      float t = (x + 2) / 9.0f;
+      Color sample = source.interpolateWith(destination, t);
+
+      for (int y = 0; y < 3; ++y) {
+        int index = (y * 6 + x) * 4;
+        REQUIRE(data[index] == sample.hexRed());
+        REQUIRE(data[index + 1] == sample.hexGreen());
+        REQUIRE(data[index + 2] == sample.hexBlue());
+        REQUIRE(data[index + 3] == 0xff);
+      }
+    }
+  }
+}
+
+TEST_CASE("Clipped SDF text matches unclipped text", "[integration]") {
+  static constexpr int kSize = 128;
+  static constexpr int kClip = 64;
+  static constexpr int kTolerance = 2;
+
+  Font font = Font(96, fonts::DroidSansMono_ttf).withSdf();
+  REQUIRE(font.withDpiScale(1.0f).glyphScale() != 1.0f);
+
+  for (bool compact : { false, true }) {
+    Renderer::instance().setCompactVertices(compact);
+    bool clip = false;
+    ApplicationEditor editor;
+    editor.onDraw() = [&](Canvas& canvas) {
+      canvas.setColor(0xff000000);
+      canvas.fill(0, 0, kSize, kSize);
+      if (clip)
+        canvas.setClampBounds(kClip, 0, kSize - kClip, kSize);
+      canvas.setColor(0xffffffff);
+      canvas.text("O", font, Font::kCenter, 0, 0, kSize, kSize);
+    };
+
+    editor.setWindowless(kSize, kSize);
+    Screenshot full = editor.takeScreenshot();
+    clip = true;
+    Screenshot clipped = editor.takeScreenshot();
+    REQUIRE(clipped.width() == kSize);
+    REQUIRE(clipped.height() == kSize);
+
+    int lit_pixels = 0;
+    for (int y = 0; y < kSize; ++y) {
+      for (int x = 0; x < kSize; ++x) {
+        int index = (y * kSize + x) * 4;
+        for (int c = 0; c < 3; ++c) {
+          int expected = x < kClip ? 0 : full.data()[index + c];
+          REQUIRE(std::abs(clipped.data()[index + c] - expected) <= kTolerance);
+        }
+        lit_pixels += x >= kClip && full.data()[index] > 0x80;
+      }
+    }
+    REQUIRE(lit_pixels > 0);
+  }
+  Renderer::instance().setCompactVertices(true);
+}
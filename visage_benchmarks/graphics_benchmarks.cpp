@@ -0,0 +1,211 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage_graphics/layer.h"
+#include "visage_graphics/line.h"
+#include "visage_graphics/palette.h"
+#include "visage_graphics/region.h"
+#include "visage_graphics/shape_batcher.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+using namespace visage;
+
+namespace {
+  constexpr int kNumShapes = 2000;
+  constexpr int kAreaSize = 1000;
+
+  ClampBounds fullClamp() {
+    return { 0.0f, 0.0f, static_cast<float>(kAreaSize), static_cast<float>(kAreaSize) };
+  }
+
+  template<typename T>
+  std::vector<T> randomShapes(int count, std::mt19937& random) {
+    std::uniform_int_distribution<int> position(0, kAreaSize - 40);
+    std::uniform_int_distribution<int> size(4, 40);
+    std::vector<T> shapes;
+    for (int i = 0; i < count; ++i) {
+      if constexpr (std::is_same_v<T, Fill>)
+        shapes.emplace_back(fullClamp(), nullptr, position(random), position(random), size(random),
+                            size(random));
+      else
+        shapes.emplace_back(fullClamp(), nullptr, position(random), position(random), size(random),
+                            size(random), 3.0f);
+    }
+    return shapes;
+  }
+}
+
+TEST_CASE("Shape batching", "[graphics]") {
+  std::mt19937 random(1);
+  std::vector<Fill> fills = randomShapes<Fill>(kNumShapes, random);
+  std::vector<RoundedRectangle> rectangles = randomShapes<RoundedRectangle>(kNumShapes, random);
+  ShapeBatcher batcher;
+
+  BENCHMARK("ShapeBatcher::addShape interleaved types") {
+    batcher.clear();
+    for (int i = 0; i < kNumShapes; ++i) {
+      batcher.addShape(fills[i]);
+      batcher.addShape(rectangles[i]);
+    }
+    return batcher.numBatches();
+  };
+
+  batcher.clear();
+  for (int i = 0; i < kNumShapes; ++i) {
+    batcher.addShape(fills[i]);
+    batcher.addShape(rectangles[i]);
+  }
+
+  BENCHMARK("ShapeBatcher::autoBatchIndex") {
+    int sum = 0;
+    for (int i = 0; i < kNumShapes; ++i)
+      sum += batcher.autoBatchIndex(rectangles[i], BlendMode::Alpha);
+    return sum;
+  };
+}
+
+TEST_CASE("Quad vertex generation", "[graphics]") {
+  std::mt19937 random(2);
+  std::vector<RoundedRectangle> rectangles = randomShapes<RoundedRectangle>(kNumShapes, random);
+  std::vector<IBounds> invalid_rects = { { 0, 0, kAreaSize / 2, kAreaSize },
+                                         { kAreaSize / 2, 0, kAreaSize / 2, kAreaSize / 2 } };
+  BatchVector<RoundedRectangle> batches;
+  batches.emplace_back(&rectangles, &invalid_rects, 0, 0);
+
+  int num_shapes = numShapes(batches);
+  std::vector<RoundedRectangle::Vertex> vertices(num_shapes * kVerticesPerQuad);
+
+  BENCHMARK("setQuadVertices") {
+    setQuadVertices(batches, vertices.data(), num_shapes);
+    return vertices.back().x;
+  };
+}
+
+TEST_CASE("Layer invalidation", "[graphics]") {
+  std::mt19937 random(3);
+  std::uniform_int_distribution<int> position(0, kAreaSize - 100);
+  std::uniform_int_distribution<int> size(1, 100);
+  std::vector<IBounds> rects;
+  for (int i = 0; i < 500; ++i)
+    rects.emplace_back(position(random), position(random), size(random), size(random));
+
+  GradientAtlas gradient_atlas;
+  Layer layer(&gradient_atlas);
+  Region region;
+  region.setBounds(0, 0, kAreaSize, kAreaSize);
+  layer.addRegion(&region);
+
+  BENCHMARK("Layer::invalidateRectInRegion") {
+    layer.clearInvalidRects();
+    for (const IBounds& rect : rects)
+      layer.invalidateRectInRegion(rect, &region);
+    return layer.anyInvalidRects();
+  };
+}
+
+TEST_CASE("Font layout", "[graphics]") {
+  Font font(14.0f, fonts::Lato_Regular_ttf, 1.0f);
+  std::u32string line = U"The quick brown fox jumps over the lazy dog 0123456789";
+  std::u32string paragraph;
+  for (int i = 0; i < 40; ++i)
+    paragraph += line + U" ";
+  std::vector<FontAtlasQuad> quads(paragraph.size());
+
+  BENCHMARK("Font::setVertexPositions") {
+    font.setVertexPositions(quads.data(), line.c_str(), line.size(), 0.0f, 0.0f, 500.0f, 20.0f);
+    return quads[0].x;
+  };
+
+  BENCHMARK("Font::lineBreaks") {
+    return font.lineBreaks(paragraph.c_str(), paragraph.size(), 300.0f).size();
+  };
+
+  BENCHMARK("Font::setMultiLineVertexPositions") {
+    font.setMultiLineVertexPositions(quads.data(), paragraph.c_str(), paragraph.size(), 0.0f, 0.0f,
+                                     300.0f, 1000.0f);
+    return quads[0].x;
+  };
+}
+
+TEST_CASE("Atlas packing", "[graphics]") {
+  std::mt19937 random(4);
+  std::uniform_int_distribution<int> size(4, 64);
+  PackedAtlasMap<int> atlas_map;
+  for (int i = 0; i < 1000; ++i)
+    atlas_map.addRect(i, size(random), size(random));
+
+  BENCHMARK("PackedAtlasMap::pack") {
+    atlas_map.pack();
+    return atlas_map.width();
+  };
+}
+
+TEST_CASE("Palette lookups", "[graphics]") {
+  static constexpr int kNumIds = 200;
+
+  std::vector<theme::ColorId> color_ids;
+  std::vector<theme::OverrideId> override_ids;
+  for (int i = 0; i < kNumIds; ++i) {
+    std::string name = "BenchmarkColor" + std::to_string(i);
+    color_ids.push_back(theme::ColorId::nextId(name, __FILE__, 0xff000000 + i));
+  }
+  for (int i = 0; i < 4; ++i)
+    override_ids.push_back(theme::OverrideId::nextId("BenchmarkOverride" + std::to_string(i)));
+
+  Palette palette;
+  for (int i = 0; i < kNumIds; i += 2)
+    palette.setColor(color_ids[i], Color(0xff000000 + i));
+  for (int i = 0; i < kNumIds; i += 7)
+    palette.setColor(override_ids[i % override_ids.size()], color_ids[i], Color(0xffffffff));
+
+  BENCHMARK("Palette::color") {
+    Brush brush;
+    int found = 0;
+    for (const theme::OverrideId& override_id : override_ids) {
+      for (const theme::ColorId& color_id : color_ids)
+        found += palette.color(override_id, color_id, brush);
+    }
+    return found;
+  };
+}
+
+TEST_CASE("Line streaming", "[graphics]") {
+  static constexpr int kNumSamples = 200000;
+
+  std::mt19937 random(5);
+  std::uniform_real_distribution<float> sample(-1.0f, 1.0f);
+  std::vector<float> samples(kNumSamples);
+  for (float& value : samples)
+    value = sample(random);
+
+  LineStream stream(kNumSamples);
+  stream.push(samples.data(), kNumSamples);
+  Line line;
+
+  BENCHMARK("LineStream::decimate") {
+    stream.decimate(line, 1000.0f, 2000, 500.0f, -500.0f);
+    return line.num_points;
+  };
+}
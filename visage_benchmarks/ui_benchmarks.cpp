@@ -0,0 +1,210 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage/app.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <random>
+#include <visage/graphics.h>
+#include <visage/ui.h>
+#include <visage/utils.h>
+
+using namespace visage;
+
+namespace {
+  // Grid of panels, each holding a row of widgets that draw a rounded rectangle and a label.
+  class BenchmarkWidget : public Frame {
+  public:
+    explicit BenchmarkWidget(int index) : label_(std::to_string(index)) { }
+
+    void draw(Canvas& canvas) override {
+      canvas.setColor(0xff223344 + (value_ & 0xff));
+      canvas.roundedRectangle(0, 0, width(), height(), 4);
+      canvas.setColor(0xffeeeeee);
+      canvas.text(label_, Font(12, fonts::Lato_Regular_ttf), Font::kCenter, 0, 0, width(),
+                  height());
+    }
+
+    void setValue(int value) {
+      value_ = value;
+      redraw();
+    }
+
+  private:
+    String label_;
+    int value_ = 0;
+  };
+
+  class WidgetTree {
+  public:
+    static constexpr int kPanelGrid = 8;
+    static constexpr int kWidgetsPerPanel = 16;
+    static constexpr int kPanelSize = 100;
+
+    explicit WidgetTree(Frame& root) {
+      int index = 0;
+      for (int r = 0; r < kPanelGrid; ++r) {
+        for (int c = 0; c < kPanelGrid; ++c) {
+          panels_.push_back(std::make_unique<Frame>());
+          Frame* panel = panels_.back().get();
+          root.addChild(panel);
+          panel->setBounds(c * kPanelSize, r * kPanelSize, kPanelSize, kPanelSize);
+
+          int widget_size = kPanelSize / 4;
+          for (int i = 0; i < kWidgetsPerPanel; ++i) {
+            widgets_.push_back(std::make_unique<BenchmarkWidget>(index++));
+            panel->addChild(widgets_.back().get());
+            widgets_.back()->setBounds((i % 4) * widget_size, (i / 4) * widget_size, widget_size,
+                                       widget_size);
+          }
+        }
+      }
+    }
+
+    std::vector<std::unique_ptr<BenchmarkWidget>>& widgets() { return widgets_; }
+
+  private:
+    std::vector<std::unique_ptr<Frame>> panels_;
+    std::vector<std::unique_ptr<BenchmarkWidget>> widgets_;
+  };
+
+  // Draws every primitive the Showcase example uses so opening it creates a comparable set of
+  // shader programs
+  class ShapeGallery : public Frame {
+  public:
+    void draw(Canvas& canvas) override {
+      float size = height();
+      canvas.setColor(0xff334455);
+      canvas.rectangle(0, 0, size, size);
+      canvas.roundedRectangle(size, 0, size, size, 8);
+      canvas.circle(2 * size, 0, size);
+      canvas.squircle(3 * size, 0, size);
+      canvas.diamond(4 * size, 0, size, 4);
+      canvas.flatArc(5 * size, 0, size, 6, 0.0f, 2.0f);
+      canvas.roundedArc(6 * size, 0, size, 6, 0.0f, 2.0f);
+      canvas.segment(7 * size, 0, 8 * size, size, 3, false);
+      canvas.segment(8 * size, 0, 9 * size, size, 3, true);
+      canvas.triangle(9 * size, size, 9.5f * size, 0, 10 * size, size);
+      canvas.quadratic(10 * size, size, 10.5f * size, 0, 11 * size, size, 2);
+      canvas.roundedRectangleShadow(11 * size, 0, size, size, 8, 6);
+      canvas.setColor(0xffeeeeee);
+      canvas.text("Open", Font(12, fonts::Lato_Regular_ttf), Font::kCenter, 0, 0, width(), size);
+    }
+  };
+
+  File openTimeCacheDirectory() {
+    return std::filesystem::temp_directory_path() / "visage_benchmark_program_cache";
+  }
+
+  long long childOpenTime() {
+    static constexpr char kOpenTimePrefix[] = "open_time_us ";
+
+    std::string output;
+    if (!spawnChildProcess(hostExecutable().string(), "[.open_editor]", output, 60000))
+      return -1;
+
+    size_t position = output.find(kOpenTimePrefix);
+    if (position == std::string::npos)
+      return -1;
+    return std::stoll(output.substr(position + sizeof(kOpenTimePrefix) - 1));
+  }
+}
+
+TEST_CASE("Frame hit testing", "[ui]") {
+  static constexpr int kSize = WidgetTree::kPanelGrid * WidgetTree::kPanelSize;
+
+  Frame root;
+  root.setBounds(0, 0, kSize, kSize);
+  WidgetTree tree(root);
+
+  std::mt19937 random(5);
+  std::uniform_real_distribution<float> position(0.0f, kSize);
+  std::vector<Point> points;
+  for (int i = 0; i < 1000; ++i)
+    points.emplace_back(position(random), position(random));
+
+  BENCHMARK("Frame::frameAtPoint") {
+    int hits = 0;
+    for (const Point& point : points)
+      hits += root.frameAtPoint(point) != &root;
+    return hits;
+  };
+}
+
+TEST_CASE("Headless frame rendering", "[ui]") {
+  static constexpr int kSize = WidgetTree::kPanelGrid * WidgetTree::kPanelSize;
+
+  ApplicationEditor editor;
+  WidgetTree tree(editor);
+  editor.setWindowless(kSize, kSize);
+  std::vector<std::unique_ptr<BenchmarkWidget>>& widgets = tree.widgets();
+
+  std::mt19937 random(6);
+  int num_widgets = widgets.size();
+  std::uniform_int_distribution<int> widget_index(0, num_widgets - 1);
+  int value = 0;
+
+  BENCHMARK("Redraw 5% of widgets") {
+    for (int i = 0; i < num_widgets / 20; ++i)
+      widgets[widget_index(random)]->setValue(++value);
+    editor.drawWindow();
+  };
+
+  BENCHMARK("Redraw all widgets") {
+    ++value;
+    for (auto& widget : widgets)
+      widget->setValue(value);
+    editor.drawWindow();
+  };
+}
+
+// Run in a child process by "Editor open time" so every launch starts with no programs created
+TEST_CASE("Open editor", "[.open_editor]") {
+  static constexpr int kSize = WidgetTree::kPanelGrid * WidgetTree::kPanelSize;
+
+  ProgramBinaryCache::setDirectory(openTimeCacheDirectory());
+  long long start = Profiler::microseconds();
+  ApplicationEditor editor;
+  WidgetTree tree(editor);
+  ShapeGallery gallery;
+  editor.addChild(&gallery);
+  gallery.setBounds(0, 0, kSize, kSize / 12);
+  editor.setWindowless(kSize, kSize);
+  long long open_time = Profiler::microseconds() - start;
+
+  ProgramBinaryCache::Stats stats = ProgramBinaryCache::stats();
+  std::printf("open_time_us %lld hits %d misses %d\n", open_time, stats.hits, stats.misses);
+}
+
+TEST_CASE("Editor open time", "[ui]") {
+  std::error_code error;
+  std::filesystem::remove_all(openTimeCacheDirectory(), error);
+
+  long long cold = childOpenTime();
+  long long warm = childOpenTime();
+  REQUIRE(cold > 0);
+  REQUIRE(warm > 0);
+  std::printf("Editor open time: %.1f ms cold, %.1f ms warm program cache\n", cold / 1000.0,
+              warm / 1000.0);
+}
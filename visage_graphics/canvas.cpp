@@ -21,7 +21,9 @@
 
 #include "canvas.h"
 
+#include "graphics_caches.h"
 #include "palette.h"
+#include "renderer.h"
 #include "theme.h"
 
 #include <bgfx/bgfx.h>
@@ -42,6 +44,24 @@ namespace visage {
     default_region_.setNeedsLayer(true);
   }
 
+  Canvas::Canvas(Canvas* parent) : Canvas() {
+    parent_ = parent;
+  }
+
+  std::unique_ptr<Canvas> Canvas::createRecordingContext() {
+    VISAGE_ASSERT(parent_ == nullptr);
+    return std::unique_ptr<Canvas>(new Canvas(this));
+  }
+
+  void Canvas::syncRecordingContext(Canvas* context) const {
+    VISAGE_ASSERT(context->parent_ == this);
+    context->palette_ = palette_;
+    context->dpi_scale_ = dpi_scale_;
+    context->render_time_ = render_time_;
+    context->delta_time_ = delta_time_;
+    context->render_frame_ = render_frame_;
+  }
+
   void Canvas::clearDrawnShapes() {
     default_region_.clear();
     default_region_.invalidate();
@@ -59,7 +79,30 @@ namespace visage {
     setClampBounds(0, 0, width, height);
   }
 
+  void Canvas::setWindowless(int width, int height) {
+    if (Renderer::instance().softwareRendering())
+      setSoftwareRendering(true);
+    composite_layer_.setHeadlessRender(width, height);
+  }
+
+  void Canvas::setSoftwareRendering(bool software) {
+    if (software && software_renderer_ == nullptr)
+      software_renderer_ = std::make_unique<SoftwareRenderer>();
+    else if (!software)
+      software_renderer_ = nullptr;
+  }
+
   int Canvas::submit(int submit_pass) {
+    VISAGE_ASSERT(parent_ == nullptr);
+    DeferredGraphicsCalls::flush();
+    if (software_renderer_)
+      return submitSoftware(submit_pass);
+
+    if (image_atlas_.updateDecodedImages()) {
+      for (Layer* layer : layers_)
+        layer->invalidate();
+    }
+
     int submission = submit_pass;
     for (int i = layers_.size() - 1; i > 0; --i)
       submission = layers_[i]->submit(submission);
@@ -67,14 +110,26 @@ namespace visage {
     if (submission > submit_pass) {
       composite_layer_.invalidate();
       submission = composite_layer_.submit(submission);
-      bgfx::frame();
-      if (render_frame_ == 0)
-        bgfx::frame();
+      submission = composite_layer_.submitScreenshotReadBacks(submission);
+      {
+        VISAGE_PROFILE_SCOPE("bgfx::frame");
+        uint32_t frame = bgfx::frame();
+        if (render_frame_ == 0)
+          frame = bgfx::frame();
+        composite_layer_.receiveScreenshots(frame);
+      }
 
       render_frame_++;
+      RenderTargetPool::releaseIdleTargets();
       FontCache::clearStaleFonts();
       gradient_atlas_.clearStaleGradients();
       image_atlas_.clearStaleImages();
+      image_atlas_.defragment();
+      updateMemoryUsage();
+    }
+    else if (composite_layer_.screenshotsPending()) {
+      submission = composite_layer_.submitScreenshotReadBacks(submission);
+      composite_layer_.receiveScreenshots(bgfx::frame());
     }
     else if (last_skipped_frame_ != render_frame_) {
       last_skipped_frame_ = render_frame_;
@@ -83,14 +138,97 @@ namespace visage {
     return submission;
   }
 
+  int Canvas::submitSoftware(int submit_pass) {
+    bool invalid = false;
+    for (Layer* layer : layers_) {
+      invalid = invalid || layer->anyInvalidRects();
+      layer->clearInvalidRects();
+    }
+
+    if (invalid) {
+      software_renderer_->setDimensions(composite_layer_.width(), composite_layer_.height());
+      software_renderer_->render(&window_region_);
+
+      render_frame_++;
+      RenderTargetPool::releaseIdleTargets();
+      FontCache::clearStaleFonts();
+      gradient_atlas_.clearStaleGradients();
+      image_atlas_.clearStaleImages();
+      image_atlas_.defragment();
+      updateMemoryUsage();
+    }
+    return submit_pass;
+  }
+
+  void Canvas::updateMemoryUsage() {
+    memory_.atlases.clear();
+    memory_.bytes[GraphicsMemory::kFonts] = FontCache::memoryUsage(&memory_.atlases);
+
+    long long image_bytes = image_atlas_.memoryBytes();
+    memory_.bytes[GraphicsMemory::kImages] = image_bytes;
+    memory_.atlases.push_back({ "Images", image_atlas_.width(), image_atlas_.height(), image_bytes });
+
+    long long gradient_bytes = gradient_atlas_.memoryBytes();
+    memory_.bytes[GraphicsMemory::kGradients] = gradient_bytes;
+    memory_.atlases.push_back({ "Gradients", gradient_atlas_.width(), gradient_atlas_.height(),
+                                gradient_bytes });
+
+    long long layer_bytes = 0;
+    long long post_effect_bytes = 0;
+    for (const Layer* layer : layers_) {
+      layer_bytes += layer->memoryBytes();
+      post_effect_bytes += layer->postEffectMemoryBytes();
+    }
+    memory_.bytes[GraphicsMemory::kLayers] = layer_bytes;
+    memory_.bytes[GraphicsMemory::kPostEffects] = post_effect_bytes;
+    memory_.bytes[GraphicsMemory::kRenderTargetPool] = RenderTargetPool::freeMemoryBytes();
+    memory_.updatePeaks();
+  }
+
+  void Canvas::setMemoryBudget(GraphicsMemory::Subsystem subsystem, long long bytes) {
+    VISAGE_ASSERT(subsystem == GraphicsMemory::kFonts || subsystem == GraphicsMemory::kImages);
+    if (subsystem == GraphicsMemory::kFonts)
+      FontCache::setMemoryBudget(bytes);
+    else if (subsystem == GraphicsMemory::kImages)
+      image_atlas_.setMemoryBudget(bytes);
+  }
+
+  long long Canvas::memoryBudget(GraphicsMemory::Subsystem subsystem) const {
+    if (subsystem == GraphicsMemory::kFonts)
+      return FontCache::memoryBudget();
+    if (subsystem == GraphicsMemory::kImages)
+      return image_atlas_.memoryBudget();
+    return 0;
+  }
+
   void Canvas::requestScreenshot() {
-    composite_layer_.requestScreenshot();
+    if (software_renderer_ == nullptr)
+      composite_layer_.requestScreenshot();
   }
 
   const Screenshot& Canvas::screenshot() const {
+    if (software_renderer_)
+      return software_renderer_->screenshot();
     return composite_layer_.screenshot();
   }
 
+  void Canvas::requestScreenshot(const IBounds& bounds, ScreenshotCallback callback) {
+    if (software_renderer_ == nullptr) {
+      composite_layer_.requestScreenshot(bounds, std::move(callback));
+      return;
+    }
+
+    const Screenshot& screenshot = software_renderer_->screenshot();
+    IBounds area = bounds.intersection({ 0, 0, screenshot.width(), screenshot.height() });
+    if (!area.hasArea()) {
+      callback(Screenshot());
+      return;
+    }
+
+    const uint8_t* data = screenshot.data() + (area.y() * screenshot.width() + area.x()) * 4;
+    callback(Screenshot(data, area.width(), area.height(), screenshot.width() * 4));
+  }
+
   void Canvas::ensureLayerExists(int layer) {
     int layers_to_add = layer + 1 - layers_.size();
     for (int i = 0; i < layers_to_add; ++i) {
@@ -125,18 +263,23 @@ namespace visage {
     addToPackedLayer(region, to);
   }
 
+  const CompiledPalette& Canvas::compiledPalette() {
+    if (compiled_palette_ == nullptr || !palette_->isCurrent(*compiled_palette_))
+      compiled_palette_ = palette_->compiled();
+    return *compiled_palette_;
+  }
+
   Brush Canvas::color(theme::ColorId color_id) {
     if (palette_) {
-      Brush result;
+      const CompiledPalette& palette = compiledPalette();
       theme::OverrideId last_check;
       for (auto it = state_memory_.rbegin(); it != state_memory_.rend(); ++it) {
         theme::OverrideId override_id = it->palette_override;
-        if (override_id.id != last_check.id && palette_->color(override_id, color_id, result))
-          return result;
+        if (override_id.id != last_check.id && palette.hasColor(override_id, color_id))
+          return palette.color(override_id, color_id);
         last_check = override_id;
       }
-      if (palette_->color({}, color_id, result))
-        return result;
+      return palette.color({}, color_id);
     }
 
     return Brush::solid(theme::ColorId::defaultColor(color_id));
@@ -144,17 +287,16 @@ namespace visage {
 
   float Canvas::value(theme::ValueId value_id) {
     if (palette_) {
-      float result = 0.0f;
+      const CompiledPalette& palette = compiledPalette();
       theme::OverrideId last_check;
       for (auto it = state_memory_.rbegin(); it != state_memory_.rend(); ++it) {
         theme::OverrideId override_id = it->palette_override;
-        if (override_id.id != last_check.id && palette_->value(override_id, value_id, result))
-          return result;
+        if (override_id.id != last_check.id && palette.hasValue(override_id, value_id))
+          return palette.value(override_id, value_id);
 
         last_check = override_id;
       }
-      if (palette_->value({}, value_id, result))
-        return result;
+      return palette.value({}, value_id);
     }
 
     return theme::ValueId::defaultValue(value_id);
@@ -202,6 +344,37 @@ namespace visage {
     result.push_back("Submit wait: " + std::to_string(stats->waitSubmit));
     result.push_back("Draw number: " + std::to_string(stats->numDraw));
     result.push_back("Num views: " + std::to_string(stats->numViews));
+    result.push_back("Render targets: " + std::to_string(RenderTargetPool::numTargets()) + " (" +
+                     std::to_string(RenderTargetPool::numFreeTargets()) + " free)");
+    ProgramBinaryCache::Stats program_cache = ProgramBinaryCache::stats();
+    result.push_back("Program cache: " + std::to_string(program_cache.hits) + " hits, " +
+                     std::to_string(program_cache.misses) + " misses, " +
+                     std::to_string(program_cache.writes) + " writes");
+    for (int i = 0; i < GraphicsMemory::kNumSubsystems; ++i) {
+      auto subsystem = static_cast<GraphicsMemory::Subsystem>(i);
+      result.push_back(std::string(GraphicsMemory::subsystemName(subsystem)) + " memory: " +
+                       std::to_string(memory_.bytes[i] / 1024) + " KB (peak " +
+                       std::to_string(memory_.peak_bytes[i] / 1024) + " KB)");
+    }
+
+    if (Profiler::instance().enabled()) {
+      Profiler::FrameStats frame = Profiler::instance().lastFrame();
+      result.push_back("Frame time: " + std::to_string(frame.duration) + " us");
+      result.push_back("Shapes: " + std::to_string(frame.counters[Profiler::kShapes]));
+      result.push_back("Batches: " + std::to_string(frame.counters[Profiler::kBatches]));
+      result.push_back("Vertices: " + std::to_string(frame.counters[Profiler::kVertices]));
+      result.push_back("Cached vertices: " + std::to_string(frame.counters[Profiler::kCachedVertices]));
+      result.push_back("Shape instances: " + std::to_string(frame.counters[Profiler::kShapeInstances]));
+      result.push_back("Invalid rects: " + std::to_string(frame.counters[Profiler::kInvalidRects]));
+      result.push_back("Invalid rect fragments: " +
+                       std::to_string(frame.counters[Profiler::kInvalidRectFragments]));
+      result.push_back("Invalid rect overdraw: " +
+                       std::to_string(frame.counters[Profiler::kInvalidRectOverdraw]) + " px");
+      result.push_back("Text layout hits: " +
+                       std::to_string(frame.counters[Profiler::kTextLayoutHits]));
+      result.push_back("Text layout misses: " +
+                       std::to_string(frame.counters[Profiler::kTextLayoutMisses]));
+    }
 
     for (auto& cap : caps_list) {
       if (caps->supported & cap.first)
@@ -22,11 +22,13 @@
 #pragma once
 
 #include "font.h"
+#include "graphics_memory.h"
 #include "graphics_utils.h"
 #include "layer.h"
 #include "region.h"
 #include "screenshot.h"
 #include "shape_batcher.h"
+#include "software_renderer.h"
 #include "text.h"
 #include "theme.h"
 #include "visage_utils/dimension.h"
@@ -34,6 +36,7 @@
 #include "visage_utils/time_utils.h"
 
 namespace visage {
+  class CompiledPalette;
   class Palette;
   class Shader;
 
@@ -58,11 +61,21 @@ namespace visage {
     Canvas(const Canvas& other) = delete;
     Canvas& operator=(const Canvas&) = delete;
 
+    // A recording context draws into Regions of this canvas from another thread. It has its own
+    // drawing state but shares this canvas' atlases, and is never submitted itself.
+    std::unique_ptr<Canvas> createRecordingContext();
+    void syncRecordingContext(Canvas* context) const;
+    bool isRecordingContext() const { return parent_ != nullptr; }
+
     void clearDrawnShapes();
     int submit(int submit_pass = 0);
 
     void requestScreenshot();
     const Screenshot& screenshot() const;
+    void requestScreenshot(const IBounds& bounds, ScreenshotCallback callback);
+    bool screenshotsPending() const {
+      return software_renderer_ == nullptr && composite_layer_.screenshotsPending();
+    }
 
     void ensureLayerExists(int layer);
     Layer* layer(int index) {
@@ -81,7 +94,9 @@ namespace visage {
       setDimensions(width, height);
     }
 
-    void setWindowless(int width, int height) { composite_layer_.setHeadlessRender(width, height); }
+    void setWindowless(int width, int height);
+    void setSoftwareRendering(bool software);
+    bool softwareRendering() const { return software_renderer_ != nullptr; }
 
     void removeFromWindow() { composite_layer_.removeFromWindow(); }
 
@@ -98,7 +113,7 @@ namespace visage {
 
     void setBlendMode(BlendMode blend_mode) { state_.blend_mode = blend_mode; }
     void setBrush(const Brush& brush) {
-      state_.brush = state_.current_region->addBrush(&gradient_atlas_, brush.gradient(),
+      state_.brush = state_.current_region->addBrush(gradientAtlas(), brush.gradient(),
                                                      brush.position() * state_.scale);
     }
     void setColor(const Brush& brush) { setBrush(brush); }
@@ -479,7 +494,11 @@ namespace visage {
 
     void endRegion() { restoreState(); }
 
-    void setPalette(Palette* palette) { palette_ = palette; }
+    void setPalette(Palette* palette) {
+      if (palette != palette_)
+        compiled_palette_ = nullptr;
+      palette_ = palette;
+    }
     void setPaletteOverride(theme::OverrideId override_id) {
       state_.palette_override = override_id;
     }
@@ -511,12 +530,28 @@ namespace visage {
     float value(theme::ValueId value_id);
     std::vector<std::string> debugInfo() const;
 
-    ImageAtlas* imageAtlas() { return &image_atlas_; }
-    GradientAtlas* gradientAtlas() { return &gradient_atlas_; }
+    // Measured after every rendered frame. Font atlases and the render target pool are shared by
+    // every canvas.
+    const GraphicsMemory& memoryUsage() const { return memory_; }
+    void resetMemoryPeaks() { memory_.resetPeaks(); }
+    // Only kFonts and kImages accept budgets. The kImages budget belongs to this canvas's image
+    // atlas, but the kFonts budget is process-wide: it sets FontCache::setMemoryBudget and
+    // applies to every canvas.
+    void setMemoryBudget(GraphicsMemory::Subsystem subsystem, long long bytes);
+    long long memoryBudget(GraphicsMemory::Subsystem subsystem) const;
+
+    ImageAtlas* imageAtlas() { return parent_ ? parent_->imageAtlas() : &image_atlas_; }
+    GradientAtlas* gradientAtlas() { return parent_ ? parent_->gradientAtlas() : &gradient_atlas_; }
 
     State* state() { return &state_; }
 
   private:
+    explicit Canvas(Canvas* parent);
+    const CompiledPalette& compiledPalette();
+
+    int submitSoftware(int submit_pass);
+    void updateMemoryUsage();
+
     template<typename T>
     constexpr float pixels(T&& value) {
       if constexpr (std::is_same_v<std::decay_t<T>, Dimension>)
@@ -730,7 +765,9 @@ namespace visage {
                             image.height, image, imageAtlas()));
     }
 
+    Canvas* parent_ = nullptr;
     Palette* palette_ = nullptr;
+    std::shared_ptr<const CompiledPalette> compiled_palette_;
     float dpi_scale_ = 1.0f;
     double render_time_ = 0.0;
     double delta_time_ = 0.0;
@@ -747,7 +784,9 @@ namespace visage {
     Region default_region_;
     Layer composite_layer_;
     std::vector<std::unique_ptr<Layer>> intermediate_layers_;
+    std::unique_ptr<SoftwareRenderer> software_renderer_;
     std::vector<Layer*> layers_;
+    GraphicsMemory memory_;
 
     float refresh_rate_ = 0.0f;
 
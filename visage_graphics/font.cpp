@@ -22,10 +22,16 @@
 #include "font.h"
 
 #include "emoji.h"
+#include "visage_utils/profiler.h"
+#include "visage_utils/thread_pool.h"
 #include "visage_utils/thread_utils.h"
 
+#include <algorithm>
 #include <bgfx/bgfx.h>
+#include <cstring>
 #include <freetype/freetype.h>
+#include <freetype/ftmodapi.h>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -55,7 +61,11 @@ namespace visage {
     }
 
   private:
-    FreeTypeLibrary() { FT_Init_FreeType(&library_); }
+    FreeTypeLibrary() {
+      FT_Init_FreeType(&library_);
+      FT_Int spread = Font::kSdfSpread;
+      FT_Property_Set(library_, "sdf", "spread", &spread);
+    }
     ~FreeTypeLibrary() {
       for (FT_Face face : faces_)
         FT_Done_Face(face);
@@ -96,6 +106,12 @@ namespace visage {
       return face_->glyph;
     }
 
+    FT_GlyphSlot characterDistanceField(char32_t character) const {
+      FT_Load_Char(face_, character, FT_LOAD_DEFAULT);
+      FT_Render_Glyph(face_->glyph, FT_RENDER_MODE_SDF);
+      return face_->glyph;
+    }
+
     FT_Face face() const { return face_; }
 
   private:
@@ -104,12 +120,12 @@ namespace visage {
 
   class PackedFont {
   public:
-    PackedFont(int size, const unsigned char* data, int data_size) : size_(size), data_(data) {
+    PackedFont(int size, const unsigned char* data, int data_size, bool sdf) :
+        size_(size), data_(data), sdf_(sdf) {
       std::unique_ptr<TypeFace> face = std::make_unique<TypeFace>(size, data, data_size);
-      std::unique_ptr<PackedGlyph[]> glyphs = std::make_unique<PackedGlyph[]>(face->numGlyphs());
       type_faces_.push_back(std::move(face));
 
-      packed_glyphs_['\n'] = Font::kNullPackedGlyph;
+      *glyphSlot('\n') = Font::kNullPackedGlyph;
     }
 
     ~PackedFont() {
@@ -117,21 +133,26 @@ namespace visage {
         bgfx::destroy(texture_handle_);
     }
 
+    // The atlas grew without moving any glyphs so the pixels carry over and only the texture
+    // needs to be recreated at the new size
     void resize() {
       if (bgfx::isValid(texture_handle_)) {
-        bgfx::destroy(texture_handle_);
+        bgfx::TextureHandle handle = texture_handle_;
+        DeferredGraphicsCalls::run([handle] { bgfx::destroy(handle); });
         texture_handle_ = BGFX_INVALID_HANDLE;
       }
-
-      atlas_map_.pack();
-      for (auto& glyph : packed_glyphs_) {
-        if (glyph.second.width == 0)
-          continue;
-
-        const PackedRect& rect = atlas_map_.rectForId(glyph.first);
-        glyph.second.atlas_left = rect.x;
-        glyph.second.atlas_top = rect.y;
-      }
+      software_atlas_ = nullptr;
+
+      int width = atlas_map_.width();
+      int height = atlas_map_.height();
+      int row_size = pixels_width_ * channels();
+      auto pixels = std::make_unique<unsigned char[]>(width * height * channels());
+      for (int y = 0; y < pixels_height_; ++y)
+        std::memcpy(pixels.get() + y * width * channels(), pixels_.get() + y * row_size, row_size);
+
+      pixels_ = std::move(pixels);
+      pixels_width_ = width;
+      pixels_height_ = height;
     }
 
     void rasterizeGlyph(char32_t character, const PackedGlyph* packed_glyph) {
@@ -139,6 +160,11 @@ namespace visage {
       if (size == 0)
         return;
 
+      if (sdf_) {
+        rasterizeDistanceField(character, packed_glyph);
+        return;
+      }
+
       std::unique_ptr<unsigned int[]> texture = std::make_unique<unsigned int[]>(size);
       if (packed_glyph->type_face) {
         FT_GlyphSlot glyph = packed_glyph->type_face->characterRasterData(character);
@@ -154,15 +180,45 @@ namespace visage {
                                                    texture.get(), packed_glyph->width, 0, 0);
       }
 
-      bgfx::updateTexture2D(texture_handle_, 0, 0, packed_glyph->atlas_left,
-                            packed_glyph->atlas_top, packed_glyph->width, packed_glyph->height,
-                            bgfx::copy(texture.get(), size * ImageAtlas::kChannels));
+      writeGlyph(packed_glyph, reinterpret_cast<const unsigned char*>(texture.get()));
+    }
+
+    void rasterizeDistanceField(char32_t character, const PackedGlyph* packed_glyph) {
+      int size = packed_glyph->width * packed_glyph->height;
+      std::unique_ptr<unsigned char[]> texture = std::make_unique<unsigned char[]>(size);
+      FT_GlyphSlot glyph = packed_glyph->type_face->characterDistanceField(character);
+      for (int y = 0; y < packed_glyph->height; ++y) {
+        const unsigned char* row = glyph->bitmap.buffer + y * glyph->bitmap.pitch;
+        std::copy(row, row + packed_glyph->width, texture.get() + y * packed_glyph->width);
+      }
+
+      writeGlyph(packed_glyph, texture.get());
+    }
+
+    void writeGlyph(const PackedGlyph* packed_glyph, const unsigned char* data) {
+      int row_size = packed_glyph->width * channels();
+      for (int y = 0; y < packed_glyph->height; ++y) {
+        std::memcpy(pixel(packed_glyph->atlas_left, packed_glyph->atlas_top + y),
+                    data + y * row_size, row_size);
+      }
+
+      if (software_atlas_) {
+        for (int y = 0; y < packed_glyph->height; ++y)
+          writeSoftwareRow(packed_glyph->atlas_left, packed_glyph->atlas_top + y, packed_glyph->width);
+      }
+
+      if (bgfx::isValid(texture_handle_)) {
+        bgfx::updateTexture2D(texture_handle_, 0, 0, packed_glyph->atlas_left,
+                              packed_glyph->atlas_top, packed_glyph->width, packed_glyph->height,
+                              bgfx::copy(data, row_size * packed_glyph->height));
+      }
     }
 
     PackedGlyph* packCharacterGlyph(PackedGlyph* packed_glyph, const TypeFace* type_face, char32_t character) {
       static constexpr float kAdvanceMult = 1.0f / (1 << 6);
 
-      FT_GlyphSlot glyph = type_face->characterInfo(character);
+      FT_GlyphSlot glyph = sdf_ ? type_face->characterDistanceField(character) :
+                                  type_face->characterInfo(character);
       packed_glyph->width = glyph->bitmap.width;
       packed_glyph->height = glyph->bitmap.rows;
       packed_glyph->x_offset = glyph->bitmap_left;
@@ -175,9 +231,10 @@ namespace visage {
     }
 
     PackedGlyph* packEmojiGlyph(PackedGlyph* packed_glyph, char32_t emoji) {
+      // Emoji are colored so they have no distance field representation
       int raster_width = lineHeight();
-      packed_glyph->width = raster_width;
-      packed_glyph->height = raster_width;
+      packed_glyph->width = sdf_ ? 0 : raster_width;
+      packed_glyph->height = sdf_ ? 0 : raster_width;
       packed_glyph->x_offset = 0;
       packed_glyph->y_offset = size_;
       packed_glyph->x_advance = raster_width;
@@ -187,7 +244,8 @@ namespace visage {
     }
 
     const PackedGlyph* packedGlyph(char32_t character) {
-      PackedGlyph* packed_glyph = &packed_glyphs_[character];
+      std::lock_guard<std::mutex> lock(mutex_);
+      PackedGlyph* packed_glyph = glyphSlot(character);
       if (packed_glyph->atlas_left >= 0)
         return packed_glyph;
 
@@ -201,25 +259,41 @@ namespace visage {
 
     void checkInit() {
       if (!bgfx::isValid(texture_handle_)) {
-        texture_handle_ = bgfx::createTexture2D(atlas_map_.width(), atlas_map_.height(), false, 1,
-                                                bgfx::TextureFormat::BGRA8);
-        int width = atlas_map_.width();
-        int height = atlas_map_.height();
-        std::unique_ptr<unsigned int[]> clear = std::make_unique<unsigned int[]>(width * height);
-        bgfx::updateTexture2D(texture_handle_, 0, 0, 0, 0, width, height,
-                              bgfx::copy(clear.get(), width * height * ImageAtlas::kChannels));
-
-        for (auto& glyph : packed_glyphs_)
-          rasterizeGlyph(glyph.first, &glyph.second);
+        bgfx::TextureFormat::Enum format = sdf_ ? bgfx::TextureFormat::R8 :
+                                                  bgfx::TextureFormat::BGRA8;
+        int size = pixels_width_ * pixels_height_ * channels();
+        texture_handle_ = bgfx::createTexture2D(pixels_width_, pixels_height_, false, 1, format,
+                                                0, size ? bgfx::copy(pixels_.get(), size) : nullptr);
       }
     }
 
+    void checkSoftwareAtlas() {
+      if (software_atlas_)
+        return;
+
+      software_atlas_ = std::make_unique<unsigned int[]>(pixels_width_ * pixels_height_);
+      for (int y = 0; y < pixels_height_; ++y)
+        writeSoftwareRow(0, y, pixels_width_);
+    }
+
     int atlasWidth() const { return atlas_map_.width(); }
-    int atlasHeight() const { return atlas_map_.width(); }
+    int atlasHeight() const { return atlas_map_.height(); }
+    long long memoryBytes() const {
+      long long atlas_bytes = static_cast<long long>(pixels_width_) * pixels_height_ * channels();
+      long long bytes = atlas_bytes;
+      if (bgfx::isValid(texture_handle_))
+        bytes += atlas_bytes;
+      if (software_atlas_)
+        bytes += static_cast<long long>(pixels_width_) * pixels_height_ * sizeof(unsigned int);
+      return bytes;
+    }
+    const unsigned int* softwareAtlas() const { return software_atlas_.get(); }
     bgfx::TextureHandle& textureHandle() { return texture_handle_; }
     int lineHeight() const { return type_faces_[0]->lineHeight(); }
     int size() const { return size_; }
     const unsigned char* data() const { return data_; }
+    bool sdf() const { return sdf_; }
+    int glyphPadding() const { return sdf_ ? Font::kSdfSpread : 0; }
 
   private:
     void packGlyph(PackedGlyph* packed_glyph, char32_t character) {
@@ -230,17 +304,57 @@ namespace visage {
       packed_glyph->atlas_left = rect.x;
       packed_glyph->atlas_top = rect.y;
 
-      if (bgfx::isValid(texture_handle_))
+      if (DeferredGraphicsCalls::shouldDefer())
+        DeferredGraphicsCalls::run([this, character, packed_glyph] { rasterizeGlyph(character, packed_glyph); });
+      else
         rasterizeGlyph(character, packed_glyph);
     }
 
+    // Basic Multilingual Plane glyphs are looked up directly in lazily allocated pages
+    PackedGlyph* glyphSlot(char32_t character) {
+      if (character >= kNumGlyphPages * kGlyphPageSize)
+        return &packed_glyphs_[character];
+
+      std::unique_ptr<PackedGlyph[]>& page = glyph_pages_[character / kGlyphPageSize];
+      if (page == nullptr)
+        page = std::make_unique<PackedGlyph[]>(kGlyphPageSize);
+      return &page[character % kGlyphPageSize];
+    }
+
+    int channels() const { return sdf_ ? 1 : ImageAtlas::kChannels; }
+
+    unsigned char* pixel(int x, int y) const {
+      return pixels_.get() + (y * pixels_width_ + x) * channels();
+    }
+
+    void writeSoftwareRow(int x, int y, int width) {
+      unsigned int* row = software_atlas_.get() + y * pixels_width_ + x;
+      const unsigned char* source = pixel(x, y);
+      if (sdf_) {
+        for (int i = 0; i < width; ++i)
+          row[i] = (source[i] << 24) + 0xffffff;
+      }
+      else
+        std::memcpy(row, source, width * sizeof(unsigned int));
+    }
+
     PackedAtlasMap<char32_t> atlas_map_;
     std::vector<std::unique_ptr<TypeFace>> type_faces_;
     int size_ = 0;
     const unsigned char* data_ = nullptr;
+    bool sdf_ = false;
+
+    std::mutex mutex_;
+    static constexpr int kGlyphPageSize = 256;
+    static constexpr int kNumGlyphPages = 256;
 
+    std::unique_ptr<PackedGlyph[]> glyph_pages_[kNumGlyphPages];
     std::map<char32_t, PackedGlyph> packed_glyphs_;
     bgfx::TextureHandle texture_handle_ = { bgfx::kInvalidHandle };
+    std::unique_ptr<unsigned char[]> pixels_;
+    int pixels_width_ = 0;
+    int pixels_height_ = 0;
+    std::unique_ptr<unsigned int[]> software_atlas_;
   };
 
   bool Font::hasNewLine(const char32_t* string, int length) {
@@ -253,24 +367,24 @@ namespace visage {
 
   Font::Font(float size, const char* data, int data_size) :
       size_(size), native_size_(std::round(size)), font_data_(data), data_size_(data_size) {
-    packed_font_ = FontCache::loadPackedFont(native_size_, data, data_size);
+    loadPackedFont();
   }
 
   Font::Font(float size, const EmbeddedFile& file) :
       size_(size), native_size_(std::round(size)), font_data_(file.data), data_size_(file.size) {
-    packed_font_ = FontCache::loadPackedFont(native_size_, file);
+    loadPackedFont();
   }
 
-  Font::Font(float size, const char* data, int data_size, float dpi_scale) :
+  Font::Font(float size, const char* data, int data_size, float dpi_scale, bool sdf) :
       size_(size), native_size_(std::round(size * dpi_scale)), font_data_(data),
-      data_size_(data_size), dpi_scale_(dpi_scale) {
-    packed_font_ = FontCache::loadPackedFont(native_size_, data, data_size);
+      data_size_(data_size), dpi_scale_(dpi_scale), sdf_(sdf) {
+    loadPackedFont();
   }
 
-  Font::Font(float size, const EmbeddedFile& file, float dpi_scale) :
+  Font::Font(float size, const EmbeddedFile& file, float dpi_scale, bool sdf) :
       size_(size), native_size_(std::round(size * dpi_scale)), font_data_(file.data),
-      data_size_(file.size), dpi_scale_(dpi_scale) {
-    packed_font_ = FontCache::loadPackedFont(native_size_, file);
+      data_size_(file.size), dpi_scale_(dpi_scale), sdf_(sdf) {
+    loadPackedFont();
   }
 
   Font::Font(const Font& other) {
@@ -279,7 +393,8 @@ namespace visage {
     dpi_scale_ = other.dpi_scale_;
     font_data_ = other.font_data_;
     data_size_ = other.data_size_;
-    packed_font_ = FontCache::loadPackedFont(native_size_, font_data_, data_size_);
+    sdf_ = other.sdf_;
+    loadPackedFont();
   }
 
   Font& Font::operator=(const Font& other) {
@@ -294,7 +409,8 @@ namespace visage {
     dpi_scale_ = other.dpi_scale_;
     font_data_ = other.font_data_;
     data_size_ = other.data_size_;
-    packed_font_ = FontCache::loadPackedFont(native_size_, font_data_, data_size_);
+    sdf_ = other.sdf_;
+    loadPackedFont();
     return *this;
   }
 
@@ -303,6 +419,17 @@ namespace visage {
       FontCache::returnPackedFont(packed_font_);
   }
 
+  void Font::loadPackedFont() {
+    if (sdf_) {
+      packed_font_ = FontCache::loadPackedFont(kSdfSize, font_data_, data_size_, true);
+      glyph_scale_ = native_size_ / static_cast<float>(kSdfSize);
+    }
+    else {
+      packed_font_ = FontCache::loadPackedFont(native_size_, font_data_, data_size_, false);
+      glyph_scale_ = 1.0f;
+    }
+  }
+
   int Font::nativeWidthOverflowIndex(const char32_t* string, int string_length, float width,
                                      bool round, int character_override) const {
     float string_width = 0;
@@ -314,7 +441,7 @@ namespace visage {
       if (!isIgnored(character))
         packed_char = packed_font_->packedGlyph(character);
 
-      float advance = packed_char->x_advance;
+      float advance = packed_char->x_advance * glyph_scale_;
       float break_point = advance;
       if (round)
         break_point = advance * 0.5f;
@@ -334,7 +461,7 @@ namespace visage {
 
     if (character_override) {
       float advance = packed_font_->packedGlyph(character_override)->x_advance;
-      return advance * length;
+      return advance * glyph_scale_ * length;
     }
 
     float width = 0.0f;
@@ -343,7 +470,7 @@ namespace visage {
         width += packed_font_->packedGlyph(string[i])->x_advance;
     }
 
-    return width;
+    return width * glyph_scale_;
   }
 
   void Font::setVertexPositions(FontAtlasQuad* quads, const char32_t* text, int length, float x,
@@ -371,41 +498,47 @@ namespace visage {
       const PackedGlyph* packed_glyph = packed_font_->packedGlyph(character);
 
       quads[i].packed_glyph = packed_glyph;
-      quads[i].x = pen_x + packed_glyph->x_offset;
-      quads[i].y = pen_y - packed_glyph->y_offset;
-      quads[i].width = packed_glyph->width;
-      quads[i].height = packed_glyph->height;
+      quads[i].x = pen_x + packed_glyph->x_offset * glyph_scale_;
+      quads[i].y = pen_y - packed_glyph->y_offset * glyph_scale_;
+      quads[i].width = packed_glyph->width * glyph_scale_;
+      quads[i].height = packed_glyph->height * glyph_scale_;
 
-      pen_x += packed_glyph->x_advance;
+      pen_x += packed_glyph->x_advance * glyph_scale_;
     }
   }
 
+  int Font::nativeNextLineBreak(const char32_t* string, int length, float width) const {
+    int overflow_index = nativeWidthOverflowIndex(string, length, width);
+    if (overflow_index == length && !hasNewLine(string, overflow_index))
+      return -1;
+
+    int next_break_index = overflow_index;
+    while (next_break_index < length && next_break_index > 0 &&
+           isPrintable(string[next_break_index - 1])) {
+      next_break_index--;
+    }
+
+    if (next_break_index == 0)
+      next_break_index = overflow_index;
+
+    for (int i = 0; i < next_break_index; ++i) {
+      if (isNewLine(string[i]))
+        next_break_index = i + 1;
+    }
+
+    return std::max(next_break_index, 1);
+  }
+
   std::vector<int> Font::nativeLineBreaks(const char32_t* string, int length, float width) const {
     std::vector<int> line_breaks;
     int break_index = 0;
     while (break_index < length) {
-      int overflow_index = nativeWidthOverflowIndex(string + break_index, length - break_index, width) +
-                           break_index;
-      if (overflow_index == length && !hasNewLine(string + break_index, overflow_index - break_index))
+      int next_break = nativeNextLineBreak(string + break_index, length - break_index, width);
+      if (next_break < 0)
         break;
 
-      int next_break_index = overflow_index;
-      while (next_break_index < length && next_break_index > break_index &&
-             isPrintable(string[next_break_index - 1])) {
-        next_break_index--;
-      }
-
-      if (next_break_index == break_index)
-        next_break_index = overflow_index;
-
-      for (int i = break_index; i < next_break_index; ++i) {
-        if (isNewLine(string[i]))
-          next_break_index = i + 1;
-      }
-
-      next_break_index = std::max(next_break_index, break_index + 1);
-      line_breaks.push_back(next_break_index);
-      break_index = next_break_index;
+      break_index += next_break;
+      line_breaks.push_back(break_index);
     }
 
     return line_breaks;
@@ -442,16 +575,18 @@ namespace visage {
   }
 
   int Font::nativeLineHeight() const {
-    return packed_font_->lineHeight();
+    return std::round(packed_font_->lineHeight() * glyph_scale_);
   }
 
   float Font::nativeCapitalHeight() const {
-    return packed_font_->packedGlyph('T')->y_offset;
+    int padding = packed_font_->glyphPadding();
+    return (packed_font_->packedGlyph('T')->y_offset - padding) * glyph_scale_;
   }
 
   float Font::nativeLowerDipHeight() const {
+    int padding = packed_font_->glyphPadding();
     const PackedGlyph* glyph = packed_font_->packedGlyph('y');
-    return (glyph->y_offset + glyph->height);
+    return (glyph->y_offset + glyph->height - 3 * padding) * glyph_scale_;
   }
 
   int Font::atlasWidth() const {
@@ -462,6 +597,11 @@ namespace visage {
     return packed_font_->atlasHeight();
   }
 
+  const unsigned int* Font::softwareAtlas() const {
+    packed_font_->checkSoftwareAtlas();
+    return packed_font_->softwareAtlas();
+  }
+
   const bgfx::TextureHandle& Font::textureHandle() const {
     packed_font_->checkInit();
     return packed_font_->textureHandle();
@@ -473,35 +613,159 @@ namespace visage {
 
   FontCache::~FontCache() = default;
 
-  PackedFont* FontCache::createOrLoadPackedFont(int size, const char* font_data, int data_size) {
-    VISAGE_ASSERT(Thread::isMainThread());
+  PackedFont* FontCache::createOrLoadPackedFont(int size, const char* font_data, int data_size,
+                                                bool sdf) {
+    VISAGE_ASSERT(Thread::isMainThread() || ThreadPool::isWorkerThread());
+    std::lock_guard<std::mutex> lock(mutex_);
 
     const unsigned char* data = reinterpret_cast<const unsigned char*>(font_data);
-    std::pair<int, unsigned const char*> font_info(size, data);
+    std::tuple<int, unsigned const char*, bool> font_info(size, data, sdf);
     if (cache_.count(font_info) == 0)
-      cache_[font_info] = std::make_unique<PackedFont>(size, data, data_size);
+      cache_[font_info] = std::make_unique<PackedFont>(size, data, data_size, sdf);
 
-    ref_count_[cache_[font_info].get()]++;
-    return cache_[font_info].get();
+    PackedFont* packed_font = cache_[font_info].get();
+    ref_count_[packed_font]++;
+    stale_order_.erase(packed_font);
+    return packed_font;
   }
 
   void FontCache::decrementPackedFont(PackedFont* packed_font) {
-    VISAGE_ASSERT(Thread::isMainThread());
+    VISAGE_ASSERT(Thread::isMainThread() || ThreadPool::isWorkerThread());
+    std::lock_guard<std::mutex> lock(mutex_);
     ref_count_[packed_font]--;
     int count = ref_count_[packed_font];
+    if (count == 0)
+      stale_order_[packed_font] = ++stale_counter_;
     has_stale_fonts_ = has_stale_fonts_ || count == 0;
     VISAGE_ASSERT(ref_count_[packed_font] >= 0);
   }
 
   void FontCache::removeStaleFonts() {
-    for (auto it = ref_count_.begin(); it != ref_count_.end();) {
-      if (it->second)
-        ++it;
-      else {
-        cache_.erase({ it->first->size(), it->first->data() });
-        it = ref_count_.erase(it);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<long long, PackedFont*>> stale;
+    stale.reserve(stale_order_.size());
+    for (const auto& font : stale_order_)
+      stale.emplace_back(font.second, font.first);
+    std::sort(stale.begin(), stale.end());
+
+    long long bytes = 0;
+    if (memory_budget_) {
+      for (const auto& font : cache_)
+        bytes += font.second->memoryBytes();
+    }
+
+    int removed = 0;
+    for (const auto& font : stale) {
+      if (memory_budget_ && bytes <= memory_budget_)
+        break;
+
+      PackedFont* packed_font = font.second;
+      bytes -= packed_font->memoryBytes();
+      TextLayoutCache::instance().removeFont(packed_font);
+      ref_count_.erase(packed_font);
+      stale_order_.erase(packed_font);
+      cache_.erase({ packed_font->size(), packed_font->data(), packed_font->sdf() });
+      removed++;
+    }
+    has_stale_fonts_ = removed < stale.size();
+  }
+
+  long long FontCache::collectMemoryUsage(std::vector<GraphicsMemory::Atlas>* atlases) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    long long bytes = 0;
+    for (const auto& font : cache_) {
+      const PackedFont* packed_font = font.second.get();
+      long long font_bytes = packed_font->memoryBytes();
+      bytes += font_bytes;
+      if (atlases) {
+        std::string name = "Font " + std::to_string(packed_font->size());
+        if (packed_font->sdf())
+          name += " SDF";
+        atlases->push_back({ name, packed_font->atlasWidth(), packed_font->atlasHeight(), font_bytes });
       }
     }
-    has_stale_fonts_ = false;
+    return bytes;
+  }
+
+  TextLayoutCache& TextLayoutCache::instance() {
+    static TextLayoutCache cache;
+    return cache;
+  }
+
+  void TextLayoutCache::setVertexPositions(FontAtlasQuad* quads, const Font& font,
+                                           const char32_t* string, int length, float width,
+                                           float height, Font::Justification justification,
+                                           bool multi_line, int character_override) {
+    if (length > kMaxCachedLength) {
+      layout(quads, font, string, length, width, height, justification, multi_line, character_override);
+      return;
+    }
+
+    std::u32string_view text(string, length);
+    Key key = { std::hash<std::u32string_view>()(text), font.packed_font_, font.glyph_scale_,
+                width, height, justification, multi_line, character_override };
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto found = lookup_.find(key);
+      if (found != lookup_.end() && found->second->text == text) {
+        hits_++;
+        VISAGE_PROFILE_COUNT(Profiler::kTextLayoutHits, 1);
+        entries_.splice(entries_.begin(), entries_, found->second);
+        std::copy(found->second->quads.begin(), found->second->quads.end(), quads);
+        return;
+      }
+    }
+
+    misses_++;
+    VISAGE_PROFILE_COUNT(Profiler::kTextLayoutMisses, 1);
+    layout(quads, font, string, length, width, height, justification, multi_line, character_override);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = lookup_.find(key);
+    if (found != lookup_.end())
+      entries_.erase(found->second);
+    else if (entries_.size() >= kMaxEntries) {
+      lookup_.erase(entries_.back().key);
+      entries_.pop_back();
+    }
+
+    entries_.push_front({ key, std::u32string(text), std::vector<FontAtlasQuad>(quads, quads + length) });
+    lookup_[key] = entries_.begin();
+  }
+
+  void TextLayoutCache::removeFont(const PackedFont* packed_font) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->key.packed_font == packed_font) {
+        lookup_.erase(it->key);
+        it = entries_.erase(it);
+      }
+      else
+        ++it;
+    }
+  }
+
+  void TextLayoutCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lookup_.clear();
+    entries_.clear();
+  }
+
+  int TextLayoutCache::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  void TextLayoutCache::layout(FontAtlasQuad* quads, const Font& font, const char32_t* string,
+                               int length, float width, float height,
+                               Font::Justification justification, bool multi_line,
+                               int character_override) {
+    if (multi_line)
+      font.setMultiLineVertexPositions(quads, string, length, 0, 0, width, height, justification);
+    else {
+      font.setVertexPositions(quads, string, length, 0, 0, width, height, justification,
+                              character_override);
+    }
   }
-}
\ No newline at end of file
+}
@@ -22,15 +22,23 @@
 #pragma once
 
 #include "color.h"
+#include "graphics_memory.h"
 #include "graphics_utils.h"
 #include "visage_file_embed/embedded_file.h"
 
+#include <atomic>
+#include <list>
 #include <map>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 namespace visage {
   class TypeFace;
   class PackedFont;
+  class TextLayoutCache;
 
   struct PackedGlyph {
     int atlas_left = -1;
@@ -53,7 +61,11 @@ namespace visage {
 
   class Font {
   public:
+    friend class TextLayoutCache;
+
     static constexpr PackedGlyph kNullPackedGlyph = { 0, 0, 0, 0, 0.0f, 0.0f, 0.0f };
+    static constexpr int kSdfSize = 48;
+    static constexpr int kSdfSpread = 6;
 
     enum Justification {
       kCenter = 0,
@@ -82,8 +94,8 @@ namespace visage {
     Font() = default;
     Font(float size, const char* font_data, int data_size);
     Font(float size, const EmbeddedFile& file);
-    Font(float size, const char* font_data, int data_size, float dpi_scale);
-    Font(float size, const EmbeddedFile& file, float dpi_scale);
+    Font(float size, const char* font_data, int data_size, float dpi_scale, bool sdf = false);
+    Font(float size, const EmbeddedFile& file, float dpi_scale, bool sdf = false);
     Font(const Font& other);
     Font& operator=(const Font& other);
     ~Font();
@@ -95,8 +107,17 @@ namespace visage {
       return dpi_scale_ ? dpi_scale_ : 1.0f;
     }
     Font withDpiScale(float dpi_scale) const {
-      return Font(size_, fontData(), dataSize(), dpi_scale);
+      return Font(size_, fontData(), dataSize(), dpi_scale, sdf_);
+    }
+
+    // Signed distance field fonts share one single channel atlas across all sizes of a typeface
+    // and are scaled on the GPU. Useful when text is drawn at many sizes or animated.
+    Font withSdf(bool sdf = true) const {
+      return Font(size_, fontData(), dataSize(), dpi_scale_, sdf);
     }
+    bool sdf() const { return sdf_; }
+    // Screen pixels per atlas texel
+    float glyphScale() const { return glyph_scale_; }
 
     int widthOverflowIndex(const char32_t* string, int string_length, float width,
                            bool round = false, int character_override = 0) const {
@@ -105,6 +126,10 @@ namespace visage {
     std::vector<int> lineBreaks(const char32_t* string, int length, float width) const {
       return nativeLineBreaks(string, length, width * dpiScale());
     }
+    // Index the first line of string wraps at, or -1 if it all fits on one line
+    int nextLineBreak(const char32_t* string, int length, float width) const {
+      return nativeNextLineBreak(string, length, width * dpiScale());
+    }
 
     float stringWidth(const char32_t* string, int length, int character_override = 0) const {
       return nativeStringWidth(string, length, character_override) / dpiScale();
@@ -122,6 +147,7 @@ namespace visage {
     const char* fontData() const { return font_data_; }
     int dataSize() const { return data_size_; }
     const bgfx::TextureHandle& textureHandle() const;
+    const unsigned int* softwareAtlas() const;
 
     void setVertexPositions(FontAtlasQuad* quads, const char32_t* string, int length, float x, float y,
                             float width, float height, Justification justification = Justification::kCenter,
@@ -140,13 +166,17 @@ namespace visage {
     int nativeLineHeight() const;
     float nativeCapitalHeight() const;
     float nativeLowerDipHeight() const;
+    int nativeNextLineBreak(const char32_t* string, int length, float width) const;
     std::vector<int> nativeLineBreaks(const char32_t* string, int length, float width) const;
+    void loadPackedFont();
 
     float size_ = 0.0f;
     int native_size_ = 0;
     const char* font_data_ = nullptr;
     int data_size_ = 0;
     float dpi_scale_ = 0.0f;
+    bool sdf_ = false;
+    float glyph_scale_ = 1.0f;
     PackedFont* packed_font_ = nullptr;
   };
 
@@ -161,18 +191,22 @@ namespace visage {
         instance()->removeStaleFonts();
     }
 
+    // Unused fonts stay cached while all font atlases fit in bytes and are released least recently
+    // used first once they don't. A budget of 0 releases unused fonts right away.
+    static void setMemoryBudget(long long bytes) { instance()->memory_budget_ = bytes; }
+    static long long memoryBudget() { return instance()->memory_budget_; }
+    static long long memoryUsage(std::vector<GraphicsMemory::Atlas>* atlases = nullptr) {
+      return instance()->collectMemoryUsage(atlases);
+    }
+
   private:
     static FontCache* instance() {
       static FontCache cache;
       return &cache;
     }
 
-    static PackedFont* loadPackedFont(int size, const EmbeddedFile& font) {
-      return instance()->createOrLoadPackedFont(size, font.data, font.size);
-    }
-
-    static PackedFont* loadPackedFont(int size, const char* font_data, int data_size) {
-      return instance()->createOrLoadPackedFont(size, font_data, data_size);
+    static PackedFont* loadPackedFont(int size, const char* font_data, int data_size, bool sdf) {
+      return instance()->createOrLoadPackedFont(size, font_data, data_size, sdf);
     }
 
     static void returnPackedFont(PackedFont* packed_font) {
@@ -181,12 +215,88 @@ namespace visage {
 
     FontCache();
 
-    PackedFont* createOrLoadPackedFont(int size, const char* font_data, int data_size);
+    PackedFont* createOrLoadPackedFont(int size, const char* font_data, int data_size, bool sdf);
     void decrementPackedFont(PackedFont* packed_font);
     void removeStaleFonts();
+    long long collectMemoryUsage(std::vector<GraphicsMemory::Atlas>* atlases);
 
-    std::map<std::pair<int, unsigned const char*>, std::unique_ptr<PackedFont>> cache_;
+    std::map<std::tuple<int, unsigned const char*, bool>, std::unique_ptr<PackedFont>> cache_;
     std::map<PackedFont*, int> ref_count_;
+    std::map<PackedFont*, long long> stale_order_;
+    std::mutex mutex_;
     bool has_stale_fonts_ = false;
+    long long stale_counter_ = 0;
+    long long memory_budget_ = 0;
+  };
+
+  // Least recently used cache of laid out glyph quads so text that has not changed skips glyph
+  // lookups, measuring and line breaking when it redraws. Entries point at glyphs so they are
+  // dropped when their PackedFont is released.
+  class TextLayoutCache {
+  public:
+    static constexpr int kMaxEntries = 2048;
+    static constexpr int kMaxCachedLength = 1024;
+
+    static TextLayoutCache& instance();
+
+    // Lays out the text at the origin, writing one quad per character
+    void setVertexPositions(FontAtlasQuad* quads, const Font& font, const char32_t* string,
+                            int length, float width, float height, Font::Justification justification,
+                            bool multi_line, int character_override = 0);
+    void removeFont(const PackedFont* packed_font);
+    void clear();
+
+    int size();
+    long long hits() const { return hits_.load(); }
+    long long misses() const { return misses_.load(); }
+
+  private:
+    struct Key {
+      size_t text_hash = 0;
+      const PackedFont* packed_font = nullptr;
+      float glyph_scale = 1.0f;
+      float width = 0.0f;
+      float height = 0.0f;
+      Font::Justification justification = Font::kCenter;
+      bool multi_line = false;
+      int character_override = 0;
+
+      bool operator==(const Key& other) const {
+        return text_hash == other.text_hash && packed_font == other.packed_font &&
+               glyph_scale == other.glyph_scale && width == other.width && height == other.height &&
+               justification == other.justification && multi_line == other.multi_line &&
+               character_override == other.character_override;
+      }
+    };
+
+    struct KeyHash {
+      size_t operator()(const Key& key) const {
+        size_t hash = key.text_hash;
+        auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+        combine(std::hash<const void*>()(key.packed_font));
+        combine(std::hash<float>()(key.glyph_scale));
+        combine(std::hash<float>()(key.width));
+        combine(std::hash<float>()(key.height));
+        combine((key.justification << 2) | (key.multi_line << 1));
+        combine(key.character_override);
+        return hash;
+      }
+    };
+
+    struct Entry {
+      Key key;
+      std::u32string text;
+      std::vector<FontAtlasQuad> quads;
+    };
+
+    static void layout(FontAtlasQuad* quads, const Font& font, const char32_t* string, int length,
+                       float width, float height, Font::Justification justification,
+                       bool multi_line, int character_override);
+
+    std::list<Entry> entries_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup_;
+    std::mutex mutex_;
+    std::atomic<long long> hits_ = 0;
+    std::atomic<long long> misses_ = 0;
   };
-}
\ No newline at end of file
+}
@@ -100,14 +100,14 @@ namespace visage {
   }
 
   void GradientAtlas::resize() {
-    texture_.reset();
-    atlas_map_.pack();
+    DeferredGraphicsCalls::release(std::move(texture_));
+    version_++;
+  }
 
-    for (auto& gradient : gradients_) {
-      const PackedRect& rect = atlas_map_.rectForId(gradient.second.get());
-      gradient.second->x = rect.x;
-      gradient.second->y = rect.y;
-    }
+  long long GradientAtlas::memoryBytes() const {
+    if (texture_ == nullptr || !bgfx::isValid(texture_->handle))
+      return 0;
+    return static_cast<long long>(atlas_map_.width()) * atlas_map_.height() * sizeof(uint64_t);
   }
 
   const bgfx::TextureHandle& GradientAtlas::colorTextureHandle() {
@@ -27,6 +27,7 @@
 #include <functional>
 #include <iosfwd>
 #include <map>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -172,6 +173,7 @@ namespace visage {
     ~GradientAtlas();
 
     PackedGradient addGradient(const Gradient& gradient) {
+      std::lock_guard<std::mutex> lock(mutex_);
       if (gradients_.count(gradient) == 0) {
         std::unique_ptr<PackedGradientRect> packed_gradient_rect = std::make_unique<PackedGradientRect>(gradient);
         if (!atlas_map_.addRect(packed_gradient_rect.get(), gradient.resolution(), 1))
@@ -180,7 +182,8 @@ namespace visage {
         const PackedRect& rect = atlas_map_.rectForId(packed_gradient_rect.get());
         packed_gradient_rect->x = rect.x;
         packed_gradient_rect->y = rect.y;
-        updateGradient(packed_gradient_rect.get());
+        const PackedGradientRect* rect_pointer = packed_gradient_rect.get();
+        DeferredGraphicsCalls::run([this, rect_pointer] { updateGradient(rect_pointer); });
         gradients_[gradient] = std::move(packed_gradient_rect);
       }
       stale_gradients_.erase(gradient);
@@ -209,6 +212,8 @@ namespace visage {
     }
     int width() const { return atlas_map_.width(); }
     int height() const { return atlas_map_.height(); }
+    int version() const { return version_; }
+    long long memoryBytes() const;
 
     const bgfx::TextureHandle& colorTextureHandle();
 
@@ -218,10 +223,13 @@ namespace visage {
 
     void removeGradient(const Gradient& gradient) {
       VISAGE_ASSERT(gradients_.count(gradient));
-      stale_gradients_[gradient] = gradients_[gradient].get();
+      // Another thread may have referenced the gradient again before this reference was destroyed
+      if (references_[gradient].expired())
+        stale_gradients_[gradient] = gradients_[gradient].get();
     }
 
     void removeGradient(const PackedGradientRect* packed_gradient_rect) {
+      std::lock_guard<std::mutex> lock(mutex_);
       removeGradient(packed_gradient_rect->gradient);
     }
 
@@ -229,7 +237,9 @@ namespace visage {
     std::map<Gradient, std::unique_ptr<PackedGradientRect>> gradients_;
     std::map<Gradient, const PackedGradientRect*> stale_gradients_;
 
+    std::mutex mutex_;
     bool hdr_ = false;
+    int version_ = 0;
     PackedAtlasMap<const PackedGradientRect*> atlas_map_;
     std::unique_ptr<GradientAtlasTexture> texture_;
     std::shared_ptr<GradientAtlas*> reference_;
@@ -400,7 +410,12 @@ namespace visage {
                                            float right, float bottom) {
       GradientTexturePosition position = computeVertexGradientPositions(brush, offset_x, offset_y,
                                                                         left, top, right, bottom);
+      setVertexGradientPositions(position, vertices, num_vertices);
+    }
 
+    template<typename V>
+    static void setVertexGradientPositions(const GradientTexturePosition& position, V* vertices,
+                                           int num_vertices) {
       for (int i = 0; i < num_vertices; ++i) {
         vertices[i].gradient_color_from_x = position.gradient_color_from_x;
         vertices[i].gradient_color_from_y = position.gradient_color_y;
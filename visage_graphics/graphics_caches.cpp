@@ -22,6 +22,9 @@
 #include "graphics_caches.h"
 
 #include <bgfx/bgfx.h>
+#include <bx/hash.h>
+#include <chrono>
+#include <cstring>
 #include <map>
 
 namespace visage {
@@ -183,4 +186,416 @@ namespace visage {
     cache_->cache[name] = bgfx::createUniform(name, bgfx_type, size);
     return cache_->cache[name];
   }
-}
\ No newline at end of file
+
+  struct RenderTargetPoolMap {
+    struct Key {
+      static constexpr int kBytesPerPixel = 4;
+
+      int width = 0;
+      int height = 0;
+      int format = 0;
+
+      long long bytes() const { return static_cast<long long>(width) * height * kBytesPerPixel; }
+
+      bool operator<(const Key& other) const {
+        if (width != other.width)
+          return width < other.width;
+        if (height != other.height)
+          return height < other.height;
+        return format < other.format;
+      }
+    };
+
+    struct FreeTarget {
+      bgfx::FrameBufferHandle handle;
+      int released_frame = 0;
+    };
+
+    std::map<Key, std::vector<FreeTarget>> free;
+    std::map<uint16_t, Key> borrowed;
+    int frame = 0;
+  };
+
+  RenderTargetPool::RenderTargetPool() {
+    pool_ = std::make_unique<RenderTargetPoolMap>();
+  }
+
+  RenderTargetPool::~RenderTargetPool() {
+    for (const auto& targets : pool_->free) {
+      for (const auto& target : targets.second)
+        bgfx::destroy(target.handle);
+    }
+  }
+
+  bgfx::FrameBufferHandle RenderTargetPool::acquireTarget(int width, int height, int format) {
+    return instance()->acquire(width, height, format);
+  }
+
+  void RenderTargetPool::releaseTarget(bgfx::FrameBufferHandle& handle) {
+    instance()->release(handle);
+  }
+
+  bgfx::FrameBufferHandle RenderTargetPool::acquire(int width, int height, int format) {
+    static constexpr uint64_t kFrameBufferFlags = BGFX_TEXTURE_RT | BGFX_SAMPLER_U_CLAMP |
+                                                  BGFX_SAMPLER_V_CLAMP;
+
+    RenderTargetPoolMap::Key key = { width, height, format };
+    bgfx::FrameBufferHandle handle = BGFX_INVALID_HANDLE;
+    auto found = pool_->free.find(key);
+    if (found != pool_->free.end() && !found->second.empty()) {
+      handle = found->second.back().handle;
+      found->second.pop_back();
+      num_free_targets_--;
+      free_bytes_ -= key.bytes();
+    }
+    else {
+      handle = bgfx::createFrameBuffer(width, height, static_cast<bgfx::TextureFormat::Enum>(format),
+                                       kFrameBufferFlags);
+      if (!bgfx::isValid(handle))
+        return handle;
+      num_targets_++;
+      bytes_ += key.bytes();
+    }
+
+    pool_->borrowed[handle.idx] = key;
+    return handle;
+  }
+
+  void RenderTargetPool::release(bgfx::FrameBufferHandle& handle) {
+    if (!bgfx::isValid(handle))
+      return;
+
+    auto borrowed = pool_->borrowed.find(handle.idx);
+    VISAGE_ASSERT(borrowed != pool_->borrowed.end());
+    if (borrowed != pool_->borrowed.end()) {
+      pool_->free[borrowed->second].push_back({ handle, pool_->frame });
+      num_free_targets_++;
+      free_bytes_ += borrowed->second.bytes();
+      pool_->borrowed.erase(borrowed);
+    }
+    handle = BGFX_INVALID_HANDLE;
+  }
+
+  void RenderTargetPool::collect() {
+    pool_->frame++;
+    for (auto it = pool_->free.begin(); it != pool_->free.end();) {
+      std::vector<RenderTargetPoolMap::FreeTarget>& targets = it->second;
+      auto idle = std::remove_if(targets.begin(), targets.end(), [this](const auto& target) {
+        if (pool_->frame - target.released_frame <= kMaxIdleFrames)
+          return false;
+        bgfx::destroy(target.handle);
+        return true;
+      });
+      int removed = targets.end() - idle;
+      num_targets_ -= removed;
+      num_free_targets_ -= removed;
+      bytes_ -= removed * it->first.bytes();
+      free_bytes_ -= removed * it->first.bytes();
+      targets.erase(idle, targets.end());
+
+      if (targets.empty())
+        it = pool_->free.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  struct UnitQuadBufferHandles {
+    bgfx::VertexBufferHandle vertex_buffer = BGFX_INVALID_HANDLE;
+    bgfx::IndexBufferHandle index_buffer = BGFX_INVALID_HANDLE;
+  };
+
+  UnitQuadBuffers::UnitQuadBuffers() {
+    handles_ = std::make_unique<UnitQuadBufferHandles>();
+  }
+
+  UnitQuadBuffers::~UnitQuadBuffers() {
+    if (bgfx::isValid(handles_->vertex_buffer))
+      bgfx::destroy(handles_->vertex_buffer);
+    if (bgfx::isValid(handles_->index_buffer))
+      bgfx::destroy(handles_->index_buffer);
+  }
+
+  void UnitQuadBuffers::setBuffers() const {
+    static constexpr UnitQuadVertex kCorners[kVerticesPerQuad] = {
+      { -1.0f, -1.0f }, { 1.0f, -1.0f }, { -1.0f, 1.0f }, { 1.0f, 1.0f }
+    };
+
+    if (!bgfx::isValid(handles_->vertex_buffer)) {
+      handles_->vertex_buffer = bgfx::createVertexBuffer(bgfx::makeRef(kCorners, sizeof(kCorners)),
+                                                         UnitQuadVertex::layout());
+    }
+    if (!bgfx::isValid(handles_->index_buffer)) {
+      handles_->index_buffer = bgfx::createIndexBuffer(bgfx::makeRef(kQuadTriangles,
+                                                                     sizeof(kQuadTriangles)));
+    }
+
+    bgfx::setVertexBuffer(0, handles_->vertex_buffer);
+    bgfx::setIndexBuffer(handles_->index_buffer);
+  }
+
+  static constexpr uint32_t kProgramBinaryMagic = 0x43425056;
+  static constexpr char kProgramBinaryExtension[] = ".bin";
+
+  struct ProgramBinaryHeader {
+    uint32_t magic = kProgramBinaryMagic;
+    uint32_t version = ProgramBinaryCache::kVersion;
+    uint32_t api_version = BGFX_API_VERSION;
+    uint32_t size = 0;
+    uint64_t device_key = 0;
+    uint32_t checksum = 0;
+    uint32_t reserved = 0;
+  };
+
+  static uint32_t programBinaryChecksum(const void* data, uint32_t size) {
+    bx::HashMurmur2A murmur {};
+    murmur.begin();
+    murmur.add(data, size);
+    return murmur.end();
+  }
+
+  ProgramBinaryCache::ProgramBinaryCache() : directory_(defaultDirectory()) { }
+
+  File ProgramBinaryCache::defaultDirectory() {
+#if VISAGE_EMSCRIPTEN
+    return {};
+#else
+    // Per-user so other accounts can't plant binaries for the driver to load
+    File app_data = appDataDirectory();
+    if (app_data.empty() || !app_data.is_absolute())
+      return {};
+    return app_data / "visage" / "program_cache";
+#endif
+  }
+
+  void ProgramBinaryCache::setCacheDirectory(const File& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    directory_ = directory;
+    bytes_ = -1;
+    has_loaded_entry_ = false;
+    loaded_data_ = {};
+  }
+
+  File ProgramBinaryCache::cacheDirectory() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return directory_;
+  }
+
+  void ProgramBinaryCache::setCacheMaxBytes(long long max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = max_bytes;
+    trim(0);
+  }
+
+  void ProgramBinaryCache::setCacheDeviceKey(uint64_t device_key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    device_key_ = device_key;
+    has_loaded_entry_ = false;
+  }
+
+  uint32_t ProgramBinaryCache::entrySize(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!loadEntry(id)) {
+      stats_.misses++;
+      return 0;
+    }
+
+    stats_.hits++;
+    return loaded_data_.size();
+  }
+
+  bool ProgramBinaryCache::readEntry(uint64_t id, void* data, uint32_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((!has_loaded_entry_ || loaded_id_ != id) && !loadEntry(id))
+      return false;
+
+    has_loaded_entry_ = false;
+    bool matches = loaded_data_.size() == size;
+    if (matches)
+      std::memcpy(data, loaded_data_.data(), size);
+    loaded_data_ = {};
+    return matches;
+  }
+
+  void ProgramBinaryCache::writeEntry(uint64_t id, const void* data, uint32_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    long long entry_bytes = sizeof(ProgramBinaryHeader) + size;
+    if (directory_.empty() || entry_bytes > max_bytes_)
+      return;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error)
+      return;
+
+    File file = entryFile(id);
+    bool replacing = std::filesystem::exists(file, error);
+    trim(entry_bytes);
+
+    ProgramBinaryHeader header;
+    header.size = size;
+    header.device_key = device_key_;
+    header.checksum = programBinaryChecksum(data, size);
+    std::vector<char> entry(entry_bytes);
+    std::memcpy(entry.data(), &header, sizeof(header));
+    std::memcpy(entry.data() + sizeof(header), data, size);
+
+    // Written beside the entry and renamed so other processes never read a partial file
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    File temp_file = file;
+    temp_file += "." + std::to_string(stamp) + ".tmp";
+    if (!replaceFileWithData(temp_file, entry.data(), entry.size())) {
+      std::filesystem::remove(temp_file, error);
+      return;
+    }
+
+    std::filesystem::rename(temp_file, file, error);
+    if (error) {
+      std::filesystem::remove(temp_file, error);
+      return;
+    }
+
+    if (replacing)
+      bytes_ = -1;
+    else
+      bytes_ += entry_bytes;
+    stats_.writes++;
+  }
+
+  void ProgramBinaryCache::removeEntries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_loaded_entry_ = false;
+    loaded_data_ = {};
+    bytes_ = -1;
+    if (directory_.empty())
+      return;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+      if (entry.path().extension() == kProgramBinaryExtension)
+        std::filesystem::remove(entry.path(), error);
+    }
+  }
+
+  long long ProgramBinaryCache::totalBytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bytes_ = -1;
+    scanDirectory();
+    return bytes_;
+  }
+
+  ProgramBinaryCache::Stats ProgramBinaryCache::cacheStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+  static std::string programBinaryHex(uint64_t value) {
+    static constexpr char kHexDigits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; --i, value >>= 4)
+      hex[i] = kHexDigits[value & 0xf];
+    return hex;
+  }
+
+  File ProgramBinaryCache::entryFile(uint64_t id) const {
+    std::string name = programBinaryHex(device_key_) + "_" + programBinaryHex(id);
+    return directory_ / (name + kProgramBinaryExtension);
+  }
+
+  bool ProgramBinaryCache::loadEntry(uint64_t id) {
+    has_loaded_entry_ = false;
+    loaded_data_ = {};
+    if (directory_.empty())
+      return false;
+
+    File file = entryFile(id);
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(file, error))
+      return false;
+
+    int size = 0;
+    std::unique_ptr<char[]> data = loadFileData(file, size);
+    ProgramBinaryHeader header;
+    bool intact = data && size >= static_cast<int>(sizeof(header));
+    bool compatible = false;
+    if (intact) {
+      std::memcpy(&header, data.get(), sizeof(header));
+      const char* payload = data.get() + sizeof(header);
+      intact = header.magic == kProgramBinaryMagic && header.size == size - sizeof(header) &&
+               header.checksum == programBinaryChecksum(payload, header.size);
+      compatible = header.version == kVersion && header.api_version == BGFX_API_VERSION &&
+                   header.device_key == device_key_;
+    }
+
+    // Entries from another build may still be used by other processes, so those are left to
+    // the size limit. Only damaged entries are removed.
+    if (!intact || !compatible) {
+      stats_.rejected++;
+      if (!intact && std::filesystem::remove(file, error) && bytes_ >= 0)
+        bytes_ = std::max(0LL, bytes_ - size);
+      return false;
+    }
+
+    loaded_data_.assign(data.get() + sizeof(header), data.get() + size);
+    loaded_id_ = id;
+    has_loaded_entry_ = true;
+    std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), error);
+    return true;
+  }
+
+  void ProgramBinaryCache::scanDirectory() {
+    if (bytes_ >= 0)
+      return;
+
+    bytes_ = 0;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+      if (entry.path().extension() != kProgramBinaryExtension)
+        continue;
+
+      uintmax_t bytes = entry.file_size(error);
+      if (!error)
+        bytes_ += bytes;
+    }
+  }
+
+  void ProgramBinaryCache::trim(long long incoming_bytes) {
+    if (directory_.empty())
+      return;
+
+    scanDirectory();
+    if (bytes_ + incoming_bytes <= max_bytes_)
+      return;
+
+    struct Entry {
+      File file;
+      long long bytes = 0;
+      std::filesystem::file_time_type last_used;
+    };
+
+    std::vector<Entry> entries;
+    std::error_code error;
+    bytes_ = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+      if (entry.path().extension() != kProgramBinaryExtension)
+        continue;
+
+      uintmax_t bytes = entry.file_size(error);
+      if (error)
+        continue;
+
+      bytes_ += bytes;
+      entries.push_back({ entry.path(), static_cast<long long>(bytes),
+                          entry.last_write_time(error) });
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+    for (const Entry& entry : entries) {
+      if (bytes_ + incoming_bytes <= max_bytes_)
+        break;
+      if (std::filesystem::remove(entry.file, error))
+        bytes_ -= entry.bytes;
+    }
+  }
+}
@@ -23,11 +23,16 @@
 
 #include "graphics_utils.h"
 #include "visage_file_embed/embedded_file.h"
+#include "visage_utils/file_system.h"
+
+#include <mutex>
 
 namespace visage {
   struct ShaderCacheMap;
   struct ProgramCacheMap;
   struct UniformCacheMap;
+  struct RenderTargetPoolMap;
+  struct UnitQuadBufferHandles;
   struct EmbeddedFile;
 
   class ShaderCache {
@@ -148,4 +153,130 @@ namespace visage {
 
     std::unique_ptr<UniformCacheMap> cache_;
   };
-}
\ No newline at end of file
+
+  class RenderTargetPool {
+  public:
+    static constexpr int kMaxIdleFrames = 4;
+
+    static RenderTargetPool* instance() {
+      static RenderTargetPool pool;
+      return &pool;
+    }
+
+    static bgfx::FrameBufferHandle acquireTarget(int width, int height, int format);
+    static void releaseTarget(bgfx::FrameBufferHandle& handle);
+    static void releaseIdleTargets() { instance()->collect(); }
+    static int numTargets() { return instance()->num_targets_; }
+    static int numFreeTargets() { return instance()->num_free_targets_; }
+    static long long memoryBytes() { return instance()->bytes_; }
+    static long long freeMemoryBytes() { return instance()->free_bytes_; }
+
+  private:
+    RenderTargetPool();
+    ~RenderTargetPool();
+
+    bgfx::FrameBufferHandle acquire(int width, int height, int format);
+    void release(bgfx::FrameBufferHandle& handle);
+    void collect();
+
+    std::unique_ptr<RenderTargetPoolMap> pool_;
+    int num_targets_ = 0;
+    int num_free_targets_ = 0;
+    long long bytes_ = 0;
+    long long free_bytes_ = 0;
+  };
+
+  // Shared unit quad vertex and index buffers that instanced shape draws expand from.
+  class UnitQuadBuffers {
+  public:
+    static UnitQuadBuffers* instance() {
+      static UnitQuadBuffers buffers;
+      return &buffers;
+    }
+
+    static void bind() { instance()->setBuffers(); }
+
+  private:
+    UnitQuadBuffers();
+    ~UnitQuadBuffers();
+
+    void setBuffers() const;
+
+    std::unique_ptr<UnitQuadBufferHandles> handles_;
+  };
+
+  // Persists the program and pipeline binaries bgfx passes to CallbackI::cacheWrite so later
+  // launches, and plugin instances in new processes, skip driver compilation. Each entry is one
+  // file named after the device key and bgfx's hash, so devices sharing the directory never see
+  // each other's entries. Its header holds the format and bgfx API versions, the device key and
+  // a checksum. Damaged entries are deleted, entries from other versions are skipped, and least
+  // recently used entries are removed once the directory grows past the size limit.
+  class ProgramBinaryCache {
+  public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr long long kDefaultMaxBytes = 64 * 1024 * 1024;
+
+    struct Stats {
+      int hits = 0;
+      int misses = 0;
+      int writes = 0;
+      int rejected = 0;
+    };
+
+    static ProgramBinaryCache* instance() {
+      static ProgramBinaryCache cache;
+      return &cache;
+    }
+
+    // Inside the per-user appDataDirectory(), empty when that can't be found
+    static File defaultDirectory();
+
+    // An empty directory turns the cache off
+    static void setDirectory(const File& directory) { instance()->setCacheDirectory(directory); }
+    static File directory() { return instance()->cacheDirectory(); }
+    static void setMaxBytes(long long max_bytes) { instance()->setCacheMaxBytes(max_bytes); }
+    // Identifies the renderer and GPU, entries written for another device are not read
+    static void setDeviceKey(uint64_t device_key) { instance()->setCacheDeviceKey(device_key); }
+
+    static uint32_t readSize(uint64_t id) { return instance()->entrySize(id); }
+    static bool read(uint64_t id, void* data, uint32_t size) {
+      return instance()->readEntry(id, data, size);
+    }
+    static void write(uint64_t id, const void* data, uint32_t size) {
+      instance()->writeEntry(id, data, size);
+    }
+    static void clear() { instance()->removeEntries(); }
+    static long long bytes() { return instance()->totalBytes(); }
+    static Stats stats() { return instance()->cacheStats(); }
+
+  private:
+    ProgramBinaryCache();
+    ~ProgramBinaryCache() = default;
+
+    void setCacheDirectory(const File& directory);
+    File cacheDirectory();
+    void setCacheMaxBytes(long long max_bytes);
+    void setCacheDeviceKey(uint64_t device_key);
+    uint32_t entrySize(uint64_t id);
+    bool readEntry(uint64_t id, void* data, uint32_t size);
+    void writeEntry(uint64_t id, const void* data, uint32_t size);
+    void removeEntries();
+    long long totalBytes();
+    Stats cacheStats();
+
+    File entryFile(uint64_t id) const;
+    bool loadEntry(uint64_t id);
+    void scanDirectory();
+    void trim(long long incoming_bytes);
+
+    std::mutex mutex_;
+    File directory_;
+    long long max_bytes_ = kDefaultMaxBytes;
+    long long bytes_ = -1;
+    uint64_t device_key_ = 0;
+    uint64_t loaded_id_ = 0;
+    std::vector<char> loaded_data_;
+    bool has_loaded_entry_ = false;
+    Stats stats_;
+  };
+}
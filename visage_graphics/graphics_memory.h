@@ -0,0 +1,85 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace visage {
+  // Texture and render target memory in bytes. Atlases count their GPU texture along with any
+  // CPU copy kept to update it.
+  struct GraphicsMemory {
+    enum Subsystem {
+      kFonts,
+      kImages,
+      kGradients,
+      kLayers,
+      kPostEffects,
+      kRenderTargetPool,
+      kNumSubsystems
+    };
+
+    struct Atlas {
+      std::string name;
+      int width = 0;
+      int height = 0;
+      long long bytes = 0;
+    };
+
+    static const char* subsystemName(Subsystem subsystem) {
+      switch (subsystem) {
+      case kFonts: return "Fonts";
+      case kImages: return "Images";
+      case kGradients: return "Gradients";
+      case kLayers: return "Layers";
+      case kPostEffects: return "Post effects";
+      case kRenderTargetPool: return "Render target pool";
+      default: return "";
+      }
+    }
+
+    long long totalBytes() const {
+      long long total = 0;
+      for (long long subsystem_bytes : bytes)
+        total += subsystem_bytes;
+      return total;
+    }
+
+    void updatePeaks() {
+      for (int i = 0; i < kNumSubsystems; ++i)
+        peak_bytes[i] = std::max(peak_bytes[i], bytes[i]);
+      peak_total_bytes = std::max(peak_total_bytes, totalBytes());
+    }
+
+    void resetPeaks() {
+      for (int i = 0; i < kNumSubsystems; ++i)
+        peak_bytes[i] = bytes[i];
+      peak_total_bytes = totalBytes();
+    }
+
+    long long bytes[kNumSubsystems] {};
+    long long peak_bytes[kNumSubsystems] {};
+    long long peak_total_bytes = 0;
+    std::vector<Atlas> atlases;
+  };
+}
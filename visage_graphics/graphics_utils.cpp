@@ -21,12 +21,12 @@
 
 #include "graphics_utils.h"
 
+#include "visage_utils/thread_pool.h"
+
 #include <bgfx/bgfx.h>
+#include <mutex>
 #include <vector>
 
-#define STB_RECT_PACK_IMPLEMENTATION
-#include <stb/stb_rect_pack.h>
-
 #if VISAGE_EMSCRIPTEN
 #include <bx/hash.h>
 #include <emscripten/emscripten.h>
@@ -255,57 +255,235 @@ namespace visage {
 #endif
 
 namespace visage {
-  struct PackedAtlasData {
-    stbrp_context pack_context {};
-    std::unique_ptr<stbrp_node[]> pack_nodes;
-  };
-
-  AtlasPacker::AtlasPacker() : data_(std::make_unique<PackedAtlasData>()) { }
-
-  AtlasPacker::~AtlasPacker() = default;
-
   bool AtlasPacker::addRect(PackedRect& rect) {
-    if (!packed_)
+    int width = rect.w + padding_;
+    int height = rect.h + padding_;
+    int x = 0;
+    int y = 0;
+    if (!placeInFreeRect(width, height, height_, x, y) && !placeOnSkyline(width, height, x, y))
       return false;
 
-    stbrp_rect r;
-    r.w = rect.w + padding_;
-    r.h = rect.h + padding_;
-    r.id = rect_index_++;
+    rect.x = x;
+    rect.y = y;
+    return true;
+  }
 
-    packed_ = stbrp_pack_rects(&data_->pack_context, &r, 1);
-    if (packed_) {
-      rect.x = r.x;
-      rect.y = r.y;
-    }
-    return packed_;
+  void AtlasPacker::removeRect(const PackedRect& rect) {
+    addFreeRect({ rect.x, rect.y, rect.w + padding_, rect.h + padding_ });
   }
 
   void AtlasPacker::clear() {
     packed_ = false;
+    skyline_.clear();
+    free_rects_.clear();
+    width_ = 0;
+    height_ = 0;
+  }
+
+  void AtlasPacker::reset(int width, int height) {
+    width_ = width;
+    height_ = height;
+    skyline_ = { { 0, 0, width } };
+    free_rects_.clear();
+    packed_ = true;
   }
 
   bool AtlasPacker::pack(std::vector<PackedRect>& rects, int width, int height) {
-    data_->pack_nodes = std::make_unique<stbrp_node[]>(width);
-    std::vector<stbrp_rect> packed_rects;
-    rect_index_ = 0;
+    reset(width, height);
+    std::vector<int> order(rects.size());
+    for (int i = 0; i < order.size(); ++i)
+      order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&rects](int a, int b) {
+      return rects[a].h > rects[b].h || (rects[a].h == rects[b].h && rects[a].w > rects[b].w);
+    });
+
+    for (int index : order)
+      packed_ = packed_ && addRect(rects[index]);
+    return packed_;
+  }
+
+  void AtlasPacker::grow(int width, int height) {
+    VISAGE_ASSERT(width >= width_ && height >= height_);
+    if (width > width_) {
+      if (!skyline_.empty() && skyline_.back().y == 0)
+        skyline_.back().width += width - width_;
+      else
+        skyline_.push_back({ width_, 0, width - width_ });
+    }
+    width_ = width;
+    height_ = height;
+  }
+
+  bool AtlasPacker::relocate(PackedRect& rect) {
+    int x = 0;
+    int y = 0;
+    if (!placeInFreeRect(rect.w + padding_, rect.h + padding_, rect.y, x, y))
+      return false;
+
+    removeRect(rect);
+    rect.x = x;
+    rect.y = y;
+    return true;
+  }
+
+  void AtlasPacker::rebuildSkyline(const std::vector<PackedRect>& rects) {
+    std::vector<int> columns(width_, 0);
     for (const PackedRect& rect : rects) {
-      stbrp_rect r;
-      r.w = rect.w + padding_;
-      r.h = rect.h + padding_;
-      r.id = rect_index_++;
-      packed_rects.push_back(r);
+      int right = std::min(width_, rect.x + rect.w + padding_);
+      int bottom = rect.y + rect.h + padding_;
+      for (int x = rect.x; x < right; ++x)
+        columns[x] = std::max(columns[x], bottom);
     }
 
-    stbrp_init_target(&data_->pack_context, width, height, data_->pack_nodes.get(), width);
-    packed_ = stbrp_pack_rects(&data_->pack_context, packed_rects.data(), packed_rects.size());
-    if (packed_) {
-      for (int i = 0; i < packed_rects.size(); ++i) {
-        rects[i].x = packed_rects[i].x;
-        rects[i].y = packed_rects[i].y;
+    skyline_.clear();
+    for (int x = 0; x < width_; ++x) {
+      if (skyline_.empty() || skyline_.back().y != columns[x])
+        skyline_.push_back({ x, columns[x], 1 });
+      else
+        skyline_.back().width++;
+    }
+
+    std::vector<PackedRect> free_rects = std::move(free_rects_);
+    free_rects_.clear();
+    for (PackedRect& free_rect : free_rects) {
+      int bottom = free_rect.y + free_rect.h;
+      for (int x = free_rect.x; x < free_rect.x + free_rect.w; ++x)
+        bottom = std::min(bottom, columns[x]);
+
+      if (bottom > free_rect.y) {
+        free_rect.h = bottom - free_rect.y;
+        free_rects_.push_back(free_rect);
       }
     }
-    return packed_;
+  }
+
+  int64_t AtlasPacker::freeArea() const {
+    int64_t area = 0;
+    for (const PackedRect& rect : free_rects_)
+      area += static_cast<int64_t>(rect.w) * rect.h;
+    for (const Segment& segment : skyline_)
+      area += static_cast<int64_t>(segment.width) * (height_ - segment.y);
+    return area;
+  }
+
+  bool AtlasPacker::placeOnSkyline(int width, int height, int& x, int& y) {
+    int best_index = -1;
+    int best_y = height_;
+    for (int i = 0; i < skyline_.size(); ++i) {
+      int left = skyline_[i].x;
+      if (left + width > width_)
+        break;
+
+      int top = 0;
+      for (int j = i, remaining = width; remaining > 0; remaining -= skyline_[j].width, ++j)
+        top = std::max(top, skyline_[j].y);
+
+      if (top + height <= height_ && (best_index < 0 || top < best_y)) {
+        best_index = i;
+        best_y = top;
+      }
+    }
+
+    if (best_index < 0)
+      return false;
+
+    x = skyline_[best_index].x;
+    y = best_y;
+    int right = x + width;
+    for (int j = best_index; j < skyline_.size() && skyline_[j].x < right; ++j) {
+      const Segment& segment = skyline_[j];
+      int segment_right = std::min(right, segment.x + segment.width);
+      if (segment.y < y)
+        free_rects_.push_back({ segment.x, segment.y, segment_right - segment.x, y - segment.y });
+    }
+
+    skyline_.insert(skyline_.begin() + best_index, { x, y + height, width });
+    for (int j = best_index + 1; j < skyline_.size() && skyline_[j].x < right;) {
+      Segment& segment = skyline_[j];
+      int overlap = right - segment.x;
+      if (overlap >= segment.width)
+        skyline_.erase(skyline_.begin() + j);
+      else {
+        segment.x += overlap;
+        segment.width -= overlap;
+        break;
+      }
+    }
+
+    for (int j = 1; j < skyline_.size();) {
+      if (skyline_[j - 1].y == skyline_[j].y) {
+        skyline_[j - 1].width += skyline_[j].width;
+        skyline_.erase(skyline_.begin() + j);
+      }
+      else
+        ++j;
+    }
+    return true;
+  }
+
+  bool AtlasPacker::placeInFreeRect(int width, int height, int max_y, int& x, int& y) {
+    int best_index = -1;
+    int64_t best_waste = 0;
+    for (int i = 0; i < free_rects_.size(); ++i) {
+      const PackedRect& rect = free_rects_[i];
+      if (rect.w < width || rect.h < height || rect.y >= max_y)
+        continue;
+
+      int64_t waste = static_cast<int64_t>(rect.w) * rect.h - static_cast<int64_t>(width) * height;
+      if (best_index < 0 || waste < best_waste) {
+        best_index = i;
+        best_waste = waste;
+      }
+    }
+
+    if (best_index < 0)
+      return false;
+
+    PackedRect rect = free_rects_[best_index];
+    free_rects_[best_index] = free_rects_.back();
+    free_rects_.pop_back();
+
+    x = rect.x;
+    y = rect.y;
+    if (rect.w - width > rect.h - height) {
+      addFreeRect({ rect.x + width, rect.y, rect.w - width, rect.h });
+      addFreeRect({ rect.x, rect.y + height, width, rect.h - height });
+    }
+    else {
+      addFreeRect({ rect.x + width, rect.y, rect.w - width, height });
+      addFreeRect({ rect.x, rect.y + height, rect.w, rect.h - height });
+    }
+    return true;
+  }
+
+  void AtlasPacker::addFreeRect(const PackedRect& rect) {
+    if (rect.w <= 0 || rect.h <= 0)
+      return;
+
+    PackedRect merged = rect;
+    for (int i = 0; i < free_rects_.size();) {
+      const PackedRect& other = free_rects_[i];
+      bool same_columns = other.x == merged.x && other.w == merged.w;
+      bool same_rows = other.y == merged.y && other.h == merged.h;
+      if (same_columns && (other.y + other.h == merged.y || merged.y + merged.h == other.y)) {
+        merged.y = std::min(merged.y, other.y);
+        merged.h += other.h;
+      }
+      else if (same_rows && (other.x + other.w == merged.x || merged.x + merged.w == other.x)) {
+        merged.x = std::min(merged.x, other.x);
+        merged.w += other.w;
+      }
+      else {
+        ++i;
+        continue;
+      }
+
+      free_rects_[i] = free_rects_.back();
+      free_rects_.pop_back();
+      i = 0;
+    }
+    free_rects_.push_back(merged);
   }
 
   bgfx::VertexLayout& UvVertex::layout() {
@@ -377,6 +555,36 @@ namespace visage {
     return layout;
   }
 
+  bgfx::VertexLayout& ShapeInstance::layout() {
+    static bgfx::VertexLayout layout;
+    static bool initialized = false;
+
+    if (!initialized) {
+      initialized = true;
+      layout.begin()
+          .add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord5, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord4, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord3, 4, bgfx::AttribType::Float)
+          .end();
+    }
+
+    return layout;
+  }
+
+  bgfx::VertexLayout& UnitQuadVertex::layout() {
+    static bgfx::VertexLayout layout;
+    static bool initialized = false;
+
+    if (!initialized) {
+      initialized = true;
+      layout.begin().add(bgfx::Attrib::Position, 2, bgfx::AttribType::Float).end();
+    }
+
+    return layout;
+  }
+
   bgfx::VertexLayout& TextureVertex::layout() {
     static bgfx::VertexLayout layout;
     static bool initialized = false;
@@ -395,6 +603,44 @@ namespace visage {
     return layout;
   }
 
+  bgfx::VertexLayout& CompactComplexShapeVertex::layout() {
+    static bgfx::VertexLayout layout;
+    static bool initialized = false;
+
+    if (!initialized) {
+      initialized = true;
+      layout.begin()
+          .add(bgfx::Attrib::Position, 2, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Int16, true)
+          .add(bgfx::Attrib::Color1, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord0, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord1, 4, bgfx::AttribType::Int16, true)
+          .add(bgfx::Attrib::TexCoord2, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord3, 4, bgfx::AttribType::Float)
+          .end();
+    }
+
+    return layout;
+  }
+
+  bgfx::VertexLayout& CompactTextureVertex::layout() {
+    static bgfx::VertexLayout layout;
+    static bool initialized = false;
+
+    if (!initialized) {
+      initialized = true;
+      layout.begin()
+          .add(bgfx::Attrib::Position, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::Color0, 4, bgfx::AttribType::Int16, true)
+          .add(bgfx::Attrib::Color1, 4, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::TexCoord0, 4, bgfx::AttribType::Int16, true)
+          .add(bgfx::Attrib::TexCoord1, 4, bgfx::AttribType::Int16, true)
+          .end();
+    }
+
+    return layout;
+  }
+
   bgfx::VertexLayout& PostEffectVertex::layout() {
     static bgfx::VertexLayout layout;
     static bool initialized = false;
@@ -413,4 +659,42 @@ namespace visage {
 
     return layout;
   }
-}
\ No newline at end of file
+
+  static std::mutex& deferredCallsMutex() {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  static std::vector<std::function<void()>>& deferredCalls() {
+    static std::vector<std::function<void()>> calls;
+    return calls;
+  }
+
+  bool DeferredGraphicsCalls::shouldDefer() {
+    return ThreadPool::isWorkerThread();
+  }
+
+  void DeferredGraphicsCalls::run(std::function<void()> call) {
+    if (!shouldDefer()) {
+      call();
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(deferredCallsMutex());
+    deferredCalls().push_back(std::move(call));
+  }
+
+  void DeferredGraphicsCalls::flush() {
+    VISAGE_ASSERT(!shouldDefer());
+    std::vector<std::function<void()>> calls;
+    {
+      std::lock_guard<std::mutex> lock(deferredCallsMutex());
+      if (deferredCalls().empty())
+        return;
+      calls.swap(deferredCalls());
+    }
+
+    for (auto& call : calls)
+      call();
+  }
+}
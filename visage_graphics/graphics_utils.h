@@ -23,6 +23,9 @@
 
 #include "visage_utils/defines.h"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -61,12 +64,25 @@ namespace visage {
   bool preprocessWebGlShader(std::string& result, const std::string& code,
                              const std::string& utils_source, const std::string& varying_source);
 
+  // bgfx may only be called from the main thread. Atlas updates made while recording on ThreadPool
+  // workers are queued here and run by flush() on the main thread before the next submission.
+  class DeferredGraphicsCalls {
+  public:
+    static bool shouldDefer();
+    static void run(std::function<void()> call);
+    static void flush();
+
+    template<typename T>
+    static void release(std::unique_ptr<T> object) {
+      if (object && shouldDefer())
+        run([released = std::shared_ptr<T>(std::move(object))]() mutable { released.reset(); });
+    }
+  };
+
   const uint16_t kQuadTriangles[] = {
     0, 1, 2, 2, 1, 3,
   };
 
-  struct PackedAtlasData;
-
   struct PackedRect {
     int x;
     int y;
@@ -81,49 +97,116 @@ namespace visage {
     int bottom;
   };
 
+  // Skyline packer that never moves a rect once placed. Space freed by removed rects and space
+  // left under the skyline is kept in a free list and reused, and the atlas grows in place.
   class AtlasPacker {
   public:
-    AtlasPacker();
-    ~AtlasPacker();
-
     bool addRect(PackedRect& rect);
+    void removeRect(const PackedRect& rect);
     void clear();
     bool pack(std::vector<PackedRect>& rects, int width, int height);
+    void reset(int width, int height);
+    void grow(int width, int height);
+    // Moves rect into free space above its current position, returns false if there is none
+    bool relocate(PackedRect& rect);
+    // Lowers the skyline to the rects still in use after relocations
+    void rebuildSkyline(const std::vector<PackedRect>& rects);
+
     void setPadding(int padding) { padding_ = padding; }
     int padding() const { return padding_; }
-
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int64_t freeArea() const;
     bool packed() const { return packed_; }
 
   private:
-    std::unique_ptr<PackedAtlasData> data_;
+    struct Segment {
+      int x;
+      int y;
+      int width;
+    };
+
+    bool placeOnSkyline(int width, int height, int& x, int& y);
+    bool placeInFreeRect(int width, int height, int max_y, int& x, int& y);
+    void addFreeRect(const PackedRect& rect);
+
+    std::vector<Segment> skyline_;
+    std::vector<PackedRect> free_rects_;
     bool packed_ = false;
     int padding_ = 1;
-    int rect_index_ = 0;
+    int width_ = 0;
+    int height_ = 0;
   };
 
   template<typename T = int>
   class PackedAtlasMap {
   public:
+    static constexpr int kDefaultWidth = 64;
+    static constexpr int kMaxWidth = kDefaultWidth << 7;
+    static constexpr int kDefragmentCandidates = 8;
+
+    struct Relocation {
+      T id;
+      PackedRect from;
+      PackedRect to;
+    };
+
+    // Returns false if the atlas had to grow to fit the rect. Existing rects keep their place.
     bool addRect(T id, int width, int height) {
-      VISAGE_ASSERT(lookup_.count(id) == 0);
+      VISAGE_ASSERT(!hasId(id));
 
-      int index = packed_rects_.size();
-      lookup_[id] = index;
-      packed_rects_.push_back({ 0, 0, std::max(0, width), std::max(0, height) });
-      return packer_.addRect(packed_rects_.back());
+      int index = 0;
+      if (free_indices_.empty()) {
+        index = packed_rects_.size();
+        packed_rects_.push_back({});
+      }
+      else {
+        index = free_indices_.back();
+        free_indices_.pop_back();
+      }
+      lookup_.insert(findId(id), { id, index });
+
+      PackedRect& rect = packed_rects_[index];
+      rect = { 0, 0, std::max(0, width), std::max(0, height) };
+      if (width_ && packer_.addRect(rect))
+        return true;
+
+      if (width_ == 0) {
+        width_ = std::max(1, rect.w + packer_.padding());
+        height_ = std::max(1, rect.h + packer_.padding());
+        packer_.reset(width_, height_);
+      }
+
+      while (!packer_.addRect(rect)) {
+        if (width_ >= kMaxWidth && height_ >= kMaxWidth) {
+          VISAGE_ASSERT(false);
+          return false;
+        }
+
+        if (width_ <= height_)
+          width_ = std::min(kMaxWidth, std::max(kDefaultWidth, width_ * 2));
+        else
+          height_ = std::min(kMaxWidth, std::max(kDefaultWidth, height_ * 2));
+        packer_.grow(width_, height_);
+      }
+      return false;
     }
 
-    bool hasId(T id) const { return lookup_.count(id) > 0; }
+    bool hasId(T id) const {
+      auto found = findId(id);
+      return found != lookup_.end() && found->first == id;
+    }
 
     void removeRect(T id) {
-      VISAGE_ASSERT(lookup_.count(id) > 0);
-      lookup_.erase(id);
+      auto found = findId(id);
+      VISAGE_ASSERT(found != lookup_.end() && found->first == id);
+      packer_.removeRect(packed_rects_[found->second]);
+      free_indices_.push_back(found->second);
+      lookup_.erase(found);
     }
 
+    // Repacks every rect from scratch into the smallest square that fits
     void pack() {
-      static constexpr int kDefaultWidth = 64;
-      static constexpr int kMaxMultiples = 8;
-
       checkRemovedRects();
       bool packed = false;
       if (packed_rects_.size() == 1) {
@@ -132,8 +215,8 @@ namespace visage {
         packed = packer_.pack(packed_rects_, width_, height_);
       }
       else if (!packed_rects_.empty()) {
-        for (int m = 0; !packed && m < kMaxMultiples; ++m) {
-          width_ = height_ = kDefaultWidth << m;
+        for (int width = kDefaultWidth; !packed && width <= kMaxWidth; width *= 2) {
+          width_ = height_ = width;
           packed = packer_.pack(packed_rects_, width_, height_);
         }
       }
@@ -141,10 +224,46 @@ namespace visage {
       VISAGE_ASSERT(packed);
     }
 
+    // Moves up to max_moves rects from the bottom of the atlas into freed space higher up. The
+    // caller copies each relocated rect's contents from the old position to the new one.
+    std::vector<Relocation> defragment(int max_moves) {
+      std::vector<Relocation> relocations;
+      if (lookup_.empty() || packer_.freeArea() * 4 < static_cast<int64_t>(width_) * height_)
+        return relocations;
+
+      std::vector<std::pair<T, int>> candidates = lookup_;
+      int num_candidates = std::min<int>(candidates.size(), max_moves * kDefragmentCandidates);
+      std::partial_sort(candidates.begin(), candidates.begin() + num_candidates, candidates.end(),
+                        [this](const std::pair<T, int>& a, const std::pair<T, int>& b) {
+                          const PackedRect& rect_a = packed_rects_[a.second];
+                          const PackedRect& rect_b = packed_rects_[b.second];
+                          return rect_a.y + rect_a.h > rect_b.y + rect_b.h;
+                        });
+
+      for (int i = 0; i < num_candidates && relocations.size() < max_moves; ++i) {
+        PackedRect& rect = packed_rects_[candidates[i].second];
+        PackedRect from = rect;
+        if (packer_.relocate(rect))
+          relocations.push_back({ candidates[i].first, from, rect });
+      }
+
+      if (!relocations.empty()) {
+        std::vector<PackedRect> rects;
+        rects.reserve(lookup_.size());
+        for (const auto& entry : lookup_)
+          rects.push_back(packed_rects_[entry.second]);
+        packer_.rebuildSkyline(rects);
+      }
+      return relocations;
+    }
+
     void clear() {
       lookup_.clear();
+      free_indices_.clear();
       packer_.clear();
       packed_rects_.clear();
+      width_ = 0;
+      height_ = 0;
     }
 
     void setPadding(int padding) { packer_.setPadding(padding); }
@@ -167,40 +286,52 @@ namespace visage {
       return result;
     }
 
-    const PackedRect& rectForId(T id) const {
-      VISAGE_ASSERT(lookup_.count(id) > 0);
-      return rectAtIndex(lookup_.at(id));
-    }
+    const PackedRect& rectForId(T id) const { return rectAtIndex(indexForId(id)); }
 
     TextureRect texturePositionsForId(T id, bool bottom_left_origin = false) const {
-      VISAGE_ASSERT(lookup_.count(id) > 0);
-      return texturePositionsForIndex(lookup_.at(id), bottom_left_origin);
+      return texturePositionsForIndex(indexForId(id), bottom_left_origin);
     }
 
     int width() const { return width_; }
     int height() const { return height_; }
     bool packed() const { return packer_.packed(); }
-    int numRects() const { return packed_rects_.size(); }
+    int numRects() const { return lookup_.size(); }
 
   private:
+    typename std::vector<std::pair<T, int>>::const_iterator findId(T id) const {
+      return std::lower_bound(lookup_.begin(), lookup_.end(), id,
+                              [](const std::pair<T, int>& entry, T value) {
+                                return std::less<T>()(entry.first, value);
+                              });
+    }
+
+    int indexForId(T id) const {
+      auto found = findId(id);
+      VISAGE_ASSERT(found != lookup_.end() && found->first == id);
+      return found->second;
+    }
+
     void checkRemovedRects() {
-      if (packed_rects_.size() == lookup_.size())
+      if (free_indices_.empty())
         return;
 
       std::vector<PackedRect> old_rects = std::move(packed_rects_);
+      packed_rects_.clear();
       packed_rects_.reserve(lookup_.size());
-      for (auto& packed : lookup_) {
+      for (auto& entry : lookup_) {
         int index = packed_rects_.size();
-        packed_rects_.push_back(old_rects[packed.second]);
-        packed.second = index;
+        packed_rects_.push_back(old_rects[entry.second]);
+        entry.second = index;
       }
+      free_indices_.clear();
     }
 
     int width_ = 0;
     int height_ = 0;
     std::vector<PackedRect> packed_rects_;
+    std::vector<int> free_indices_;
     AtlasPacker packer_;
-    std::map<T, int> lookup_;
+    std::vector<std::pair<T, int>> lookup_;
   };
 
   struct UvVertex {
@@ -279,6 +410,54 @@ namespace visage {
     static bgfx::VertexLayout& layout();
   };
 
+  // Per shape data for the instanced ShapeVertex pipeline, corners are expanded in the vertex
+  // shader from a shared unit quad.
+  struct ShapeInstance {
+    ShapeInstance() = default;
+    explicit ShapeInstance(const ShapeVertex& vertex) :
+        x(vertex.x), y(vertex.y), dimension_x(vertex.dimension_x), dimension_y(vertex.dimension_y),
+        gradient_color_from_x(vertex.gradient_color_from_x),
+        gradient_color_from_y(vertex.gradient_color_from_y),
+        gradient_color_to_x(vertex.gradient_color_to_x), gradient_color_to_y(vertex.gradient_color_to_y),
+        gradient_position_from_x(vertex.gradient_position_from_x),
+        gradient_position_from_y(vertex.gradient_position_from_y),
+        gradient_position_to_x(vertex.gradient_position_to_x),
+        gradient_position_to_y(vertex.gradient_position_to_y), clamp_left(vertex.clamp_left),
+        clamp_top(vertex.clamp_top), clamp_right(vertex.clamp_right),
+        clamp_bottom(vertex.clamp_bottom), thickness(vertex.thickness), fade(vertex.fade),
+        value_1(vertex.value_1), value_2(vertex.value_2) { }
+
+    float x;
+    float y;
+    float dimension_x;
+    float dimension_y;
+    float gradient_color_from_x;
+    float gradient_color_from_y;
+    float gradient_color_to_x;
+    float gradient_color_to_y;
+    float gradient_position_from_x;
+    float gradient_position_from_y;
+    float gradient_position_to_x;
+    float gradient_position_to_y;
+    float clamp_left;
+    float clamp_top;
+    float clamp_right;
+    float clamp_bottom;
+    float thickness;
+    float fade;
+    float value_1;
+    float value_2;
+
+    static bgfx::VertexLayout& layout();
+  };
+
+  struct UnitQuadVertex {
+    float coordinate_x;
+    float coordinate_y;
+
+    static bgfx::VertexLayout& layout();
+  };
+
   struct TextureVertex {
     float x;
     float y;
@@ -304,6 +483,130 @@ namespace visage {
     static bgfx::VertexLayout& layout();
   };
 
+  // Compact vertices store clamp bounds and texture positions as whole pixels in normalized int16
+  // attributes. The compact shader variants scale them back up by this range.
+  static constexpr float kCompactPixelRange = 32767.0f;
+
+  inline int16_t compactNormalized(float value) {
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * kCompactPixelRange));
+  }
+
+  inline int16_t compactPixels(float value) {
+    float clamped = std::clamp(value, -kCompactPixelRange, kCompactPixelRange);
+    return static_cast<int16_t>(std::lround(clamped));
+  }
+
+  // ComplexShapeVertex with gradient atlas positions and clamp bounds packed into int16
+  struct CompactComplexShapeVertex {
+    CompactComplexShapeVertex() = default;
+    explicit CompactComplexShapeVertex(const ComplexShapeVertex& vertex) :
+        x(vertex.x), y(vertex.y),
+        gradient_color_from_x(compactNormalized(vertex.gradient_color_from_x)),
+        gradient_color_from_y(compactNormalized(vertex.gradient_color_from_y)),
+        gradient_color_to_x(compactNormalized(vertex.gradient_color_to_x)),
+        gradient_color_to_y(compactNormalized(vertex.gradient_color_to_y)),
+        gradient_position_from_x(vertex.gradient_position_from_x),
+        gradient_position_from_y(vertex.gradient_position_from_y),
+        gradient_position_to_x(vertex.gradient_position_to_x),
+        gradient_position_to_y(vertex.gradient_position_to_y), coordinate_x(vertex.coordinate_x),
+        coordinate_y(vertex.coordinate_y), dimension_x(vertex.dimension_x),
+        dimension_y(vertex.dimension_y), clamp_left(compactPixels(vertex.clamp_left)),
+        clamp_top(compactPixels(vertex.clamp_top)), clamp_right(compactPixels(vertex.clamp_right)),
+        clamp_bottom(compactPixels(vertex.clamp_bottom)), thickness(vertex.thickness),
+        fade(vertex.fade), value_1(vertex.value_1), value_2(vertex.value_2),
+        value_3(vertex.value_3), value_4(vertex.value_4), value_5(vertex.value_5),
+        value_6(vertex.value_6) { }
+
+    float x;
+    float y;
+    int16_t gradient_color_from_x;
+    int16_t gradient_color_from_y;
+    int16_t gradient_color_to_x;
+    int16_t gradient_color_to_y;
+    float gradient_position_from_x;
+    float gradient_position_from_y;
+    float gradient_position_to_x;
+    float gradient_position_to_y;
+    float coordinate_x;
+    float coordinate_y;
+    float dimension_x;
+    float dimension_y;
+    int16_t clamp_left;
+    int16_t clamp_top;
+    int16_t clamp_right;
+    int16_t clamp_bottom;
+    float thickness;
+    float fade;
+    float value_1;
+    float value_2;
+    float value_3;
+    float value_4;
+    float value_5;
+    float value_6;
+
+    static bgfx::VertexLayout& layout();
+  };
+
+  // TextureVertex with gradient atlas positions, texture positions, direction and clamp bounds
+  // packed into int16. Direction is normalized so fractional texel scales survive.
+  struct CompactTextureVertex {
+    CompactTextureVertex() = default;
+    explicit CompactTextureVertex(const TextureVertex& vertex) :
+        x(vertex.x), y(vertex.y), dimension_x(vertex.dimension_x), dimension_y(vertex.dimension_y),
+        gradient_color_from_x(compactNormalized(vertex.gradient_color_from_x)),
+        gradient_color_from_y(compactNormalized(vertex.gradient_color_from_y)),
+        gradient_color_to_x(compactNormalized(vertex.gradient_color_to_x)),
+        gradient_color_to_y(compactNormalized(vertex.gradient_color_to_y)),
+        gradient_position_from_x(vertex.gradient_position_from_x),
+        gradient_position_from_y(vertex.gradient_position_from_y),
+        gradient_position_to_x(vertex.gradient_position_to_x),
+        gradient_position_to_y(vertex.gradient_position_to_y),
+        texture_x(compactPixels(vertex.texture_x)), texture_y(compactPixels(vertex.texture_y)),
+        direction_x(compactNormalized(vertex.direction_x)),
+        direction_y(compactNormalized(vertex.direction_y)),
+        clamp_left(compactPixels(vertex.clamp_left)), clamp_top(compactPixels(vertex.clamp_top)),
+        clamp_right(compactPixels(vertex.clamp_right)),
+        clamp_bottom(compactPixels(vertex.clamp_bottom)) { }
+
+    float x;
+    float y;
+    float dimension_x;
+    float dimension_y;
+    int16_t gradient_color_from_x;
+    int16_t gradient_color_from_y;
+    int16_t gradient_color_to_x;
+    int16_t gradient_color_to_y;
+    float gradient_position_from_x;
+    float gradient_position_from_y;
+    float gradient_position_to_x;
+    float gradient_position_to_y;
+    int16_t texture_x;
+    int16_t texture_y;
+    int16_t direction_x;
+    int16_t direction_y;
+    int16_t clamp_left;
+    int16_t clamp_top;
+    int16_t clamp_right;
+    int16_t clamp_bottom;
+
+    static bgfx::VertexLayout& layout();
+  };
+
+  template<typename V>
+  struct CompactVertex {
+    using Type = void;
+  };
+
+  template<>
+  struct CompactVertex<ComplexShapeVertex> {
+    using Type = CompactComplexShapeVertex;
+  };
+
+  template<>
+  struct CompactVertex<TextureVertex> {
+    using Type = CompactTextureVertex;
+  };
+
   struct PostEffectVertex {
     float x;
     float y;
@@ -21,55 +21,167 @@
 
 #include "image.h"
 
+#include "visage_utils/space.h"
+#include "visage_utils/thread_pool.h"
+#include "visage_utils/thread_utils.h"
+
 #include <bgfx/bgfx.h>
 #include <bimg/decode.h>
 #include <bx/allocator.h>
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <nanosvg/src/nanosvg.h>
 #include <nanosvg/src/nanosvgrast.h>
 
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include <stb_image_resize2.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VISAGE_IMAGE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VISAGE_IMAGE_NEON 1
+#endif
+
 namespace visage {
   static bx::DefaultAllocator* allocator() {
     static bx::DefaultAllocator allocator;
     return &allocator;
   }
 
-  static void boxBlur(unsigned char* dest, unsigned char* cache, int width, int blur_radius, int stride) {
-    for (int i = 0; i < blur_radius; ++i)
-      cache[i] = 0;
+  // Running sum of the four channels of a pixel for box blurring.
+  class PixelSum {
+  public:
+#if VISAGE_IMAGE_SSE2
+    void add(const unsigned char* pixel) { value_ = _mm_add_epi32(value_, load(pixel)); }
+    void subtract(const unsigned char* pixel) { value_ = _mm_sub_epi32(value_, load(pixel)); }
+
+    void storeAverage(unsigned char* dest, float scale) const {
+      __m128 average = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(value_), _mm_set1_ps(0.5f)),
+                                  _mm_set1_ps(scale));
+      __m128i result = _mm_cvttps_epi32(average);
+      result = _mm_packs_epi32(result, result);
+      result = _mm_packus_epi16(result, result);
+      int packed = _mm_cvtsi128_si32(result);
+      std::memcpy(dest, &packed, sizeof(packed));
+    }
+
+  private:
+    static __m128i load(const unsigned char* pixel) {
+      int packed = 0;
+      std::memcpy(&packed, pixel, sizeof(packed));
+      __m128i zero = _mm_setzero_si128();
+      __m128i bytes = _mm_cvtsi32_si128(packed);
+      return _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, zero), zero);
+    }
+
+    __m128i value_ = _mm_setzero_si128();
+#elif VISAGE_IMAGE_NEON
+    void add(const unsigned char* pixel) { value_ = vaddq_s32(value_, load(pixel)); }
+    void subtract(const unsigned char* pixel) { value_ = vsubq_s32(value_, load(pixel)); }
+
+    void storeAverage(unsigned char* dest, float scale) const {
+      float32x4_t average = vmulq_n_f32(vaddq_f32(vcvtq_f32_s32(value_), vdupq_n_f32(0.5f)), scale);
+      uint16x4_t narrow = vqmovun_s32(vcvtq_s32_f32(average));
+      uint8x8_t bytes = vqmovn_u16(vcombine_u16(narrow, narrow));
+      uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+      std::memcpy(dest, &packed, sizeof(packed));
+    }
+
+  private:
+    static int32x4_t load(const unsigned char* pixel) {
+      uint32_t packed = 0;
+      std::memcpy(&packed, pixel, sizeof(packed));
+      uint16x8_t wide = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(packed)));
+      return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(wide)));
+    }
 
-    int value = 0;
-    int sample_index = 0;
-    int write_index = 0;
-    for (; sample_index < blur_radius / 2; ++sample_index) {
-      cache[sample_index] = dest[sample_index * stride];
-      value += cache[sample_index];
+    int32x4_t value_ = vdupq_n_s32(0);
+#else
+    void add(const unsigned char* pixel) {
+      for (int i = 0; i < ImageAtlas::kChannels; ++i)
+        value_[i] += pixel[i];
     }
 
-    for (; sample_index < width - blur_radius / 2; ++sample_index) {
-      int cache_index = sample_index % blur_radius;
-      int cached = cache[cache_index];
-      int sample = dest[sample_index * stride];
-      cache[cache_index] = sample;
-      value += sample - cached;
-      dest[write_index * stride] = value / blur_radius;
-      write_index++;
+    void subtract(const unsigned char* pixel) {
+      for (int i = 0; i < ImageAtlas::kChannels; ++i)
+        value_[i] -= pixel[i];
     }
 
-    for (; sample_index < width; ++sample_index) {
-      value -= cache[sample_index % blur_radius];
-      dest[write_index * stride] = value / blur_radius;
-      write_index++;
+    void storeAverage(unsigned char* dest, float scale) const {
+      for (int i = 0; i < ImageAtlas::kChannels; ++i)
+        dest[i] = static_cast<int>((value_[i] + 0.5f) * scale);
+    }
+
+  private:
+    int value_[ImageAtlas::kChannels] {};
+#endif
+  };
+
+  // Centered box blur with zero padding outside the image, all channels of a row at once.
+  static void boxBlurRow(unsigned char* row, unsigned char* scratch, int width, int radius) {
+    static constexpr int kChannels = ImageAtlas::kChannels;
+
+    int half = radius / 2;
+    float scale = 1.0f / radius;
+    std::memcpy(scratch, row, width * kChannels);
+
+    PixelSum sum;
+    for (int i = 0; i < std::min(half, width); ++i)
+      sum.add(scratch + i * kChannels);
+
+    for (int i = 0; i < width; ++i) {
+      if (i + half < width)
+        sum.add(scratch + (i + half) * kChannels);
+      if (i - half > 0)
+        sum.subtract(scratch + (i - half - 1) * kChannels);
+      sum.storeAverage(row + i * kChannels, scale);
+    }
+  }
+
+  // Same blur down the columns, walking whole rows so memory is read in order.
+  static void boxBlurColumns(unsigned char* data, unsigned char* scratch, PixelSum* sums,
+                             int width, int height, int radius) {
+    static constexpr int kChannels = ImageAtlas::kChannels;
+
+    int half = radius / 2;
+    float scale = 1.0f / radius;
+    int row_size = width * kChannels;
+    std::memcpy(scratch, data, row_size * height);
+
+    for (int x = 0; x < width; ++x)
+      sums[x] = PixelSum();
+
+    auto add_row = [&](int y) {
+      for (int x = 0; x < width; ++x)
+        sums[x].add(scratch + y * row_size + x * kChannels);
+    };
+
+    for (int y = 0; y < std::min(half, height); ++y)
+      add_row(y);
+
+    for (int y = 0; y < height; ++y) {
+      if (y + half < height)
+        add_row(y + half);
+      if (y - half > 0) {
+        const unsigned char* remove = scratch + (y - half - 1) * row_size;
+        for (int x = 0; x < width; ++x)
+          sums[x].subtract(remove + x * kChannels);
+      }
+
+      unsigned char* row = data + y * row_size;
+      for (int x = 0; x < width; ++x)
+        sums[x].storeAverage(row + x * kChannels, scale);
     }
   }
 
   class SvgRasterizer {
   public:
+    // nanosvg rasterizers keep scratch state, so each decoding thread gets its own
     static SvgRasterizer& instance() {
-      static SvgRasterizer instance;
+      static thread_local SvgRasterizer instance;
       return instance;
     }
 
@@ -102,9 +214,127 @@ namespace visage {
     NSVGrasterizer* rasterizer_ = nullptr;
   };
 
+  static std::unique_ptr<unsigned char[]> decodeImage(const ImageFile& image, int width,
+                                                      int height) {
+    if (width == 0 && image.svg)
+      return nullptr;
+
+    if (image.svg) {
+      std::unique_ptr<unsigned char[]> data = SvgRasterizer::instance().rasterize(image);
+
+      if (image.blur_radius)
+        ImageAtlas::blurImage(data.get(), image.width, image.height, image.blur_radius);
+      return data;
+    }
+
+    bimg::ImageContainer* image_container = bimg::imageParse(allocator(), image.data,
+                                                             image.data_size, bimg::TextureFormat::RGBA8);
+    if (image_container == nullptr)
+      return nullptr;
+
+    int size = width * height * ImageAtlas::kChannels;
+    std::unique_ptr<unsigned char[]> result = std::make_unique<unsigned char[]>(size);
+    unsigned char* image_data = static_cast<unsigned char*>(image_container->m_data);
+    if (image_container->m_width == width && image_container->m_height == height)
+      std::memcpy(result.get(), image_data, size);
+    else {
+      stbir_resize_uint8_srgb(image_data, image_container->m_width, image_container->m_height,
+                              image_container->m_width * ImageAtlas::kChannels, result.get(), width,
+                              height, width * ImageAtlas::kChannels, STBIR_BGRA);
+    }
+    bimg::imageFree(image_container);
+    return result;
+  }
+
+  struct ImageDecodeBatch {
+    struct Tile {
+      ImageFile image;
+      int width = 0;
+      int height = 0;
+      std::unique_ptr<unsigned char[]> data;
+    };
+
+    std::vector<Tile> tiles;
+    std::atomic<bool> done = false;
+  };
+
+  // Background thread that decodes and rasterizes batches of images across a ThreadPool so the
+  // main thread never waits on image files.
+  class ImageDecoder : public Thread {
+  public:
+    static ImageDecoder& instance() {
+      static ImageDecoder instance;
+      return instance;
+    }
+
+    ~ImageDecoder() override {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      condition_.notify_all();
+      stop();
+    }
+
+    void decode(std::shared_ptr<ImageDecodeBatch> batch) {
+#if VISAGE_EMSCRIPTEN
+      decodeBatch(*batch);
+#else
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(batch));
+      }
+      condition_.notify_one();
+      if (!running())
+        start();
+#endif
+    }
+
+    void run() override {
+      while (true) {
+        std::shared_ptr<ImageDecodeBatch> batch;
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          condition_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+          if (stop_)
+            return;
+
+          batch = std::move(queue_.front());
+          queue_.pop_front();
+        }
+        decodeBatch(*batch);
+      }
+    }
+
+  private:
+    ImageDecoder() : Thread("Image Decoder") { }
+
+    void decodeBatch(ImageDecodeBatch& batch) {
+      auto decode_tile = [&batch](int index, int) {
+        ImageDecodeBatch::Tile& tile = batch.tiles[index];
+        tile.data = decodeImage(tile.image, tile.width, tile.height);
+      };
+
+      if (pool_ == nullptr)
+        pool_ = std::make_unique<ThreadPool>();
+      pool_->parallelFor(batch.tiles.size(), decode_tile);
+      batch.done = true;
+    }
+
+    std::unique_ptr<ThreadPool> pool_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::shared_ptr<ImageDecodeBatch>> queue_;
+    bool stop_ = false;
+  };
+
+  // CPU copy of the atlas texture. Decoded images are written here and the changed area is
+  // uploaded in one update per frame. Images that are still decoding stay transparent.
   class ImageAtlasTexture {
   public:
-    explicit ImageAtlasTexture(int width, int height) : width_(width), height_(height) { }
+    explicit ImageAtlasTexture(int width, int height) :
+        width_(width), height_(height),
+        pixels_(std::make_unique<unsigned char[]>(width * height * ImageAtlas::kChannels)) { }
 
     ~ImageAtlasTexture() { destroyHandle(); }
 
@@ -115,24 +345,78 @@ namespace visage {
       texture_handle_ = BGFX_INVALID_HANDLE;
     }
 
-    bool hasHandle() const { return bgfx::isValid(texture_handle_); }
-
     bgfx::TextureHandle& handle() { return texture_handle_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    long long memoryBytes() const {
+      long long bytes = static_cast<long long>(width_) * height_ * ImageAtlas::kChannels;
+      return bgfx::isValid(texture_handle_) ? 2 * bytes : bytes;
+    }
 
-    void checkHandle() {
-      if (!bgfx::isValid(texture_handle_))
-        texture_handle_ = bgfx::createTexture2D(width_, height_, false, 1, bgfx::TextureFormat::RGBA8);
+    void writeImage(const unsigned char* data, int x, int y, int width, int height) {
+      int row_size = width * ImageAtlas::kChannels;
+      for (int r = 0; r < height; ++r)
+        std::memcpy(pixel(x, y + r), data + r * row_size, row_size);
+      addDirtyRect(x, y, width, height);
     }
 
-    void updateTexture(const unsigned char* data, int x, int y, int width, int height) {
-      VISAGE_ASSERT(bgfx::isValid(texture_handle_));
-      bgfx::updateTexture2D(texture_handle_, 0, 0, x, y, width, height,
-                            bgfx::copy(data, width * height * ImageAtlas::kChannels));
+    void copyImage(const ImageAtlasTexture& source, int source_x, int source_y, int x, int y,
+                   int width, int height) {
+      for (int r = 0; r < height; ++r) {
+        std::memcpy(pixel(x, y + r), source.pixel(source_x, source_y + r),
+                    width * ImageAtlas::kChannels);
+      }
+      addDirtyRect(x, y, width, height);
+    }
+
+    void clearImage(int x, int y, int width, int height) {
+      for (int r = 0; r < height; ++r)
+        std::memset(pixel(x, y + r), 0, width * ImageAtlas::kChannels);
+      addDirtyRect(x, y, width, height);
+    }
+
+    void upload() {
+      if (!bgfx::isValid(texture_handle_)) {
+        texture_handle_ = bgfx::createTexture2D(width_, height_, false, 1,
+                                                bgfx::TextureFormat::RGBA8);
+        dirty_ = { 0, 0, width_, height_ };
+      }
+
+      if (!dirty_.hasArea())
+        return;
+
+      int row_size = dirty_.width() * ImageAtlas::kChannels;
+      const bgfx::Memory* memory = bgfx::alloc(row_size * dirty_.height());
+      for (int r = 0; r < dirty_.height(); ++r)
+        std::memcpy(memory->data + r * row_size, pixel(dirty_.x(), dirty_.y() + r), row_size);
+
+      bgfx::updateTexture2D(texture_handle_, 0, 0, dirty_.x(), dirty_.y(), dirty_.width(),
+                            dirty_.height(), memory);
+      dirty_ = {};
     }
 
   private:
+    unsigned char* pixel(int x, int y) const {
+      return pixels_.get() + (y * width_ + x) * ImageAtlas::kChannels;
+    }
+
+    void addDirtyRect(int x, int y, int width, int height) {
+      if (!dirty_.hasArea()) {
+        dirty_ = { x, y, width, height };
+        return;
+      }
+
+      int left = std::min(dirty_.x(), x);
+      int top = std::min(dirty_.y(), y);
+      int right = std::max(dirty_.right(), x + width);
+      int bottom = std::max(dirty_.bottom(), y + height);
+      dirty_ = { left, top, right - left, bottom - top };
+    }
+
     int width_ = 0;
     int height_ = 0;
+    std::unique_ptr<unsigned char[]> pixels_;
+    IBounds dirty_;
     bgfx::TextureHandle texture_handle_ = BGFX_INVALID_HANDLE;
   };
 
@@ -142,20 +426,16 @@ namespace visage {
     int radius = std::min(blur_radius, width - 1);
     radius = radius + ((radius + 1) % 2);
 
-    std::unique_ptr<unsigned char[]> cache = std::make_unique<unsigned char[]>(radius);
-
+    std::unique_ptr<unsigned char[]> scratch = std::make_unique<unsigned char[]>(width * height *
+                                                                                 kChannels);
     for (int r = 0; r < height; ++r) {
-      for (int channel = 0; channel < ImageAtlas::kChannels; ++channel) {
-        for (int i = 0; i < kBoxBlurIterations; ++i)
-          boxBlur(location + r * width * ImageAtlas::kChannels + channel, cache.get(), width,
-                  radius, ImageAtlas::kChannels);
-      }
-    }
-
-    for (int c = 0; c < width * ImageAtlas::kChannels; ++c) {
       for (int i = 0; i < kBoxBlurIterations; ++i)
-        boxBlur(location + c, cache.get(), height, radius, width * ImageAtlas::kChannels);
+        boxBlurRow(location + r * width * kChannels, scratch.get(), width, radius);
     }
+
+    std::unique_ptr<PixelSum[]> sums = std::make_unique<PixelSum[]>(width);
+    for (int i = 0; i < kBoxBlurIterations; ++i)
+      boxBlurColumns(location, scratch.get(), sums.get(), width, height, radius);
   }
 
   ImageAtlas::PackedImageReference::~PackedImageReference() {
@@ -171,6 +451,7 @@ namespace visage {
   ImageAtlas::~ImageAtlas() = default;
 
   ImageAtlas::PackedImage ImageAtlas::addImage(const ImageFile& image) {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (images_.count(image) == 0) {
       int width = image.width;
       int height = image.height;
@@ -188,7 +469,7 @@ namespace visage {
         resize();
 
       loadImageRect(packed_image_rect.get());
-      updateImage(packed_image_rect.get());
+      pending_decodes_.push_back(image);
       images_[image] = std::move(packed_image_rect);
     }
     stale_images_.erase(image);
@@ -202,12 +483,94 @@ namespace visage {
   }
 
   void ImageAtlas::resize() {
-    clearStaleImages();
+    auto texture = std::make_unique<ImageAtlasTexture>(atlas_map_.width(), atlas_map_.height());
+    if (texture_)
+      texture->copyImage(*texture_, 0, 0, 0, 0, texture_->width(), texture_->height());
+
+    DeferredGraphicsCalls::release(std::move(texture_));
+    texture_ = std::move(texture);
+  }
+
+  void ImageAtlas::clearStaleImages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stale_images_.empty())
+      return;
+
+    std::vector<std::pair<long long, ImageFile>> stale;
+    stale.reserve(stale_images_.size());
+    for (const auto& image : stale_images_)
+      stale.emplace_back(image.second.order, image.first);
+    std::sort(stale.begin(), stale.end());
+
+    long long bytes = memory_budget_ ? packedBytes() : 0;
+    for (const auto& image : stale) {
+      if (memory_budget_ && bytes <= memory_budget_)
+        break;
+
+      const PackedImageRect* rect = stale_images_[image.second].rect;
+      int padding = atlas_map_.padding();
+      bytes -= static_cast<long long>(rect->w + padding) * (rect->h + padding) * kChannels;
+      texture_->clearImage(rect->x, rect->y, rect->w, rect->h);
+      atlas_map_.removeRect(rect);
+      stale_images_.erase(image.second);
+      references_.erase(image.second);
+      images_.erase(image.second);
+      generation_++;
+    }
+
+    shrink();
+  }
+
+  void ImageAtlas::shrink() {
+    static constexpr int kMinShrinkWidth = PackedAtlasMap<const PackedImageRect*>::kDefaultWidth;
+
+    long long area = static_cast<long long>(width()) * height();
+    if (texture_ == nullptr || images_.empty() || area == shrink_checked_area_)
+      return;
+    if (area <= kMinShrinkWidth * kMinShrinkWidth)
+      return;
+
+    if (packedBytes() / kChannels * 4 > area)
+      return;
 
     atlas_map_.pack();
-    texture_ = std::make_unique<ImageAtlasTexture>(atlas_map_.width(), atlas_map_.height());
-    for (auto& image : images_)
-      loadImageRect(image.second.get());
+    shrink_checked_area_ = static_cast<long long>(width()) * height();
+
+    auto texture = std::make_unique<ImageAtlasTexture>(atlas_map_.width(), atlas_map_.height());
+    for (auto& image : images_) {
+      PackedImageRect* rect = image.second.get();
+      const PackedRect& packed_rect = atlas_map_.rectForId(rect);
+      texture->copyImage(*texture_, rect->x, rect->y, packed_rect.x, packed_rect.y, rect->w, rect->h);
+      loadImageRect(rect);
+    }
+
+    DeferredGraphicsCalls::release(std::move(texture_));
+    texture_ = std::move(texture);
+  }
+
+  long long ImageAtlas::packedBytes() const {
+    int padding = atlas_map_.padding();
+    long long bytes = 0;
+    for (const auto& image : images_) {
+      const PackedImageRect* rect = image.second.get();
+      bytes += static_cast<long long>(rect->w + padding) * (rect->h + padding) * kChannels;
+    }
+    return bytes;
+  }
+
+  long long ImageAtlas::memoryBytes() const {
+    return texture_ ? texture_->memoryBytes() : 0;
+  }
+
+  void ImageAtlas::defragment() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& relocation : atlas_map_.defragment(kMaxRelocationsPerFrame)) {
+      PackedImageRect* rect = images_[relocation.id->image].get();
+      const PackedRect& from = relocation.from;
+      texture_->copyImage(*texture_, from.x, from.y, relocation.to.x, relocation.to.y, from.w, from.h);
+      texture_->clearImage(from.x, from.y, from.w, from.h);
+      loadImageRect(rect);
+    }
   }
 
   void ImageAtlas::loadImageRect(PackedImageRect* packed_image_rect) const {
@@ -218,52 +581,60 @@ namespace visage {
     packed_image_rect->h = rect.h;
   }
 
-  void ImageAtlas::updateImage(const PackedImageRect* image) const {
-    if (image->w == 0 && image->image.svg)
-      return;
+  std::unique_ptr<unsigned char[]> ImageAtlas::rasterizeImage(const PackedImageRect* image) const {
+    PackedRect packed_rect = atlas_map_.rectForId(image);
+    return decodeImage(image->image, packed_rect.w, packed_rect.h);
+  }
 
-    if (texture_ == nullptr || !bgfx::isValid(texture_->handle()))
-      return;
+  bool ImageAtlas::updateDecodedImages() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pending_decodes_.empty()) {
+      auto batch = std::make_shared<ImageDecodeBatch>();
+      for (const ImageFile& image : pending_decodes_) {
+        auto packed_image_rect = images_.find(image);
+        if (packed_image_rect != images_.end()) {
+          const PackedImageRect* rect = packed_image_rect->second.get();
+          batch->tiles.push_back({ image, rect->w, rect->h, nullptr });
+        }
+      }
+      pending_decodes_.clear();
+      ImageDecoder::instance().decode(batch);
+      decode_batches_.push_back(std::move(batch));
+    }
 
-    PackedRect packed_rect = atlas_map_.rectForId(image);
-    if (image->image.svg) {
-      std::unique_ptr<unsigned char[]> data = SvgRasterizer::instance().rasterize(image->image);
+    bool updated = false;
+    for (auto it = decode_batches_.begin(); it != decode_batches_.end();) {
+      if (!(*it)->done) {
+        ++it;
+        continue;
+      }
 
-      if (image->image.blur_radius)
-        blurImage(data.get(), image->image.width, image->image.height, image->image.blur_radius);
+      for (const ImageDecodeBatch::Tile& tile : (*it)->tiles) {
+        auto packed_image_rect = images_.find(tile.image);
+        if (packed_image_rect == images_.end())
+          continue;
 
-      texture_->updateTexture(data.get(), packed_rect.x, packed_rect.y, packed_rect.w, packed_rect.h);
-    }
-    else {
-      bimg::ImageContainer* image_container = bimg::imageParse(allocator(), image->image.data,
-                                                               image->image.data_size,
-                                                               bimg::TextureFormat::RGBA8);
-      if (image_container) {
-        unsigned char* image_data = static_cast<unsigned char*>(image_container->m_data);
-        if (image_container->m_width == packed_rect.w && image_container->m_height == packed_rect.h) {
-          texture_->updateTexture(image_data, packed_rect.x, packed_rect.y, packed_rect.w,
-                                  packed_rect.h);
-        }
-        else {
-          int size = packed_rect.w * packed_rect.h * kChannels;
-          std::unique_ptr<unsigned char[]> resampled = std::make_unique<unsigned char[]>(size);
-          stbir_resize_uint8_srgb(image_data, image_container->m_width, image_container->m_height,
-                                  image_container->m_width * kChannels, resampled.get(),
-                                  packed_rect.w, packed_rect.h, packed_rect.w * kChannels, STBIR_BGRA);
-          texture_->updateTexture(resampled.get(), packed_rect.x, packed_rect.y, packed_rect.w,
-                                  packed_rect.h);
-        }
-        bimg::imageFree(image_container);
+        PackedImageRect* rect = packed_image_rect->second.get();
+        if (rect->w != tile.width || rect->h != tile.height)
+          continue;
+
+        if (tile.data)
+          texture_->writeImage(tile.data.get(), rect->x, rect->y, rect->w, rect->h);
+        rect->ready = true;
+        updated = true;
       }
+      it = decode_batches_.erase(it);
     }
+    return updated;
+  }
+
+  bool ImageAtlas::decoding() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !pending_decodes_.empty() || !decode_batches_.empty();
   }
 
   const bgfx::TextureHandle& ImageAtlas::textureHandle() const {
-    if (!texture_->hasHandle()) {
-      texture_->checkHandle();
-      for (auto& image : images_)
-        updateImage(image.second.get());
-    }
+    texture_->upload();
     return texture_->handle();
   }
 
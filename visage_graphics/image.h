@@ -24,7 +24,10 @@
 #include "graphics_utils.h"
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <utility>
+#include <vector>
 
 namespace visage {
   struct ImageFile {
@@ -70,6 +73,7 @@ namespace visage {
   };
 
   class ImageAtlasTexture;
+  struct ImageDecodeBatch;
 
   class ImageAtlas {
   public:
@@ -86,6 +90,7 @@ namespace visage {
       int y = 0;
       int w = 0;
       int h = 0;
+      bool ready = false;
     };
 
     struct PackedImageReference {
@@ -119,6 +124,12 @@ namespace visage {
         return reference_->packed_image_rect->h;
       }
 
+      // False while the image is still decoding and drawing as a transparent placeholder
+      bool ready() const {
+        VISAGE_ASSERT(reference_->atlas.lock().get());
+        return reference_->packed_image_rect->ready;
+      }
+
       const ImageFile& image() const {
         VISAGE_ASSERT(reference_->atlas.lock().get());
         return reference_->packed_image_rect->image;
@@ -139,38 +150,66 @@ namespace visage {
     ImageAtlas();
     virtual ~ImageAtlas();
 
+    static constexpr int kMaxRelocationsPerFrame = 16;
+
     PackedImage addImage(const ImageFile& image);
-    void clearStaleImages() {
-      for (const auto& stale : stale_images_) {
-        images_.erase(stale.first);
-        atlas_map_.removeRect(stale.second);
-      }
-      stale_images_.clear();
-    }
+    // Releases unused images, oldest first, and repacks the atlas into a smaller texture once
+    // most of it is empty
+    void clearStaleImages();
+    // Moves a few images from the bottom of the atlas into space freed by stale images
+    void defragment();
+
+    // Unused images stay in the atlas while the packed images fit in bytes. A budget of 0
+    // releases unused images right away.
+    void setMemoryBudget(long long bytes) { memory_budget_ = bytes; }
+    long long memoryBudget() const { return memory_budget_; }
+    long long memoryBytes() const;
+    // Changes whenever images are released, so cached copies of packed images can be dropped
+    int generation() const { return generation_; }
 
     int width() const { return atlas_map_.width(); }
     int height() const { return atlas_map_.height(); }
+    // Starts decoding newly added images in the background and copies finished ones into the
+    // atlas. Returns true if any image became ready.
+    bool updateDecodedImages();
+    bool decoding() const;
     const bgfx::TextureHandle& textureHandle() const;
     void setImageCoordinates(TextureVertex* vertices, const PackedImage& image) const;
+    std::unique_ptr<unsigned char[]> rasterizeImage(const PackedImageRect* image) const;
 
   private:
+    struct StaleImage {
+      const PackedImageRect* rect = nullptr;
+      long long order = 0;
+    };
+
     void resize();
+    void shrink();
+    long long packedBytes() const;
     void loadImageRect(PackedImageRect* image) const;
-    void updateImage(const PackedImageRect* image) const;
 
     void removeImage(const ImageFile& image) {
       VISAGE_ASSERT(images_.count(image));
-      stale_images_[image] = images_[image].get();
+      if (references_[image].expired())
+        stale_images_[image] = { images_[image].get(), ++stale_counter_ };
     }
 
     void removeImage(const PackedImageRect* packed_image_rect) {
+      std::lock_guard<std::mutex> lock(mutex_);
       removeImage(packed_image_rect->image);
     }
 
     std::map<ImageFile, std::weak_ptr<PackedImageReference>> references_;
     std::map<ImageFile, std::unique_ptr<PackedImageRect>> images_;
-    std::map<ImageFile, const PackedImageRect*> stale_images_;
-
+    std::map<ImageFile, StaleImage> stale_images_;
+    long long stale_counter_ = 0;
+    int generation_ = 0;
+    long long memory_budget_ = 0;
+    long long shrink_checked_area_ = 0;
+    std::vector<ImageFile> pending_decodes_;
+    std::vector<std::shared_ptr<ImageDecodeBatch>> decode_batches_;
+
+    mutable std::mutex mutex_;
     PackedAtlasMap<const PackedImageRect*> atlas_map_;
     std::unique_ptr<ImageAtlasTexture> texture_;
     std::shared_ptr<ImageAtlas*> reference_;
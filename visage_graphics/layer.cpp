@@ -22,7 +22,9 @@
 #include "layer.h"
 
 #include "canvas.h"
+#include "graphics_caches.h"
 #include "region.h"
+#include "region_submit_queue.h"
 #include "renderer.h"
 
 #include <bgfx/bgfx.h>
@@ -32,112 +34,49 @@ namespace visage {
     bgfx::TextureHandle read_back_handle = BGFX_INVALID_HANDLE;
     bgfx::FrameBufferHandle handle = BGFX_INVALID_HANDLE;
     bgfx::TextureFormat::Enum format = bgfx::TextureFormat::RGBA8;
+    bool pooled = false;
   };
 
-  struct RegionPosition {
-    RegionPosition(Region* region, std::vector<IBounds> invalid_rects, int position, int x = 0, int y = 0) :
-        region(region), invalid_rects(std::move(invalid_rects)), position(position), x(x), y(y) { }
-    RegionPosition() = default;
-
-    Region* region = nullptr;
-    std::vector<IBounds> invalid_rects;
-    int position = 0;
-    int x = 0;
-    int y = 0;
-
-    SubmitBatch* currentBatch() const { return region->submitBatchAtPosition(position); }
-    bool isDone() const { return position >= region->numSubmitBatches(); }
+  struct ScreenshotReadBack {
+    bgfx::TextureHandle handle = BGFX_INVALID_HANDLE;
+    Screenshot screenshot;
+    ScreenshotCallback callback;
+    uint32_t ready_frame = 0;
+    bool pending = false;
   };
 
-  inline void moveToVector(std::vector<IBounds>& rects, std::vector<IBounds>& pieces) {
-    rects.insert(rects.end(), pieces.begin(), pieces.end());
-    pieces.clear();
-  }
-
-  static void addSubRegions(std::vector<RegionPosition>& positions, std::vector<RegionPosition>& overlapping,
-                            const RegionPosition& done_position) {
-    auto begin = done_position.region->subRegions().cbegin();
-    auto end = done_position.region->subRegions().cend();
-    for (auto it = begin; it != end; ++it) {
-      Region* sub_region = *it;
-      if (!sub_region->isVisible())
-        continue;
-
-      if (sub_region->needsLayer())
-        sub_region = sub_region->intermediateRegion();
-
-      bool overlaps = std::any_of(begin, it, [sub_region](const Region* other) {
-        return other->isVisible() && sub_region->overlaps(other);
-      });
-
-      IBounds bounds(done_position.x + sub_region->x(), done_position.y + sub_region->y(),
-                     sub_region->width(), sub_region->height());
-
-      std::vector<IBounds> invalid_rects;
-      for (const IBounds& invalid_rect : done_position.invalid_rects) {
-        if (bounds.overlaps(invalid_rect))
-          invalid_rects.push_back(invalid_rect.intersection(bounds));
-      }
-
-      if (invalid_rects.empty())
-        continue;
+  struct ScreenshotRequest {
+    IBounds bounds;
+    ScreenshotCallback callback;
+  };
 
-      if (overlaps)
-        overlapping.emplace_back(sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y());
-      else if (sub_region->isEmpty())
-        addSubRegions(positions, overlapping,
-                      { sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y() });
-      else
-        positions.emplace_back(sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y());
-    }
-  }
+  struct WindowScreenshot {
+    std::string name;
+    std::vector<ScreenshotRequest> requests;
+    int frames_waited = 0;
+  };
 
-  static void checkOverlappingRegions(std::vector<RegionPosition>& positions,
-                                      std::vector<RegionPosition>& overlapping) {
-    std::vector<RegionPosition> new_overlapping;
-
-    for (auto it = overlapping.begin(); it != overlapping.end();) {
-      bool overlaps = std::any_of(positions.begin(), positions.end(), [it](const RegionPosition& other) {
-        return it->x < other.x + other.region->width() && it->x + it->region->width() > other.x &&
-               it->y < other.y + other.region->height() && it->y + it->region->height() > other.y;
-      });
-
-      if (!overlaps) {
-        if (it->isDone())
-          addSubRegions(positions, new_overlapping, *it);
-        else
-          positions.push_back(*it);
-        it = overlapping.erase(it);
+  struct ScreenshotReadBacks {
+    ~ScreenshotReadBacks() {
+      for (ScreenshotReadBack& read_back : ring) {
+        if (bgfx::isValid(read_back.handle))
+          bgfx::destroy(read_back.handle);
       }
-      else
-        ++it;
-    }
 
-    overlapping.insert(overlapping.end(), new_overlapping.begin(), new_overlapping.end());
-  }
-
-  static const SubmitBatch* nextBatch(const std::vector<RegionPosition>& positions,
-                                      const void* current_batch_id, BlendMode current_blend_mode) {
-    const SubmitBatch* next_batch = positions[0].currentBatch();
-    for (auto& position : positions) {
-      const SubmitBatch* batch = position.currentBatch();
-      if (next_batch->compare(batch) > 0) {
-        if (batch->compare(current_batch_id, current_blend_mode) > 0 ||
-            next_batch->compare(current_batch_id, current_blend_mode) < 0) {
-          next_batch = position.currentBatch();
-        }
-      }
-      else if (next_batch->compare(current_batch_id, current_blend_mode) < 0 &&
-               batch->compare(current_batch_id, current_blend_mode) > 0) {
-        next_batch = position.currentBatch();
-      }
+      Screenshot unused;
+      for (const WindowScreenshot& capture : window_captures)
+        Renderer::instance().takeWindowScreenshot(capture.name, unused);
     }
 
-    return next_batch;
-  }
+    ScreenshotReadBack ring[Layer::kScreenshotReadBackRing];
+    std::vector<ScreenshotRequest> requests;
+    std::vector<WindowScreenshot> window_captures;
+    int next = 0;
+  };
 
   Layer::Layer(GradientAtlas* gradient_atlas) : gradient_atlas_(gradient_atlas) {
     frame_buffer_data_ = std::make_unique<FrameBufferData>();
+    screenshot_read_backs_ = std::make_unique<ScreenshotReadBacks>();
     clear_brush_ = std::make_unique<const PackedBrush>(gradient_atlas, Brush::solid(0));
   }
 
@@ -161,10 +100,10 @@ namespace visage {
       frame_buffer_data_->handle = bgfx::createFrameBuffer(window_handle_, width_, height_,
                                                            frame_buffer_data_->format);
     }
-    else {
+    else if (headless_render_) {
       bool read_back = (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT) &&
                        (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_READ_BACK);
-      if (headless_render_ && read_back) {
+      if (read_back) {
         uint64_t flags = BGFX_TEXTURE_BLIT_DST | BGFX_TEXTURE_READ_BACK;
         frame_buffer_data_->read_back_handle = bgfx::createTexture2D(width_, height_, false, 1,
                                                                      bgfx::TextureFormat::RGBA8, flags);
@@ -172,12 +111,21 @@ namespace visage {
       frame_buffer_data_->handle = bgfx::createFrameBuffer(width_, height_, frame_buffer_data_->format,
                                                            kFrameBufferFlags);
     }
+    else {
+      frame_buffer_data_->handle = RenderTargetPool::acquireTarget(width_, height_,
+                                                                   frame_buffer_data_->format);
+      frame_buffer_data_->pooled = true;
+    }
 
     bottom_left_origin_ = bgfx::getCaps()->originBottomLeft;
   }
 
   void Layer::destroyFrameBuffer() const {
-    if (bgfx::isValid(frame_buffer_data_->handle)) {
+    if (frame_buffer_data_->pooled) {
+      RenderTargetPool::releaseTarget(frame_buffer_data_->handle);
+      frame_buffer_data_->pooled = false;
+    }
+    else if (bgfx::isValid(frame_buffer_data_->handle)) {
       bgfx::destroy(frame_buffer_data_->handle);
       frame_buffer_data_->handle = BGFX_INVALID_HANDLE;
     }
@@ -191,36 +139,63 @@ namespace visage {
     return frame_buffer_data_->format;
   }
 
+  long long Layer::memoryBytes() const {
+    static constexpr int kBytesPerPixel = 4;
+
+    long long frame_buffer_bytes = static_cast<long long>(width_) * height_ * kBytesPerPixel;
+    long long bytes = 0;
+    if (bgfx::isValid(frame_buffer_data_->handle))
+      bytes += frame_buffer_bytes;
+    if (bgfx::isValid(frame_buffer_data_->read_back_handle))
+      bytes += frame_buffer_bytes;
+    for (const ScreenshotReadBack& read_back : screenshot_read_backs_->ring) {
+      if (bgfx::isValid(read_back.handle))
+        bytes += static_cast<long long>(read_back.screenshot.width()) *
+                 read_back.screenshot.height() * kBytesPerPixel;
+    }
+    return bytes;
+  }
+
+  long long Layer::postEffectMemoryBytes() const {
+    long long bytes = 0;
+    for (const Region* region : regions_) {
+      if (region->postEffect())
+        bytes += region->postEffect()->memoryBytes();
+    }
+    return bytes;
+  }
+
   void Layer::invalidateRectInRegion(IBounds rect, const Region* region) {
     IBounds region_bounds = boundsForRegion(region);
     rect = rect + IPoint(region_bounds.x(), region_bounds.y());
     rect = rect.intersection(region_bounds);
+    if (rect.hasArea())
+      invalid_rects_[region].add(rect);
+  }
 
-    std::vector<IBounds>& invalid_rects = invalid_rects_[region];
-
-    for (auto it = invalid_rects.begin(); it != invalid_rects.end();) {
-      IBounds& invalid_rect = *it;
-      if (invalid_rect.contains(rect)) {
-        moveToVector(invalid_rects, invalid_rect_pieces_);
-        return;
-      }
+  void Layer::collectInvalidPieces() {
+    invalid_pieces_.clear();
+    invalid_rect_stats_ = {};
+    for (auto& region_invalid_rects : invalid_rects_) {
+      BandedRegion& invalid = region_invalid_rects.second;
+      invalid_rect_stats_.rects += invalid.numRects();
+      invalid_rect_stats_.overdraw += invalid.coalesce(invalid_rect_piece_cost_);
 
-      if (rect.contains(invalid_rect)) {
-        it = invalid_rects.erase(it);
-        continue;
-      }
-      IBounds::breakIntoNonOverlapping(rect, invalid_rect, invalid_rect_pieces_);
-      ++it;
+      std::vector<IBounds>& pieces = invalid_pieces_[region_invalid_rects.first];
+      invalid.appendRects(pieces);
+      invalid_rect_stats_.fragments += pieces.size();
     }
+    invalid_rects_.clear();
 
-    invalid_rects.push_back(rect);
-    moveToVector(invalid_rects, invalid_rect_pieces_);
+    VISAGE_PROFILE_COUNT(Profiler::kInvalidRects, invalid_rect_stats_.rects);
+    VISAGE_PROFILE_COUNT(Profiler::kInvalidRectFragments, invalid_rect_stats_.fragments);
+    VISAGE_PROFILE_COUNT(Profiler::kInvalidRectOverdraw, invalid_rect_stats_.overdraw);
   }
 
   void Layer::clearInvalidRectAreas(int submit_pass) {
     ShapeBatch<Fill> clear_batch(BlendMode::Opaque);
     std::vector<IBounds> invalid_rects;
-    for (auto& region_invalid_rects : invalid_rects_) {
+    for (auto& region_invalid_rects : invalid_pieces_) {
       for (const IBounds& rect : region_invalid_rects.second) {
         invalid_rects.push_back(rect);
         float x = rect.x();
@@ -239,6 +214,8 @@ namespace visage {
     if (!anyInvalidRects())
       return submit_pass;
 
+    VISAGE_PROFILE_SCOPE("Layer::submit");
+    collectInvalidPieces();
     checkFrameBuffer();
     bgfx::setViewMode(submit_pass, bgfx::ViewMode::Sequential);
     bgfx::setViewRect(submit_pass, 0, 0, width_, height_);
@@ -249,55 +226,16 @@ namespace visage {
     if (intermediate_layer_)
       clearInvalidRectAreas(submit_pass);
 
-    std::vector<RegionPosition> region_positions;
-    std::vector<RegionPosition> overlapping_regions;
+    RegionSubmitQueue submit_queue(width_, height_);
     for (Region* region : regions_) {
       IPoint point = coordinatesForRegion(region);
-      if (region->isEmpty()) {
-        addSubRegions(region_positions, overlapping_regions,
-                      { region, invalid_rects_[region], 0, point.x, point.y });
-      }
-      else
-        region_positions.emplace_back(region, invalid_rects_[region], 0, point.x, point.y);
+      submit_queue.addRegion(region, invalid_pieces_[region], point.x, point.y);
     }
 
-    invalid_rects_.clear();
-
-    const void* current_batch_id = nullptr;
-    BlendMode current_blend_mode = BlendMode::Opaque;
     std::vector<PositionedBatch> batches;
-    std::vector<RegionPosition> done_regions;
-
-    while (!region_positions.empty()) {
-      const SubmitBatch* next_batch = nextBatch(region_positions, current_batch_id, current_blend_mode);
-      for (auto& region_position : region_positions) {
-        SubmitBatch* batch = region_position.currentBatch();
-        if (batch->id() != next_batch->id() || batch->blendMode() != next_batch->blendMode())
-          continue;
-
-        batches.push_back({ batch, &region_position.invalid_rects, region_position.x,
-                            region_position.y });
-        region_position.position++;
-      }
-
+    while (submit_queue.nextBatches(batches)) {
       batches.front().batch->submit(*this, submit_pass, batches);
       batches.clear();
-
-      auto done_it = std::partition(region_positions.begin(), region_positions.end(),
-                                    [](const RegionPosition& position) { return position.isDone(); });
-      done_regions.insert(done_regions.end(), std::make_move_iterator(region_positions.begin()),
-                          std::make_move_iterator(done_it));
-      region_positions.erase(region_positions.begin(), done_it);
-
-      for (auto& region_position : done_regions)
-        addSubRegions(region_positions, overlapping_regions, region_position);
-
-      if (!done_regions.empty())
-        checkOverlappingRegions(region_positions, overlapping_regions);
-
-      done_regions.clear();
-      current_batch_id = next_batch->id();
-      current_blend_mode = next_batch->blendMode();
     }
 
     if (screenshot_requested_ && bgfx::isValid(frame_buffer_data_->read_back_handle)) {
@@ -329,7 +267,6 @@ namespace visage {
   void Layer::addPackedRegion(Region* region) {
     addRegion(region);
     if (!atlas_map_.addRect(region, region->width(), region->height())) {
-      atlas_map_.pack();
       invalidate();
       setDimensions(atlas_map_.width(), atlas_map_.height());
     }
@@ -369,4 +306,113 @@ namespace visage {
     else
       return Renderer::instance().screenshot();
   }
+
+  void Layer::requestScreenshot(const IBounds& bounds, ScreenshotCallback callback) {
+    screenshot_read_backs_->requests.push_back({ bounds, std::move(callback) });
+  }
+
+  bool Layer::screenshotsPending() const {
+    const ScreenshotReadBacks& read_backs = *screenshot_read_backs_;
+    if (!read_backs.requests.empty() || !read_backs.window_captures.empty())
+      return true;
+
+    for (const ScreenshotReadBack& read_back : read_backs.ring) {
+      if (read_back.pending)
+        return true;
+    }
+    return false;
+  }
+
+  int Layer::submitScreenshotReadBacks(int submit_pass) {
+    std::vector<ScreenshotRequest>& requests = screenshot_read_backs_->requests;
+    if (requests.empty() || !bgfx::isValid(frame_buffer_data_->handle))
+      return submit_pass;
+
+    if (window_handle_ && !hdr_) {
+      std::string name = Renderer::instance().nextWindowScreenshotName();
+      bgfx::requestScreenShot(frame_buffer_data_->handle, name.c_str());
+      screenshot_read_backs_->window_captures.push_back({ name, std::move(requests) });
+      requests.clear();
+      return submit_pass;
+    }
+
+    bool read_back = headless_render_ && !hdr_ &&
+                     (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_BLIT) &&
+                     (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_READ_BACK);
+
+    int num_started = 0;
+    bool blitted = false;
+    for (ScreenshotRequest& request : requests) {
+      IBounds bounds = request.bounds.intersection({ 0, 0, width_, height_ });
+      if (!read_back || !bounds.hasArea()) {
+        request.callback(Screenshot());
+        num_started++;
+        continue;
+      }
+
+      ScreenshotReadBack& slot = screenshot_read_backs_->ring[screenshot_read_backs_->next];
+      if (slot.pending)
+        break;
+
+      Screenshot& screenshot = slot.screenshot;
+      if (screenshot.width() != bounds.width() || screenshot.height() != bounds.height()) {
+        if (bgfx::isValid(slot.handle))
+          bgfx::destroy(slot.handle);
+        slot.handle = bgfx::createTexture2D(bounds.width(), bounds.height(), false, 1,
+                                            bgfx::TextureFormat::RGBA8,
+                                            BGFX_TEXTURE_BLIT_DST | BGFX_TEXTURE_READ_BACK);
+        slot.screenshot.setDimensions(bounds.width(), bounds.height());
+      }
+
+      bgfx::blit(submit_pass, slot.handle, 0, 0, bgfx::getTexture(frame_buffer_data_->handle),
+                 bounds.x(), bounds.y(), bounds.width(), bounds.height());
+      slot.ready_frame = bgfx::readTexture(slot.handle, slot.screenshot.data());
+      slot.callback = std::move(request.callback);
+      slot.pending = true;
+      blitted = true;
+      screenshot_read_backs_->next = (screenshot_read_backs_->next + 1) % kScreenshotReadBackRing;
+      num_started++;
+    }
+
+    requests.erase(requests.begin(), requests.begin() + num_started);
+    return blitted ? submit_pass + 1 : submit_pass;
+  }
+
+  void Layer::receiveScreenshots(uint32_t frame) {
+    static constexpr int kMaxWindowScreenshotFrames = 8;
+
+    std::vector<WindowScreenshot>& window_captures = screenshot_read_backs_->window_captures;
+    for (auto capture = window_captures.begin(); capture != window_captures.end();) {
+      Screenshot window;
+      bool received = Renderer::instance().takeWindowScreenshot(capture->name, window);
+      if (!received && ++capture->frames_waited < kMaxWindowScreenshotFrames) {
+        ++capture;
+        continue;
+      }
+
+      std::vector<ScreenshotRequest> requests = std::move(capture->requests);
+      capture = window_captures.erase(capture);
+      for (ScreenshotRequest& request : requests) {
+        IBounds bounds = request.bounds.intersection({ 0, 0, window.width(), window.height() });
+        if (!bounds.hasArea()) {
+          request.callback(Screenshot());
+          continue;
+        }
+
+        const uint8_t* source = window.data() + (bounds.y() * window.width() + bounds.x()) * 4;
+        request.callback(Screenshot(source, bounds.width(), bounds.height(), window.width() * 4));
+      }
+    }
+
+    for (int i = 0; i < kScreenshotReadBackRing; ++i) {
+      int index = (screenshot_read_backs_->next + i) % kScreenshotReadBackRing;
+      ScreenshotReadBack& read_back = screenshot_read_backs_->ring[index];
+      if (read_back.pending && read_back.ready_frame <= frame) {
+        read_back.pending = false;
+        ScreenshotCallback callback = std::move(read_back.callback);
+        read_back.callback = nullptr;
+        callback(read_back.screenshot);
+      }
+    }
+  }
 }
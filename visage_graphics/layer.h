@@ -24,15 +24,24 @@
 #include "gradient.h"
 #include "graphics_utils.h"
 #include "screenshot.h"
+#include "visage_utils/banded_region.h"
 #include "visage_utils/space.h"
 
 namespace visage {
   class Region;
   struct FrameBufferData;
+  struct ScreenshotReadBacks;
 
   class Layer {
   public:
     static constexpr int kInvalidRectMemory = 2;
+    static constexpr int kScreenshotReadBackRing = 3;
+
+    struct InvalidRectStats {
+      int rects = 0;
+      int fragments = 0;
+      long long overdraw = 0;
+    };
 
     explicit Layer(GradientAtlas* gradient_atlas);
     ~Layer();
@@ -42,6 +51,8 @@ namespace visage {
 
     bgfx::FrameBufferHandle& frameBuffer() const;
     int frameBufferFormat() const;
+    long long memoryBytes() const;
+    long long postEffectMemoryBytes() const;
 
     GradientAtlas* gradientAtlas() const { return gradient_atlas_; }
 
@@ -75,11 +86,18 @@ namespace visage {
     void invalidate() {
       invalid_rects_.clear();
       for (const auto& region : regions_)
-        invalid_rects_[region].push_back(boundsForRegion(region));
+        invalid_rects_[region] = BandedRegion(boundsForRegion(region));
     }
 
     void invalidateRectInRegion(IBounds rect, const Region* region);
     bool anyInvalidRects() const { return !invalid_rects_.empty(); }
+    void clearInvalidRects() { invalid_rects_.clear(); }
+
+    // Invalid areas are grown when that saves more than piece_cost overdrawn pixels per
+    // rectangle, since every rectangle re-emits each shape that touches it.
+    void setInvalidRectPieceCost(int piece_cost) { invalid_rect_piece_cost_ = piece_cost; }
+    int invalidRectPieceCost() const { return invalid_rect_piece_cost_; }
+    const InvalidRectStats& invalidRectStats() const { return invalid_rect_stats_; }
 
     void setDimensions(int width, int height) {
       if (width == width_ && height == height_)
@@ -105,6 +123,16 @@ namespace visage {
 
     void requestScreenshot();
     const Screenshot& screenshot() const;
+
+    // Headless layers copy the requested area into one of a ring of read-back textures and hand
+    // the pixels to the callback once the GPU finishes, usually one or two frames later. Window
+    // layers capture the back buffer with bgfx::requestScreenShot and crop it for each request.
+    // HDR layers answer with an empty Screenshot.
+    void requestScreenshot(const IBounds& bounds, ScreenshotCallback callback);
+    bool screenshotsPending() const;
+    int submitScreenshotReadBacks(int submit_pass);
+    void receiveScreenshots(uint32_t frame);
+
     void pairToWindow(void* window_handle, int width, int height) {
       window_handle_ = window_handle;
       setDimensions(width, height);
@@ -129,6 +157,8 @@ namespace visage {
     }
 
   private:
+    void collectInvalidPieces();
+
     bool bottom_left_origin_ = false;
     bool hdr_ = false;
     int width_ = 0;
@@ -144,9 +174,12 @@ namespace visage {
     GradientAtlas* gradient_atlas_ = nullptr;
     std::unique_ptr<const PackedBrush> clear_brush_;
     std::unique_ptr<FrameBufferData> frame_buffer_data_;
+    std::unique_ptr<ScreenshotReadBacks> screenshot_read_backs_;
     PackedAtlasMap<const Region*> atlas_map_;
-    std::map<const Region*, std::vector<IBounds>> invalid_rects_;
-    std::vector<IBounds> invalid_rect_pieces_;
+    std::map<const Region*, BandedRegion> invalid_rects_;
+    std::map<const Region*, std::vector<IBounds>> invalid_pieces_;
+    int invalid_rect_piece_cost_ = BandedRegion::kDefaultPieceCost;
+    InvalidRectStats invalid_rect_stats_;
     std::vector<Region*> regions_;
   };
 }
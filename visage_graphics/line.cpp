@@ -0,0 +1,153 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "line.h"
+
+#include "visage_utils/defines.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VISAGE_LINE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VISAGE_LINE_NEON 1
+#endif
+
+namespace visage {
+  static void spanMinMax(const float* samples, int count, float& min, float& max) {
+    int i = 0;
+#if VISAGE_LINE_SSE2
+    if (count >= 8) {
+      __m128 min_values = _mm_loadu_ps(samples);
+      __m128 max_values = min_values;
+      for (i = 4; i + 4 <= count; i += 4) {
+        __m128 values = _mm_loadu_ps(samples + i);
+        min_values = _mm_min_ps(min_values, values);
+        max_values = _mm_max_ps(max_values, values);
+      }
+      float mins[4], maxes[4];
+      _mm_storeu_ps(mins, min_values);
+      _mm_storeu_ps(maxes, max_values);
+      min = std::min(min, std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3])));
+      max = std::max(max, std::max(std::max(maxes[0], maxes[1]), std::max(maxes[2], maxes[3])));
+    }
+#elif VISAGE_LINE_NEON
+    if (count >= 8) {
+      float32x4_t min_values = vld1q_f32(samples);
+      float32x4_t max_values = min_values;
+      for (i = 4; i + 4 <= count; i += 4) {
+        float32x4_t values = vld1q_f32(samples + i);
+        min_values = vminq_f32(min_values, values);
+        max_values = vmaxq_f32(max_values, values);
+      }
+      float mins[4], maxes[4];
+      vst1q_f32(mins, min_values);
+      vst1q_f32(maxes, max_values);
+      min = std::min(min, std::min(std::min(mins[0], mins[1]), std::min(mins[2], mins[3])));
+      max = std::max(max, std::max(std::max(maxes[0], maxes[1]), std::max(maxes[2], maxes[3])));
+    }
+#endif
+    for (; i < count; ++i) {
+      min = std::min(min, samples[i]);
+      max = std::max(max, samples[i]);
+    }
+  }
+
+  void LineStream::setCapacity(int capacity) {
+    samples_.assign(std::max(0, capacity), 0.0f);
+    clear();
+  }
+
+  void LineStream::push(const float* samples, int count) {
+    int capacity = samples_.size();
+    if (capacity == 0)
+      return;
+
+    if (count > capacity) {
+      samples += count - capacity;
+      count = capacity;
+    }
+
+    int first = std::min(count, capacity - write_index_);
+    std::copy(samples, samples + first, samples_.begin() + write_index_);
+    std::copy(samples + first, samples + count, samples_.begin());
+    write_index_ = (write_index_ + count) % capacity;
+    size_ = std::min(capacity, size_ + count);
+  }
+
+  float LineStream::sampleAt(int index) const {
+    VISAGE_ASSERT(index >= 0 && index < size_);
+    int capacity = samples_.size();
+    return samples_[(write_index_ - size_ + index + capacity) % capacity];
+  }
+
+  void LineStream::minMax(int start, int count, float& min, float& max) const {
+    int capacity = samples_.size();
+    int begin = (write_index_ - size_ + start + capacity) % capacity;
+    int first = std::min(count, capacity - begin);
+    min = max = samples_[begin];
+    spanMinMax(samples_.data() + begin, first, min, max);
+    spanMinMax(samples_.data(), count - first, min, max);
+  }
+
+  void LineStream::decimate(Line& line, float width, int columns, float y_offset, float y_scale) const {
+    columns = std::max(1, columns);
+    if (size_ <= 2 * columns) {
+      line.setNumPoints(size_);
+      float x_scale = size_ > 1 ? width / (size_ - 1) : 0.0f;
+      for (int i = 0; i < size_; ++i) {
+        line.x[i] = i * x_scale;
+        line.y[i] = y_offset + sampleAt(i) * y_scale;
+        line.values[i] = 0.0f;
+      }
+      return;
+    }
+
+    line.setNumPoints(2 * columns);
+    float column_width = width / columns;
+    float previous = sampleAt(0);
+    for (int c = 0; c < columns; ++c) {
+      int start = static_cast<int64_t>(c) * size_ / columns;
+      int end = static_cast<int64_t>(c + 1) * size_ / columns;
+      float min = 0.0f;
+      float max = 0.0f;
+      minMax(start, end - start, min, max);
+
+      float first = min;
+      float second = max;
+      if (std::abs(previous - max) < std::abs(previous - min))
+        std::swap(first, second);
+      previous = second;
+
+      int index = 2 * c;
+      line.x[index] = (c + 0.25f) * column_width;
+      line.y[index] = y_offset + first * y_scale;
+      line.x[index + 1] = (c + 0.75f) * column_width;
+      line.y[index + 1] = y_offset + second * y_scale;
+      line.values[index] = 0.0f;
+      line.values[index + 1] = 0.0f;
+    }
+  }
+}
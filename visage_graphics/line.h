@@ -22,6 +22,7 @@
 #pragma once
 
 #include <vector>
+
 namespace visage {
   struct Line {
     static constexpr int kLineVerticesPerPoint = 6;
@@ -50,4 +51,35 @@ namespace visage {
     float line_value_scale = 1.0f;
     float fill_value_scale = 1.0f;
   };
+
+  // Ring buffer of evenly spaced samples for lines that receive far more points than there are
+  // pixels, like oscilloscopes and spectrums. decimate() reduces the samples to at most a minimum
+  // and a maximum per pixel column so drawing cost follows the width instead of the sample count.
+  class LineStream {
+  public:
+    explicit LineStream(int capacity = 0) { setCapacity(capacity); }
+
+    void setCapacity(int capacity);
+    int capacity() const { return samples_.size(); }
+    int size() const { return size_; }
+    void clear() {
+      write_index_ = 0;
+      size_ = 0;
+    }
+
+    void push(float sample) { push(&sample, 1); }
+    void push(const float* samples, int count);
+    float sampleAt(int index) const;
+
+    // Fills line with the buffered samples, oldest first, spread across width. Each sample is
+    // placed at y_offset + sample * y_scale.
+    void decimate(Line& line, float width, int columns, float y_offset, float y_scale) const;
+
+  private:
+    void minMax(int start, int count, float& min, float& max) const;
+
+    std::vector<float> samples_;
+    int write_index_ = 0;
+    int size_ = 0;
+  };
 }
@@ -25,9 +25,103 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <set>
 #include <sstream>
 
 namespace visage {
+  CompiledPalette::CompiledPalette(const Palette& palette, unsigned int version) :
+      version_(version), num_color_ids_(theme::ColorId::numColorIds()),
+      num_value_ids_(theme::ValueId::numValueIds()) {
+    int num_rows = kEmptyRow + 1;
+    auto add_row = [&](theme::OverrideId override_id) {
+      if (override_id.isDefault() || override_id.id == theme::OverrideId::kInvalidId)
+        return;
+      if (override_id.id >= override_rows_.size())
+        override_rows_.resize(override_id.id + 1, kEmptyRow);
+      if (override_rows_[override_id.id] == kEmptyRow)
+        override_rows_[override_id.id] = num_rows++;
+    };
+    for (const auto& override_map : palette.color_map_)
+      add_row(override_map.first);
+    for (const auto& override_map : palette.value_map_)
+      add_row(override_map.first);
+
+    colors_.resize(num_rows * num_color_ids_);
+    color_set_.resize(colors_.size(), false);
+    for (int i = 0; i < num_color_ids_; ++i)
+      colors_[i] = Brush::solid(theme::ColorId::defaultColor(theme::ColorId(i)));
+
+    values_.resize(num_rows * num_value_ids_);
+    value_set_.resize(values_.size(), false);
+    for (int i = 0; i < num_value_ids_; ++i)
+      values_[i] = theme::ValueId::defaultValue(theme::ValueId(i));
+
+    auto assign_colors = [&](theme::OverrideId override_id,
+                             const std::map<theme::ColorId, int>& map) {
+      int offset = row(override_id) * num_color_ids_;
+      for (const auto& assignment : map) {
+        if (assignment.first.id >= num_color_ids_ || assignment.second == Palette::kNotSetId)
+          continue;
+
+        int index = assignment.second;
+        if (index >= 0 && index < palette.colors_.size())
+          colors_[offset + assignment.first.id] = palette.colors_[index];
+        else
+          colors_[offset + assignment.first.id] = Brush::solid(Palette::kInvalidColor);
+        color_set_[offset + assignment.first.id] = true;
+      }
+    };
+
+    auto assign_values = [&](theme::OverrideId override_id,
+                             const std::map<theme::ValueId, float>& map) {
+      int offset = row(override_id) * num_value_ids_;
+      for (const auto& assignment : map) {
+        if (assignment.first.id >= num_value_ids_ || assignment.second == Palette::kNotSetValue)
+          continue;
+
+        values_[offset + assignment.first.id] = assignment.second;
+        value_set_[offset + assignment.first.id] = true;
+      }
+    };
+
+    auto global_colors = palette.color_map_.find(theme::OverrideId());
+    if (global_colors != palette.color_map_.end())
+      assign_colors(global_colors->first, global_colors->second);
+    auto global_values = palette.value_map_.find(theme::OverrideId());
+    if (global_values != palette.value_map_.end())
+      assign_values(global_values->first, global_values->second);
+
+    for (int r = 1; r < num_rows; ++r) {
+      std::copy(colors_.begin(), colors_.begin() + num_color_ids_,
+                colors_.begin() + r * num_color_ids_);
+      std::copy(values_.begin(), values_.begin() + num_value_ids_,
+                values_.begin() + r * num_value_ids_);
+    }
+
+    for (const auto& override_map : palette.color_map_) {
+      if (row(override_map.first) > kEmptyRow)
+        assign_colors(override_map.first, override_map.second);
+    }
+    for (const auto& override_map : palette.value_map_) {
+      if (row(override_map.first) > kEmptyRow)
+        assign_values(override_map.first, override_map.second);
+    }
+  }
+
+  std::shared_ptr<const CompiledPalette> Palette::compiled() const {
+    std::shared_ptr<const CompiledPalette> result = std::atomic_load(&compiled_);
+    if (result && isCurrent(*result))
+      return result;
+
+    std::lock_guard<std::mutex> lock(compile_mutex_);
+    result = std::atomic_load(&compiled_);
+    if (result == nullptr || !isCurrent(*result)) {
+      result = std::make_shared<CompiledPalette>(*this, version_.load(std::memory_order_acquire));
+      std::atomic_store(&compiled_, result);
+    }
+    return result;
+  }
+
   void Palette::initWithDefaults() {
     value_map_.clear();
     int num_value_ids = theme::ValueId::numValueIds();
@@ -59,6 +153,7 @@ namespace visage {
     }
 
     sortColors();
+    invalidate();
   }
 
   void Palette::sortColors() {
@@ -93,19 +188,35 @@ namespace visage {
           mapped.second = color_movement[mapped.second];
       }
     }
+    invalidate();
+  }
+
+  template<typename Id, typename T>
+  static std::set<Id> assignableIds(const std::map<theme::OverrideId, std::map<Id, T>>& id_map,
+                                    theme::OverrideId override_id) {
+    // Overrides can reassign anything set globally, plus whatever they already set themselves
+    std::set<Id> ids;
+    for (theme::OverrideId id : { theme::OverrideId(), override_id }) {
+      auto it = id_map.find(id);
+      if (it != id_map.end()) {
+        for (const auto& assignment : it->second)
+          ids.insert(assignment.first);
+      }
+    }
+    return ids;
   }
 
-  std::map<std::string, std::vector<theme::ColorId>> Palette::colorIdList(theme::OverrideId override_id) {
+  std::map<std::string, std::vector<theme::ColorId>> Palette::colorIdList(theme::OverrideId override_id) const {
     std::map<std::string, std::vector<theme::ColorId>> results;
-    for (const auto& color : color_map_[override_id])
-      results[theme::ColorId::groupName(color.first)].push_back(color.first);
+    for (theme::ColorId color_id : assignableIds(color_map_, override_id))
+      results[theme::ColorId::groupName(color_id)].push_back(color_id);
     return results;
   }
 
-  std::map<std::string, std::vector<theme::ValueId>> Palette::valueIdList(theme::OverrideId override_id) {
+  std::map<std::string, std::vector<theme::ValueId>> Palette::valueIdList(theme::OverrideId override_id) const {
     std::map<std::string, std::vector<theme::ValueId>> results;
-    for (const auto& value : value_map_[override_id])
-      results[theme::ValueId::groupName(value.first)].push_back(value.first);
+    for (theme::ValueId value_id : assignableIds(value_map_, override_id))
+      results[theme::ValueId::groupName(value_id)].push_back(value_id);
     return results;
   }
 
@@ -120,6 +231,7 @@ namespace visage {
           color.second--;
       }
     }
+    invalidate();
   }
 
   std::string Palette::encode() const {
@@ -216,5 +328,6 @@ namespace visage {
       colors_.emplace_back();
       colors_[i].decode(stream);
     }
+    invalidate();
   }
 }
\ No newline at end of file
@@ -25,11 +25,74 @@
 #include "gradient.h"
 #include "theme.h"
 
+#include <atomic>
 #include <iosfwd>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace visage {
+  class Palette;
+
+  // Immutable flat lookup tables built from a Palette. Every override row already falls back to
+  // the global assignment and then the theme default, so a lookup is a couple of array loads.
+  class CompiledPalette {
+  public:
+    CompiledPalette(const Palette& palette, unsigned int version);
+
+    unsigned int version() const { return version_; }
+    int numColorIds() const { return num_color_ids_; }
+    int numValueIds() const { return num_value_ids_; }
+
+    bool hasColor(theme::OverrideId override_id, theme::ColorId color_id) const {
+      return color_set_[colorIndex(override_id, color_id)];
+    }
+
+    const Brush& color(theme::OverrideId override_id, theme::ColorId color_id) const {
+      return colors_[colorIndex(override_id, color_id)];
+    }
+
+    bool hasValue(theme::OverrideId override_id, theme::ValueId value_id) const {
+      return value_set_[valueIndex(override_id, value_id)];
+    }
+
+    float value(theme::OverrideId override_id, theme::ValueId value_id) const {
+      return values_[valueIndex(override_id, value_id)];
+    }
+
+  private:
+    // Row 0 holds the global assignments. Row 1 is a copy of it with nothing marked as set, used
+    // for overrides that have no entries so hasColor/hasValue don't report global assignments.
+    static constexpr int kGlobalRow = 0;
+    static constexpr int kEmptyRow = 1;
+
+    int row(theme::OverrideId override_id) const {
+      if (override_id.isDefault())
+        return kGlobalRow;
+      return override_id.id < override_rows_.size() ? override_rows_[override_id.id] : kEmptyRow;
+    }
+
+    int colorIndex(theme::OverrideId override_id, theme::ColorId color_id) const {
+      VISAGE_ASSERT(color_id.id < num_color_ids_);
+      return row(override_id) * num_color_ids_ + color_id.id;
+    }
+
+    int valueIndex(theme::OverrideId override_id, theme::ValueId value_id) const {
+      VISAGE_ASSERT(value_id.id < num_value_ids_);
+      return row(override_id) * num_value_ids_ + value_id.id;
+    }
+
+    unsigned int version_ = 0;
+    int num_color_ids_ = 0;
+    int num_value_ids_ = 0;
+    std::vector<int> override_rows_;
+    std::vector<Brush> colors_;
+    std::vector<bool> color_set_;
+    std::vector<float> values_;
+    std::vector<bool> value_set_;
+  };
+
   class Palette {
   public:
     static constexpr int kInvalidId = -2;
@@ -39,6 +102,16 @@ namespace visage {
     static constexpr char kEncodingSeparator = '@';
 
     Palette() = default;
+    Palette(const Palette& other) :
+        colors_(other.colors_), color_map_(other.color_map_), value_map_(other.value_map_) { }
+
+    Palette& operator=(const Palette& other) {
+      colors_ = other.colors_;
+      color_map_ = other.color_map_;
+      value_map_ = other.value_map_;
+      invalidate();
+      return *this;
+    }
 
     int numColors() const { return colors_.size(); }
 
@@ -52,22 +125,34 @@ namespace visage {
     void initWithDefaults();
     void sortColors();
 
-    std::map<std::string, std::vector<theme::ColorId>> colorIdList(theme::OverrideId override_id);
-    std::map<std::string, std::vector<theme::ValueId>> valueIdList(theme::OverrideId override_id);
+    std::map<std::string, std::vector<theme::ColorId>> colorIdList(theme::OverrideId override_id) const;
+    std::map<std::string, std::vector<theme::ValueId>> valueIdList(theme::OverrideId override_id) const;
+
+    // Returns the lookup tables for the current state, rebuilding them after any change.
+    // Safe to call from several threads at once as long as nothing edits the palette.
+    std::shared_ptr<const CompiledPalette> compiled() const;
+    bool isCurrent(const CompiledPalette& compiled) const {
+      return compiled.version() == version_.load(std::memory_order_acquire) &&
+             compiled.numColorIds() == theme::ColorId::numColorIds() &&
+             compiled.numValueIds() == theme::ValueId::numValueIds();
+    }
 
     void setEditColor(int index, const Brush& color) {
       VISAGE_ASSERT(index >= 0 && index < colors_.size());
       colors_[index] = color;
+      invalidate();
     }
 
     void setColorIndexFrom(int index, const Color& color) {
       VISAGE_ASSERT(index >= 0 && index < colors_.size());
       colors_[index].gradient().setColor(0, color);
+      invalidate();
     }
 
     void setColorIndexTo(int index, const Color& color) {
       VISAGE_ASSERT(index >= 0 && index < colors_.size());
       colors_[index].gradient().setColor(1, color);
+      invalidate();
     }
 
     void toggleColorIndexStyle(int index) {
@@ -84,23 +169,21 @@ namespace visage {
         colors_[index].gradient().setResolution(1);
         colors_[index].position().shape = GradientPosition::InterpolationShape::Solid;
       }
+      invalidate();
     }
 
-    bool color(theme::OverrideId override_id, theme::ColorId color_id, Brush& color) {
-      color_map_[override_id].try_emplace(color_id, kNotSetId);
-
-      if (color_map_[override_id][color_id] == kNotSetId)
+    bool color(theme::OverrideId override_id, theme::ColorId color_id, Brush& color) const {
+      std::shared_ptr<const CompiledPalette> tables = compiled();
+      if (!tables->hasColor(override_id, color_id))
         return false;
 
-      if (color_map_[override_id][color_id] == kInvalidId)
-        color = Brush::solid(kInvalidColor);
-      else
-        color = colors_[color_map_[override_id][color_id]];
+      color = tables->color(override_id, color_id);
       return true;
     }
 
     void setColorMap(theme::OverrideId override_id, theme::ColorId color_id, int index) {
       color_map_[override_id][color_id] = index;
+      invalidate();
     }
 
     void setColor(theme::OverrideId override_id, theme::ColorId color_id, const Color& color) {
@@ -118,34 +201,45 @@ namespace visage {
 
     void setValue(theme::OverrideId override_id, theme::ValueId value_id, float value) {
       value_map_[override_id][value_id] = value;
+      invalidate();
     }
 
     void setValue(theme::ValueId value_id, float value) { setValue({}, value_id, value); }
 
     void removeValue(theme::OverrideId override_id, theme::ValueId value_id) {
-      if (value_map_[override_id].count(value_id))
-        value_map_[override_id].erase(value_id);
+      auto it = value_map_.find(override_id);
+      if (it != value_map_.end() && it->second.erase(value_id))
+        invalidate();
     }
 
     void removeValue(theme::ValueId value_id) { removeValue({}, value_id); }
 
-    int colorMap(theme::OverrideId override_id, theme::ColorId color_id) {
-      return color_map_[override_id][color_id];
+    int colorMap(theme::OverrideId override_id, theme::ColorId color_id) const {
+      auto it = color_map_.find(override_id);
+      if (it == color_map_.end())
+        return kNotSetId;
+      auto index = it->second.find(color_id);
+      return index == it->second.end() ? kNotSetId : index->second;
     }
 
-    bool value(theme::OverrideId override_id, theme::ValueId value_id, float& result) {
-      value_map_[override_id].try_emplace(value_id, kNotSetValue);
-      result = value_map_[override_id][value_id];
-      return result != kNotSetValue;
+    bool value(theme::OverrideId override_id, theme::ValueId value_id, float& result) const {
+      std::shared_ptr<const CompiledPalette> tables = compiled();
+      if (!tables->hasValue(override_id, value_id))
+        return false;
+
+      result = tables->value(override_id, value_id);
+      return true;
     }
 
     int addColor(const Color& color = 0xffff00ff) {
       colors_.emplace_back(Brush::solid(color));
+      invalidate();
       return colors_.size() - 1;
     }
 
     int addBrush(const Brush& color) {
       colors_.emplace_back(color);
+      invalidate();
       return colors_.size() - 1;
     }
 
@@ -153,6 +247,7 @@ namespace visage {
       color_map_.clear();
       value_map_.clear();
       colors_.clear();
+      invalidate();
     }
 
     void removeColor(int index);
@@ -161,8 +256,16 @@ namespace visage {
     void decode(const std::string& data);
 
   private:
+    friend class CompiledPalette;
+
+    void invalidate() { version_.fetch_add(1, std::memory_order_acq_rel); }
+
     std::vector<Brush> colors_;
     std::map<theme::OverrideId, std::map<theme::ColorId, int>> color_map_;
     std::map<theme::OverrideId, std::map<theme::ValueId, float>> value_map_;
+
+    std::atomic<unsigned int> version_ = 1;
+    mutable std::mutex compile_mutex_;
+    mutable std::shared_ptr<const CompiledPalette> compiled_;
   };
 }
\ No newline at end of file
@@ -63,23 +63,16 @@ namespace visage {
         bgfx::destroy(screen_index_buffer);
       if (bgfx::isValid(screen_vertex_buffer))
         bgfx::destroy(screen_vertex_buffer);
-      destroyFrameBuffers();
+      if (bgfx::isValid(inv_screen_vertex_buffer))
+        bgfx::destroy(inv_screen_vertex_buffer);
+      releaseFrameBuffers(0);
     }
 
-    void destroyFrameBuffers() {
-      for (auto& buffer : downsample_buffers1) {
-        if (bgfx::isValid(buffer))
-          bgfx::destroy(buffer);
-        buffer = BGFX_INVALID_HANDLE;
+    void releaseFrameBuffers(int start_stage) {
+      for (int i = start_stage; i < DownsamplePostEffect::kMaxDownsamples; ++i) {
+        RenderTargetPool::releaseTarget(downsample_buffers1[i]);
+        RenderTargetPool::releaseTarget(downsample_buffers2[i]);
       }
-      for (auto& buffer : downsample_buffers2) {
-        if (bgfx::isValid(buffer))
-          bgfx::destroy(buffer);
-        buffer = BGFX_INVALID_HANDLE;
-      }
-
-      bgfx::frame();
-      bgfx::frame();
     }
   };
 
@@ -110,13 +103,10 @@ namespace visage {
     }
   }
 
-  void DownsamplePostEffect::checkBuffers(const Region* region) {
-    static constexpr uint64_t kFrameBufferFlags = BGFX_TEXTURE_RT | BGFX_SAMPLER_U_CLAMP |
-                                                  BGFX_SAMPLER_V_CLAMP;
-
-    int full_width = region->width();
-    int full_height = region->height();
-    bgfx::TextureFormat::Enum format = static_cast<bgfx::TextureFormat::Enum>(region->layer()->frameBufferFormat());
+  void DownsamplePostEffect::checkBuffers(const Region* region, int stages) {
+    full_width_ = region->width();
+    full_height_ = region->height();
+    format_ = region->layer()->frameBufferFormat();
 
     if (!bgfx::isValid(handles_->screen_index_buffer)) {
       handles_->screen_index_buffer = bgfx::createIndexBuffer(bgfx::makeRef(visage::kQuadTriangles,
@@ -128,24 +118,45 @@ namespace visage {
       handles_->inv_screen_vertex_buffer = bgfx::createVertexBuffer(inv_vertex_memory, UvVertex::layout());
     }
 
-    if (full_width != full_width_ || full_height != full_height_ || format_ != format) {
-      full_width_ = full_width;
-      full_height_ = full_height;
-      format_ = format;
-      handles_->destroyFrameBuffers();
+    for (int i = 0; i < kMaxDownsamples; ++i) {
+      int scale = 1 << (i + 1);
+      widths_[i] = std::max(1, (full_width_ + scale - 1) / scale);
+      heights_[i] = std::max(1, (full_height_ + scale - 1) / scale);
+    }
+
+    handles_->releaseFrameBuffers(0);
+    for (int i = 0; i < stages; ++i) {
+      auto& buffers1 = handles_->downsample_buffers1;
+      auto& buffers2 = handles_->downsample_buffers2;
+      buffers1[i] = RenderTargetPool::acquireTarget(widths_[i], heights_[i], format_);
+      if (i > 0)
+        buffers2[i] = RenderTargetPool::acquireTarget(widths_[i], heights_[i], format_);
     }
+  }
 
-    if (!bgfx::isValid(handles_->downsample_buffers1[0])) {
-      for (int i = 0; i < kMaxDownsamples; ++i) {
-        int scale = 1 << (i + 1);
-        widths_[i] = std::max(1, (full_width + scale - 1) / scale);
-        heights_[i] = std::max(1, (full_height + scale - 1) / scale);
-        handles_->downsample_buffers1[i] = bgfx::createFrameBuffer(widths_[i], heights_[i], format,
-                                                                   kFrameBufferFlags);
-        handles_->downsample_buffers2[i] = bgfx::createFrameBuffer(widths_[i], heights_[i], format,
-                                                                   kFrameBufferFlags);
-      }
+  bgfx::FrameBufferHandle DownsamplePostEffect::blendBuffer() {
+    bgfx::FrameBufferHandle& buffer = handles_->downsample_buffers2[0];
+    if (!bgfx::isValid(buffer))
+      buffer = RenderTargetPool::acquireTarget(widths_[0], heights_[0], format_);
+    return buffer;
+  }
+
+  void DownsamplePostEffect::releaseScratchBuffers() {
+    handles_->releaseFrameBuffers(1);
+  }
+
+  long long DownsamplePostEffect::memoryBytes() const {
+    static constexpr int kBytesPerPixel = 4;
+
+    long long bytes = 0;
+    for (int i = 0; i < kMaxDownsamples; ++i) {
+      long long stage_bytes = static_cast<long long>(widths_[i]) * heights_[i] * kBytesPerPixel;
+      if (bgfx::isValid(handles_->downsample_buffers1[i]))
+        bytes += stage_bytes;
+      if (bgfx::isValid(handles_->downsample_buffers2[i]))
+        bytes += stage_bytes;
     }
+    return bytes;
   }
 
   void DownsamplePostEffect::setInitialVertices(Region* region) {
@@ -192,11 +203,10 @@ namespace visage {
   BlurPostEffect::~BlurPostEffect() = default;
 
   int BlurPostEffect::preprocess(Region* region, int submit_pass) {
-    checkBuffers(region);
-
     stages_ = 0.99f + std::max(blur_size_, 0.0f) * blur_amount_;
     stages_ = std::max(0.0f, std::min(stages_, kMaxDownsamples + 0.1f));
     int stage_index = static_cast<int>(stages_);
+    checkBuffers(region, stage_index);
     int last_width = full_width_;
     int last_height = full_height_;
 
@@ -279,6 +289,7 @@ namespace visage {
       submit_pass++;
     }
 
+    releaseScratchBuffers();
     return submit_pass;
   }
 
@@ -304,7 +315,7 @@ namespace visage {
                                                        dest_height * 0.5f / heights_[stage_index - 2]);
     }
     else {
-      destination = handles_->downsample_buffers2[0];
+      destination = blendBuffer();
       dest_width = widths_[0];
       dest_height = heights_[0];
 
@@ -440,12 +451,11 @@ namespace visage {
   BloomPostEffect::~BloomPostEffect() = default;
 
   int BloomPostEffect::preprocess(Region* region, int submit_pass) {
-    checkBuffers(region);
-
     float hdr_range = hdr() ? kHdrColorRange : 1.0f;
     float stages = std::max(std::floor(bloom_size_) + 0.99f, 0.0f);
     stages = std::max(1.0f, std::min(stages, kMaxDownsamples + 0.99f));
     downsamples_ = stages;
+    checkBuffers(region, downsamples_);
 
     setBlendMode(BlendMode::Opaque);
     setInitialVertices(region);
@@ -532,6 +542,7 @@ namespace visage {
       submit_pass++;
     }
 
+    releaseScratchBuffers();
     return submit_pass;
   }
 
@@ -33,6 +33,7 @@ namespace visage {
     virtual ~PostEffect() = default;
     virtual int preprocess(Region* region, int submit_pass) { return submit_pass; }
     virtual void submit(const SampleRegion& source, Layer& destination, int submit_pass, int x, int y) { }
+    virtual long long memoryBytes() const { return 0; }
     bool hdr() const { return hdr_; }
 
   private:
@@ -47,9 +48,13 @@ namespace visage {
 
     DownsamplePostEffect(bool hdr = false);
 
+    long long memoryBytes() const override;
+
   protected:
     void setInitialVertices(Region* region);
-    void checkBuffers(const Region* region);
+    void checkBuffers(const Region* region, int stages);
+    bgfx::FrameBufferHandle blendBuffer();
+    void releaseScratchBuffers();
     void setScreenVertexBuffer(bool inverted);
 
     int full_width_ = 0;
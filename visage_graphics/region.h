@@ -22,6 +22,7 @@
 #pragma once
 
 #include "shape_batcher.h"
+#include "visage_utils/object_arena.h"
 #include "visage_utils/space.h"
 
 namespace visage {
@@ -104,7 +105,7 @@ namespace visage {
       shape_batcher_.clear();
       text_store_.clear();
       old_brushes_.clear();
-      old_brushes_ = std::move(brushes_);
+      old_brushes_.swap(brushes_);
     }
 
     void setupIntermediateRegion();
@@ -117,13 +118,11 @@ namespace visage {
     bool needsLayer() const { return intermediate_region_.get(); }
     Region* intermediateRegion() const { return intermediate_region_.get(); }
     const PackedBrush* addBrush(GradientAtlas* atlas, const Brush& brush) {
-      brushes_.push_back(std::make_unique<PackedBrush>(atlas, brush));
-      return brushes_.back().get();
+      return brushes_.create(atlas, brush);
     }
     const PackedBrush* addBrush(GradientAtlas* atlas, const Gradient& gradient,
                                 const GradientPosition& position) {
-      brushes_.push_back(std::make_unique<PackedBrush>(atlas, gradient, position));
-      return brushes_.back().get();
+      return brushes_.create(atlas, gradient, position);
     }
 
   private:
@@ -132,8 +131,7 @@ namespace visage {
     void decrementLayer() { setLayerIndex(layer_index_ - 1); }
 
     Text* addText(const String& string, const Font& font, Font::Justification justification) {
-      text_store_.push_back(std::make_unique<Text>(string, font, justification));
-      return text_store_.back().get();
+      return text_store_.create(string, font, justification);
     }
 
     void clearSubRegions() { sub_regions_.clear(); }
@@ -155,9 +153,9 @@ namespace visage {
     Region* parent_ = nullptr;
     PostEffect* post_effect_ = nullptr;
     ShapeBatcher shape_batcher_;
-    std::vector<std::unique_ptr<PackedBrush>> brushes_;
-    std::vector<std::unique_ptr<PackedBrush>> old_brushes_;
-    std::vector<std::unique_ptr<Text>> text_store_;
+    ObjectArena<PackedBrush> brushes_;
+    ObjectArena<PackedBrush> old_brushes_;
+    ObjectArena<Text> text_store_;
     std::vector<Region*> sub_regions_;
     std::unique_ptr<Region> intermediate_region_;
   };
@@ -0,0 +1,213 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "region_submit_queue.h"
+
+#include "region.h"
+
+#include <cstdint>
+
+namespace visage {
+  void OverlapGrid::reset(int width, int height) {
+    columns_ = std::max(1, (width + kCellSize - 1) / kCellSize);
+    rows_ = std::max(1, (height + kCellSize - 1) / kCellSize);
+    cells_.assign(columns_ * rows_, {});
+  }
+
+  void OverlapGrid::add(const IBounds& bounds) {
+    forEachCell(bounds, [&](int cell) { cells_[cell].push_back(bounds); });
+  }
+
+  void OverlapGrid::remove(const IBounds& bounds) {
+    forEachCell(bounds, [&](int cell) {
+      auto& entries = cells_[cell];
+      auto found = std::find(entries.begin(), entries.end(), bounds);
+      if (found != entries.end()) {
+        *found = entries.back();
+        entries.pop_back();
+      }
+    });
+  }
+
+  bool OverlapGrid::overlaps(const IBounds& bounds) const {
+    bool result = false;
+    forEachCell(bounds, [&](int cell) {
+      if (!result) {
+        result = std::any_of(cells_[cell].begin(), cells_[cell].end(),
+                             [&bounds](const IBounds& other) { return bounds.overlaps(other); });
+      }
+    });
+    return result;
+  }
+
+  SubmitBatch* RegionSubmitQueue::Position::currentBatch() const {
+    return region->submitBatchAtPosition(index);
+  }
+
+  bool RegionSubmitQueue::Position::isDone() const {
+    return index >= region->numSubmitBatches();
+  }
+
+  IBounds RegionSubmitQueue::Position::bounds() const {
+    return { x, y, region->width(), region->height() };
+  }
+
+  void RegionSubmitQueue::addRegion(Region* region, std::vector<IBounds> invalid_rects, int x, int y) {
+    Position position = { region, std::move(invalid_rects), 0, x, y };
+    if (region->isEmpty())
+      addSubRegions(position, overlapping_);
+    else
+      activate(std::move(position));
+  }
+
+  RegionSubmitQueue::Entry RegionSubmitQueue::entryFor(size_t sequence) const {
+    const SubmitBatch* batch = positions_[sequence].currentBatch();
+    return { batch->id(), batch->blendMode(), sequence };
+  }
+
+  void RegionSubmitQueue::activate(Position position) {
+    size_t sequence = positions_.size();
+    position.active = true;
+    active_grid_.add(position.bounds());
+    positions_.push_back(std::move(position));
+    active_.insert(entryFor(sequence));
+    active_order_.push(sequence);
+  }
+
+  void RegionSubmitQueue::addSubRegions(const Position& done_position, std::vector<Position>& overlapping) {
+    const std::vector<Region*>& sub_regions = done_position.region->subRegions();
+    bool use_grid = sub_regions.size() > kSiblingGridThreshold;
+    OverlapGrid sibling_grid;
+    if (use_grid)
+      sibling_grid.reset(done_position.region->width(), done_position.region->height());
+
+    for (auto it = sub_regions.begin(); it != sub_regions.end(); ++it) {
+      Region* sub_region = *it;
+      if (!sub_region->isVisible())
+        continue;
+
+      if (sub_region->needsLayer())
+        sub_region = sub_region->intermediateRegion();
+
+      bool overlaps = false;
+      if (use_grid) {
+        overlaps = sibling_grid.overlaps({ sub_region->x(), sub_region->y(), sub_region->width(),
+                                           sub_region->height() });
+        sibling_grid.add({ (*it)->x(), (*it)->y(), (*it)->width(), (*it)->height() });
+      }
+      else {
+        overlaps = std::any_of(sub_regions.begin(), it, [sub_region](const Region* other) {
+          return other->isVisible() && sub_region->overlaps(other);
+        });
+      }
+
+      IBounds bounds(done_position.x + sub_region->x(), done_position.y + sub_region->y(),
+                     sub_region->width(), sub_region->height());
+
+      std::vector<IBounds> invalid_rects;
+      for (const IBounds& invalid_rect : done_position.invalid_rects) {
+        if (bounds.overlaps(invalid_rect))
+          invalid_rects.push_back(invalid_rect.intersection(bounds));
+      }
+
+      if (invalid_rects.empty())
+        continue;
+
+      Position position = { sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y() };
+      if (overlaps)
+        overlapping.push_back(std::move(position));
+      else if (sub_region->isEmpty())
+        addSubRegions(position, overlapping);
+      else
+        activate(std::move(position));
+    }
+  }
+
+  void RegionSubmitQueue::checkOverlappingRegions() {
+    std::vector<Position> waiting;
+    std::vector<Position> new_overlapping;
+
+    for (Position& position : overlapping_) {
+      if (active_grid_.overlaps(position.bounds()))
+        waiting.push_back(std::move(position));
+      else if (position.isDone())
+        addSubRegions(position, new_overlapping);
+      else
+        activate(std::move(position));
+    }
+
+    waiting.insert(waiting.end(), std::make_move_iterator(new_overlapping.begin()),
+                   std::make_move_iterator(new_overlapping.end()));
+    overlapping_ = std::move(waiting);
+  }
+
+  bool RegionSubmitQueue::currentKeyIsOldest() {
+    while (!positions_[active_order_.top()].active)
+      active_order_.pop();
+
+    const SubmitBatch* oldest = positions_[active_order_.top()].currentBatch();
+    return oldest->compare(current_id_, current_blend_mode_) == 0;
+  }
+
+  bool RegionSubmitQueue::nextBatches(std::vector<PositionedBatch>& batches) {
+    while (active_.empty() && !overlapping_.empty())
+      checkOverlappingRegions();
+
+    if (active_.empty())
+      return false;
+
+    if (!currentKeyIsOldest()) {
+      auto next = active_.upper_bound({ current_id_, current_blend_mode_, SIZE_MAX });
+      if (next == active_.end())
+        next = active_.begin();
+      current_id_ = next->id;
+      current_blend_mode_ = next->blend_mode;
+    }
+
+    std::vector<size_t> sequences;
+    auto end = active_.lower_bound({ current_id_, current_blend_mode_, SIZE_MAX });
+    for (auto it = active_.lower_bound({ current_id_, current_blend_mode_, 0 }); it != end; ++it)
+      sequences.push_back(it->sequence);
+    active_.erase(active_.lower_bound({ current_id_, current_blend_mode_, 0 }), end);
+
+    std::vector<size_t> done;
+    for (size_t sequence : sequences) {
+      Position& position = positions_[sequence];
+      batches.push_back({ position.currentBatch(), &position.invalid_rects, position.x, position.y });
+      position.index++;
+      if (position.isDone()) {
+        position.active = false;
+        active_grid_.remove(position.bounds());
+        done.push_back(sequence);
+      }
+      else
+        active_.insert(entryFor(sequence));
+    }
+
+    for (size_t sequence : done)
+      addSubRegions(positions_[sequence], overlapping_);
+
+    if (!done.empty())
+      checkOverlappingRegions();
+
+    return true;
+  }
+}
@@ -0,0 +1,120 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "shape_batcher.h"
+
+#include <deque>
+#include <functional>
+#include <queue>
+#include <set>
+
+namespace visage {
+  class Region;
+
+  // Buckets rectangles into coarse cells so overlap queries only test nearby entries.
+  class OverlapGrid {
+  public:
+    static constexpr int kCellSize = 64;
+
+    void reset(int width, int height);
+    void add(const IBounds& bounds);
+    void remove(const IBounds& bounds);
+    bool overlaps(const IBounds& bounds) const;
+
+  private:
+    template<typename F>
+    void forEachCell(const IBounds& bounds, F&& function) const {
+      int left = std::clamp(bounds.x() / kCellSize, 0, columns_ - 1);
+      int right = std::clamp(std::max(bounds.x(), bounds.right() - 1) / kCellSize, 0, columns_ - 1);
+      int top = std::clamp(bounds.y() / kCellSize, 0, rows_ - 1);
+      int bottom = std::clamp(std::max(bounds.y(), bounds.bottom() - 1) / kCellSize, 0, rows_ - 1);
+      for (int row = top; row <= bottom; ++row) {
+        for (int column = left; column <= right; ++column)
+          function(row * columns_ + column);
+      }
+    }
+
+    int columns_ = 1;
+    int rows_ = 1;
+    std::vector<std::vector<IBounds>> cells_;
+  };
+
+  // Orders the batches of Region trees for submission as a k-way merge keyed on batch id and
+  // blend mode, visiting keys in cyclic order so each one is submitted as few times as possible.
+  // A region that overlaps an earlier sibling waits until nothing it overlaps is still drawing.
+  class RegionSubmitQueue {
+  public:
+    static constexpr int kSiblingGridThreshold = 16;
+
+    RegionSubmitQueue(int width, int height) { active_grid_.reset(width, height); }
+
+    void addRegion(Region* region, std::vector<IBounds> invalid_rects, int x, int y);
+
+    // Fills batches with the next batch of every region sharing the following key, in the
+    // order regions were queued, and moves those regions past it. Returns false when done.
+    bool nextBatches(std::vector<PositionedBatch>& batches);
+
+  private:
+    struct Position {
+      Region* region = nullptr;
+      std::vector<IBounds> invalid_rects;
+      int index = 0;
+      int x = 0;
+      int y = 0;
+      bool active = false;
+
+      SubmitBatch* currentBatch() const;
+      bool isDone() const;
+      IBounds bounds() const;
+    };
+
+
+    struct Entry {
+      const void* id = nullptr;
+      BlendMode blend_mode = BlendMode::Opaque;
+      size_t sequence = 0;
+
+      bool operator<(const Entry& other) const {
+        if (id != other.id)
+          return std::less<const void*>()(id, other.id);
+        if (blend_mode != other.blend_mode)
+          return blend_mode < other.blend_mode;
+        return sequence < other.sequence;
+      }
+    };
+
+    Entry entryFor(size_t sequence) const;
+    void activate(Position position);
+    void addSubRegions(const Position& done_position, std::vector<Position>& overlapping);
+    void checkOverlappingRegions();
+    bool currentKeyIsOldest();
+
+    std::deque<Position> positions_;
+    std::set<Entry> active_;
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<>> active_order_;
+    std::vector<Position> overlapping_;
+    OverlapGrid active_grid_;
+    const void* current_id_ = nullptr;
+    BlendMode current_blend_mode_ = BlendMode::Opaque;
+  };
+}
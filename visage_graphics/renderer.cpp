@@ -21,12 +21,16 @@
 
 #include "renderer.h"
 
+#include "graphics_caches.h"
 #include "visage_utils/string_utils.h"
 
 #include <bgfx/bgfx.h>
 #include <bgfx/platform.h>
+#include <cstring>
 
 namespace visage {
+  static constexpr char kWindowScreenshotPrefix[] = "visage_window_screenshot_";
+
   class GraphicsCallbackHandler : public bgfx::CallbackI {
     void fatal(const char* file_path, uint16_t line, bgfx::Fatal::Enum _code, const char* error) override {
       VISAGE_LOG(String(file_path) + String(" (") + line + String(") "));
@@ -44,13 +48,24 @@ namespace visage {
     void profilerBegin(const char*, uint32_t, const char*, uint16_t) override { }
     void profilerBeginLiteral(const char*, uint32_t, const char*, uint16_t) override { }
     void profilerEnd() override { }
-    uint32_t cacheReadSize(uint64_t) override { return 0; }
-    bool cacheRead(uint64_t, void*, uint32_t) override { return false; }
-    void cacheWrite(uint64_t, const void*, uint32_t) override { }
+    uint32_t cacheReadSize(uint64_t id) override { return ProgramBinaryCache::readSize(id); }
+    bool cacheRead(uint64_t id, void* data, uint32_t size) override {
+      return ProgramBinaryCache::read(id, data, size);
+    }
+    void cacheWrite(uint64_t id, const void* data, uint32_t size) override {
+      ProgramBinaryCache::write(id, data, size);
+    }
 
     void screenShot(const char* file_path, uint32_t width, uint32_t height, uint32_t pitch,
                     const void* data, uint32_t size, bool y_flip) override {
-      Renderer::instance().setScreenshotData(static_cast<const uint8_t*>(data), width, height, pitch, true);
+      const uint8_t* pixels = static_cast<const uint8_t*>(data);
+      if (file_path && std::strncmp(file_path, kWindowScreenshotPrefix,
+                                    sizeof(kWindowScreenshotPrefix) - 1) == 0) {
+        Renderer::instance().setWindowScreenshotData(file_path, pixels, width, height, pitch,
+                                                     y_flip);
+      }
+      else
+        Renderer::instance().setScreenshotData(pixels, width, height, pitch, true);
     }
 
     void captureBegin(uint32_t, uint32_t, uint32_t, bgfx::TextureFormat::Enum, bool) override { }
@@ -92,10 +107,11 @@ namespace visage {
     if (initialized_)
       return;
 
-    callback_handler_ = std::make_unique<GraphicsCallbackHandler>();
     initialized_ = true;
-    startRenderThread();
+    if (software_rendering_)
+      return;
 
+    callback_handler_ = std::make_unique<GraphicsCallbackHandler>();
     bgfx::Init bgfx_init;
     bgfx_init.resolution.numBackBuffers = 1;
     bgfx_init.resolution.width = 0;
@@ -134,17 +150,54 @@ namespace visage {
       supported_ = supported_renderers[i] == bgfx_init.type;
 
     if (!supported_) {
-      VISAGE_ASSERT(false);
       std::string renderer_name = bgfx::getRendererName(bgfx_init.type);
-      error_message_ = renderer_name + " is required and not supported on this computer.";
+      error_message_ = renderer_name + " is not supported on this computer. Windowless canvases "
+                                       "use software rendering and windows can't be drawn.";
+      VISAGE_LOG(error_message_);
+      software_rendering_ = true;
+      return;
     }
 
+    startRenderThread();
     bgfx::init(bgfx_init);
     VISAGE_ASSERT(bgfx::getRendererType() == bgfx_init.type);
-    swap_chain_supported_ = bgfx::getCaps()->supported & BGFX_CAPS_SWAP_CHAIN;
+    const bgfx::Caps* caps = bgfx::getCaps();
+    swap_chain_supported_ = caps->supported & BGFX_CAPS_SWAP_CHAIN;
+    uint64_t device_key = (static_cast<uint64_t>(caps->rendererType) << 32) |
+                          (static_cast<uint64_t>(caps->vendorId) << 16) | caps->deviceId;
+    ProgramBinaryCache::setDeviceKey(device_key);
   }
 
   void Renderer::setScreenshotData(const uint8_t* data, int width, int height, int pitch, bool blue_red) {
     screenshot_ = Screenshot(data, width, height, pitch, blue_red);
   }
+
+  std::string Renderer::nextWindowScreenshotName() {
+    return kWindowScreenshotPrefix + std::to_string(next_window_screenshot_++);
+  }
+
+  void Renderer::setWindowScreenshotData(const std::string& name, const uint8_t* data, int width,
+                                         int height, int pitch, bool y_flip) {
+    Screenshot screenshot;
+    screenshot.setDimensions(width, height);
+    for (int y = 0; y < height; ++y) {
+      int source_row = y_flip ? height - 1 - y : y;
+      Screenshot::copyPixels(screenshot.data() + y * width * 4, data + source_row * pitch, width,
+                             true);
+    }
+
+    std::lock_guard<std::mutex> lock(window_screenshots_mutex_);
+    window_screenshots_[name] = std::move(screenshot);
+  }
+
+  bool Renderer::takeWindowScreenshot(const std::string& name, Screenshot& screenshot) {
+    std::lock_guard<std::mutex> lock(window_screenshots_mutex_);
+    auto found = window_screenshots_.find(name);
+    if (found == window_screenshots_.end())
+      return false;
+
+    screenshot = std::move(found->second);
+    window_screenshots_.erase(found);
+    return true;
+  }
 }
@@ -24,6 +24,9 @@
 #include "screenshot.h"
 #include "visage_utils/thread_utils.h"
 
+#include <map>
+#include <mutex>
+
 namespace visage {
   class GraphicsCallbackHandler;
 
@@ -38,11 +41,29 @@ namespace visage {
     void setScreenshotData(const uint8_t* data, int width, int height, int pitch, bool blue_red);
     const Screenshot& screenshot() const { return screenshot_; }
 
+    // Window captures requested with bgfx::requestScreenShot under a name from
+    // nextWindowScreenshotName() arrive on the render thread and wait here until taken.
+    std::string nextWindowScreenshotName();
+    void setWindowScreenshotData(const std::string& name, const uint8_t* data, int width,
+                                 int height, int pitch, bool y_flip);
+    bool takeWindowScreenshot(const std::string& name, Screenshot& screenshot);
+
     const std::string& errorMessage() const { return error_message_; }
     bool supported() const { return supported_; }
     bool swapChainSupported() const { return swap_chain_supported_; }
     bool initialized() const { return initialized_; }
 
+    void setSoftwareRendering(bool software) {
+      VISAGE_ASSERT(!initialized_);
+      software_rendering_ = software;
+    }
+    bool softwareRendering() const { return software_rendering_; }
+
+    // Text, images and complex shapes upload reduced precision vertices unless this is turned off.
+    // HDR layers always draw with full precision vertices.
+    void setCompactVertices(bool compact) { compact_vertices_ = compact; }
+    bool compactVertices() const { return compact_vertices_; }
+
   private:
     void startRenderThread();
     void render();
@@ -51,8 +72,13 @@ namespace visage {
     bool initialized_ = false;
     bool supported_ = false;
     bool swap_chain_supported_ = false;
+    bool software_rendering_ = false;
+    bool compact_vertices_ = true;
 
     Screenshot screenshot_;
+    std::mutex window_screenshots_mutex_;
+    std::map<std::string, Screenshot> window_screenshots_;
+    std::atomic<unsigned int> next_window_screenshot_ = 0;
     std::string error_message_;
     std::atomic<bool> render_thread_started_ = false;
     std::unique_ptr<GraphicsCallbackHandler> callback_handler_;
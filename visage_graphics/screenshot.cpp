@@ -24,7 +24,51 @@
 #include <bimg/bimg.h>
 #include <bx/file.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VISAGE_SCREENSHOT_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VISAGE_SCREENSHOT_NEON 1
+#endif
+
 namespace visage {
+  void Screenshot::copyPixels(uint8_t* dest, const uint8_t* source, int num_pixels, bool blue_red) {
+    if (!blue_red) {
+      std::copy_n(source, num_pixels * 4, dest);
+      return;
+    }
+
+    int i = 0;
+#if VISAGE_SCREENSHOT_SSE2
+    const __m128i green_alpha = _mm_set1_epi32(static_cast<int>(0xff00ff00));
+    const __m128i channel = _mm_set1_epi32(0xff);
+    for (; i + 4 <= num_pixels; i += 4) {
+      __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+      __m128i red = _mm_slli_epi32(_mm_and_si128(pixels, channel), 16);
+      __m128i blue = _mm_and_si128(_mm_srli_epi32(pixels, 16), channel);
+      __m128i result = _mm_or_si128(_mm_and_si128(pixels, green_alpha), _mm_or_si128(red, blue));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), result);
+    }
+#elif VISAGE_SCREENSHOT_NEON
+    for (; i + 16 <= num_pixels; i += 16) {
+      uint8x16x4_t pixels = vld4q_u8(source + i * 4);
+      uint8x16_t red = pixels.val[0];
+      pixels.val[0] = pixels.val[2];
+      pixels.val[2] = red;
+      vst4q_u8(dest + i * 4, pixels);
+    }
+#endif
+
+    for (; i < num_pixels; ++i) {
+      uint8_t red = source[i * 4];
+      dest[i * 4] = source[i * 4 + 2];
+      dest[i * 4 + 1] = source[i * 4 + 1];
+      dest[i * 4 + 2] = red;
+      dest[i * 4 + 3] = source[i * 4 + 3];
+    }
+  }
+
   void Screenshot::save(const char* path) const {
     bx::FileWriter writer;
     bx::Error error;
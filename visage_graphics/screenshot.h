@@ -21,17 +21,21 @@
 
 #pragma once
 
+#include "visage_utils/defines.h"
 #include "visage_utils/file_system.h"
 
+#include <functional>
+
 namespace visage {
+  class Screenshot;
+  using ScreenshotCallback = std::function<void(const Screenshot&)>;
+
   class Screenshot {
   public:
     Screenshot() = default;
     Screenshot(const uint8_t* data, int width, int height, bool blue_red = false) :
         width_(width), height_(height), data_(std::make_unique<uint8_t[]>(width * height * 4)) {
-      std::copy_n(data, width * height * 4, data_.get());
-      if (blue_red)
-        flipBlueRed();
+      copyPixels(data_.get(), data, width * height, blue_red);
     }
 
     Screenshot(const uint8_t* data, int width, int height, int pitch, bool blue_red = false) :
@@ -39,14 +43,11 @@ namespace visage {
       VISAGE_ASSERT(pitch >= width * 4);
 
       if (pitch == width * 4)
-        std::copy_n(data, width * height * 4, data_.get());
+        copyPixels(data_.get(), data, width * height, blue_red);
       else {
         for (int y = 0; y < height; ++y)
-          std::copy_n(data + y * pitch, width * 4, data_.get() + y * width * 4);
+          copyPixels(data_.get() + y * width * 4, data + y * pitch, width, blue_red);
       }
-
-      if (blue_red)
-        flipBlueRed();
     }
 
     Screenshot(const Screenshot& other) : width_(other.width_), height_(other.height_) {
@@ -64,6 +65,9 @@ namespace visage {
       return *this;
     }
 
+    Screenshot(Screenshot&&) = default;
+    Screenshot& operator=(Screenshot&&) = default;
+
     void save(const char* path) const;
     void save(const std::string& path) const;
     void save(const File& file) const;
@@ -78,15 +82,10 @@ namespace visage {
     int width() const { return width_; }
     int height() const { return height_; }
 
-  private:
-    void flipBlueRed() {
-      for (int i = 0; i < width_ * height_ * 4; i += 4) {
-        uint8_t temp = data_[i];
-        data_[i] = data_[i + 2];
-        data_[i + 2] = temp;
-      }
-    }
+    // Copies RGBA pixels, optionally swapping the red and blue channels on the way.
+    static void copyPixels(uint8_t* dest, const uint8_t* source, int num_pixels, bool blue_red);
 
+  private:
     int width_ = 0;
     int height_ = 0;
     std::unique_ptr<uint8_t[]> data_;
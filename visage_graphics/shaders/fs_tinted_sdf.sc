@@ -0,0 +1,15 @@
+$input v_coordinates, v_position, v_gradient_pos, v_gradient_color_pos
+
+#include <shader_include.sh>
+
+uniform vec4 u_color_mult;
+
+SAMPLER2D(s_gradient, 0);
+SAMPLER2D(s_texture, 1);
+
+void main() {
+  vec2 gradient_pos = gradient(v_gradient_color_pos.xy, v_gradient_color_pos.zw, v_gradient_pos.xy, v_gradient_pos.zw, v_position);
+  float distance = texture2D(s_texture, v_coordinates).r - 0.5;
+  float alpha = clamp(distance / max(fwidth(distance), 0.0001) + 0.5, 0.0, 1.0);
+  gl_FragColor = u_color_mult * texture2D(s_gradient, gradient_pos) * vec4(1.0, 1.0, 1.0, alpha);
+}
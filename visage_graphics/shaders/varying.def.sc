@@ -14,3 +14,9 @@ vec4 a_texcoord0     : TEXCOORD0;
 vec4 a_texcoord1     : TEXCOORD1;
 vec4 a_texcoord2     : TEXCOORD2;
 vec4 a_texcoord3     : TEXCOORD3;
+
+vec4 i_data0         : TEXCOORD7;
+vec4 i_data1         : TEXCOORD6;
+vec4 i_data2         : TEXCOORD5;
+vec4 i_data3         : TEXCOORD4;
+vec4 i_data4         : TEXCOORD3;
@@ -0,0 +1,22 @@
+$input a_position, i_data0, i_data1, i_data2, i_data3, i_data4
+$output v_coordinates, v_dimensions, v_shader_values, v_position, v_gradient_pos, v_gradient_color_pos
+
+#include <shader_include.sh>
+
+uniform vec4 u_bounds;
+
+void main() {
+  vec2 corner = i_data0.xy + (a_position.xy * 0.5 + 0.5) * i_data0.zw;
+  vec2 expanded = corner + a_position.xy * 0.5;
+  vec2 clamped = clamp(expanded, i_data3.xy, i_data3.zw);
+  vec2 delta = clamped - expanded;
+
+  v_position = clamped;
+  v_gradient_color_pos = i_data1;
+  v_gradient_pos = i_data2;
+  v_dimensions = i_data0.zw + vec2(1.0, 1.0);
+  v_coordinates = a_position.xy + (2.0 * delta) / v_dimensions;
+  vec2 adjusted_position = clamped * u_bounds.xy + u_bounds.zw;
+  gl_Position = vec4(adjusted_position, 0.5, 1.0);
+  v_shader_values = i_data4;
+}
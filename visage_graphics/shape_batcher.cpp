@@ -25,11 +25,15 @@
 #include "font.h"
 #include "graphics_caches.h"
 #include "line.h"
+#include "renderer.h"
 #include "shader.h"
 #include "uniforms.h"
 #include "visage_utils/space.h"
 
 #include <bgfx/bgfx.h>
+#include <cfloat>
+#include <cmath>
+#include <mutex>
 
 namespace visage {
   static constexpr uint64_t blendModeValue(BlendMode blend_mode) {
@@ -106,16 +110,7 @@ namespace visage {
   }
 
   inline float inverseSqrt(float value) {
-    static constexpr float kThreeHalves = 1.5f;
-
-    float x2 = value * 0.5f;
-    float y = value;
-    int i = *reinterpret_cast<int*>(&y);
-    i = 0x5f3759df - (i >> 1);
-    y = *reinterpret_cast<float*>(&i);
-    y = y * (kThreeHalves - (x2 * y * y));
-    y = y * (kThreeHalves - (x2 * y * y));
-    return y;
+    return value > 0.0f ? 1.0f / std::sqrt(value) : FLT_MAX;
   }
 
   inline float inverseMagnitudeOfPoint(Point point) {
@@ -276,6 +271,7 @@ namespace visage {
                                 bgfx::TransientIndexBuffer* index_buffer) {
     int num_vertices = num_quads * kVerticesPerQuad;
     int num_indices = num_quads * kIndicesPerQuad;
+    VISAGE_PROFILE_COUNT(Profiler::kVertices, num_vertices);
     if (!bgfx::allocTransientBuffers(vertex_buffer, layout, num_vertices, index_buffer, num_indices)) {
       VISAGE_LOG("Not enough transient buffer memory for %d quads", num_quads);
       return false;
@@ -303,6 +299,217 @@ namespace visage {
     return vertex_buffer.data;
   }
 
+  bool supportsShapeInstancing() {
+    static const bool supported = (bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING) != 0;
+    return supported;
+  }
+
+  void setUnitQuadBuffers() {
+    UnitQuadBuffers::bind();
+  }
+
+  uint8_t* initShapeInstances(int num_instances, const bgfx::VertexLayout& layout) {
+    uint16_t stride = layout.getStride();
+    VISAGE_PROFILE_COUNT(Profiler::kShapeInstances, num_instances);
+    if (bgfx::getAvailInstanceDataBuffer(num_instances, stride) < num_instances) {
+      VISAGE_LOG("Not enough instance buffer memory for %d shapes", num_instances);
+      return nullptr;
+    }
+
+    bgfx::InstanceDataBuffer instance_buffer {};
+    bgfx::allocInstanceDataBuffer(&instance_buffer, num_instances, stride);
+    setUnitQuadBuffers();
+    bgfx::setInstanceDataBuffer(&instance_buffer);
+    return instance_buffer.data;
+  }
+
+  bool useCompactVertices(const Layer& layer) {
+    return !layer.hdr() && Renderer::instance().compactVertices();
+  }
+
+  // Cached buffers holding static GPU buffers, most recently drawn first
+  struct CachedQuadBufferList {
+    std::mutex mutex;
+    std::list<CachedQuadBuffer*> buffers;
+  };
+
+  static CachedQuadBufferList& cachedQuadBuffers() {
+    static CachedQuadBufferList list;
+    return list;
+  }
+
+  bool CachedQuadBuffer::bind(uint64_t key) {
+    if (key != key_) {
+      destroy();
+      key_ = key;
+      repeats_ = 0;
+      return false;
+    }
+
+    if (!isCached()) {
+      repeats_++;
+      return false;
+    }
+
+    if (instanced_) {
+      setUnitQuadBuffers();
+      bgfx::setInstanceDataBuffer(bgfx::VertexBufferHandle { vertex_handle_ }, 0, num_quads_);
+    }
+    else {
+      bgfx::setVertexBuffer(0, bgfx::VertexBufferHandle { vertex_handle_ });
+      bgfx::setIndexBuffer(bgfx::IndexBufferHandle { index_handle_ });
+    }
+    markUsed();
+    VISAGE_PROFILE_COUNT(Profiler::kCachedVertices, num_quads_ * kVerticesPerQuad);
+    return true;
+  }
+
+  uint8_t* CachedQuadBuffer::vertexData(int num_quads, const bgfx::VertexLayout& layout) {
+    num_quads_ = num_quads;
+    instanced_ = false;
+    vertex_data_.resize(num_quads * kVerticesPerQuad * layout.getStride());
+    VISAGE_PROFILE_COUNT(Profiler::kVertices, num_quads * kVerticesPerQuad);
+    return vertex_data_.data();
+  }
+
+  bool CachedQuadBuffer::upload(const bgfx::VertexLayout& layout) {
+    int num_indices = num_quads_ * kIndicesPerQuad;
+    const bgfx::Memory* index_memory = bgfx::alloc(num_indices * sizeof(uint16_t));
+    uint16_t* indices = reinterpret_cast<uint16_t*>(index_memory->data);
+    for (int i = 0; i < num_quads_; ++i) {
+      int vertex_index = i * kVerticesPerQuad;
+      int index = i * kIndicesPerQuad;
+      for (int v = 0; v < kIndicesPerQuad; ++v)
+        indices[index + v] = vertex_index + kQuadTriangles[v];
+    }
+
+    bgfx::VertexBufferHandle vertex_handle = bgfx::createVertexBuffer(bgfx::copy(vertex_data_.data(),
+                                                                                  vertex_data_.size()),
+                                                                       layout);
+    bgfx::IndexBufferHandle index_handle = bgfx::createIndexBuffer(index_memory);
+    vertex_data_ = {};
+    if (!bgfx::isValid(vertex_handle) || !bgfx::isValid(index_handle)) {
+      if (bgfx::isValid(vertex_handle))
+        bgfx::destroy(vertex_handle);
+      if (bgfx::isValid(index_handle))
+        bgfx::destroy(index_handle);
+      repeats_ = 0;
+      return false;
+    }
+
+    vertex_handle_ = vertex_handle.idx;
+    index_handle_ = index_handle.idx;
+    markUsed();
+    bgfx::setVertexBuffer(0, vertex_handle);
+    bgfx::setIndexBuffer(index_handle);
+    return true;
+  }
+
+  uint8_t* CachedQuadBuffer::instanceData(int num_instances, const bgfx::VertexLayout& layout) {
+    num_quads_ = num_instances;
+    instanced_ = true;
+    vertex_data_.resize(num_instances * layout.getStride());
+    VISAGE_PROFILE_COUNT(Profiler::kShapeInstances, num_instances);
+    return vertex_data_.data();
+  }
+
+  bool CachedQuadBuffer::uploadInstances(const bgfx::VertexLayout& layout) {
+    bgfx::VertexBufferHandle vertex_handle = bgfx::createVertexBuffer(bgfx::copy(vertex_data_.data(),
+                                                                                  vertex_data_.size()),
+                                                                       layout);
+    vertex_data_ = {};
+    if (!bgfx::isValid(vertex_handle)) {
+      repeats_ = 0;
+      return false;
+    }
+
+    vertex_handle_ = vertex_handle.idx;
+    markUsed();
+    setUnitQuadBuffers();
+    bgfx::setInstanceDataBuffer(vertex_handle, 0, num_quads_);
+    return true;
+  }
+
+  void CachedQuadBuffer::destroy() {
+    {
+      CachedQuadBufferList& list = cachedQuadBuffers();
+      std::lock_guard<std::mutex> lock(list.mutex);
+      if (in_lru_)
+        list.buffers.erase(lru_entry_);
+      in_lru_ = false;
+    }
+
+    releaseHandles();
+    key_ = 0;
+    repeats_ = 0;
+  }
+
+  int CachedQuadBuffer::numCachedBuffers() {
+    CachedQuadBufferList& list = cachedQuadBuffers();
+    std::lock_guard<std::mutex> lock(list.mutex);
+    return static_cast<int>(list.buffers.size());
+  }
+
+  void CachedQuadBuffer::markUsed() {
+    CachedQuadBufferList& list = cachedQuadBuffers();
+    std::lock_guard<std::mutex> lock(list.mutex);
+    if (in_lru_)
+      list.buffers.splice(list.buffers.begin(), list.buffers, lru_entry_);
+    else
+      lru_entry_ = list.buffers.insert(list.buffers.begin(), this);
+    in_lru_ = true;
+
+    while (list.buffers.size() > static_cast<size_t>(kMaxCachedBuffers)) {
+      CachedQuadBuffer* oldest = list.buffers.back();
+      list.buffers.pop_back();
+      oldest->in_lru_ = false;
+      oldest->releaseHandles();
+      oldest->repeats_ = 0;
+    }
+  }
+
+  void CachedQuadBuffer::releaseHandles() {
+    uint16_t vertex_handle = vertex_handle_;
+    uint16_t index_handle = index_handle_;
+    auto destroy_handles = [vertex_handle, index_handle] {
+      if (vertex_handle != kInvalidHandle)
+        bgfx::destroy(bgfx::VertexBufferHandle { vertex_handle });
+      if (index_handle != kInvalidHandle)
+        bgfx::destroy(bgfx::IndexBufferHandle { index_handle });
+    };
+
+    if (vertex_handle != kInvalidHandle || index_handle != kInvalidHandle)
+      DeferredGraphicsCalls::run(destroy_handles);
+
+    vertex_handle_ = kInvalidHandle;
+    index_handle_ = kInvalidHandle;
+    num_quads_ = 0;
+  }
+
+  static void hashCombine(uint64_t& hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  }
+
+  static uint64_t packPair(int first, int second) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(first)) << 32) | static_cast<uint32_t>(second);
+  }
+
+  uint64_t quadCacheKey(const Layer& layer, BlendMode blend_mode, const std::vector<PositionedBatch>& batches) {
+    uint64_t key = static_cast<uint64_t>(blend_mode) + 1;
+    hashCombine(key, layer.gradientAtlas()->version());
+    hashCombine(key, useCompactVertices(layer));
+    for (const PositionedBatch& batch : batches) {
+      hashCombine(key, reinterpret_cast<uintptr_t>(batch.batch));
+      hashCombine(key, batch.batch->modificationStamp());
+      hashCombine(key, packPair(batch.x, batch.y));
+      for (const IBounds& rect : *batch.invalid_rects) {
+        hashCombine(key, packPair(rect.x(), rect.y()));
+        hashCombine(key, packPair(rect.width(), rect.height()));
+      }
+    }
+    return key;
+  }
+
   void submitShapes(const Layer& layer, const EmbeddedFile& vertex_shader,
                     const EmbeddedFile& fragment_shader, int submit_pass) {
     setTimeUniform(layer.time());
@@ -417,7 +624,8 @@ namespace visage {
   }
 
   void submitImages(const BatchVector<ImageWrapper>& batches, const Layer& layer, int submit_pass) {
-    if (!setupQuads(batches))
+    bool compact = useCompactVertices(layer);
+    if (!setupQuads(batches, compact))
       return;
 
     const ImageAtlas* image_atlas = batches[0].shapes->front().image_atlas;
@@ -429,7 +637,7 @@ namespace visage {
     setUniformDimensions(layer.width(), layer.height());
     setColorMult(layer.hdr());
 
-    auto program = ProgramCache::programHandle(ImageWrapper::vertexShader(),
+    auto program = ProgramCache::programHandle(quadVertexShader<ImageWrapper>(compact),
                                                ImageWrapper::fragmentShader());
     bgfx::submit(submit_pass, program);
   }
@@ -467,8 +675,15 @@ namespace visage {
     if (total_length == 0)
       return;
 
-    TextureVertex* vertices = initQuadVertices<TextureVertex>(total_length);
-    if (vertices == nullptr)
+    bool compact = useCompactVertices(layer);
+    TextureVertex* vertices = nullptr;
+    CompactTextureVertex* compact_vertices = nullptr;
+    if (compact)
+      compact_vertices = initQuadVertices<CompactTextureVertex>(total_length);
+    else
+      vertices = initQuadVertices<TextureVertex>(total_length);
+
+    if (vertices == nullptr && compact_vertices == nullptr)
       return;
 
     int vertex_index = 0;
@@ -495,6 +710,14 @@ namespace visage {
           };
 
           ClampBounds positioned_clamp = clamp.withOffset(batch.x, batch.y);
+          ClampBounds clip = positioned_clamp;
+          if (compact) {
+            clip.left = std::round(clip.left);
+            clip.top = std::round(clip.top);
+            clip.right = std::round(clip.right);
+            clip.bottom = std::round(clip.bottom);
+          }
+
           float direction_x = 1.0f;
           float direction_y = 0.0f;
           int coordinate_index0 = 0;
@@ -527,9 +750,13 @@ namespace visage {
             coordinate_index3 = 2;
           }
 
-          PackedBrush::setVertexGradientPositions(text_block.brush, vertices + vertex_index,
-                                                  length * kVerticesPerQuad, x, y, batch.x, batch.y,
-                                                  x + text_block.width, y + text_block.height);
+          float texel_scale = 1.0f / text_block.font.glyphScale();
+          direction_x *= texel_scale;
+          direction_y *= texel_scale;
+
+          PackedBrush::GradientTexturePosition gradient_position =
+              PackedBrush::computeVertexGradientPositions(text_block.brush, x, y, batch.x, batch.y,
+                                                          x + text_block.width, y + text_block.height);
 
           for (int i = 0; i < length; ++i) {
             if (!overlaps(text_block.quads[i]))
@@ -545,34 +772,57 @@ namespace visage {
             float texture_width = text_block.quads[i].packed_glyph->width;
             float texture_height = text_block.quads[i].packed_glyph->height;
 
-            vertices[vertex_index].x = left;
-            vertices[vertex_index].y = top;
-            vertices[vertex_index + 1].x = right;
-            vertices[vertex_index + 1].y = top;
-            vertices[vertex_index + 2].x = left;
-            vertices[vertex_index + 2].y = bottom;
-            vertices[vertex_index + 3].x = right;
-            vertices[vertex_index + 3].y = bottom;
-
-            vertices[vertex_index + coordinate_index0].texture_x = texture_x;
-            vertices[vertex_index + coordinate_index0].texture_y = texture_y;
-            vertices[vertex_index + coordinate_index1].texture_x = texture_x + texture_width;
-            vertices[vertex_index + coordinate_index1].texture_y = texture_y;
-            vertices[vertex_index + coordinate_index2].texture_x = texture_x;
-            vertices[vertex_index + coordinate_index2].texture_y = texture_y + texture_height;
-            vertices[vertex_index + coordinate_index3].texture_x = texture_x + texture_width;
-            vertices[vertex_index + coordinate_index3].texture_y = texture_y + texture_height;
+            TextureVertex quad_vertices[kVerticesPerQuad] {};
+            PackedBrush::setVertexGradientPositions(gradient_position, quad_vertices,
+                                                    kVerticesPerQuad);
+            quad_vertices[coordinate_index0].texture_x = texture_x;
+            quad_vertices[coordinate_index0].texture_y = texture_y;
+            quad_vertices[coordinate_index1].texture_x = texture_x + texture_width;
+            quad_vertices[coordinate_index1].texture_y = texture_y;
+            quad_vertices[coordinate_index2].texture_x = texture_x;
+            quad_vertices[coordinate_index2].texture_y = texture_y + texture_height;
+            quad_vertices[coordinate_index3].texture_x = texture_x + texture_width;
+            quad_vertices[coordinate_index3].texture_y = texture_y + texture_height;
+
+            // Clip on the CPU and interpolate the atlas positions so clamped glyphs sample the
+            // same texels at any glyph scale. The shader clamp then leaves them untouched.
+            float origin_x = quad_vertices[0].texture_x;
+            float origin_y = quad_vertices[0].texture_y;
+            float across_x = quad_vertices[1].texture_x - origin_x;
+            float across_y = quad_vertices[1].texture_y - origin_y;
+            float down_x = quad_vertices[2].texture_x - origin_x;
+            float down_y = quad_vertices[2].texture_y - origin_y;
+            float clipped_left = std::clamp(left, clip.left, clip.right);
+            float clipped_right = std::clamp(right, clipped_left, clip.right);
+            float clipped_top = std::clamp(top, clip.top, clip.bottom);
+            float clipped_bottom = std::clamp(bottom, clipped_top, clip.bottom);
+            for (int v = 0; v < kVerticesPerQuad; ++v) {
+              float vertex_x = (v & 1) ? clipped_right : clipped_left;
+              float vertex_y = (v & 2) ? clipped_bottom : clipped_top;
+              float t_x = right > left ? (vertex_x - left) / (right - left) : 0.0f;
+              float t_y = bottom > top ? (vertex_y - top) / (bottom - top) : 0.0f;
+              quad_vertices[v].x = vertex_x;
+              quad_vertices[v].y = vertex_y;
+              quad_vertices[v].texture_x = origin_x + t_x * across_x + t_y * down_x;
+              quad_vertices[v].texture_y = origin_y + t_x * across_y + t_y * down_y;
+            }
 
             for (int v = 0; v < kVerticesPerQuad; ++v) {
-              int index = vertex_index + v;
-              vertices[index].clamp_left = positioned_clamp.left;
-              vertices[index].clamp_top = positioned_clamp.top;
-              vertices[index].clamp_right = positioned_clamp.right;
-              vertices[index].clamp_bottom = positioned_clamp.bottom;
-              vertices[index].direction_x = direction_x;
-              vertices[index].direction_y = direction_y;
+              quad_vertices[v].clamp_left = positioned_clamp.left;
+              quad_vertices[v].clamp_top = positioned_clamp.top;
+              quad_vertices[v].clamp_right = positioned_clamp.right;
+              quad_vertices[v].clamp_bottom = positioned_clamp.bottom;
+              quad_vertices[v].direction_x = direction_x;
+              quad_vertices[v].direction_y = direction_y;
             }
 
+            if (compact) {
+              for (int v = 0; v < kVerticesPerQuad; ++v)
+                compact_vertices[vertex_index + v] = CompactTextureVertex(quad_vertices[v]);
+            }
+            else
+              std::copy(quad_vertices, quad_vertices + kVerticesPerQuad, vertices + vertex_index);
+
             vertex_index += kVerticesPerQuad;
           }
         }
@@ -587,8 +837,10 @@ namespace visage {
     setTexture<Uniforms::kTexture>(1, font.textureHandle());
     setUniformDimensions(layer.width(), layer.height());
     setColorMult(layer.hdr());
-    bgfx::submit(submit_pass,
-                 ProgramCache::programHandle(shaders::vs_tinted_texture, shaders::fs_tinted_texture));
+    const EmbeddedFile& fragment = font.sdf() ? shaders::fs_tinted_sdf : shaders::fs_tinted_texture;
+    const EmbeddedFile& vertex = compact ? shaders::vs_tinted_texture_compact
+                                         : shaders::vs_tinted_texture;
+    bgfx::submit(submit_pass, ProgramCache::programHandle(vertex, fragment));
   }
 
   void submitShader(const BatchVector<ShaderWrapper>& batches, const Layer& layer, int submit_pass) {
@@ -24,10 +24,15 @@
 #include "graphics_utils.h"
 #include "post_effects.h"
 #include "shapes.h"
+#include "software_renderer.h"
+#include "visage_utils/profiler.h"
 #include "visage_utils/space.h"
 
 #include <algorithm>
+#include <atomic>
+#include <list>
 #include <numeric>
+#include <type_traits>
 
 #ifndef NDEBUG
 #include <random>
@@ -96,6 +101,10 @@ namespace visage {
                                 bgfx::TransientVertexBuffer* vertex_buffer,
                                 bgfx::TransientIndexBuffer* index_buffer);
   uint8_t* initQuadVerticesWithLayout(int num_quads, const bgfx::VertexLayout& layout);
+  bool supportsShapeInstancing();
+  void setUnitQuadBuffers();
+  uint8_t* initShapeInstances(int num_instances, const bgfx::VertexLayout& layout);
+  bool useCompactVertices(const Layer& layer);
   template<typename T>
   T* initQuadVertices(int num_quads) {
     return reinterpret_cast<T*>(initQuadVerticesWithLayout(num_quads, T::layout()));
@@ -104,6 +113,47 @@ namespace visage {
   void submitShapes(const Layer& layer, const EmbeddedFile& vertex_shader,
                     const EmbeddedFile& fragment_shader, int submit_pass);
 
+  // Static vertex and index buffer for a batch whose quads came out identical on consecutive
+  // submits. Keeps the generated vertices, or shape instances, on the GPU until the cache key
+  // changes. At most kMaxCachedBuffers are live at once, the least recently drawn are released.
+  class CachedQuadBuffer {
+  public:
+    static constexpr int kMaxCachedBuffers = 256;
+
+    CachedQuadBuffer() = default;
+    ~CachedQuadBuffer() { destroy(); }
+
+    CachedQuadBuffer(const CachedQuadBuffer&) = delete;
+    CachedQuadBuffer& operator=(const CachedQuadBuffer&) = delete;
+
+    bool bind(uint64_t key);
+    bool shouldCache() const { return repeats_ > 0; }
+    uint8_t* vertexData(int num_quads, const bgfx::VertexLayout& layout);
+    bool upload(const bgfx::VertexLayout& layout);
+    uint8_t* instanceData(int num_instances, const bgfx::VertexLayout& layout);
+    bool uploadInstances(const bgfx::VertexLayout& layout);
+    void destroy();
+    bool isCached() const { return vertex_handle_ != kInvalidHandle; }
+
+    static int numCachedBuffers();
+
+  private:
+    static constexpr uint16_t kInvalidHandle = 0xffff;
+
+    void markUsed();
+    void releaseHandles();
+
+    uint64_t key_ = 0;
+    int repeats_ = 0;
+    int num_quads_ = 0;
+    bool instanced_ = false;
+    uint16_t vertex_handle_ = kInvalidHandle;
+    uint16_t index_handle_ = kInvalidHandle;
+    std::vector<uint8_t> vertex_data_;
+    std::list<CachedQuadBuffer*>::iterator lru_entry_;
+    bool in_lru_ = false;
+  };
+
   void submitLine(const LineWrapper& line_wrapper, const Layer& layer, int submit_pass);
   void submitLineFill(const LineFillWrapper& line_fill_wrapper, const Layer& layer, int submit_pass);
   void submitImages(const BatchVector<ImageWrapper>& batches, const Layer& layer, int submit_pass);
@@ -111,45 +161,210 @@ namespace visage {
   void submitShader(const BatchVector<ShaderWrapper>& batches, const Layer& layer, int submit_pass);
   void submitSampleRegions(const BatchVector<SampleRegion>& batches, const Layer& layer, int submit_pass);
 
+  template<typename T, typename F>
+  void forEachShapePiece(const BatchVector<T>& batches, F&& callback) {
+    for (const auto& batch : batches) {
+      for (const T& shape : *batch.shapes) {
+        for (const IBounds& invalid_rect : *batch.invalid_rects) {
+          ClampBounds clamp = shape.clamp.clamp(invalid_rect.x() - batch.x, invalid_rect.y() - batch.y,
+                                                invalid_rect.width(), invalid_rect.height());
+          if (!shape.totallyClamped(clamp))
+            callback(shape, clamp.withOffset(batch.x, batch.y), batch.x, batch.y);
+        }
+      }
+    }
+  }
+
+  template<typename T>
+  void setQuadVertices(const BatchVector<T>& batches, typename T::Vertex* vertices, int num_shapes) {
+    int vertex_index = 0;
+    forEachShapePiece(batches, [&](const T& shape, ClampBounds clamp, int x, int y) {
+      setQuadPositions(vertices + vertex_index, shape, clamp, x, y);
+      shape.setVertexData(vertices + vertex_index);
+      vertex_index += kVerticesPerQuad;
+    });
+
+    // debugVertices(vertices, num_shapes, kVerticesPerQuad);
+    VISAGE_ASSERT(vertex_index == num_shapes * kVerticesPerQuad);
+  }
+
+  template<typename T, typename = void>
+  struct HasInstanceVertexShader : std::false_type { };
+
+  template<typename T>
+  struct HasInstanceVertexShader<T, std::void_t<decltype(T::instanceVertexShader())>> :
+      std::true_type { };
+
+  // Shapes with an instance vertex shader upload one ShapeInstance each instead of four vertices
+  template<typename T>
+  constexpr bool instancesShapes() {
+    return HasInstanceVertexShader<T>::value && std::is_same_v<typename T::Vertex, ShapeVertex>;
+  }
+
+  template<typename T>
+  void setShapeInstances(const BatchVector<T>& batches, ShapeInstance* instances, int num_shapes) {
+    int instance_index = 0;
+    ShapeVertex corners[kVerticesPerQuad];
+    forEachShapePiece(batches, [&](const T& shape, ClampBounds clamp, int x, int y) {
+      setQuadPositions(corners, shape, clamp, x, y);
+      shape.setVertexData(corners);
+      instances[instance_index++] = ShapeInstance(corners[0]);
+    });
+
+    VISAGE_ASSERT(instance_index == num_shapes);
+  }
+
   template<typename T>
-  bool setupQuads(const BatchVector<T>& batches) {
+  bool setupShapeInstances(const BatchVector<T>& batches, CachedQuadBuffer& cache, uint64_t key) {
+    if (cache.bind(key))
+      return true;
+
     int num_shapes = numShapes(batches);
     if (num_shapes == 0)
       return false;
 
-    auto vertices = initQuadVertices<typename T::Vertex>(num_shapes);
-    if (vertices == nullptr)
+    const bgfx::VertexLayout& layout = ShapeInstance::layout();
+    if (cache.shouldCache()) {
+      auto instances = reinterpret_cast<ShapeInstance*>(cache.instanceData(num_shapes, layout));
+      setShapeInstances(batches, instances, num_shapes);
+      if (cache.uploadInstances(layout))
+        return true;
+    }
+
+    auto instances = reinterpret_cast<ShapeInstance*>(initShapeInstances(num_shapes, layout));
+    if (instances == nullptr)
       return false;
+
+    setShapeInstances(batches, instances, num_shapes);
+    return true;
+  }
+
+  template<typename T, typename = void>
+  struct HasCompactVertexShader : std::false_type { };
+
+  template<typename T>
+  struct HasCompactVertexShader<T, std::void_t<decltype(T::compactVertexShader())>> :
+      std::true_type { };
+
+  template<typename T>
+  constexpr bool compactsVertices() {
+    return HasCompactVertexShader<T>::value;
+  }
+
+  template<typename T>
+  const EmbeddedFile& quadVertexShader(bool compact) {
+    if constexpr (compactsVertices<T>()) {
+      if (compact)
+        return T::compactVertexShader();
+    }
+    return T::vertexShader();
+  }
+
+  template<typename T, typename C>
+  void setCompactQuadVertices(const BatchVector<T>& batches, C* vertices, int num_shapes) {
     int vertex_index = 0;
+    typename T::Vertex corners[kVerticesPerQuad];
+    forEachShapePiece(batches, [&](const T& shape, ClampBounds clamp, int x, int y) {
+      setQuadPositions(corners, shape, clamp, x, y);
+      shape.setVertexData(corners);
+      for (int v = 0; v < kVerticesPerQuad; ++v)
+        vertices[vertex_index++] = C(corners[v]);
+    });
 
-    for (const auto& batch : batches) {
-      for (const T& shape : *batch.shapes) {
-        for (const IBounds& invalid_rect : *batch.invalid_rects) {
-          ClampBounds clamp = shape.clamp.clamp(invalid_rect.x() - batch.x, invalid_rect.y() - batch.y,
-                                                invalid_rect.width(), invalid_rect.height());
-          if (shape.totallyClamped(clamp))
-            continue;
+    VISAGE_ASSERT(vertex_index == num_shapes * kVerticesPerQuad);
+  }
 
-          clamp = clamp.withOffset(batch.x, batch.y);
-          setQuadPositions(vertices + vertex_index, shape, clamp, batch.x, batch.y);
-          shape.setVertexData(vertices + vertex_index);
-          vertex_index += kVerticesPerQuad;
-        }
+  template<typename T>
+  bool setupQuads(const BatchVector<T>& batches, bool compact = false) {
+    int num_shapes = numShapes(batches);
+    if (num_shapes == 0)
+      return false;
+
+    if constexpr (compactsVertices<T>()) {
+      if (compact) {
+        using Compact = typename CompactVertex<typename T::Vertex>::Type;
+        auto vertices = initQuadVertices<Compact>(num_shapes);
+        if (vertices == nullptr)
+          return false;
+
+        setCompactQuadVertices(batches, vertices, num_shapes);
+        return true;
       }
     }
 
-    // debugVertices(vertices, num_shapes, kVerticesPerQuad);
-    VISAGE_ASSERT(vertex_index == num_shapes * kVerticesPerQuad);
+    auto vertices = initQuadVertices<typename T::Vertex>(num_shapes);
+    if (vertices == nullptr)
+      return false;
+
+    setQuadVertices(batches, vertices, num_shapes);
     return true;
   }
 
+  template<typename T>
+  bool setupCachedQuads(const BatchVector<T>& batches, CachedQuadBuffer& cache, uint64_t key,
+                        bool compact = false) {
+    if (cache.bind(key))
+      return true;
+
+    if (!cache.shouldCache())
+      return setupQuads(batches, compact);
+
+    int num_shapes = numShapes(batches);
+    if (num_shapes == 0)
+      return false;
+
+    if constexpr (compactsVertices<T>()) {
+      if (compact) {
+        using Compact = typename CompactVertex<typename T::Vertex>::Type;
+        const bgfx::VertexLayout& layout = Compact::layout();
+        auto vertices = reinterpret_cast<Compact*>(cache.vertexData(num_shapes, layout));
+        setCompactQuadVertices(batches, vertices, num_shapes);
+        return cache.upload(layout) || setupQuads(batches, compact);
+      }
+    }
+
+    const bgfx::VertexLayout& layout = T::Vertex::layout();
+    auto vertices = reinterpret_cast<typename T::Vertex*>(cache.vertexData(num_shapes, layout));
+    setQuadVertices(batches, vertices, num_shapes);
+    return cache.upload(layout) || setupQuads(batches, compact);
+  }
+
   template<typename T>
   static void submitShapes(const BatchVector<T>& batches, BlendMode state, Layer& layer, int submit_pass) {
-    if (!setupQuads(batches))
+    bool compact = compactsVertices<T>() && useCompactVertices(layer);
+    if (!setupQuads(batches, compact))
+      return;
+
+    setBlendMode(state);
+    submitShapes(layer, quadVertexShader<T>(compact), T::fragmentShader(), submit_pass);
+  }
+
+  template<typename T>
+  static void submitCachedShapes(const BatchVector<T>& batches, BlendMode state, Layer& layer,
+                                 int submit_pass, CachedQuadBuffer& cache, uint64_t key) {
+    bool compact = compactsVertices<T>() && useCompactVertices(layer);
+    if (!setupCachedQuads(batches, cache, key, compact))
+      return;
+
+    setBlendMode(state);
+    submitShapes(layer, quadVertexShader<T>(compact), T::fragmentShader(), submit_pass);
+  }
+
+  template<typename T>
+  static void submitInstancedShapes(const BatchVector<T>& batches, BlendMode state, Layer& layer,
+                                    int submit_pass, CachedQuadBuffer& cache, uint64_t key) {
+    if (!setupShapeInstances(batches, cache, key))
       return;
 
     setBlendMode(state);
-    submitShapes(layer, T::vertexShader(), T::fragmentShader(), submit_pass);
+    submitShapes(layer, T::instanceVertexShader(), T::fragmentShader(), submit_pass);
+  }
+
+  template<typename T>
+  constexpr bool cachesQuadVertices() {
+    return !std::is_same_v<T, LineWrapper> && !std::is_same_v<T, LineFillWrapper> &&
+           !std::is_same_v<T, ImageWrapper> && !std::is_same_v<T, ShaderWrapper> &&
+           !std::is_same_v<T, TextBlock> && !std::is_same_v<T, SampleRegion>;
   }
 
   template<>
@@ -229,12 +444,27 @@ namespace visage {
     int y = 0;
   };
 
+  uint64_t quadCacheKey(const Layer& layer, BlendMode blend_mode, const std::vector<PositionedBatch>& batches);
+
+  inline int nextBatchTypeIndex() {
+    static std::atomic<int> next_index = 0;
+    return next_index++;
+  }
+
+  template<typename T>
+  int batchTypeIndex() {
+    static const int index = nextBatchTypeIndex();
+    return index;
+  }
+
   class SubmitBatch {
   public:
-    explicit SubmitBatch(BlendMode blend_mode) : blend_mode_(blend_mode) { }
+    SubmitBatch(BlendMode blend_mode, int type_index) :
+        blend_mode_(blend_mode), type_index_(type_index) { }
     virtual ~SubmitBatch() = default;
     virtual void clear() = 0;
     virtual void submit(Layer& layer, int submit_pass, const std::vector<PositionedBatch>& others) = 0;
+    virtual void rasterize(SoftwareRenderer& renderer, const IBounds& clip, int x, int y) const = 0;
 
     bool overlapsShape(const BaseShape& shape) const {
       int x = shape.x;
@@ -247,6 +477,8 @@ namespace visage {
     }
 
     const void* id() const { return id_; }
+    int typeIndex() const { return type_index_; }
+    uint64_t modificationStamp() const { return modification_stamp_; }
     void setBlendMode(BlendMode blend_mode) { blend_mode_ = blend_mode; }
     BlendMode blendMode() const { return blend_mode_; }
 
@@ -264,7 +496,11 @@ namespace visage {
 
     int compare(const SubmitBatch* other) const { return compare(other->id_, other->blend_mode_); }
 
-    void clearAreas() { areas_.clear(); }
+    void reset() {
+      id_ = nullptr;
+      areas_.clear();
+    }
+
     void addShapeArea(const BaseShape& shape) {
       VISAGE_ASSERT(id_ == nullptr || id_ == shape.batch_id);
       id_ = shape.batch_id;
@@ -277,6 +513,11 @@ namespace visage {
       id_ = id;
     }
 
+    void touch() {
+      static std::atomic<uint64_t> next_stamp = 1;
+      modification_stamp_ = next_stamp++;
+    }
+
   private:
     struct Area {
       float x, y, right, bottom;
@@ -285,37 +526,68 @@ namespace visage {
     const void* id_ = nullptr;
     std::vector<Area> areas_;
     BlendMode blend_mode_;
+    int type_index_ = 0;
+    uint64_t modification_stamp_ = 0;
   };
 
   template<typename T>
   class ShapeBatch : public SubmitBatch {
   public:
-    explicit ShapeBatch(BlendMode blend_mode) : SubmitBatch(blend_mode) { }
+    explicit ShapeBatch(BlendMode blend_mode) : SubmitBatch(blend_mode, batchTypeIndex<T>()) { }
     ~ShapeBatch() override = default;
 
     void clear() override {
-      clearAreas();
+      reset();
       shapes_.clear();
+      cached_quads_.destroy();
+      touch();
     }
 
     void submit(Layer& layer, int submit_pass, const std::vector<PositionedBatch>& batches) override {
+      VISAGE_PROFILE_SCOPE("SubmitBatch::submit");
       BatchVector<T> batch_list;
       batch_list.reserve(batches.size());
       for (const PositionedBatch& batch : batches) {
         VISAGE_ASSERT(batch.batch->id() == id());
         const std::vector<T>* shapes = &reinterpret_cast<ShapeBatch<T>*>(batch.batch)->shapes_;
         batch_list.emplace_back(shapes, batch.invalid_rects, batch.x, batch.y);
+        VISAGE_PROFILE_COUNT(Profiler::kShapes, shapes->size());
+      }
+      VISAGE_PROFILE_COUNT(Profiler::kBatches, 1);
+
+      if constexpr (instancesShapes<T>()) {
+        if (supportsShapeInstancing()) {
+          submitInstancedShapes(batch_list, blendMode(), layer, submit_pass, cached_quads_,
+                                quadCacheKey(layer, blendMode(), batches));
+          return;
+        }
+      }
+
+      if constexpr (cachesQuadVertices<T>()) {
+        submitCachedShapes(batch_list, blendMode(), layer, submit_pass, cached_quads_,
+                           quadCacheKey(layer, blendMode(), batches));
+      }
+      else
+        submitShapes(batch_list, blendMode(), layer, submit_pass);
+    }
+
+    void rasterize(SoftwareRenderer& renderer, const IBounds& clip, int x, int y) const override {
+      for (const T& shape : shapes_) {
+        ClampBounds clamp = shape.clamp.clamp(clip.x() - x, clip.y() - y, clip.width(), clip.height());
+        if (!shape.totallyClamped(clamp))
+          renderer.addShape(shape, clamp.withOffset(x, y), x, y, blendMode());
       }
-      submitShapes(batch_list, blendMode(), layer, submit_pass);
     }
 
     void addShape(T shape) {
       addShapeArea(shape);
       shapes_.push_back(std::move(shape));
+      touch();
     }
 
   private:
     std::vector<T> shapes_;
+    CachedQuadBuffer cached_quads_;
   };
 
   class ShapeBatcher {
@@ -323,7 +595,9 @@ namespace visage {
     void clear() {
       for (auto& batch : batches_) {
         batch->clear();
-        unused_batches_[batch->id()].push_back(std::move(batch));
+        if (batch->typeIndex() >= unused_batches_.size())
+          unused_batches_.resize(batch->typeIndex() + 1);
+        unused_batches_[batch->typeIndex()].push_back(std::move(batch));
       }
       batches_.clear();
     }
@@ -364,10 +638,11 @@ namespace visage {
     }
 
     template<typename T>
-    ShapeBatch<T>* createNewBatch(const void* id, BlendMode blend, int insert_index) {
-      if (!unused_batches_[id].empty()) {
-        auto batch = std::move(unused_batches_[id].back());
-        unused_batches_[id].pop_back();
+    ShapeBatch<T>* createNewBatch(BlendMode blend, int insert_index) {
+      int type_index = batchTypeIndex<T>();
+      if (type_index < unused_batches_.size() && !unused_batches_[type_index].empty()) {
+        auto batch = std::move(unused_batches_[type_index].back());
+        unused_batches_[type_index].pop_back();
         batch->setBlendMode(blend);
         batches_.insert(batches_.begin() + insert_index, std::move(batch));
       }
@@ -383,7 +658,7 @@ namespace visage {
       bool match = batch_index < batches_.size() && batches_[batch_index]->id() == shape.batch_id &&
                    batches_[batch_index]->blendMode() == blend;
       ShapeBatch<T>* batch = match ? reinterpret_cast<ShapeBatch<T>*>(batches_[batch_index].get()) :
-                                     createNewBatch<T>(shape.batch_id, blend, batch_index);
+                                     createNewBatch<T>(blend, batch_index);
 
       batch->addShape(std::move(shape));
     }
@@ -396,7 +671,7 @@ namespace visage {
 
   private:
     std::vector<std::unique_ptr<SubmitBatch>> batches_;
-    std::map<const void*, std::vector<std::unique_ptr<SubmitBatch>>> unused_batches_;
+    std::vector<std::vector<std::unique_ptr<SubmitBatch>>> unused_batches_;
     bool manual_batching_ = false;
   };
 }
\ No newline at end of file
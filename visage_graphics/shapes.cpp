@@ -33,6 +33,16 @@
     return fragment;                                \
   }
 
+#define VISAGE_SET_INSTANCE_SHADER(shape, vertex)     \
+  const EmbeddedFile& shape::instanceVertexShader() { \
+    return vertex;                                    \
+  }
+
+#define VISAGE_SET_COMPACT_SHADER(shape, vertex)     \
+  const EmbeddedFile& shape::compactVertexShader() { \
+    return vertex;                                   \
+  }
+
 namespace visage {
   VISAGE_SET_PROGRAM(Fill, shaders::vs_color, shaders::fs_color)
   VISAGE_SET_PROGRAM(Rectangle, shaders::vs_shape, shaders::fs_rectangle)
@@ -51,6 +61,20 @@ namespace visage {
   VISAGE_SET_PROGRAM(LineFillWrapper, shaders::vs_line_fill, shaders::fs_line_fill)
   VISAGE_SET_PROGRAM(SampleRegion, shaders::vs_post_effect, shaders::fs_post_effect)
 
+  VISAGE_SET_INSTANCE_SHADER(Rectangle, shaders::vs_shape_instance)
+  VISAGE_SET_INSTANCE_SHADER(RoundedRectangle, shaders::vs_shape_instance)
+  VISAGE_SET_INSTANCE_SHADER(Circle, shaders::vs_shape_instance)
+  VISAGE_SET_INSTANCE_SHADER(Squircle, shaders::vs_shape_instance)
+  VISAGE_SET_INSTANCE_SHADER(FlatArc, shaders::vs_arc_instance)
+  VISAGE_SET_INSTANCE_SHADER(RoundedArc, shaders::vs_arc_instance)
+  VISAGE_SET_INSTANCE_SHADER(Diamond, shaders::vs_shape_instance)
+
+  VISAGE_SET_COMPACT_SHADER(FlatSegment, shaders::vs_complex_shape_compact)
+  VISAGE_SET_COMPACT_SHADER(RoundedSegment, shaders::vs_complex_shape_compact)
+  VISAGE_SET_COMPACT_SHADER(Triangle, shaders::vs_complex_shape_compact)
+  VISAGE_SET_COMPACT_SHADER(QuadraticBezier, shaders::vs_complex_shape_compact)
+  VISAGE_SET_COMPACT_SHADER(ImageWrapper, shaders::vs_tinted_texture_compact)
+
   SampleRegion::SampleRegion(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                              float width, float height, const Region* region, PostEffect* post_effect) :
       Shape(region->layer(), clamp, brush, x, y, width, height), region(region),
@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <cfloat>
+#include <mutex>
 
 #define VISAGE_CREATE_BATCH_ID \
   static void* batchId() {     \
@@ -179,6 +180,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     Rectangle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
               float height) : Primitive(batchId(), clamp, brush, x, y, width, height) { }
@@ -190,6 +192,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     RoundedRectangle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                      float width, float height, float rounding) :
@@ -208,6 +211,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     Circle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width) :
         Primitive(batchId(), clamp, brush, x, y, width, width) { }
@@ -219,6 +223,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     Squircle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
              float height, float power) :
@@ -237,6 +242,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     FlatArc(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
             float height, float thickness, float center_radians, float radians) :
@@ -261,6 +267,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     RoundedArc(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
                float height, float thickness, float center_radians, float radians) :
@@ -285,6 +292,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& compactVertexShader();
 
     FlatSegment(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
                 float height, float a_x, float a_y, float b_x, float b_y, float thickness,
@@ -314,6 +322,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& compactVertexShader();
 
     RoundedSegment(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                    float width, float height, float a_x, float a_y, float b_x, float b_y,
@@ -343,6 +352,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& compactVertexShader();
 
     Triangle(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
              float height, float a_x, float a_y, float b_x, float b_y, float c_x, float c_y,
@@ -377,6 +387,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& compactVertexShader();
 
     QuadraticBezier(const ClampBounds& clamp, const PackedBrush* brush, float x, float y,
                     float width, float height, float a_x, float a_y, float b_x, float b_y,
@@ -411,6 +422,7 @@ namespace visage {
     VISAGE_CREATE_BATCH_ID
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& instanceVertexShader();
 
     Diamond(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
             float height, float rounding) :
@@ -428,6 +440,7 @@ namespace visage {
   struct ImageWrapper : Shape<TextureVertex> {
     static const EmbeddedFile& vertexShader();
     static const EmbeddedFile& fragmentShader();
+    static const EmbeddedFile& compactVertexShader();
 
     ImageWrapper(const ClampBounds& clamp, const PackedBrush* brush, float x, float y, float width,
                  float height, const ImageFile& image, ImageAtlas* image_atlas) :
@@ -486,7 +499,9 @@ namespace visage {
     }
 
     std::vector<T> vector(int size) {
+      std::unique_lock<std::mutex> lock(mutex_);
       std::vector<T> vector = removeVector(size);
+      lock.unlock();
       vector.resize(size);
       return vector;
     }
@@ -496,6 +511,7 @@ namespace visage {
         return;
 
       vector.clear();
+      std::lock_guard<std::mutex> lock(mutex_);
       auto pos = std::lower_bound(pool_.begin(), pool_.end(), vector,
                                   [](const std::vector<T>& vector, const std::vector<T>& insert) {
                                     return vector.capacity() < insert.capacity();
@@ -524,6 +540,7 @@ namespace visage {
       return {};
     }
 
+    std::mutex mutex_;
     std::vector<std::vector<T>> pool_;
   };
 
@@ -541,13 +558,9 @@ namespace visage {
       float h = height;
       if (direction == Direction::Left || direction == Direction::Right)
         std::swap(w, h);
-      if (text->multiLine()) {
-        font.setMultiLineVertexPositions(quads.data(), c_str, length, 0, 0, w, h, text->justification());
-      }
-      else {
-        font.setVertexPositions(quads.data(), c_str, length, 0, 0, w, h, text->justification(),
-                                text->characterOverride());
-      }
+      TextLayoutCache::instance().setVertexPositions(quads.data(), font, c_str, length, w, h,
+                                                     text->justification(), text->multiLine(),
+                                                     text->characterOverride());
 
       if (direction == Direction::Down) {
         for (auto& quad : quads) {
@@ -0,0 +1,610 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "software_renderer.h"
+
+#include "region.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VISAGE_SOFTWARE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VISAGE_SOFTWARE_NEON 1
+#endif
+
+namespace visage {
+  static constexpr int kSoftwareChannels = 4;
+  static constexpr float kSoftwarePi = 3.14159265358979323846f;
+
+  static inline float softwareSmoothed(float from, float to, float value) {
+    float t = std::clamp((value - from) / (to - from), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+  }
+
+  static inline float softwareBorder(float distance, float thickness, float fade) {
+    return softwareSmoothed(0.0f, 2.0f * fade, thickness - std::abs(distance + thickness));
+  }
+
+  static inline float sdSoftwareRoundedRectangle(float x, float y, float width, float height,
+                                                 float rounding) {
+    float offset_x = std::abs(x) - width + rounding;
+    float offset_y = std::abs(y) - height + rounding;
+    float outside = std::sqrt(std::max(offset_x, 0.0f) * std::max(offset_x, 0.0f) +
+                              std::max(offset_y, 0.0f) * std::max(offset_y, 0.0f));
+    return std::min(std::max(offset_x, offset_y), 0.0f) + outside - rounding;
+  }
+
+  static float sdSoftwareQuadraticBezier(float x, float y, float x1, float y1, float x2, float y2,
+                                         float x3, float y3) {
+    float a_x = x2 - x1;
+    float a_y = y2 - y1;
+    float b_x = x1 - 2.0f * x2 + x3;
+    float b_y = y1 - 2.0f * y2 + y3;
+    float c_x = a_x * 2.0f;
+    float c_y = a_y * 2.0f;
+    float d_x = x1 - x;
+    float d_y = y1 - y;
+
+    float kk = 1.0f / (b_x * b_x + b_y * b_y);
+    float kx = kk * (a_x * b_x + a_y * b_y);
+    float ky = kk * (2.0f * (a_x * a_x + a_y * a_y) + (d_x * b_x + d_y * b_y)) / 3.0f;
+    float kz = kk * (d_x * a_x + d_y * a_y);
+
+    float p = ky - kx * kx;
+    float q = kx * (2.0f * kx * kx - 3.0f * ky) + kz;
+    float h = q * q + 4.0f * p * p * p;
+
+    auto distance_at = [&](float t) {
+      float q_x = d_x + (c_x + b_x * t) * t;
+      float q_y = d_y + (c_y + b_y * t) * t;
+      return q_x * q_x + q_y * q_y;
+    };
+
+    if (h >= 0.0f) {
+      h = std::sqrt(h);
+      float t = std::cbrt((h - q) * 0.5f) + std::cbrt((-h - q) * 0.5f);
+      return std::sqrt(distance_at(std::clamp(t - kx, 0.0f, 1.0f)));
+    }
+
+    float z = std::sqrt(-p);
+    float v = std::acos(q / (p * z * 2.0f)) / 3.0f;
+    float m = std::cos(v);
+    float n = std::sin(v) * 1.732050808f;
+    float t1 = std::clamp((m + m) * z - kx, 0.0f, 1.0f);
+    float t2 = std::clamp((-n - m) * z - kx, 0.0f, 1.0f);
+    return std::sqrt(std::min(distance_at(t1), distance_at(t2)));
+  }
+
+  static float sdSoftwareFlatArc(float x, float y, float radius, float thickness,
+                                 float center_radians, float radians) {
+    float length = std::sqrt(x * x + y * y);
+    float ring = std::abs(length - radius) - thickness;
+
+    float angle = std::atan2(x, -y) - center_radians;
+    angle = angle - 2.0f * kSoftwarePi * std::floor((angle + kSoftwarePi) / (2.0f * kSoftwarePi));
+    float outside_angle = std::abs(angle) - std::min(radians, kSoftwarePi * 0.999f);
+    float angular = length * std::sin(std::clamp(outside_angle, -0.5f * kSoftwarePi, 0.5f * kSoftwarePi));
+    return std::max(ring, angular);
+  }
+
+  static inline void blendLinear(float* dest, const float* source, float factor) {
+#if VISAGE_SOFTWARE_SSE2
+    __m128 result = _mm_add_ps(_mm_loadu_ps(source), _mm_mul_ps(_mm_loadu_ps(dest), _mm_set1_ps(factor)));
+    _mm_storeu_ps(dest, result);
+#elif VISAGE_SOFTWARE_NEON
+    vst1q_f32(dest, vmlaq_n_f32(vld1q_f32(source), vld1q_f32(dest), factor));
+#else
+    for (int i = 0; i < kSoftwareChannels; ++i)
+      dest[i] = source[i] + dest[i] * factor;
+#endif
+  }
+
+  static inline void blendPixel(float* dest, const float* color, float coverage, BlendMode blend_mode) {
+    float alpha = color[3] * coverage;
+    float source[kSoftwareChannels];
+    switch (blend_mode) {
+    case BlendMode::Opaque:
+      source[0] = color[0];
+      source[1] = color[1];
+      source[2] = color[2];
+      source[3] = alpha;
+      blendLinear(dest, source, 0.0f);
+      return;
+    case BlendMode::Composite:
+      source[0] = color[0];
+      source[1] = color[1];
+      source[2] = color[2];
+      source[3] = alpha;
+      blendLinear(dest, source, 1.0f - alpha);
+      return;
+    case BlendMode::Alpha:
+      source[0] = color[0] * alpha;
+      source[1] = color[1] * alpha;
+      source[2] = color[2] * alpha;
+      source[3] = alpha;
+      blendLinear(dest, source, 1.0f - alpha);
+      return;
+    case BlendMode::Add:
+      source[0] = color[0] * alpha;
+      source[1] = color[1] * alpha;
+      source[2] = color[2] * alpha;
+      source[3] = alpha * alpha;
+      blendLinear(dest, source, 1.0f);
+      return;
+    case BlendMode::Sub:
+      dest[0] = std::max(0.0f, dest[0] - color[0] * alpha);
+      dest[1] = std::max(0.0f, dest[1] - color[1] * alpha);
+      dest[2] = std::max(0.0f, dest[2] - color[2] * alpha);
+      dest[3] = dest[3] + alpha * alpha;
+      return;
+    case BlendMode::Mult:
+      dest[0] *= color[0];
+      dest[1] *= color[1];
+      dest[2] *= color[2];
+      dest[3] *= alpha;
+      return;
+    case BlendMode::MaskAdd:
+      dest[3] = alpha + dest[3] * (1.0f - alpha);
+      return;
+    case BlendMode::MaskRemove:
+      dest[3] = std::max(0.0f, dest[3] - alpha * alpha);
+      return;
+    }
+  }
+
+  static inline void blendSpan(float* dest, int num_pixels, const float* color, BlendMode blend_mode) {
+    for (int i = 0; i < num_pixels; ++i)
+      blendPixel(dest + i * kSoftwareChannels, color, 1.0f, blend_mode);
+  }
+
+  static inline void loadColor(float* result, const Color& color) {
+    result[0] = color.red() * color.hdr();
+    result[1] = color.green() * color.hdr();
+    result[2] = color.blue() * color.hdr();
+    result[3] = color.alpha();
+  }
+
+  static inline void commandColor(float* result, const SoftwareRenderer::Command& command, float x, float y) {
+    if (command.gradient == nullptr) {
+      result[0] = result[1] = result[2] = result[3] = 1.0f;
+      return;
+    }
+
+    float t = (x - command.gradient_from_x) * command.gradient_delta_x +
+              (y - command.gradient_from_y) * command.gradient_delta_y;
+    loadColor(result, command.gradient->sample(std::clamp(t, 0.0f, 1.0f)));
+  }
+
+  static void setCommandGradient(SoftwareRenderer::Command& command, const PackedBrush* brush,
+                                 float offset_x, float offset_y, float left, float top, float right,
+                                 float bottom) {
+    if (brush == nullptr)
+      return;
+
+    command.gradient = &brush->gradient()->gradient();
+    float from_x = 0.0f;
+    float from_y = 0.0f;
+    float to_x = 0.0f;
+    float to_y = 0.0f;
+    const GradientPosition& position = brush->position();
+    if (position.shape == GradientPosition::InterpolationShape::Horizontal) {
+      from_x = left + 0.5f;
+      to_x = right - 0.5f;
+    }
+    else if (position.shape == GradientPosition::InterpolationShape::Vertical) {
+      from_y = top + 0.5f;
+      to_y = bottom - 0.5f;
+    }
+    else if (position.shape == GradientPosition::InterpolationShape::PointsLinear) {
+      from_x = offset_x + position.point_from.x;
+      from_y = offset_y + position.point_from.y;
+      to_x = offset_x + position.point_to.x;
+      to_y = offset_y + position.point_to.y;
+    }
+
+    float delta_x = to_x - from_x;
+    float delta_y = to_y - from_y;
+    float length_squared = delta_x * delta_x + delta_y * delta_y;
+    command.gradient_from_x = from_x;
+    command.gradient_from_y = from_y;
+    if (length_squared > 0.0f) {
+      command.gradient_delta_x = delta_x / length_squared;
+      command.gradient_delta_y = delta_y / length_squared;
+    }
+  }
+
+  SoftwareRenderer::SoftwareRenderer() {
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  SoftwareRenderer::~SoftwareRenderer() = default;
+
+  void SoftwareRenderer::setDimensions(int width, int height) {
+    width_ = std::max(0, width);
+    height_ = std::max(0, height);
+  }
+
+  SoftwareRenderer::Command& SoftwareRenderer::addCommand(ShapeType type, const BaseShape& shape,
+                                                          const ClampBounds& clamp, float x, float y,
+                                                          BlendMode blend_mode, float expansion) {
+    Command& command = commands_.emplace_back();
+    command.type = type;
+    command.blend_mode = blend_mode;
+    command.shape = &shape;
+    command.x = x;
+    command.y = y;
+
+    float left = std::max(clamp.left, x + shape.x - expansion);
+    float top = std::max(clamp.top, y + shape.y - expansion);
+    float right = std::min(clamp.right, x + shape.x + shape.width + expansion);
+    float bottom = std::min(clamp.bottom, y + shape.y + shape.height + expansion);
+    command.left = std::max(0, static_cast<int>(std::ceil(left - 0.5f)));
+    command.top = std::max(0, static_cast<int>(std::ceil(top - 0.5f)));
+    command.right = std::min(width_, static_cast<int>(std::ceil(right - 0.5f)));
+    command.bottom = std::min(height_, static_cast<int>(std::ceil(bottom - 0.5f)));
+
+    float shape_left = x + shape.x;
+    float shape_top = y + shape.y;
+    setCommandGradient(command, shape.brush, x, y, shape_left, shape_top, shape_left + shape.width,
+                       shape_top + shape.height);
+    return command;
+  }
+
+  void SoftwareRenderer::addShape(const TextBlock& text, const ClampBounds& clamp, float x, float y,
+                                  BlendMode blend_mode) {
+    if (text.quads.empty())
+      return;
+
+    Command& command = addCommand(ShapeType::Text, text, clamp, x, y, blend_mode, 0.0f);
+    float text_x = x + text.x;
+    float text_y = y + text.y;
+    setCommandGradient(command, text.brush, text_x, text_y, x, y, text_x + text.width,
+                       text_y + text.height);
+    command.texture = text.font.softwareAtlas();
+    command.texture_width = text.font.atlasWidth();
+    if (text.font.sdf())
+      command.distance_range = 2.0f * Font::kSdfSpread;
+  }
+
+  void SoftwareRenderer::addShape(const ImageWrapper& image, const ClampBounds& clamp, float x,
+                                  float y, BlendMode blend_mode) {
+    if (image.image_atlas != image_atlas_ ||
+        image.image_atlas->generation() != image_atlas_generation_) {
+      images_.clear();
+      image_atlas_ = image.image_atlas;
+      image_atlas_generation_ = image.image_atlas->generation();
+    }
+
+    const ImageAtlas::PackedImageRect* packed_rect = image.packed_image.packedImageRect();
+    auto cached = images_.find(packed_rect);
+    if (cached == images_.end()) {
+      std::unique_ptr<unsigned char[]> pixels = image.image_atlas->rasterizeImage(packed_rect);
+      if (pixels == nullptr)
+        return;
+      cached = images_.emplace(packed_rect, std::move(pixels)).first;
+    }
+
+    Command& command = addCommand(ShapeType::Image, image, clamp, x, y, blend_mode, 0.0f);
+    command.texture = cached->second.get();
+    command.texture_width = image.packed_image.w();
+  }
+
+  void SoftwareRenderer::addRegion(const Region* region, int x, int y, const IBounds& clip) {
+    IBounds bounds = clip.intersection({ x, y, region->width(), region->height() });
+    if (bounds.width() <= 0 || bounds.height() <= 0)
+      return;
+
+    for (int i = 0; i < region->numSubmitBatches(); ++i)
+      region->submitBatchAtPosition(i)->rasterize(*this, bounds, x, y);
+
+    for (const Region* sub_region : region->subRegions()) {
+      if (sub_region->isVisible())
+        addRegion(sub_region, x + sub_region->x(), y + sub_region->y(), bounds);
+    }
+  }
+
+  void SoftwareRenderer::render(const Region* region) {
+    commands_.clear();
+    pixels_.assign(width_ * height_ * kSoftwareChannels, 0.0f);
+    addRegion(region, region->x(), region->y(), { 0, 0, width_, height_ });
+
+    int num_tiles = (height_ + kTileHeight - 1) / kTileHeight;
+    if (num_threads_ > 1 && num_tiles > 1 && !ThreadPool::isWorkerThread()) {
+      if (thread_pool_ == nullptr)
+        thread_pool_ = std::make_unique<ThreadPool>(num_threads_);
+
+      thread_pool_->parallelFor(num_tiles, [this](int tile, int) {
+        rasterizeRows(tile * kTileHeight, std::min(height_, (tile + 1) * kTileHeight));
+      });
+    }
+    else {
+      for (int tile = 0; tile < num_tiles; ++tile)
+        rasterizeRows(tile * kTileHeight, std::min(height_, (tile + 1) * kTileHeight));
+    }
+
+    writeScreenshot();
+    commands_.clear();
+  }
+
+  void SoftwareRenderer::rasterizeRows(int top, int bottom) {
+    for (const Command& command : commands_) {
+      int command_top = std::max(top, command.top);
+      int command_bottom = std::min(bottom, command.bottom);
+      if (command_top < command_bottom && command.left < command.right)
+        rasterizeCommand(command, command_top, command_bottom);
+    }
+  }
+
+  void SoftwareRenderer::rasterizeCommand(const Command& command, int top, int bottom) {
+    if (command.type == ShapeType::Text) {
+      rasterizeText(command, top, bottom);
+      return;
+    }
+    if (command.type == ShapeType::Image) {
+      rasterizeImage(command, top, bottom);
+      return;
+    }
+
+    const BaseShape& shape = *command.shape;
+    float color[kSoftwareChannels];
+    bool solid = command.gradient == nullptr || command.gradient->resolution() <= 1;
+    if (solid)
+      commandColor(color, command, 0.0f, 0.0f);
+
+    if (command.type == ShapeType::Fill && solid) {
+      for (int y = top; y < bottom; ++y) {
+        float* row = pixels_.data() + (y * width_ + command.left) * kSoftwareChannels;
+        blendSpan(row, command.right - command.left, color, command.blend_mode);
+      }
+      return;
+    }
+
+    float center_x = command.x + shape.x + shape.width * 0.5f;
+    float center_y = command.y + shape.y + shape.height * 0.5f;
+    float dimension_x = shape.width + 1.0f;
+    float dimension_y = shape.height + 1.0f;
+
+    float thickness = command.thickness;
+    float fade = command.fade;
+
+    for (int y = top; y < bottom; ++y) {
+      float* row = pixels_.data() + y * width_ * kSoftwareChannels;
+      float position_y = 2.0f * (y + 0.5f - center_y);
+      for (int x = command.left; x < command.right; ++x) {
+        float position_x = 2.0f * (x + 0.5f - center_x);
+        float coverage = 1.0f;
+
+        switch (command.type) {
+        case ShapeType::RoundedRectangle: {
+          auto rectangle = static_cast<const RoundedRectangle*>(command.shape);
+          float distance = sdSoftwareRoundedRectangle(position_x, position_y, dimension_x,
+                                                      dimension_y, 2.0f * rectangle->rounding);
+          coverage = softwareBorder(distance, thickness + 1.0f, fade);
+          break;
+        }
+        case ShapeType::Circle: {
+          float distance = std::sqrt(position_x * position_x + position_y * position_y) - dimension_x;
+          coverage = softwareBorder(distance, thickness + 1.0f, fade);
+          break;
+        }
+        case ShapeType::FlatArc: {
+          auto arc = static_cast<const FlatArc*>(command.shape);
+          float distance = sdSoftwareFlatArc(position_x, position_y, dimension_x - thickness,
+                                             thickness, arc->center_radians, arc->radians);
+          coverage = 1.0f - softwareSmoothed(-2.0f, 0.0f, distance);
+          break;
+        }
+        case ShapeType::QuadraticBezier: {
+          auto bezier = static_cast<const QuadraticBezier*>(command.shape);
+          float distance = sdSoftwareQuadraticBezier(position_x, position_y,
+                                                     bezier->a_x * dimension_x, bezier->a_y * dimension_y,
+                                                     bezier->b_x * dimension_x, bezier->b_y * dimension_y,
+                                                     bezier->c_x * dimension_x, bezier->c_y * dimension_y);
+          coverage = 1.0f - softwareSmoothed(-2.0f, 0.0f, std::abs(distance) - thickness);
+          break;
+        }
+        default: break;
+        }
+
+        if (coverage <= 0.0f)
+          continue;
+
+        if (!solid)
+          commandColor(color, command, x + 0.5f, y + 0.5f);
+        blendPixel(row + x * kSoftwareChannels, color, coverage, command.blend_mode);
+      }
+    }
+  }
+
+  void SoftwareRenderer::rasterizeText(const Command& command, int top, int bottom) {
+    if (command.distance_range > 0.0f) {
+      rasterizeSdfText(command, top, bottom);
+      return;
+    }
+
+    auto text = static_cast<const TextBlock*>(command.shape);
+    auto atlas = static_cast<const unsigned int*>(command.texture);
+    if (atlas == nullptr)
+      return;
+
+    float text_x = command.x + text->x;
+    float text_y = command.y + text->y;
+    float color[kSoftwareChannels];
+    float texel[kSoftwareChannels];
+    for (const FontAtlasQuad& quad : text->quads) {
+      float quad_left = text_x + quad.x;
+      float quad_top = text_y + quad.y;
+      int left = std::max(command.left, static_cast<int>(std::ceil(quad_left - 0.5f)));
+      int right = std::min(command.right, static_cast<int>(std::ceil(quad_left + quad.width - 0.5f)));
+      int quad_start = std::max(top, static_cast<int>(std::ceil(quad_top - 0.5f)));
+      int quad_end = std::min(bottom, static_cast<int>(std::ceil(quad_top + quad.height - 0.5f)));
+      const PackedGlyph* glyph = quad.packed_glyph;
+
+      for (int y = quad_start; y < quad_end; ++y) {
+        float* row = pixels_.data() + y * width_ * kSoftwareChannels;
+        float v = (y + 0.5f - quad_top) / quad.height;
+        for (int x = left; x < right; ++x) {
+          float u = (x + 0.5f - quad_left) / quad.width;
+          float texture_u = u;
+          float texture_v = v;
+          if (text->direction == Direction::Down) {
+            texture_u = 1.0f - u;
+            texture_v = 1.0f - v;
+          }
+          else if (text->direction == Direction::Left) {
+            texture_u = 1.0f - v;
+            texture_v = u;
+          }
+          else if (text->direction == Direction::Right) {
+            texture_u = v;
+            texture_v = 1.0f - u;
+          }
+
+          int texture_x = std::min(glyph->width - 1, static_cast<int>(texture_u * glyph->width));
+          int texture_y = std::min(glyph->height - 1, static_cast<int>(texture_v * glyph->height));
+          unsigned int argb = atlas[(glyph->atlas_top + texture_y) * command.texture_width +
+                                    glyph->atlas_left + texture_x];
+          if ((argb >> 24) == 0)
+            continue;
+
+          loadColor(texel, Color(argb));
+          commandColor(color, command, x + 0.5f, y + 0.5f);
+          for (int c = 0; c < kSoftwareChannels; ++c)
+            color[c] *= texel[c];
+          blendPixel(row + x * kSoftwareChannels, color, 1.0f, command.blend_mode);
+        }
+      }
+    }
+  }
+
+  void SoftwareRenderer::rasterizeSdfText(const Command& command, int top, int bottom) {
+    auto text = static_cast<const TextBlock*>(command.shape);
+    auto atlas = static_cast<const unsigned int*>(command.texture);
+    if (atlas == nullptr)
+      return;
+
+    float text_x = command.x + text->x;
+    float text_y = command.y + text->y;
+    float color[kSoftwareChannels];
+    for (const FontAtlasQuad& quad : text->quads) {
+      float quad_left = text_x + quad.x;
+      float quad_top = text_y + quad.y;
+      int left = std::max(command.left, static_cast<int>(std::ceil(quad_left - 0.5f)));
+      int right = std::min(command.right, static_cast<int>(std::ceil(quad_left + quad.width - 0.5f)));
+      int quad_start = std::max(top, static_cast<int>(std::ceil(quad_top - 0.5f)));
+      int quad_end = std::min(bottom, static_cast<int>(std::ceil(quad_top + quad.height - 0.5f)));
+      const PackedGlyph* glyph = quad.packed_glyph;
+      float pixel_range = command.distance_range * (quad.width + quad.height) /
+                          (glyph->width + glyph->height);
+
+      auto alpha = [&](int x, int y) {
+        x = std::clamp(x, 0, glyph->width - 1);
+        y = std::clamp(y, 0, glyph->height - 1);
+        unsigned int argb = atlas[(glyph->atlas_top + y) * command.texture_width + glyph->atlas_left + x];
+        return (argb >> 24) * (1.0f / 255.0f);
+      };
+
+      for (int y = quad_start; y < quad_end; ++y) {
+        float* row = pixels_.data() + y * width_ * kSoftwareChannels;
+        float v = (y + 0.5f - quad_top) / quad.height;
+        for (int x = left; x < right; ++x) {
+          float u = (x + 0.5f - quad_left) / quad.width;
+          float texture_u = u;
+          float texture_v = v;
+          if (text->direction == Direction::Down) {
+            texture_u = 1.0f - u;
+            texture_v = 1.0f - v;
+          }
+          else if (text->direction == Direction::Left) {
+            texture_u = 1.0f - v;
+            texture_v = u;
+          }
+          else if (text->direction == Direction::Right) {
+            texture_u = v;
+            texture_v = 1.0f - u;
+          }
+
+          float sample_x = texture_u * glyph->width - 0.5f;
+          float sample_y = texture_v * glyph->height - 0.5f;
+          int texture_x = std::floor(sample_x);
+          int texture_y = std::floor(sample_y);
+          float t_x = sample_x - texture_x;
+          float t_y = sample_y - texture_y;
+          float top_distance = alpha(texture_x, texture_y) * (1.0f - t_x) +
+                               alpha(texture_x + 1, texture_y) * t_x;
+          float bottom_distance = alpha(texture_x, texture_y + 1) * (1.0f - t_x) +
+                                  alpha(texture_x + 1, texture_y + 1) * t_x;
+          float distance = (top_distance * (1.0f - t_y) + bottom_distance * t_y - 0.5f) * pixel_range;
+          float coverage = std::clamp(distance + 0.5f, 0.0f, 1.0f);
+          if (coverage <= 0.0f)
+            continue;
+
+          commandColor(color, command, x + 0.5f, y + 0.5f);
+          blendPixel(row + x * kSoftwareChannels, color, coverage, command.blend_mode);
+        }
+      }
+    }
+  }
+
+  void SoftwareRenderer::rasterizeImage(const Command& command, int top, int bottom) {
+    auto image = static_cast<const ImageWrapper*>(command.shape);
+    auto data = static_cast<const unsigned char*>(command.texture);
+    int image_width = command.texture_width;
+    int image_height = image->packed_image.h();
+    if (image_width <= 0 || image_height <= 0)
+      return;
+
+    float image_x = command.x + image->x;
+    float image_y = command.y + image->y;
+    float color[kSoftwareChannels];
+    for (int y = top; y < bottom; ++y) {
+      float* row = pixels_.data() + y * width_ * kSoftwareChannels;
+      float v = (y + 0.5f - image_y) / image->height;
+      int texture_y = std::clamp(static_cast<int>(v * image_height), 0, image_height - 1);
+      for (int x = command.left; x < command.right; ++x) {
+        float u = (x + 0.5f - image_x) / image->width;
+        int texture_x = std::clamp(static_cast<int>(u * image_width), 0, image_width - 1);
+        const unsigned char* texel = data + (texture_y * image_width + texture_x) * kSoftwareChannels;
+        if (texel[3] == 0)
+          continue;
+
+        commandColor(color, command, x + 0.5f, y + 0.5f);
+        for (int c = 0; c < kSoftwareChannels; ++c)
+          color[c] *= texel[c] * (1.0f / 0xff);
+        blendPixel(row + x * kSoftwareChannels, color, 1.0f, command.blend_mode);
+      }
+    }
+  }
+
+  void SoftwareRenderer::writeScreenshot() {
+    screenshot_.setDimensions(width_, height_);
+    uint8_t* data = screenshot_.data();
+    for (int i = 0; i < width_ * height_ * kSoftwareChannels; ++i) {
+      float value = std::clamp(pixels_[i], 0.0f, 1.0f);
+      data[i] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+    }
+  }
+}
@@ -0,0 +1,156 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "screenshot.h"
+#include "shapes.h"
+#include "visage_utils/space.h"
+#include "visage_utils/thread_pool.h"
+
+#include <atomic>
+#include <map>
+#include <typeinfo>
+
+namespace visage {
+  class Region;
+
+  // Rasterizes the shape stream of a Region tree on the CPU into a Screenshot.
+  // Used when no supported GPU renderer is available, e.g. headless Linux machines.
+  class SoftwareRenderer {
+  public:
+    static constexpr int kTileHeight = 32;
+
+    enum class ShapeType {
+      Fill,
+      RoundedRectangle,
+      Circle,
+      FlatArc,
+      QuadraticBezier,
+      Text,
+      Image,
+    };
+
+    struct Command {
+      ShapeType type = ShapeType::Fill;
+      BlendMode blend_mode = BlendMode::Alpha;
+      const BaseShape* shape = nullptr;
+      float x = 0.0f;
+      float y = 0.0f;
+      int left = 0;
+      int top = 0;
+      int right = 0;
+      int bottom = 0;
+      const Gradient* gradient = nullptr;
+      float gradient_from_x = 0.0f;
+      float gradient_from_y = 0.0f;
+      float gradient_delta_x = 0.0f;
+      float gradient_delta_y = 0.0f;
+      float thickness = 0.0f;
+      float fade = 1.0f;
+      const void* texture = nullptr;
+      int texture_width = 0;
+      float distance_range = 0.0f;
+    };
+
+    SoftwareRenderer();
+    ~SoftwareRenderer();
+
+    void setDimensions(int width, int height);
+    void setNumThreads(int num_threads) {
+      num_threads_ = std::max(1, num_threads);
+      if (thread_pool_ && thread_pool_->numThreads() != num_threads_)
+        thread_pool_ = nullptr;
+    }
+    int numThreads() const { return num_threads_; }
+
+    void addShape(const Fill& fill, const ClampBounds& clamp, float x, float y, BlendMode blend_mode) {
+      addCommand(ShapeType::Fill, fill, clamp, x, y, blend_mode, 1.0f);
+    }
+
+    void addShape(const RoundedRectangle& rectangle, const ClampBounds& clamp, float x, float y,
+                  BlendMode blend_mode) {
+      addPrimitive(ShapeType::RoundedRectangle, rectangle, clamp, x, y, blend_mode);
+    }
+
+    void addShape(const Circle& circle, const ClampBounds& clamp, float x, float y, BlendMode blend_mode) {
+      addPrimitive(ShapeType::Circle, circle, clamp, x, y, blend_mode);
+    }
+
+    void addShape(const FlatArc& arc, const ClampBounds& clamp, float x, float y, BlendMode blend_mode) {
+      addPrimitive(ShapeType::FlatArc, arc, clamp, x, y, blend_mode);
+    }
+
+    void addShape(const QuadraticBezier& bezier, const ClampBounds& clamp, float x, float y,
+                  BlendMode blend_mode) {
+      addPrimitive(ShapeType::QuadraticBezier, bezier, clamp, x, y, blend_mode);
+    }
+
+    void addShape(const TextBlock& text, const ClampBounds& clamp, float x, float y, BlendMode blend_mode);
+    void addShape(const ImageWrapper& image, const ClampBounds& clamp, float x, float y,
+                  BlendMode blend_mode);
+
+    // Shapes without a software rasterizer are skipped, logged once per shape type
+    template<typename T>
+    void addShape(const T&, const ClampBounds&, float, float, BlendMode) {
+      static std::atomic<bool> logged = false;
+      if (!logged.exchange(true))
+        VISAGE_LOG("Software renderer skipped unsupported shape %s", typeid(T).name());
+    }
+
+    void render(const Region* region);
+    const Screenshot& screenshot() const { return screenshot_; }
+    int numCommands() const { return commands_.size(); }
+
+  private:
+    Command& addCommand(ShapeType type, const BaseShape& shape, const ClampBounds& clamp, float x,
+                        float y, BlendMode blend_mode, float expansion);
+
+    template<typename V>
+    void addPrimitive(ShapeType type, const Primitive<V>& primitive, const ClampBounds& clamp,
+                      float x, float y, BlendMode blend_mode) {
+      Command& command = addCommand(type, primitive, clamp, x, y, blend_mode, 0.5f);
+      command.fade = primitive.pixel_width;
+      command.thickness = primitive.thickness;
+      if (primitive.thickness == kFullThickness)
+        command.thickness = (primitive.width + primitive.height) * primitive.pixel_width;
+    }
+
+    void addRegion(const Region* region, int x, int y, const IBounds& clip);
+    void rasterizeRows(int top, int bottom);
+    void rasterizeCommand(const Command& command, int top, int bottom);
+    void rasterizeText(const Command& command, int top, int bottom);
+    void rasterizeSdfText(const Command& command, int top, int bottom);
+    void rasterizeImage(const Command& command, int top, int bottom);
+    void writeScreenshot();
+
+    int width_ = 0;
+    int height_ = 0;
+    int num_threads_ = 1;
+    std::vector<Command> commands_;
+    std::vector<float> pixels_;
+    std::unique_ptr<ThreadPool> thread_pool_;
+    std::map<const void*, std::unique_ptr<unsigned char[]>> images_;
+    const ImageAtlas* image_atlas_ = nullptr;
+    int image_atlas_generation_ = 0;
+    Screenshot screenshot_;
+  };
+}
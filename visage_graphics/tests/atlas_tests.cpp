@@ -0,0 +1,141 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/graphics_utils.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+using namespace visage;
+
+namespace {
+  bool overlaps(const PackedRect& a, const PackedRect& b, int padding) {
+    return a.x < b.x + b.w + padding && b.x < a.x + a.w + padding && a.y < b.y + b.h + padding &&
+           b.y < a.y + a.h + padding;
+  }
+
+  template<typename T>
+  void checkPlacement(const PackedAtlasMap<T>& atlas_map, const std::vector<T>& ids) {
+    for (int i = 0; i < ids.size(); ++i) {
+      const PackedRect& rect = atlas_map.rectForId(ids[i]);
+      REQUIRE(rect.x >= 0);
+      REQUIRE(rect.y >= 0);
+      REQUIRE(rect.x + rect.w + atlas_map.padding() <= atlas_map.width());
+      REQUIRE(rect.y + rect.h + atlas_map.padding() <= atlas_map.height());
+      for (int j = i + 1; j < ids.size(); ++j)
+        REQUIRE_FALSE(overlaps(rect, atlas_map.rectForId(ids[j]), atlas_map.padding()));
+    }
+  }
+}
+
+TEST_CASE("Atlas growth keeps existing rects in place", "[graphics]") {
+  std::mt19937 random(3);
+  std::uniform_int_distribution<int> size(1, 40);
+  PackedAtlasMap<int> atlas_map;
+  std::vector<int> ids;
+  std::vector<PackedRect> positions;
+
+  for (int i = 0; i < 500; ++i) {
+    int width = atlas_map.width();
+    int height = atlas_map.height();
+    bool fit = atlas_map.addRect(i, size(random), size(random));
+    REQUIRE(fit == (width == atlas_map.width() && height == atlas_map.height()));
+
+    for (int j = 0; j < ids.size(); ++j) {
+      REQUIRE(atlas_map.rectForId(ids[j]).x == positions[j].x);
+      REQUIRE(atlas_map.rectForId(ids[j]).y == positions[j].y);
+    }
+    ids.push_back(i);
+    positions.push_back(atlas_map.rectForId(i));
+  }
+
+  checkPlacement(atlas_map, ids);
+}
+
+TEST_CASE("Atlas reuses space from removed rects", "[graphics]") {
+  PackedAtlasMap<int> atlas_map;
+  std::vector<int> ids;
+  for (int i = 0; i < 64; ++i) {
+    atlas_map.addRect(i, 15, 15);
+    ids.push_back(i);
+  }
+
+  int width = atlas_map.width();
+  int height = atlas_map.height();
+  for (int i = 0; i < 64; i += 2)
+    atlas_map.removeRect(i);
+  ids.erase(std::remove_if(ids.begin(), ids.end(), [](int id) { return id % 2 == 0; }), ids.end());
+
+  for (int i = 64; i < 96; ++i) {
+    REQUIRE(atlas_map.addRect(i, 15, 15));
+    ids.push_back(i);
+  }
+
+  REQUIRE(atlas_map.width() == width);
+  REQUIRE(atlas_map.height() == height);
+  REQUIRE(atlas_map.numRects() == 64);
+  checkPlacement(atlas_map, ids);
+}
+
+TEST_CASE("Atlas defragmentation moves rects up into freed space", "[graphics]") {
+  PackedAtlasMap<int> atlas_map;
+  for (int i = 0; i < 256; ++i)
+    atlas_map.addRect(i, 7, 7);
+
+  std::vector<int> ids;
+  for (int i = 0; i < 256; ++i) {
+    if (i < 192)
+      atlas_map.removeRect(i);
+    else
+      ids.push_back(i);
+  }
+
+  int lowest_bottom = 0;
+  for (int id : ids)
+    lowest_bottom = std::max(lowest_bottom, atlas_map.rectForId(id).y + 7);
+
+  int moves = 0;
+  for (int frame = 0; frame < 32; ++frame) {
+    auto relocations = atlas_map.defragment(4);
+    REQUIRE(relocations.size() <= 4);
+    for (const auto& relocation : relocations) {
+      REQUIRE(relocation.to.y < relocation.from.y);
+      REQUIRE_FALSE(overlaps(relocation.from, relocation.to, atlas_map.padding()));
+      REQUIRE(atlas_map.rectForId(relocation.id).x == relocation.to.x);
+      REQUIRE(atlas_map.rectForId(relocation.id).y == relocation.to.y);
+    }
+    moves += relocations.size();
+    checkPlacement(atlas_map, ids);
+  }
+
+  int new_lowest_bottom = 0;
+  for (int id : ids)
+    new_lowest_bottom = std::max(new_lowest_bottom, atlas_map.rectForId(id).y + 7);
+
+  REQUIRE(moves > 0);
+  REQUIRE(new_lowest_bottom < lowest_bottom);
+
+  for (int i = 0; i < 64; ++i) {
+    atlas_map.addRect(1000 + i, 7, 7);
+    ids.push_back(1000 + i);
+  }
+  checkPlacement(atlas_map, ids);
+}
@@ -0,0 +1,173 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage_graphics/canvas.h"
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+using namespace visage;
+
+namespace {
+  int countInkedPixels(const Screenshot& screenshot) {
+    int count = 0;
+    for (int i = 0; i < screenshot.width() * screenshot.height(); ++i)
+      count += screenshot.data()[i * 4 + 3] > 0x80;
+    return count;
+  }
+
+  int renderInk(const Font& font) {
+    Canvas canvas;
+    canvas.setSoftwareRendering(true);
+    canvas.setDimensions(200, 60);
+    canvas.setColor(0xffffffff);
+    canvas.text(String("Visage Hamburgefonstiv"), font, Font::kCenter, 0, 0, 200, 60);
+    canvas.submit();
+    return countInkedPixels(canvas.screenshot());
+  }
+}
+
+TEST_CASE("Sdf fonts share one atlas across sizes", "[graphics]") {
+  Font small = Font(10, fonts::DroidSansMono_ttf, 1.0f).withSdf();
+  Font large = Font(40, fonts::DroidSansMono_ttf, 1.0f).withSdf();
+  REQUIRE(small.sdf());
+  REQUIRE(small.packedFont() == large.packedFont());
+  REQUIRE(large.withDpiScale(2.0f).packedFont() == small.packedFont());
+
+  Font bitmap_small(10, fonts::DroidSansMono_ttf, 1.0f);
+  Font bitmap_large(40, fonts::DroidSansMono_ttf, 1.0f);
+  REQUIRE(bitmap_small.packedFont() != bitmap_large.packedFont());
+  REQUIRE(bitmap_small.packedFont() != small.packedFont());
+}
+
+TEST_CASE("Sdf font metrics match bitmap metrics", "[graphics]") {
+  std::u32string text = U"Visage Hamburgefonstiv";
+  for (float size : { 12.0f, 24.0f, 60.0f }) {
+    Font bitmap(size, fonts::DroidSansMono_ttf, 1.0f);
+    Font sdf = bitmap.withSdf();
+    float bitmap_width = bitmap.stringWidth(text);
+    REQUIRE(std::abs(sdf.stringWidth(text) - bitmap_width) < bitmap_width * 0.05f);
+    REQUIRE(std::abs(sdf.lineHeight() - bitmap.lineHeight()) <= 1.0f);
+    REQUIRE(std::abs(sdf.capitalHeight() - bitmap.capitalHeight()) <= 1.0f);
+  }
+}
+
+TEST_CASE("Sdf text renders like bitmap text", "[graphics]") {
+  Font bitmap(16, fonts::DroidSansMono_ttf, 1.0f);
+  int bitmap_ink = renderInk(bitmap);
+  int sdf_ink = renderInk(bitmap.withSdf());
+  REQUIRE(bitmap_ink > 0);
+  REQUIRE(std::abs(sdf_ink - bitmap_ink) < bitmap_ink / 5);
+}
+
+TEST_CASE("Text layout cache returns the same quads as layout", "[graphics]") {
+  TextLayoutCache& cache = TextLayoutCache::instance();
+  cache.clear();
+  Font font(14, fonts::DroidSansMono_ttf, 1.0f);
+  std::u32string text = U"Cached label\nwith two lines";
+  int length = text.size();
+
+  std::vector<FontAtlasQuad> expected(length);
+  font.setMultiLineVertexPositions(expected.data(), text.c_str(), length, 0, 0, 90, 60, Font::kLeft);
+
+  long long misses = cache.misses();
+  long long hits = cache.hits();
+  for (int i = 0; i < 3; ++i) {
+    std::vector<FontAtlasQuad> quads(length);
+    cache.setVertexPositions(quads.data(), font, text.c_str(), length, 90, 60, Font::kLeft, true);
+    for (int q = 0; q < length; ++q) {
+      REQUIRE(quads[q].packed_glyph == expected[q].packed_glyph);
+      REQUIRE(quads[q].x == expected[q].x);
+      REQUIRE(quads[q].y == expected[q].y);
+    }
+  }
+  REQUIRE(cache.misses() == misses + 1);
+  REQUIRE(cache.hits() == hits + 2);
+
+  std::vector<FontAtlasQuad> single_line(length);
+  cache.setVertexPositions(single_line.data(), font, text.c_str(), length, 90, 60, Font::kLeft, false);
+  REQUIRE(cache.misses() == misses + 2);
+  REQUIRE(cache.size() == 2);
+
+  cache.removeFont(font.packedFont());
+  REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("Text layout cache concurrent layouts", "[graphics]") {
+  TextLayoutCache& cache = TextLayoutCache::instance();
+  cache.clear();
+  Font font(14, fonts::DroidSansMono_ttf, 1.0f);
+  std::u32string text = U"Shared label";
+  int length = text.size();
+
+  std::vector<FontAtlasQuad> expected(length);
+  font.setVertexPositions(expected.data(), text.c_str(), length, 0, 0, 120, 20, Font::kCenter);
+
+  std::atomic<int> mismatches = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      std::vector<FontAtlasQuad> quads(length);
+      for (int i = 0; i < 200; ++i) {
+        cache.setVertexPositions(quads.data(), font, text.c_str(), length, 120, 20,
+                                 Font::kCenter, false);
+        for (int q = 0; q < length; ++q) {
+          if (quads[q].packed_glyph != expected[q].packed_glyph || quads[q].x != expected[q].x)
+            mismatches++;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  REQUIRE(mismatches == 0);
+  REQUIRE(cache.size() == 1);
+  cache.clear();
+}
+
+TEST_CASE("Unused fonts stay cached within the font memory budget", "[graphics]") {
+  std::u32string text = U"Budgeted";
+  auto load_font = [&text] {
+    Font font(27, fonts::DroidSansMono_ttf, 1.0f);
+    font.stringWidth(text);
+    return font.packedFont();
+  };
+
+  FontCache::clearStaleFonts();
+  long long start = FontCache::memoryUsage();
+  long long budget = FontCache::memoryBudget();
+
+  FontCache::setMemoryBudget(1024LL * 1024 * 1024);
+  const PackedFont* packed_font = load_font();
+  long long loaded = FontCache::memoryUsage();
+  REQUIRE(loaded > start);
+  FontCache::clearStaleFonts();
+  REQUIRE(FontCache::memoryUsage() == loaded);
+  REQUIRE(load_font() == packed_font);
+
+  FontCache::setMemoryBudget(0);
+  FontCache::clearStaleFonts();
+  REQUIRE(FontCache::memoryUsage() == start);
+  FontCache::setMemoryBudget(budget);
+}
@@ -20,6 +20,7 @@
  */
 
 #include "visage_graphics/image.h"
+#include "visage_utils/thread_utils.h"
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
@@ -29,6 +30,22 @@
 using namespace visage;
 using namespace Catch;
 
+namespace {
+  void referenceBoxBlur(std::vector<int>& values, int offset, int length, int stride, int radius) {
+    std::vector<int> source(length);
+    for (int i = 0; i < length; ++i)
+      source[i] = values[offset + i * stride];
+
+    int half = radius / 2;
+    for (int i = 0; i < length; ++i) {
+      int sum = 0;
+      for (int s = std::max(0, i - half); s <= std::min(length - 1, i + half); ++s)
+        sum += source[s];
+      values[offset + i * stride] = sum / radius;
+    }
+  }
+}
+
 TEST_CASE("Image blur", "[graphics]") {
   static constexpr int kWidth = 128;
   static constexpr int kHeight = 64;
@@ -43,4 +60,60 @@ TEST_CASE("Image blur", "[graphics]") {
     REQUIRE(image[i] == 0);
     REQUIRE(image[(kWidth * kHeight + 1) * ImageAtlas::kChannels + i] == 0);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Image blur matches separable box blur", "[graphics]") {
+  static constexpr int kWidth = 37;
+  static constexpr int kHeight = 23;
+  static constexpr int kChannels = ImageAtlas::kChannels;
+
+  std::mt19937 random(1);
+  std::vector<unsigned char> image(kWidth * kHeight * kChannels);
+  for (unsigned char& value : image)
+    value = random() % 256;
+
+  for (int blur_radius : { 1, 4, 9, 100 }) {
+    std::vector<int> expected(image.begin(), image.end());
+    int radius = std::min(blur_radius, kWidth - 1);
+    radius = radius + ((radius + 1) % 2);
+    for (int i = 0; i < 3; ++i) {
+      for (int offset = 0; offset < kHeight * kWidth * kChannels; offset += kWidth * kChannels) {
+        for (int c = 0; c < kChannels; ++c)
+          referenceBoxBlur(expected, offset + c, kWidth, kChannels, radius);
+      }
+    }
+    for (int i = 0; i < 3; ++i) {
+      for (int c = 0; c < kWidth * kChannels; ++c)
+        referenceBoxBlur(expected, c, kHeight, kWidth * kChannels, radius);
+    }
+
+    std::vector<unsigned char> blurred = image;
+    ImageAtlas::blurImage(blurred.data(), kWidth, kHeight, blur_radius);
+    for (int i = 0; i < blurred.size(); ++i)
+      REQUIRE(blurred[i] == expected[i]);
+  }
+}
+
+TEST_CASE("Image atlas decodes in the background", "[graphics]") {
+  static constexpr char kSvg[] = "<svg width='10' height='10'><rect width='10' height='10' "
+                                 "fill='#ffffff'/></svg>";
+
+  ImageAtlas atlas;
+  std::vector<ImageAtlas::PackedImage> images;
+  for (int i = 1; i <= 20; ++i)
+    images.push_back(atlas.addImage(Svg(kSvg, sizeof(kSvg) - 1, i, i, i % 3)));
+
+  for (const auto& image : images)
+    REQUIRE_FALSE(image.ready());
+  REQUIRE(atlas.decoding());
+
+  long long start = time::milliseconds();
+  while (atlas.decoding() && time::milliseconds() - start < 10000) {
+    atlas.updateDecodedImages();
+    Thread::sleep(1);
+  }
+
+  REQUIRE_FALSE(atlas.decoding());
+  for (const auto& image : images)
+    REQUIRE(image.ready());
+}
@@ -0,0 +1,84 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/line.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+
+using namespace visage;
+
+TEST_CASE("Line stream keeps the newest samples", "[graphics]") {
+  LineStream stream(10);
+  std::vector<float> samples(25);
+  for (int i = 0; i < samples.size(); ++i)
+    samples[i] = i;
+
+  stream.push(samples.data(), 7);
+  REQUIRE(stream.size() == 7);
+  REQUIRE(stream.sampleAt(0) == 0.0f);
+
+  stream.push(samples.data() + 7, 6);
+  REQUIRE(stream.size() == 10);
+  for (int i = 0; i < 10; ++i)
+    REQUIRE(stream.sampleAt(i) == 3.0f + i);
+
+  stream.push(samples.data(), 25);
+  for (int i = 0; i < 10; ++i)
+    REQUIRE(stream.sampleAt(i) == 15.0f + i);
+
+  Line line;
+  stream.decimate(line, 90.0f, 100, 1.0f, 2.0f);
+  REQUIRE(line.num_points == 10);
+  REQUIRE(line.x[9] == 90.0f);
+  REQUIRE(line.y[0] == 31.0f);
+}
+
+TEST_CASE("Line stream decimates to the min and max of each column", "[graphics]") {
+  static constexpr int kNumSamples = 100003;
+  static constexpr int kColumns = 200;
+
+  LineStream stream(kNumSamples);
+  std::vector<float> samples(kNumSamples);
+  for (int i = 0; i < kNumSamples; ++i)
+    samples[i] = std::sin(i * 0.37f) * (1.0f + i % 17);
+
+  stream.push(samples.data(), 1234);
+  stream.push(samples.data() + 1234, kNumSamples - 1234);
+  stream.push(samples.data(), 0);
+
+  Line line;
+  stream.decimate(line, 400.0f, kColumns, 0.0f, 1.0f);
+  REQUIRE(line.num_points == 2 * kColumns);
+
+  for (int c = 0; c < kColumns; ++c) {
+    int start = static_cast<int64_t>(c) * kNumSamples / kColumns;
+    int end = static_cast<int64_t>(c + 1) * kNumSamples / kColumns;
+    float min = *std::min_element(samples.begin() + start, samples.begin() + end);
+    float max = *std::max_element(samples.begin() + start, samples.begin() + end);
+
+    float first = line.y[2 * c];
+    float second = line.y[2 * c + 1];
+    REQUIRE(std::min(first, second) == min);
+    REQUIRE(std::max(first, second) == max);
+    REQUIRE(line.x[2 * c] < line.x[2 * c + 1]);
+  }
+}
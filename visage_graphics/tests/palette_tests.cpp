@@ -0,0 +1,142 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/palette.h"
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+using namespace visage;
+
+namespace {
+  const theme::ColorId kTestColor = theme::ColorId::nextId("PaletteTestColor", __FILE__,
+                                                          0xff112233);
+  const theme::ColorId kOtherColor = theme::ColorId::nextId("PaletteOtherColor", __FILE__,
+                                                           0xff445566);
+  const theme::ValueId kTestValue = theme::ValueId::nextId("PaletteTestValue", __FILE__, 3.0f);
+  const theme::OverrideId kTestOverride = theme::OverrideId::nextId("PaletteTestOverride");
+  const theme::OverrideId kEmptyOverride = theme::OverrideId::nextId("PaletteEmptyOverride");
+}
+
+TEST_CASE("Compiled palette falls back to global then defaults", "[graphics]") {
+  Palette palette;
+  palette.setColor(kTestColor, Color(0xffaabbcc));
+  palette.setColor(kTestOverride, kOtherColor, Color(0xffddeeff));
+  palette.setValue(kTestOverride, kTestValue, 7.0f);
+
+  std::shared_ptr<const CompiledPalette> compiled = palette.compiled();
+  REQUIRE(compiled->hasColor({}, kTestColor));
+  REQUIRE_FALSE(compiled->hasColor({}, kOtherColor));
+  REQUIRE_FALSE(compiled->hasColor(kTestOverride, kTestColor));
+  REQUIRE(compiled->hasColor(kTestOverride, kOtherColor));
+
+  auto argb = [&](theme::OverrideId override_id, theme::ColorId color_id) {
+    return compiled->color(override_id, color_id).gradient().sample(0.0f).toARGB();
+  };
+  REQUIRE(argb(kTestOverride, kTestColor) == 0xffaabbcc);
+  REQUIRE(argb(kTestOverride, kOtherColor) == 0xffddeeff);
+  REQUIRE(argb({}, kOtherColor) == 0xff445566);
+
+  REQUIRE_FALSE(compiled->hasValue({}, kTestValue));
+  REQUIRE(compiled->value({}, kTestValue) == 3.0f);
+  REQUIRE(compiled->value(kTestOverride, kTestValue) == 7.0f);
+
+  Brush brush;
+  REQUIRE_FALSE(palette.color({}, kOtherColor, brush));
+  REQUIRE(palette.color(kTestOverride, kOtherColor, brush));
+}
+
+TEST_CASE("Compiled palette nested overrides without entries", "[graphics]") {
+  Palette palette;
+  palette.setColor(kTestColor, Color(0xffaabbcc));
+  palette.setValue(kTestValue, 5.0f);
+  palette.setColor(kTestOverride, kTestColor, Color(0xffddeeff));
+  palette.setValue(kTestOverride, kTestValue, 7.0f);
+
+  std::shared_ptr<const CompiledPalette> compiled = palette.compiled();
+  REQUIRE_FALSE(compiled->hasColor(kEmptyOverride, kTestColor));
+  REQUIRE_FALSE(compiled->hasValue(kEmptyOverride, kTestValue));
+  REQUIRE(compiled->color(kEmptyOverride, kTestColor).gradient().sample(0.0f).toARGB() ==
+          0xffaabbcc);
+  REQUIRE(compiled->value(kEmptyOverride, kTestValue) == 5.0f);
+
+  // Same walk Frame does: the inner override has no entries so the outer one must win.
+  auto nested_color = [&](std::initializer_list<theme::OverrideId> overrides) {
+    for (theme::OverrideId override_id : overrides) {
+      if (compiled->hasColor(override_id, kTestColor))
+        return compiled->color(override_id, kTestColor).gradient().sample(0.0f).toARGB();
+    }
+    return compiled->color({}, kTestColor).gradient().sample(0.0f).toARGB();
+  };
+  auto nested_value = [&](std::initializer_list<theme::OverrideId> overrides) {
+    for (theme::OverrideId override_id : overrides) {
+      if (compiled->hasValue(override_id, kTestValue))
+        return compiled->value(override_id, kTestValue);
+    }
+    return compiled->value({}, kTestValue);
+  };
+  REQUIRE(nested_color({ kEmptyOverride, kTestOverride }) == 0xffddeeff);
+  REQUIRE(nested_value({ kEmptyOverride, kTestOverride }) == 7.0f);
+  REQUIRE(nested_color({ kEmptyOverride }) == 0xffaabbcc);
+  REQUIRE(nested_value({ kEmptyOverride }) == 5.0f);
+}
+
+TEST_CASE("Compiled palette rebuilds only after edits", "[graphics]") {
+  Palette palette;
+  palette.setColor(kTestColor, Color(0xffaabbcc));
+
+  std::shared_ptr<const CompiledPalette> compiled = palette.compiled();
+  REQUIRE(palette.compiled() == compiled);
+  REQUIRE(palette.isCurrent(*compiled));
+
+  palette.setColorMap({}, kTestColor, Palette::kInvalidId);
+  REQUIRE_FALSE(palette.isCurrent(*compiled));
+  std::shared_ptr<const CompiledPalette> rebuilt = palette.compiled();
+  REQUIRE(rebuilt != compiled);
+  Color invalid = rebuilt->color({}, kTestColor).gradient().sample(0.0f);
+  REQUIRE(invalid.toARGB() == Palette::kInvalidColor);
+
+  palette.removeValue(kTestValue);
+  REQUIRE(palette.compiled() == rebuilt);
+}
+
+TEST_CASE("Compiled palette concurrent readers", "[graphics]") {
+  Palette palette;
+  palette.setColor(kTestOverride, kTestColor, Color(0xffaabbcc));
+
+  std::vector<std::thread> threads;
+  std::atomic<int> mismatches = 0;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        Brush brush;
+        if (!palette.color(kTestOverride, kTestColor, brush) ||
+            brush.gradient().sample(0.0f).toARGB() != 0xffaabbcc)
+          mismatches++;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  REQUIRE(mismatches == 0);
+}
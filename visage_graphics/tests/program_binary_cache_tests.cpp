@@ -0,0 +1,150 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/graphics_caches.h"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+using namespace visage;
+
+namespace {
+  class TestCacheDirectory {
+  public:
+    TestCacheDirectory() {
+      directory_ = std::filesystem::temp_directory_path() / "visage_program_cache_tests";
+      std::filesystem::remove_all(directory_);
+      ProgramBinaryCache::setDirectory(directory_);
+      ProgramBinaryCache::setDeviceKey(1);
+    }
+
+    ~TestCacheDirectory() {
+      ProgramBinaryCache::setDirectory(ProgramBinaryCache::defaultDirectory());
+      ProgramBinaryCache::setMaxBytes(ProgramBinaryCache::kDefaultMaxBytes);
+      ProgramBinaryCache::setDeviceKey(0);
+      std::filesystem::remove_all(directory_);
+    }
+
+    std::vector<File> entries() const {
+      std::vector<File> result;
+      for (const auto& entry : std::filesystem::directory_iterator(directory_))
+        result.push_back(entry.path());
+      return result;
+    }
+
+  private:
+    File directory_;
+  };
+
+  std::vector<char> testBinary(int size, char seed) {
+    std::vector<char> data(size);
+    for (int i = 0; i < size; ++i)
+      data[i] = static_cast<char>(seed + i * 7);
+    return data;
+  }
+}
+
+TEST_CASE("Program binary cache round trip", "[graphics]") {
+  TestCacheDirectory directory;
+  std::vector<char> binary = testBinary(300, 3);
+
+  REQUIRE(ProgramBinaryCache::readSize(42) == 0);
+  ProgramBinaryCache::write(42, binary.data(), binary.size());
+  REQUIRE(directory.entries().size() == 1);
+
+  REQUIRE(ProgramBinaryCache::readSize(42) == binary.size());
+  std::vector<char> result(binary.size());
+  REQUIRE(ProgramBinaryCache::read(42, result.data(), result.size()));
+  REQUIRE(result == binary);
+  REQUIRE(ProgramBinaryCache::readSize(43) == 0);
+
+  ProgramBinaryCache::clear();
+  REQUIRE(directory.entries().empty());
+  REQUIRE(ProgramBinaryCache::readSize(42) == 0);
+}
+
+TEST_CASE("Program binary cache rejects corrupt and foreign entries", "[graphics]") {
+  TestCacheDirectory directory;
+  std::vector<char> binary = testBinary(128, 11);
+  ProgramBinaryCache::write(7, binary.data(), binary.size());
+  ProgramBinaryCache::write(8, binary.data(), binary.size());
+
+  File corrupt;
+  for (const File& file : directory.entries()) {
+    if (file.filename().string().find("7.bin") != std::string::npos)
+      corrupt = file;
+  }
+  REQUIRE_FALSE(corrupt.empty());
+  {
+    std::fstream stream(corrupt, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(-1, std::ios::end);
+    stream.put('x');
+  }
+
+  int rejected = ProgramBinaryCache::stats().rejected;
+  REQUIRE(ProgramBinaryCache::readSize(7) == 0);
+  REQUIRE_FALSE(fileExists(corrupt));
+  REQUIRE(ProgramBinaryCache::stats().rejected == rejected + 1);
+
+  ProgramBinaryCache::setDeviceKey(2);
+  REQUIRE(ProgramBinaryCache::readSize(8) == 0);
+  REQUIRE(directory.entries().size() == 1);
+
+  ProgramBinaryCache::setDeviceKey(1);
+  REQUIRE(ProgramBinaryCache::readSize(8) == binary.size());
+
+  File foreign = directory.entries().front();
+  {
+    std::fstream stream(foreign, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(sizeof(uint32_t));
+    stream.put('x');
+  }
+  REQUIRE(ProgramBinaryCache::readSize(8) == 0);
+  REQUIRE(ProgramBinaryCache::stats().rejected == rejected + 2);
+  REQUIRE(fileExists(foreign));
+}
+
+TEST_CASE("Program binary cache defaults to a per-user directory", "[graphics]") {
+  File directory = ProgramBinaryCache::defaultDirectory();
+  File app_data = appDataDirectory();
+  if (app_data.empty() || !app_data.is_absolute()) {
+    REQUIRE(directory.empty());
+    return;
+  }
+
+  auto mismatch = std::mismatch(app_data.begin(), app_data.end(), directory.begin(),
+                                directory.end());
+  REQUIRE(mismatch.first == app_data.end());
+}
+
+TEST_CASE("Program binary cache stays within its size limit", "[graphics]") {
+  TestCacheDirectory directory;
+  std::vector<char> binary = testBinary(1000, 5);
+  ProgramBinaryCache::setMaxBytes(2500);
+
+  for (uint64_t id = 1; id <= 5; ++id) {
+    ProgramBinaryCache::write(id, binary.data(), binary.size());
+    REQUIRE(ProgramBinaryCache::bytes() <= 2500);
+    REQUIRE(ProgramBinaryCache::readSize(id) == binary.size());
+  }
+  REQUIRE(directory.entries().size() == 2);
+}
@@ -0,0 +1,88 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage_graphics/canvas.h"
+#include "visage_utils/thread_pool.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  constexpr int kGridSize = 8;
+  constexpr int kCellSize = 16;
+
+  void drawCell(Canvas& canvas, Region& region, int index) {
+    canvas.beginRegion(&region);
+    canvas.setColor(0xff000000 | (index * 0x030507));
+    canvas.fill(0, 0, kCellSize, kCellSize);
+    canvas.setBrush(Brush::horizontal(Color(0xff000000 | index * 4), Color(0xffffffff - index)));
+    canvas.circle(1, 1, kCellSize - 2);
+    canvas.setColor(0xffffffff);
+    Font font(8 + index % 4, fonts::DroidSansMono_ttf);
+    canvas.text(String(index), font, Font::kCenter, 0, 0, kCellSize, kCellSize);
+    canvas.endRegion();
+  }
+
+  Screenshot renderCells(bool parallel) {
+    Canvas canvas;
+    canvas.setSoftwareRendering(true);
+    canvas.setDimensions(kGridSize * kCellSize, kGridSize * kCellSize);
+
+    std::vector<std::unique_ptr<Region>> regions;
+    for (int i = 0; i < kGridSize * kGridSize; ++i) {
+      regions.push_back(std::make_unique<Region>());
+      canvas.addRegion(regions.back().get());
+      regions.back()->setBounds((i % kGridSize) * kCellSize, (i / kGridSize) * kCellSize,
+                                kCellSize, kCellSize);
+    }
+
+    if (parallel) {
+      ThreadPool pool(4);
+      std::vector<std::unique_ptr<Canvas>> contexts;
+      for (int i = 0; i < pool.numThreads(); ++i) {
+        contexts.push_back(canvas.createRecordingContext());
+        canvas.syncRecordingContext(contexts.back().get());
+      }
+      pool.parallelFor(regions.size(), [&](int index, int thread) {
+        drawCell(*contexts[thread], *regions[index], index);
+      });
+    }
+    else {
+      for (int i = 0; i < regions.size(); ++i)
+        drawCell(canvas, *regions[i], i);
+    }
+
+    canvas.submit();
+    return canvas.screenshot();
+  }
+}
+
+TEST_CASE("Parallel recording matches serial recording", "[graphics]") {
+  Screenshot serial = renderCells(false);
+  Screenshot parallel = renderCells(true);
+  REQUIRE(serial.width() == parallel.width());
+  REQUIRE(serial.height() == parallel.height());
+
+  int size = serial.width() * serial.height() * 4;
+  REQUIRE(std::equal(serial.data(), serial.data() + size, parallel.data()));
+}
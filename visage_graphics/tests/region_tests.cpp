@@ -0,0 +1,126 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage_graphics/canvas.h"
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdlib>
+#include <new>
+
+using namespace visage;
+
+namespace {
+  std::atomic<bool> count_allocations = false;
+  std::atomic<int> num_allocations = 0;
+
+  class AllocationCounter {
+  public:
+    AllocationCounter() {
+      num_allocations = 0;
+      count_allocations = true;
+    }
+    ~AllocationCounter() { count_allocations = false; }
+
+    int count() const { return num_allocations; }
+  };
+}
+
+void* operator new(std::size_t size) {
+  if (count_allocations)
+    num_allocations++;
+
+  if (void* result = std::malloc(size ? size : 1))
+    return result;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace {
+  void drawRegion(Canvas& canvas, Region& region, const Brush& background, const Brush& gradient) {
+    canvas.beginRegion(&region);
+    canvas.setBrush(background);
+    canvas.fill(0, 0, region.width(), region.height());
+    for (int i = 0; i < 20; ++i) {
+      canvas.setBrush(i % 2 ? background : gradient);
+      canvas.circle(i * 4, i * 2, 10);
+      canvas.roundedRectangle(i * 3, i * 4, 20, 10, 4);
+      canvas.ring(i * 5, i * 3, 12, 2);
+    }
+    canvas.setBrush(background);
+    canvas.fill(5, 5, 10, 10);
+    canvas.endRegion();
+  }
+}
+
+TEST_CASE("Region redraw is allocation free in steady state", "[graphics]") {
+  Canvas canvas;
+  Region region;
+  region.setBounds(0, 0, 100, 100);
+
+  Brush background = Brush::solid(0xff223344);
+  Brush gradient = Brush::horizontal(0xffff0000, 0xff0000ff);
+
+  for (int i = 0; i < 3; ++i)
+    drawRegion(canvas, region, background, gradient);
+
+  AllocationCounter counter;
+  for (int i = 0; i < 10; ++i)
+    drawRegion(canvas, region, background, gradient);
+  REQUIRE(counter.count() == 0);
+}
+
+TEST_CASE("Region redraw with different fonts reuses batches", "[graphics]") {
+  Canvas canvas;
+  Region region;
+  region.setBounds(0, 0, 100, 100);
+
+  Font small(10, fonts::DroidSansMono_ttf, 1.0f);
+  Font large(20, fonts::DroidSansMono_ttf, 1.0f);
+  auto draw_text = [&](const std::vector<const Font*>& fonts) {
+    canvas.beginRegion(&region);
+    canvas.setColor(0xffffffff);
+    for (int i = 0; i < fonts.size(); ++i)
+      canvas.text("text", *fonts[i], Font::kLeft, 0, i * 30, 100, 30);
+    canvas.endRegion();
+  };
+
+  draw_text({ &small });
+  REQUIRE(region.numSubmitBatches() == 1);
+  const void* small_id = region.submitBatchAtPosition(0)->id();
+
+  draw_text({ &large });
+  REQUIRE(region.numSubmitBatches() == 1);
+  const void* large_id = region.submitBatchAtPosition(0)->id();
+  REQUIRE(large_id != small_id);
+
+  draw_text({ &large, &small });
+  REQUIRE(region.numSubmitBatches() == 2);
+  REQUIRE(region.submitBatchAtPosition(0)->id() != region.submitBatchAtPosition(1)->id());
+}
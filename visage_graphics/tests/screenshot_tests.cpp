@@ -0,0 +1,102 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/renderer.h"
+#include "visage_graphics/screenshot.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+using namespace visage;
+
+TEST_CASE("Screenshot swaps blue and red", "[graphics]") {
+  static constexpr int kWidth = 23;
+  static constexpr int kHeight = 3;
+
+  std::vector<uint8_t> pixels(kWidth * kHeight * 4);
+  for (int i = 0; i < kWidth * kHeight * 4; ++i)
+    pixels[i] = i * 7;
+
+  Screenshot screenshot(pixels.data(), kWidth, kHeight, true);
+  REQUIRE(screenshot.width() == kWidth);
+  REQUIRE(screenshot.height() == kHeight);
+  for (int i = 0; i < kWidth * kHeight * 4; i += 4) {
+    REQUIRE(screenshot.data()[i] == pixels[i + 2]);
+    REQUIRE(screenshot.data()[i + 1] == pixels[i + 1]);
+    REQUIRE(screenshot.data()[i + 2] == pixels[i]);
+    REQUIRE(screenshot.data()[i + 3] == pixels[i + 3]);
+  }
+}
+
+TEST_CASE("Screenshot copies a sub rectangle", "[graphics]") {
+  static constexpr int kWidth = 20;
+  static constexpr int kHeight = 10;
+
+  std::vector<uint8_t> pixels(kWidth * kHeight * 4);
+  for (int i = 0; i < kWidth * kHeight * 4; ++i)
+    pixels[i] = i * 3;
+
+  int x = 3;
+  int y = 2;
+  const uint8_t* start = pixels.data() + (y * kWidth + x) * 4;
+  Screenshot screenshot(start, 9, 5, kWidth * 4);
+  REQUIRE(screenshot.width() == 9);
+  REQUIRE(screenshot.height() == 5);
+  for (int r = 0; r < 5; ++r) {
+    for (int c = 0; c < 9; ++c) {
+      for (int channel = 0; channel < 4; ++channel) {
+        int source = ((y + r) * kWidth + x + c) * 4 + channel;
+        REQUIRE(screenshot.data()[(r * 9 + c) * 4 + channel] == pixels[source]);
+      }
+    }
+  }
+}
+
+TEST_CASE("Window screenshots are flipped, swapped and taken once", "[graphics]") {
+  static constexpr int kWidth = 4;
+  static constexpr int kHeight = 3;
+  static constexpr int kPitch = kWidth * 4 + 8;
+
+  std::vector<uint8_t> pixels(kPitch * kHeight);
+  for (int i = 0; i < kPitch * kHeight; ++i)
+    pixels[i] = i;
+
+  Renderer& renderer = Renderer::instance();
+  std::string name = renderer.nextWindowScreenshotName();
+  REQUIRE(name != renderer.nextWindowScreenshotName());
+  renderer.setWindowScreenshotData(name, pixels.data(), kWidth, kHeight, kPitch, true);
+
+  Screenshot screenshot;
+  REQUIRE(renderer.takeWindowScreenshot(name, screenshot));
+  REQUIRE_FALSE(renderer.takeWindowScreenshot(name, screenshot));
+  REQUIRE(screenshot.width() == kWidth);
+  REQUIRE(screenshot.height() == kHeight);
+  for (int r = 0; r < kHeight; ++r) {
+    const uint8_t* source = pixels.data() + (kHeight - 1 - r) * kPitch;
+    for (int c = 0; c < kWidth; ++c) {
+      const uint8_t* pixel = screenshot.data() + (r * kWidth + c) * 4;
+      REQUIRE(pixel[0] == source[c * 4 + 2]);
+      REQUIRE(pixel[1] == source[c * 4 + 1]);
+      REQUIRE(pixel[2] == source[c * 4]);
+      REQUIRE(pixel[3] == source[c * 4 + 3]);
+    }
+  }
+}
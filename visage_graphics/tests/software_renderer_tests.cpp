@@ -0,0 +1,89 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  Color pixelAt(const Screenshot& screenshot, int x, int y) {
+    const uint8_t* pixel = screenshot.data() + (y * screenshot.width() + x) * 4;
+    return Color(pixel[3] / 255.0f, pixel[0] / 255.0f, pixel[1] / 255.0f, pixel[2] / 255.0f);
+  }
+}
+
+TEST_CASE("Software rendering fill", "[graphics]") {
+  Canvas canvas;
+  canvas.setSoftwareRendering(true);
+  canvas.setDimensions(20, 20);
+  canvas.setColor(0xffff0000);
+  canvas.fill(0, 0, 10, 10);
+  canvas.submit();
+
+  const Screenshot& screenshot = canvas.screenshot();
+  REQUIRE(screenshot.width() == 20);
+  REQUIRE(screenshot.height() == 20);
+  REQUIRE(pixelAt(screenshot, 0, 0).toARGB() == 0xffff0000);
+  REQUIRE(pixelAt(screenshot, 9, 9).toARGB() == 0xffff0000);
+  REQUIRE(pixelAt(screenshot, 10, 10).hexAlpha() == 0);
+  REQUIRE(pixelAt(screenshot, 19, 0).hexAlpha() == 0);
+}
+
+TEST_CASE("Software rendering blends in draw order", "[graphics]") {
+  Canvas canvas;
+  canvas.setSoftwareRendering(true);
+  canvas.setDimensions(20, 20);
+  canvas.setColor(0xff0000ff);
+  canvas.fill(0, 0, 20, 20);
+  canvas.setColor(0xff00ff00);
+  canvas.circle(4, 4, 12);
+  canvas.submit();
+
+  const Screenshot& screenshot = canvas.screenshot();
+  REQUIRE(pixelAt(screenshot, 10, 10).toARGB() == 0xff00ff00);
+  REQUIRE(pixelAt(screenshot, 0, 0).toARGB() == 0xff0000ff);
+  REQUIRE(pixelAt(screenshot, 19, 19).toARGB() == 0xff0000ff);
+
+  Color edge = pixelAt(screenshot, 5, 5);
+  REQUIRE(edge.hexGreen() > 0);
+  REQUIRE(edge.hexBlue() > 0);
+}
+
+TEST_CASE("Software rendering repeats across frames and tiles", "[graphics]") {
+  static constexpr int kHeight = 5 * SoftwareRenderer::kTileHeight;
+
+  Canvas canvas;
+  canvas.setSoftwareRendering(true);
+  canvas.setDimensions(20, kHeight);
+  for (int frame = 0; frame < 3; ++frame) {
+    unsigned int color = frame % 2 ? 0xff00ff00 : 0xffff0000;
+    canvas.clearDrawnShapes();
+    canvas.setColor(color);
+    canvas.fill(0, 0, 20, kHeight);
+    canvas.submit();
+
+    const Screenshot& screenshot = canvas.screenshot();
+    for (int y = 0; y < kHeight; y += SoftwareRenderer::kTileHeight / 2)
+      REQUIRE(pixelAt(screenshot, 10, y).toARGB() == color);
+  }
+}
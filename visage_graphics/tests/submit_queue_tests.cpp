@@ -0,0 +1,291 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/canvas.h"
+#include "visage_graphics/region_submit_queue.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+using namespace visage;
+
+namespace {
+  struct SubmittedBatch {
+    const SubmitBatch* batch = nullptr;
+    std::vector<IBounds> invalid_rects;
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const SubmittedBatch& other) const {
+      return batch == other.batch && invalid_rects == other.invalid_rects && x == other.x &&
+             y == other.y;
+    }
+  };
+
+  using SubmitSequence = std::vector<std::vector<SubmittedBatch>>;
+
+  void record(SubmitSequence& sequence, const std::vector<PositionedBatch>& batches) {
+    sequence.emplace_back();
+    for (const PositionedBatch& batch : batches)
+      sequence.back().push_back({ batch.batch, *batch.invalid_rects, batch.x, batch.y });
+  }
+
+  // The linear scan ordering Layer::submit used before RegionSubmitQueue, with a stable partition
+  // so the expected order is well defined.
+  namespace reference {
+    struct RegionPosition {
+      Region* region = nullptr;
+      std::vector<IBounds> invalid_rects;
+      int position = 0;
+      int x = 0;
+      int y = 0;
+
+      SubmitBatch* currentBatch() const { return region->submitBatchAtPosition(position); }
+      bool isDone() const { return position >= region->numSubmitBatches(); }
+    };
+
+    void addSubRegions(std::vector<RegionPosition>& positions,
+                       std::vector<RegionPosition>& overlapping, const RegionPosition& done_position) {
+      auto begin = done_position.region->subRegions().cbegin();
+      auto end = done_position.region->subRegions().cend();
+      for (auto it = begin; it != end; ++it) {
+        Region* sub_region = *it;
+        if (!sub_region->isVisible())
+          continue;
+
+        bool overlaps = std::any_of(begin, it, [sub_region](const Region* other) {
+          return other->isVisible() && sub_region->overlaps(other);
+        });
+
+        IBounds bounds(done_position.x + sub_region->x(), done_position.y + sub_region->y(),
+                       sub_region->width(), sub_region->height());
+
+        std::vector<IBounds> invalid_rects;
+        for (const IBounds& invalid_rect : done_position.invalid_rects) {
+          if (bounds.overlaps(invalid_rect))
+            invalid_rects.push_back(invalid_rect.intersection(bounds));
+        }
+
+        if (invalid_rects.empty())
+          continue;
+
+        RegionPosition position = { sub_region, std::move(invalid_rects), 0, bounds.x(), bounds.y() };
+        if (overlaps)
+          overlapping.push_back(std::move(position));
+        else if (sub_region->isEmpty())
+          addSubRegions(positions, overlapping, position);
+        else
+          positions.push_back(std::move(position));
+      }
+    }
+
+    void checkOverlappingRegions(std::vector<RegionPosition>& positions,
+                                 std::vector<RegionPosition>& overlapping) {
+      std::vector<RegionPosition> new_overlapping;
+
+      for (auto it = overlapping.begin(); it != overlapping.end();) {
+        bool overlaps = std::any_of(positions.begin(), positions.end(), [it](const RegionPosition& other) {
+          return it->x < other.x + other.region->width() && it->x + it->region->width() > other.x &&
+                 it->y < other.y + other.region->height() && it->y + it->region->height() > other.y;
+        });
+
+        if (!overlaps) {
+          if (it->isDone())
+            addSubRegions(positions, new_overlapping, *it);
+          else
+            positions.push_back(*it);
+          it = overlapping.erase(it);
+        }
+        else
+          ++it;
+      }
+
+      overlapping.insert(overlapping.end(), new_overlapping.begin(), new_overlapping.end());
+    }
+
+    const SubmitBatch* nextBatch(const std::vector<RegionPosition>& positions,
+                                 const void* current_batch_id, BlendMode current_blend_mode) {
+      const SubmitBatch* next_batch = positions[0].currentBatch();
+      for (auto& position : positions) {
+        const SubmitBatch* batch = position.currentBatch();
+        if (next_batch->compare(batch) > 0) {
+          if (batch->compare(current_batch_id, current_blend_mode) > 0 ||
+              next_batch->compare(current_batch_id, current_blend_mode) < 0) {
+            next_batch = position.currentBatch();
+          }
+        }
+        else if (next_batch->compare(current_batch_id, current_blend_mode) < 0 &&
+                 batch->compare(current_batch_id, current_blend_mode) > 0) {
+          next_batch = position.currentBatch();
+        }
+      }
+      return next_batch;
+    }
+
+    SubmitSequence submit(Region* root, const IBounds& invalid_rect) {
+      SubmitSequence sequence;
+      std::vector<RegionPosition> positions;
+      std::vector<RegionPosition> overlapping;
+      positions.push_back({ root, { invalid_rect }, 0, 0, 0 });
+
+      const void* current_batch_id = nullptr;
+      BlendMode current_blend_mode = BlendMode::Opaque;
+      std::vector<PositionedBatch> batches;
+
+      while (!positions.empty()) {
+        const SubmitBatch* next_batch = nextBatch(positions, current_batch_id, current_blend_mode);
+        for (auto& position : positions) {
+          SubmitBatch* batch = position.currentBatch();
+          if (batch->compare(next_batch) == 0) {
+            batches.push_back({ batch, &position.invalid_rects, position.x, position.y });
+            position.position++;
+          }
+        }
+
+        record(sequence, batches);
+        batches.clear();
+
+        auto done_it = std::stable_partition(positions.begin(), positions.end(),
+                                             [](const RegionPosition& p) { return p.isDone(); });
+        std::vector<RegionPosition> done(positions.begin(), done_it);
+        positions.erase(positions.begin(), done_it);
+
+        for (auto& position : done)
+          addSubRegions(positions, overlapping, position);
+
+        if (!done.empty())
+          checkOverlappingRegions(positions, overlapping);
+
+        current_batch_id = next_batch->id();
+        current_blend_mode = next_batch->blendMode();
+      }
+      return sequence;
+    }
+  }
+
+  SubmitSequence submitWithQueue(Region* root, const IBounds& invalid_rect, int width, int height) {
+    SubmitSequence sequence;
+    RegionSubmitQueue queue(width, height);
+    queue.addRegion(root, { invalid_rect }, 0, 0);
+
+    std::vector<PositionedBatch> batches;
+    while (queue.nextBatches(batches)) {
+      record(sequence, batches);
+      batches.clear();
+    }
+    return sequence;
+  }
+
+  void drawShapes(Canvas& canvas, Region& region, std::mt19937& random) {
+    static constexpr BlendMode kBlendModes[] = { BlendMode::Alpha, BlendMode::Add };
+
+    canvas.beginRegion(&region);
+    int num_shapes = random() % 4 + 1;
+    for (int i = 0; i < num_shapes; ++i) {
+      canvas.setBlendMode(kBlendModes[random() % 2]);
+      canvas.setColor(0xff000000 | random());
+      int width = region.width();
+      int height = region.height();
+      switch (random() % 4) {
+      case 0: canvas.fill(0, 0, width, height); break;
+      case 1: canvas.circle(0, 0, std::min(width, height)); break;
+      case 2: canvas.roundedRectangle(0, 0, width, height, 4); break;
+      default: canvas.rectangle(1, 1, width - 2, height - 2); break;
+      }
+    }
+    canvas.endRegion();
+  }
+
+  struct RegionTree {
+    static constexpr int kSize = 256;
+
+    RegionTree(int num_children, unsigned int seed) : random(seed) {
+      canvas.setDimensions(kSize, kSize);
+      root.setBounds(0, 0, kSize, kSize);
+      canvas.addRegion(&root);
+      drawShapes(canvas, root, random);
+
+      for (int i = 0; i < num_children; ++i) {
+        Region* child = createRegion(root, kSize);
+        if (random() % 4 == 0) {
+          for (int g = 0; g < 3; ++g)
+            createRegion(*child, child->width());
+        }
+      }
+    }
+
+    Region* createRegion(Region& parent, int parent_size) {
+      regions.push_back(std::make_unique<Region>());
+      Region* region = regions.back().get();
+      parent.addRegion(region);
+
+      int width = random() % (parent_size / 2) + 4;
+      int height = random() % (parent_size / 2) + 4;
+      region->setBounds(random() % parent_size - width / 4, random() % parent_size - height / 4,
+                        width, height);
+      region->setVisible(random() % 8 != 0);
+      if (random() % 6)
+        drawShapes(canvas, *region, random);
+      return region;
+    }
+
+    std::mt19937 random;
+    Canvas canvas;
+    Region root;
+    std::vector<std::unique_ptr<Region>> regions;
+  };
+}
+
+TEST_CASE("Overlap grid matches direct overlap tests", "[graphics]") {
+  std::mt19937 random(7);
+  std::vector<IBounds> rects;
+  OverlapGrid grid;
+  grid.reset(300, 200);
+
+  for (int i = 0; i < 200; ++i) {
+    IBounds rect(random() % 400 - 50, random() % 300 - 50, random() % 80, random() % 80);
+    bool expected = std::any_of(rects.begin(), rects.end(),
+                                [&rect](const IBounds& other) { return rect.overlaps(other); });
+    REQUIRE(grid.overlaps(rect) == expected);
+
+    rects.push_back(rect);
+    grid.add(rect);
+    if (i % 3 == 0) {
+      grid.remove(rects.front());
+      rects.erase(rects.begin());
+    }
+  }
+}
+
+TEST_CASE("Region submit queue keeps the linear scan ordering", "[graphics]") {
+  for (int num_children : { 3, 12, 40 }) {
+    for (unsigned int seed = 1; seed <= 10; ++seed) {
+      RegionTree tree(num_children, seed);
+      IBounds invalid_rect(0, 0, RegionTree::kSize, RegionTree::kSize);
+
+      SubmitSequence expected = reference::submit(&tree.root, invalid_rect);
+      SubmitSequence result = submitWithQueue(&tree.root, invalid_rect, RegionTree::kSize,
+                                              RegionTree::kSize);
+      REQUIRE(!expected.empty());
+      REQUIRE(result == expected);
+    }
+  }
+}
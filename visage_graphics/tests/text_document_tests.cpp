@@ -0,0 +1,81 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "embedded/fonts.h"
+#include "visage_graphics/text_document.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+using namespace visage;
+
+namespace {
+  std::u32string randomText(std::mt19937& generator, int length) {
+    static constexpr char32_t kCharacters[] = U"abcdefghij      \n";
+    std::uniform_int_distribution<int> distribution(0, std::size(kCharacters) - 2);
+    std::u32string result;
+    for (int i = 0; i < length; ++i)
+      result.push_back(kCharacters[distribution(generator)]);
+    return result;
+  }
+}
+
+TEST_CASE("Text document edits match a plain string", "[graphics]") {
+  std::mt19937 generator(7);
+  std::u32string expected = randomText(generator, 500);
+  TextDocument document(expected);
+
+  for (int i = 0; i < 3000; ++i) {
+    int position = std::uniform_int_distribution<int>(0, expected.size())(generator);
+    int max_erase = std::min<int>(4, expected.size() - position);
+    int erase = std::uniform_int_distribution<int>(0, max_erase)(generator);
+    int insert_length = std::uniform_int_distribution<int>(0, 6)(generator);
+    std::u32string insert = randomText(generator, insert_length);
+
+    expected.replace(position, erase, insert);
+    document.replace(position, erase, insert);
+    REQUIRE(document.length() == expected.size());
+    REQUIRE(document.numPieces() <= TextDocument::kMaxPieces);
+  }
+
+  REQUIRE(document.text().toUtf32() == expected);
+  REQUIRE(document.substring(100, 50) == expected.substr(100, 50));
+  REQUIRE(document.at(321) == expected[321]);
+}
+
+TEST_CASE("Text document rewraps edits like a full line break pass", "[graphics]") {
+  std::mt19937 generator(11);
+  Font font(10, fonts::DroidSansMono_ttf, 1.0f);
+  TextDocument document(randomText(generator, 2000));
+  document.setWrap(font, 120.0f);
+  REQUIRE(document.numLines() > 20);
+
+  for (int i = 0; i < 500; ++i) {
+    int length = document.length();
+    int position = std::uniform_int_distribution<int>(0, length)(generator);
+    int erase = std::uniform_int_distribution<int>(0, std::min(20, length - position))(generator);
+    int insert_length = std::uniform_int_distribution<int>(0, 12)(generator);
+    document.replace(position, erase, randomText(generator, insert_length));
+
+    const String& text = document.text();
+    REQUIRE(document.lineBreaks() == font.lineBreaks(text.c_str(), text.length(), 120.0f));
+  }
+}
@@ -0,0 +1,196 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_graphics/shapes.h"
+
+#include <bgfx/bgfx.h>
+
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+using namespace Catch;
+
+namespace {
+  constexpr float kTolerance = 0.001f;
+
+  struct Vec2 {
+    float x = 0.0f;
+    float y = 0.0f;
+  };
+
+  struct ShapeOutput {
+    Vec2 position;
+    Vec2 coordinates;
+    float gradient_color[4] {};
+    float shader_values[8] {};
+  };
+
+  float decodeNormalized(int16_t value) {
+    return std::max(value / kCompactPixelRange, -1.0f);
+  }
+
+  float decodePixels(int16_t value) {
+    return decodeNormalized(value) * kCompactPixelRange;
+  }
+
+  Vec2 clampPosition(float x, float y, float left, float top, float right, float bottom) {
+    return { std::clamp(x, left, right), std::clamp(y, top, bottom) };
+  }
+
+  // Mirrors vs_complex_shape
+  ShapeOutput runShapeVertex(const ComplexShapeVertex& vertex) {
+    ShapeOutput output;
+    float x = vertex.x + vertex.coordinate_x * 0.5f;
+    float y = vertex.y + vertex.coordinate_y * 0.5f;
+    output.position = clampPosition(x, y, vertex.clamp_left, vertex.clamp_top, vertex.clamp_right,
+                                    vertex.clamp_bottom);
+    output.coordinates.x = vertex.coordinate_x +
+                           2.0f * (output.position.x - x) / (vertex.dimension_x + 1.0f);
+    output.coordinates.y = vertex.coordinate_y +
+                           2.0f * (output.position.y - y) / (vertex.dimension_y + 1.0f);
+    float gradient_color[] = { vertex.gradient_color_from_x, vertex.gradient_color_from_y,
+                               vertex.gradient_color_to_x, vertex.gradient_color_to_y };
+    float values[] = { vertex.thickness, vertex.fade,    vertex.value_1, vertex.value_2,
+                       vertex.value_3,   vertex.value_4, vertex.value_5, vertex.value_6 };
+    std::copy(std::begin(gradient_color), std::end(gradient_color), output.gradient_color);
+    std::copy(std::begin(values), std::end(values), output.shader_values);
+    return output;
+  }
+
+  // Mirrors vs_complex_shape_compact with normalized int16 attributes converted on fetch
+  ShapeOutput runShapeVertex(const CompactComplexShapeVertex& vertex) {
+    ShapeOutput output;
+    float x = vertex.x + vertex.coordinate_x * 0.5f;
+    float y = vertex.y + vertex.coordinate_y * 0.5f;
+    output.position = clampPosition(x, y, decodePixels(vertex.clamp_left),
+                                    decodePixels(vertex.clamp_top),
+                                    decodePixels(vertex.clamp_right),
+                                    decodePixels(vertex.clamp_bottom));
+    output.coordinates.x = vertex.coordinate_x +
+                           2.0f * (output.position.x - x) / (vertex.dimension_x + 1.0f);
+    output.coordinates.y = vertex.coordinate_y +
+                           2.0f * (output.position.y - y) / (vertex.dimension_y + 1.0f);
+    float gradient_color[] = { decodeNormalized(vertex.gradient_color_from_x),
+                               decodeNormalized(vertex.gradient_color_from_y),
+                               decodeNormalized(vertex.gradient_color_to_x),
+                               decodeNormalized(vertex.gradient_color_to_y) };
+    float values[] = { vertex.thickness, vertex.fade,    vertex.value_1, vertex.value_2,
+                       vertex.value_3,   vertex.value_4, vertex.value_5, vertex.value_6 };
+    std::copy(std::begin(gradient_color), std::end(gradient_color), output.gradient_color);
+    std::copy(std::begin(values), std::end(values), output.shader_values);
+    return output;
+  }
+
+  // Mirrors vs_tinted_texture and vs_tinted_texture_compact
+  Vec2 runTextureVertex(Vec2 position, Vec2 texture, Vec2 direction, float left, float top,
+                        float right, float bottom) {
+    Vec2 clamped = clampPosition(position.x, position.y, left, top, right, bottom);
+    float delta_x = clamped.x - position.x;
+    float delta_y = clamped.y - position.y;
+    return { texture.x + direction.x * delta_x + direction.y * delta_y,
+             texture.y + direction.x * delta_y + direction.y * delta_x };
+  }
+
+  template<typename T>
+  void checkCompactShape(const T& shape) {
+    ClampBounds clamp = { 4.0f, 6.0f, 50.0f, 41.0f };
+    ComplexShapeVertex vertices[kVerticesPerQuad];
+    setQuadPositions(vertices, shape, clamp);
+    shape.setVertexData(vertices);
+
+    for (int i = 0; i < kVerticesPerQuad; ++i) {
+      vertices[i].gradient_color_from_x = 0.1234f;
+      vertices[i].gradient_color_from_y = 0.5678f;
+      vertices[i].gradient_color_to_x = 0.9012f;
+      vertices[i].gradient_color_to_y = 0.5678f;
+
+      ShapeOutput full = runShapeVertex(vertices[i]);
+      ShapeOutput compact = runShapeVertex(CompactComplexShapeVertex(vertices[i]));
+      REQUIRE(compact.position.x == Approx(full.position.x).margin(kTolerance));
+      REQUIRE(compact.position.y == Approx(full.position.y).margin(kTolerance));
+      REQUIRE(compact.coordinates.x == Approx(full.coordinates.x).margin(kTolerance));
+      REQUIRE(compact.coordinates.y == Approx(full.coordinates.y).margin(kTolerance));
+      for (int c = 0; c < 4; ++c)
+        REQUIRE(compact.gradient_color[c] == Approx(full.gradient_color[c]).margin(kTolerance));
+      for (int v = 0; v < 8; ++v)
+        REQUIRE(compact.shader_values[v] == Approx(full.shader_values[v]).margin(kTolerance));
+    }
+  }
+}
+
+TEST_CASE("Compact vertex layouts match their structs", "[graphics]") {
+  REQUIRE(CompactComplexShapeVertex::layout().getStride() == sizeof(CompactComplexShapeVertex));
+  REQUIRE(CompactTextureVertex::layout().getStride() == sizeof(CompactTextureVertex));
+  REQUIRE(sizeof(CompactComplexShapeVertex) < sizeof(ComplexShapeVertex));
+  REQUIRE(sizeof(CompactTextureVertex) < sizeof(TextureVertex));
+}
+
+TEST_CASE("Compact complex shapes match full precision", "[graphics]") {
+  checkCompactShape(FlatSegment({}, nullptr, 2.5f, 3.0f, 40.0f, 30.0f, 4.0f, 5.0f, 36.5f, 24.25f,
+                                2.0f, 1.0f));
+  checkCompactShape(RoundedSegment({}, nullptr, 8.0f, 1.5f, 44.0f, 44.0f, 4.0f, 4.0f, 40.0f, 40.0f,
+                                   3.5f, 1.0f));
+  checkCompactShape(Triangle({}, nullptr, 0.0f, 0.0f, 60.0f, 50.0f, 3.0f, 45.0f, 30.0f, 4.0f, 57.0f,
+                             45.0f, 2.0f, 1.0f));
+  checkCompactShape(QuadraticBezier({}, nullptr, 10.25f, 12.75f, 32.0f, 20.0f, 0.0f, 20.0f, 16.0f,
+                                    0.0f, 32.0f, 20.0f, 1.5f, 1.0f));
+}
+
+TEST_CASE("Compact texture vertices match full precision", "[graphics]") {
+  Vec2 directions[] = { { 1.0f, 0.0f },   { -1.0f, 0.0f },  { 0.0f, -1.0f },
+                        { 0.0f, 1.0f },   { 0.375f, 0.0f }, { 0.0f, -0.625f } };
+  for (const Vec2& direction : directions) {
+    TextureVertex vertex {};
+    vertex.x = 18.0f;
+    vertex.y = 71.0f;
+    vertex.texture_x = 4093.0f;
+    vertex.texture_y = 517.0f;
+    vertex.direction_x = direction.x;
+    vertex.direction_y = direction.y;
+    vertex.clamp_left = 20.0f;
+    vertex.clamp_top = 64.0f;
+    vertex.clamp_right = 300.0f;
+    vertex.clamp_bottom = 68.0f;
+    vertex.gradient_color_from_x = 0.75f;
+    vertex.gradient_color_to_y = 0.003f;
+
+    CompactTextureVertex compact(vertex);
+    Vec2 full_result = runTextureVertex({ vertex.x, vertex.y },
+                                        { vertex.texture_x, vertex.texture_y }, direction,
+                                        vertex.clamp_left, vertex.clamp_top, vertex.clamp_right,
+                                        vertex.clamp_bottom);
+    Vec2 compact_result = runTextureVertex({ compact.x, compact.y },
+                                           { decodePixels(compact.texture_x),
+                                             decodePixels(compact.texture_y) },
+                                           { decodeNormalized(compact.direction_x),
+                                             decodeNormalized(compact.direction_y) },
+                                           decodePixels(compact.clamp_left),
+                                           decodePixels(compact.clamp_top),
+                                           decodePixels(compact.clamp_right),
+                                           decodePixels(compact.clamp_bottom));
+
+    REQUIRE(compact_result.x == Approx(full_result.x).margin(kTolerance));
+    REQUIRE(compact_result.y == Approx(full_result.y).margin(kTolerance));
+    REQUIRE(decodeNormalized(compact.gradient_color_from_x) == Approx(0.75f).margin(kTolerance));
+    REQUIRE(decodeNormalized(compact.gradient_color_to_y) == Approx(0.003f).margin(kTolerance));
+  }
+}
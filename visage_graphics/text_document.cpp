@@ -0,0 +1,231 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "text_document.h"
+
+#include <algorithm>
+
+namespace visage {
+  void TextDocument::setText(const String& text) {
+    original_ = text.toUtf32();
+    added_.clear();
+    pieces_.clear();
+    piece_offsets_.clear();
+    length_ = original_.size();
+    if (length_) {
+      pieces_.push_back({ false, 0, length_ });
+      piece_offsets_.push_back(0);
+    }
+
+    text_ = text;
+    text_dirty_ = false;
+    rewrap();
+  }
+
+  void TextDocument::replace(int position, int length, const char32_t* text, int text_length) {
+    VISAGE_ASSERT(position >= 0 && length >= 0 && position + length <= length_);
+    if (length == 0 && text_length == 0)
+      return;
+
+    int first = split(position);
+    if (length) {
+      int last = split(position + length);
+      pieces_.erase(pieces_.begin() + first, pieces_.begin() + last);
+      piece_offsets_.erase(piece_offsets_.begin() + first, piece_offsets_.begin() + last);
+    }
+
+    if (text_length) {
+      int start = added_.size();
+      added_.append(text, text_length);
+
+      Piece* previous = first > 0 ? &pieces_[first - 1] : nullptr;
+      if (previous && previous->added && previous->start + previous->length == start)
+        previous->length += text_length;
+      else {
+        pieces_.insert(pieces_.begin() + first, { true, start, text_length });
+        piece_offsets_.insert(piece_offsets_.begin() + first, 0);
+      }
+    }
+
+    length_ += text_length - length;
+    updateOffsets(std::max(0, first - 1));
+    text_dirty_ = true;
+
+    if (pieces_.size() > kMaxPieces)
+      compact();
+    if (wrap_)
+      updateLineBreaks(position, length, text_length);
+  }
+
+  char32_t TextDocument::at(int index) const {
+    VISAGE_ASSERT(index >= 0 && index < length_);
+    int piece = pieceAt(index);
+    return pieceData(pieces_[piece])[index - piece_offsets_[piece]];
+  }
+
+  void TextDocument::copy(int position, int length, char32_t* destination) const {
+    VISAGE_ASSERT(position >= 0 && position + length <= length_);
+    if (length <= 0)
+      return;
+
+    int piece = pieceAt(position);
+    int offset = position - piece_offsets_[piece];
+    while (length > 0) {
+      int count = std::min(length, pieces_[piece].length - offset);
+      const char32_t* data = pieceData(pieces_[piece]) + offset;
+      destination = std::copy(data, data + count, destination);
+      length -= count;
+      offset = 0;
+      piece++;
+    }
+  }
+
+  std::u32string TextDocument::substring(int position, int length) const {
+    position = std::max(0, std::min(position, length_));
+    length = std::max(0, std::min(length, length_ - position));
+    std::u32string result(length, 0);
+    copy(position, length, result.data());
+    return result;
+  }
+
+  const String& TextDocument::text() const {
+    if (text_dirty_) {
+      text_ = substring(0, length_);
+      text_dirty_ = false;
+    }
+    return text_;
+  }
+
+  void TextDocument::setWrap(const Font& font, float width) {
+    wrap_ = true;
+    wrap_font_ = font;
+    wrap_width_ = width;
+    rewrap();
+  }
+
+  void TextDocument::clearWrap() {
+    wrap_ = false;
+    wrap_font_ = Font();
+    line_breaks_.clear();
+  }
+
+  int TextDocument::lineAtIndex(int index) const {
+    return std::upper_bound(line_breaks_.begin(), line_breaks_.end(), index) - line_breaks_.begin();
+  }
+
+  int TextDocument::pieceAt(int position) const {
+    auto upper = std::upper_bound(piece_offsets_.begin(), piece_offsets_.end(), position);
+    return std::max<int>(0, upper - piece_offsets_.begin() - 1);
+  }
+
+  int TextDocument::split(int position) {
+    if (position >= length_)
+      return pieces_.size();
+
+    int index = pieceAt(position);
+    int offset = position - piece_offsets_[index];
+    if (offset == 0)
+      return index;
+
+    Piece right = pieces_[index];
+    right.start += offset;
+    right.length -= offset;
+    pieces_[index].length = offset;
+    pieces_.insert(pieces_.begin() + index + 1, right);
+    piece_offsets_.insert(piece_offsets_.begin() + index + 1, position);
+    return index + 1;
+  }
+
+  void TextDocument::updateOffsets(int start_piece) {
+    for (int i = start_piece; i < pieces_.size(); ++i)
+      piece_offsets_[i] = i ? piece_offsets_[i - 1] + pieces_[i - 1].length : 0;
+  }
+
+  void TextDocument::compact() {
+    std::u32string compacted = substring(0, length_);
+    original_ = std::move(compacted);
+    added_.clear();
+    pieces_.clear();
+    piece_offsets_.clear();
+    if (length_) {
+      pieces_.push_back({ false, 0, length_ });
+      piece_offsets_.push_back(0);
+    }
+  }
+
+  void TextDocument::rewrap() {
+    if (!wrap_ || wrap_font_.packedFont() == nullptr) {
+      line_breaks_.clear();
+      return;
+    }
+
+    const String& full_text = text();
+    line_breaks_ = wrap_font_.lineBreaks(full_text.c_str(), full_text.length(), wrap_width_);
+  }
+
+  // A break only depends on the text up to the start of the line after next, so wrapping restarts
+  // two lines above the edit and stops once a new break matches a shifted break after the edit.
+  void TextDocument::updateLineBreaks(int position, int removed, int inserted) {
+    if (wrap_font_.packedFont() == nullptr)
+      return;
+
+    int restart_line = std::max(0, lineAtIndex(position) - 2);
+    int break_index = lineStart(restart_line);
+    int delta = inserted - removed;
+    int edit_end = position + inserted;
+
+    auto reusable = std::lower_bound(line_breaks_.begin(), line_breaks_.end(), position + removed);
+    std::vector<int> old_breaks(reusable, line_breaks_.end());
+    line_breaks_.resize(restart_line);
+
+    int old_index = 0;
+    while ((break_index = nextLineBreak(break_index)) >= 0) {
+      if (break_index >= edit_end) {
+        while (old_index < old_breaks.size() && old_breaks[old_index] + delta < break_index)
+          old_index++;
+
+        if (old_index < old_breaks.size() && old_breaks[old_index] + delta == break_index) {
+          for (; old_index < old_breaks.size(); ++old_index)
+            line_breaks_.push_back(old_breaks[old_index] + delta);
+          return;
+        }
+      }
+      line_breaks_.push_back(break_index);
+    }
+  }
+
+  int TextDocument::nextLineBreak(int start) {
+    int window = kMinWrapWindow;
+    while (true) {
+      int size = std::min(window, length_ - start);
+      wrap_window_.resize(size);
+      copy(start, size, wrap_window_.data());
+
+      // A break found inside a truncated window is exact, only "fits on one line" needs more text
+      int line_break = wrap_font_.nextLineBreak(wrap_window_.data(), size, wrap_width_);
+      if (line_break >= 0)
+        return start + line_break;
+      if (start + size == length_)
+        return -1;
+      window *= 2;
+    }
+  }
+}
@@ -0,0 +1,98 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "font.h"
+#include "visage_utils/string_utils.h"
+
+#include <vector>
+
+namespace visage {
+  // Piece table text storage. Edits only touch the piece list, and when wrapping is enabled line
+  // breaks are recomputed from just before the edit until they line up with the old breaks again.
+  class TextDocument {
+  public:
+    static constexpr int kMaxPieces = 1024;
+    static constexpr int kMinWrapWindow = 256;
+
+    TextDocument() = default;
+    explicit TextDocument(const String& text) { setText(text); }
+
+    void setText(const String& text);
+    void replace(int position, int length, const char32_t* text, int text_length);
+    void replace(int position, int length, const std::u32string& text) {
+      replace(position, length, text.c_str(), text.size());
+    }
+    void insert(int position, const std::u32string& text) { replace(position, 0, text); }
+    void erase(int position, int length) { replace(position, length, nullptr, 0); }
+
+    int length() const { return length_; }
+    bool isEmpty() const { return length_ == 0; }
+    char32_t at(int index) const;
+    char32_t operator[](int index) const { return at(index); }
+    void copy(int position, int length, char32_t* destination) const;
+    std::u32string substring(int position, int length) const;
+    const String& text() const;
+    int numPieces() const { return pieces_.size(); }
+
+    void setWrap(const Font& font, float width);
+    void clearWrap();
+    bool wraps() const { return wrap_; }
+    const std::vector<int>& lineBreaks() const { return line_breaks_; }
+    int numLines() const { return line_breaks_.size() + 1; }
+    int lineAtIndex(int index) const;
+    int lineStart(int line) const { return line > 0 ? line_breaks_[line - 1] : 0; }
+
+  private:
+    struct Piece {
+      bool added = false;
+      int start = 0;
+      int length = 0;
+    };
+
+    const char32_t* pieceData(const Piece& piece) const {
+      return (piece.added ? added_.data() : original_.data()) + piece.start;
+    }
+    int pieceAt(int position) const;
+    int split(int position);
+    void updateOffsets(int start_piece);
+    void compact();
+    void rewrap();
+    void updateLineBreaks(int position, int removed, int inserted);
+    int nextLineBreak(int start);
+
+    std::u32string original_;
+    std::u32string added_;
+    std::vector<Piece> pieces_;
+    std::vector<int> piece_offsets_;
+    int length_ = 0;
+
+    mutable String text_;
+    mutable bool text_dirty_ = false;
+
+    bool wrap_ = false;
+    Font wrap_font_;
+    float wrap_width_ = 0.0f;
+    std::vector<int> line_breaks_;
+    std::u32string wrap_window_;
+  };
+}
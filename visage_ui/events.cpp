@@ -24,6 +24,8 @@
 #include "frame.h"
 #include "visage_utils/time_utils.h"
 
+#include <algorithm>
+
 namespace visage {
 
   EventTimer::~EventTimer() {
@@ -35,11 +37,11 @@ namespace visage {
     VISAGE_ASSERT(ms > 0);
 
     if (ms > 0) {
-      if (!isRunning())
-        EventManager::instance().addTimer(this);
-
+      bool running = isRunning();
       last_run_time_ = time::milliseconds();
       ms_ = ms;
+      if (!running)
+        EventManager::instance().addTimer(this);
     }
   }
 
@@ -63,23 +65,77 @@ namespace visage {
   }
 
   void EventManager::addTimer(EventTimer* timer) {
-    timers_.push_back(timer);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      timers_.push_back(timer);
+    }
+    wake();
   }
 
   void EventManager::removeTimer(const EventTimer* timer) {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = std::find(timers_.begin(), timers_.end(), timer);
     if (it != timers_.end())
       timers_.erase(it);
   }
 
   void EventManager::addCallback(std::function<void()> callback) {
-    callbacks_.push_back(std::move(callback));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      callbacks_.push_back(std::move(callback));
+    }
+    wake();
+  }
+
+  bool EventManager::hasPendingEvents() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !timers_.empty() || !callbacks_.empty();
+  }
+
+  bool EventManager::hasPendingCallbacks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !callbacks_.empty();
+  }
+
+  long long EventManager::millisecondsUntilNextTimer() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (timers_.empty())
+      return -1;
+
+    long long next_time = timers_.front()->nextRunTime();
+    for (const EventTimer* timer : timers_)
+      next_time = std::min(next_time, timer->nextRunTime());
+    return std::max(0LL, next_time - time::milliseconds());
+  }
+
+  void EventManager::addWakeCallback(const void* owner, std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_callbacks_.emplace_back(owner, std::move(callback));
+  }
+
+  void EventManager::removeWakeCallback(const void* owner) {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_callbacks_.erase(std::remove_if(wake_callbacks_.begin(), wake_callbacks_.end(),
+                                         [owner](const auto& wake) { return wake.first == owner; }),
+                          wake_callbacks_.end());
+  }
+
+  void EventManager::wake() {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    for (auto& wake : wake_callbacks_)
+      wake.second();
   }
 
   void EventManager::checkEventTimers() {
     long long current_time = time::milliseconds();
-    std::vector<EventTimer*> timers = timers_;
-    std::vector<std::function<void()>> callbacks = std::move(callbacks_);
+    std::vector<EventTimer*> timers;
+    std::vector<std::function<void()>> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      timers = timers_;
+      callbacks = std::move(callbacks_);
+      callbacks_.clear();
+    }
 
     for (auto timer : timers)
       timer->checkTimer(current_time);
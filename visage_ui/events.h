@@ -26,6 +26,7 @@
 #include "visage_utils/space.h"
 
 #include <functional>
+#include <mutex>
 #include <string>
 
 namespace visage {
@@ -45,6 +46,7 @@ namespace visage {
       VISAGE_ASSERT(ms_ >= -1);
       return ms_ > 0;
     }
+    long long nextRunTime() const { return last_run_time_ + ms_; }
 
   private:
     int ms_ = 0;
@@ -65,13 +67,28 @@ namespace visage {
     void removeTimer(const EventTimer* timer);
     void addCallback(std::function<void()> function);
     void checkEventTimers();
+    bool hasPendingEvents() const;
+    bool hasPendingCallbacks() const;
+    // Milliseconds until the earliest running timer is due, or -1 when no timer is running
+    long long millisecondsUntilNextTimer() const;
+
+    // Called from whichever thread queues a callback or starts a timer so event loops blocked
+    // waiting for input can wake up and service it
+    void addWakeCallback(const void* owner, std::function<void()> callback);
+    void removeWakeCallback(const void* owner);
 
   private:
     EventManager() = default;
     ~EventManager() = default;
 
+    void wake();
+
+    mutable std::mutex mutex_;
     std::vector<EventTimer*> timers_ {};
     std::vector<std::function<void()>> callbacks_ {};
+
+    std::mutex wake_mutex_;
+    std::vector<std::pair<const void*, std::function<void()>>> wake_callbacks_;
   };
 
   static void runOnEventThread(std::function<void()> function) {
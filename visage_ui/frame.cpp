@@ -22,6 +22,7 @@
 #include "frame.h"
 
 #include "visage_graphics/theme.h"
+#include "visage_utils/profiler.h"
 
 namespace visage {
   void Frame::setVisible(bool visible) {
@@ -59,6 +60,7 @@ namespace visage {
       return;
 
     children_.push_back(child);
+    invalidateSpatialIndex();
     child->parent_ = this;
     child->setEventHandler(event_handler_);
     if (palette_)
@@ -114,24 +116,44 @@ namespace visage {
     return -1;
   }
 
+  Frame* Frame::childAtPoint(Point point, bool on_top) {
+    auto hit = [&](Frame* child) -> Frame* {
+      if (child->isOnTop() == on_top && child->isVisible() && child->containsPoint(point))
+        return child->frameAtPoint(point - child->topLeft());
+      return nullptr;
+    };
+
+    if (spatial_index_) {
+      Frame* result = nullptr;
+      spatial_index_->forEachCandidateReversed(point, [&](int index) {
+        result = hit(children_[index]);
+        return result != nullptr;
+      });
+      return result;
+    }
+
+    for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
+      if (Frame* result = hit(*it))
+        return result;
+    }
+    return nullptr;
+  }
+
   Frame* Frame::frameAtPoint(Point point) {
     if (pass_mouse_events_to_children_) {
-      for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
-        auto& child = *it;
-        if (child->isOnTop() && child->isVisible() && child->containsPoint(point)) {
-          Frame* result = child->frameAtPoint(point - child->topLeft());
-          if (result)
-            return result;
-        }
-      }
-      for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
-        auto& child = *it;
-        if (!child->isOnTop() && child->isVisible() && child->containsPoint(point)) {
-          Frame* result = child->frameAtPoint(point - child->topLeft());
-          if (result)
-            return result;
-        }
+      if (spatial_index_ && spatial_index_dirty_) {
+        std::vector<Bounds> children_bounds;
+        children_bounds.reserve(children_.size());
+        for (const Frame* child : children_)
+          children_bounds.push_back(child->bounds());
+        spatial_index_->build(children_bounds);
+        spatial_index_dirty_ = false;
       }
+
+      if (Frame* result = childAtPoint(point, true))
+        return result;
+      if (Frame* result = childAtPoint(point, false))
+        return result;
     }
 
     if (!ignores_mouse_events_)
@@ -139,6 +161,14 @@ namespace visage {
     return nullptr;
   }
 
+  void Frame::setSpatialIndexEnabled(bool enabled) {
+    if (enabled && spatial_index_ == nullptr)
+      spatial_index_ = std::make_unique<SpatialGrid>();
+    else if (!enabled)
+      spatial_index_ = nullptr;
+    invalidateSpatialIndex();
+  }
+
   Frame* Frame::topParentFrame() {
     Frame* frame = this;
     while (frame->parent_)
@@ -151,14 +181,27 @@ namespace visage {
     if (bounds_ == bounds && native_bounds_ == new_native_bounds)
       return;
 
+    if (parent_ && bounds_ != bounds)
+      parent_->invalidateSpatialIndex();
+
+    bool resized = bounds_.width() != bounds.width() || bounds_.height() != bounds.height() ||
+                   native_bounds_.width() != new_native_bounds.width() ||
+                   native_bounds_.height() != new_native_bounds.height();
     bounds_ = bounds;
     native_bounds_ = new_native_bounds;
     region_.setBounds(native_bounds_.x(), native_bounds_.y(), native_bounds_.width(),
                       native_bounds_.height());
-    computeLayout();
-    if (layout_ == nullptr || !layout_->flex()) {
-      for (Frame* child : children_)
-        computeLayout(child);
+
+    // Children are laid out in local coordinates so moving this frame doesn't affect them unless
+    // one of the layouts changed since the last pass
+    uint64_t layout_stamp = layoutStamp();
+    if (resized || layout_stamp != layout_stamp_) {
+      layout_stamp_ = layout_stamp;
+      computeLayout();
+      if (layout_ == nullptr || !layout_->flex()) {
+        for (Frame* child : children_)
+          computeLayout(child);
+      }
     }
 
     on_resize_.callback();
@@ -171,21 +214,34 @@ namespace visage {
 
   void Frame::computeLayout() {
     if (nativeWidth() && nativeHeight() && layout_.get() && layout().flex()) {
-      std::vector<const Layout*> children_layouts;
+      // Shared between frames, only used until flexPositions returns
+      static std::vector<const Layout*> children_layouts;
+      children_layouts.clear();
       for (Frame* child : children_) {
         if (child->layout_)
           children_layouts.push_back(child->layout_.get());
       }
 
+      // Copied because resize callbacks can re-enter this layout and overwrite its results
       std::vector<IBounds> children_bounds = layout().flexPositions(children_layouts,
                                                                     nativeLocalBounds(), dpi_scale_);
-      for (int i = 0; i < children_.size(); ++i) {
-        if (children_[i]->layout_)
-          children_[i]->setNativeBounds(children_bounds[i]);
+      int layout_index = 0;
+      for (Frame* child : children_) {
+        if (child->layout_)
+          child->setNativeBounds(children_bounds[layout_index++]);
       }
     }
   }
 
+  uint64_t Frame::layoutStamp() const {
+    uint64_t stamp = layout_ ? layout_->version() : 0;
+    for (const Frame* child : children_) {
+      if (child->layout_)
+        stamp = stamp * 0x100000001b3ull ^ child->layout_->version();
+    }
+    return stamp;
+  }
+
   void Frame::computeLayout(Frame* child) {
     if (child->layout_ == nullptr || (layout_ && layout_->flex()))
       return;
@@ -302,18 +358,22 @@ namespace visage {
       child->init();
   }
 
-  void Frame::drawToRegion(Canvas& canvas) {
+  bool Frame::prepareToDraw() {
     if (!redrawing_)
-      return;
+      return false;
 
     redrawing_ = false;
     region_.invalidate();
     region_.setNeedsLayer(requiresLayer());
     if (width() <= 0 || height() <= 0) {
       region_.clear();
-      return;
+      return false;
     }
+    return true;
+  }
 
+  void Frame::recordToRegion(Canvas& canvas) {
+    VISAGE_PROFILE_SCOPE(name_.empty() ? "Frame::drawToRegion" : name_.c_str());
     canvas.beginRegion(&region_);
 
     if (!palette_override_.isDefault())
@@ -341,6 +401,7 @@ namespace visage {
     child->event_handler_ = nullptr;
     region_.removeRegion(child->region());
     children_.erase(std::find(children_.begin(), children_.end(), child));
+    invalidateSpatialIndex();
   }
 
   void Frame::setPostEffect(PostEffect* post_effect) {
@@ -357,16 +418,13 @@ namespace visage {
 
   float Frame::paletteValue(theme::ValueId value_id) const {
     if (palette_) {
-      const Frame* frame = this;
-      float result = 0.0f;
-      while (frame) {
+      std::shared_ptr<const CompiledPalette> palette = palette_->compiled();
+      for (const Frame* frame = this; frame; frame = frame->parent_) {
         theme::OverrideId override_id = frame->palette_override_;
-        if (!override_id.isDefault() && palette_->value(override_id, value_id, result))
-          return result;
-        frame = frame->parent_;
+        if (!override_id.isDefault() && palette->hasValue(override_id, value_id))
+          return palette->value(override_id, value_id);
       }
-      if (palette_->value({}, value_id, result))
-        return result;
+      return palette->value({}, value_id);
     }
 
     return theme::ValueId::defaultValue(value_id);
@@ -374,16 +432,13 @@ namespace visage {
 
   Brush Frame::paletteColor(theme::ColorId color_id) const {
     if (palette_) {
-      Brush result;
-      const Frame* frame = this;
-      while (frame) {
+      std::shared_ptr<const CompiledPalette> palette = palette_->compiled();
+      for (const Frame* frame = this; frame; frame = frame->parent_) {
         theme::OverrideId override_id = frame->palette_override_;
-        if (!override_id.isDefault() && palette_->color(override_id, color_id, result))
-          return result;
-        frame = frame->parent_;
+        if (!override_id.isDefault() && palette->hasColor(override_id, color_id))
+          return palette->color(override_id, color_id);
       }
-      if (palette_->color({}, color_id, result))
-        return result;
+      return palette->color({}, color_id);
     }
 
     return Brush::solid(theme::ColorId::defaultColor(color_id));
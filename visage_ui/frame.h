@@ -23,6 +23,7 @@
 
 #include "events.h"
 #include "layout.h"
+#include "spatial_grid.h"
 #include "undo_history.h"
 #include "visage_graphics/canvas.h"
 #include "visage_graphics/palette.h"
@@ -213,6 +214,8 @@ namespace visage {
     bool containsPoint(Point point) const { return bounds_.contains(point); }
     Frame* frameAtPoint(Point point);
     Frame* topParentFrame();
+    void setSpatialIndexEnabled(bool enabled);
+    bool spatialIndexEnabled() const { return spatial_index_ != nullptr; }
 
     void setBounds(Bounds bounds);
     void setBounds(float x, float y, float width, float height) {
@@ -272,7 +275,15 @@ namespace visage {
     bool focusNextTextReceiver(const Frame* starting_child = nullptr) const;
     bool focusPreviousTextReceiver(const Frame* starting_child = nullptr) const;
 
-    void drawToRegion(Canvas& canvas);
+    void drawToRegion(Canvas& canvas) {
+      if (prepareToDraw())
+        recordToRegion(canvas);
+    }
+
+    // drawToRegion in two halves. prepareToDraw updates the Canvas layers and must run on the main
+    // thread. recordToRegion only writes to this frame's Region and can run on a ThreadPool worker.
+    bool prepareToDraw();
+    void recordToRegion(Canvas& canvas);
 
     void setDpiScale(float dpi_scale) {
       bool changed = dpi_scale_ != dpi_scale;
@@ -365,9 +376,12 @@ namespace visage {
       on_hierarchy_change_.callback();
     }
 
+    uint64_t layoutStamp() const;
     void initChildren();
     void destroyChildren();
     void eraseChild(Frame* child);
+    void invalidateSpatialIndex() { spatial_index_dirty_ = true; }
+    Frame* childAtPoint(Point point, bool on_top);
 
     bool requiresLayer() const {
       return post_effect_ || cached_ || masked_ || alpha_transparency_ != 1.0f;
@@ -405,6 +419,8 @@ namespace visage {
 
     std::vector<Frame*> children_;
     std::map<Frame*, std::unique_ptr<Frame>> owned_children_;
+    std::unique_ptr<SpatialGrid> spatial_index_;
+    bool spatial_index_dirty_ = true;
     Frame* parent_ = nullptr;
     FrameEventHandler* event_handler_ = nullptr;
 
@@ -419,6 +435,7 @@ namespace visage {
     float alpha_transparency_ = 1.0f;
     Region region_;
     std::unique_ptr<Layout> layout_;
+    uint64_t layout_stamp_ = 0;
     bool drawing_ = true;
     bool redrawing_ = false;
   };
@@ -22,8 +22,59 @@
 #include "layout.h"
 
 namespace visage {
-  std::vector<IBounds> Layout::flexChildGroup(const std::vector<const Layout*>& children,
-                                              IBounds bounds, float dpi_scale) const {
+  struct FlexScratch {
+    std::vector<int> dimensions;
+    std::vector<int> margins_before;
+    std::vector<int> margins_after;
+    std::vector<int> breaks;
+    std::vector<int> cross_sizes;
+    std::vector<int> cross_positions;
+  };
+
+  static FlexScratch& flexScratch() {
+    static thread_local FlexScratch scratch;
+    return scratch;
+  }
+
+  void Layout::changed() {
+    version_ = nextVersion();
+    custom_functions_ = flex_gap_.hasCustomFunctions();
+    for (int i = 0; i < 2; ++i) {
+      custom_functions_ = custom_functions_ || margin_before_[i].hasCustomFunctions() ||
+                          margin_after_[i].hasCustomFunctions() ||
+                          padding_before_[i].hasCustomFunctions() ||
+                          padding_after_[i].hasCustomFunctions() ||
+                          dimensions_[i].hasCustomFunctions();
+    }
+  }
+
+  bool Layout::isCached(const std::vector<const Layout*>& children, const IBounds& bounds,
+                        float dpi_scale) const {
+    if (custom_functions_ || cached_version_ != version_ || cached_bounds_ != bounds ||
+        cached_dpi_scale_ != dpi_scale || cached_children_.size() != children.size()) {
+      return false;
+    }
+
+    for (int i = 0; i < children.size(); ++i) {
+      if (cached_children_[i].layout != children[i] || cached_children_[i].version != children[i]->version_ ||
+          children[i]->custom_functions_) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Layout::cacheKey(const std::vector<const Layout*>& children, const IBounds& bounds, float dpi_scale) {
+    cached_version_ = version_;
+    cached_bounds_ = bounds;
+    cached_dpi_scale_ = dpi_scale;
+    cached_children_.resize(children.size());
+    for (int i = 0; i < children.size(); ++i)
+      cached_children_[i] = { children[i], children[i]->version_ };
+  }
+
+  void Layout::flexChildGroup(const Layout* const* children, int num_children, IBounds bounds,
+                              float dpi_scale) {
     int width = bounds.width();
     int height = bounds.height();
     int dim = flex_rows_ ? 1 : 0;
@@ -31,15 +82,19 @@ namespace visage {
 
     int flex_area = flex_rows_ ? height : width;
     int flex_gap = flex_gap_.computeInt(dpi_scale, width, height);
-    flex_area -= flex_gap * (children.size() - 1);
+    flex_area -= flex_gap * (num_children - 1);
     float total_flex_grow = 0.0f;
     float total_flex_shrink = 0.0f;
 
-    std::vector<int> dimensions, margins_before, margins_after;
-    dimensions.reserve(children.size());
-    margins_before.reserve(children.size());
-    margins_after.reserve(children.size());
-    for (const Layout* child : children) {
+    FlexScratch& scratch = flexScratch();
+    std::vector<int>& dimensions = scratch.dimensions;
+    std::vector<int>& margins_before = scratch.margins_before;
+    std::vector<int>& margins_after = scratch.margins_after;
+    dimensions.clear();
+    margins_before.clear();
+    margins_after.clear();
+    for (int i = 0; i < num_children; ++i) {
+      const Layout* child = children[i];
       int margin_before = child->margin_before_[dim].computeInt(dpi_scale, width, height);
       int margin_after = child->margin_after_[dim].computeInt(dpi_scale, width, height);
       int dimension = child->dimensions_[dim].computeInt(dpi_scale, width, height);
@@ -53,7 +108,7 @@ namespace visage {
     }
 
     if (flex_area > 0) {
-      for (int i = 0; i < children.size(); ++i) {
+      for (int i = 0; i < num_children; ++i) {
         if (children[i]->flex_grow_) {
           int delta = std::round(flex_area * children[i]->flex_grow_ / total_flex_grow);
           dimensions[i] += delta;
@@ -64,7 +119,7 @@ namespace visage {
     }
 
     if (flex_area < 0) {
-      for (int i = 0; i < children.size(); ++i) {
+      for (int i = 0; i < num_children; ++i) {
         if (children[i]->flex_shrink_) {
           int delta = std::round(flex_area * children[i]->flex_shrink_ * dimensions[i] / total_flex_shrink);
           delta = std::max(delta, -dimensions[i]);
@@ -75,12 +130,10 @@ namespace visage {
       }
     }
 
-    std::vector<IBounds> results;
-    results.reserve(children.size());
-
+    int start = results_.size();
     int position = 0;
     int cross_area = flex_rows_ ? width : height;
-    for (int i = 0; i < children.size(); ++i) {
+    for (int i = 0; i < num_children; ++i) {
       int cross_before = children[i]->margin_before_[cross_dim].computeInt(dpi_scale, width, height);
       int cross_after = children[i]->margin_after_[cross_dim].computeInt(dpi_scale, width, height);
       int default_cross_size = 0;
@@ -101,34 +154,29 @@ namespace visage {
                                                                       default_cross_size);
       int cross_offset = cross_alignment_mult * (cross_area - cross_before - cross_size - cross_after);
       position += margins_before[i];
-      results.emplace_back(position, cross_before + cross_offset, dimensions[i], cross_size);
+      results_.emplace_back(position, cross_before + cross_offset, dimensions[i], cross_size);
       position += dimensions[i] + margins_after[i] + flex_gap;
     }
 
-    if (flex_reverse_direction_) {
-      int full_flex_area = flex_rows_ ? height : width;
-      for (IBounds& result : results)
+    int full_flex_area = flex_rows_ ? height : width;
+    for (int i = start; i < results_.size(); ++i) {
+      IBounds& result = results_[i];
+      if (flex_reverse_direction_)
         result.setX(full_flex_area - result.right());
-    }
-
-    if (flex_rows_) {
-      for (IBounds& result : results)
+      if (flex_rows_)
         result.flipDimensions();
-    }
-
-    for (IBounds& result : results)
       result = result + IPoint(bounds.x(), bounds.y());
-
-    return results;
+    }
   }
 
-  std::vector<int> Layout::alignCrossPositions(std::vector<int>& sizes, int cross_area, int gap) const {
+  void Layout::alignCrossPositions(std::vector<int>& sizes, std::vector<int>& cross_positions,
+                                   int cross_area, int gap) const {
     int cross_total = gap * (sizes.size() - 1);
     for (int size : sizes)
       cross_total += size;
 
     int cross_extra_space = cross_area - cross_total;
-    std::vector<int> cross_positions;
+    cross_positions.clear();
 
     if (wrap_alignment_ == WrapAlignment::Stretch) {
       int position = 0;
@@ -142,7 +190,7 @@ namespace visage {
         cross_positions.push_back(position);
         position += sizes[i] + gap;
       }
-      return cross_positions;
+      return;
     }
 
     int position = 0;
@@ -174,12 +222,9 @@ namespace visage {
       cross_positions.push_back(position);
       position += sizes[i] + gap + space;
     }
-
-    return cross_positions;
   }
 
-  std::vector<IBounds> Layout::flexChildWrap(const std::vector<const Layout*>& children,
-                                             IBounds bounds, float dpi_scale) const {
+  void Layout::flexChildWrap(const std::vector<const Layout*>& children, IBounds bounds, float dpi_scale) {
     int width = bounds.width();
     int height = bounds.height();
     int dim = flex_rows_ ? 1 : 0;
@@ -190,8 +235,11 @@ namespace visage {
     int cross_max = 0;
     int flex_gap = flex_gap_.computeInt(dpi_scale, width, height);
 
-    std::vector<int> breaks;
-    std::vector<int> cross_sizes;
+    FlexScratch& scratch = flexScratch();
+    std::vector<int>& breaks = scratch.breaks;
+    std::vector<int>& cross_sizes = scratch.cross_sizes;
+    breaks.clear();
+    cross_sizes.clear();
 
     for (int i = 0; i < children.size(); ++i) {
       const Layout* child = children[i];
@@ -220,10 +268,9 @@ namespace visage {
     breaks.push_back(children.size());
     cross_sizes.push_back(cross_max);
     int cross_area = flex_rows_ ? width : height;
-    std::vector<int> cross_positions = alignCrossPositions(cross_sizes, cross_area, flex_gap);
+    std::vector<int>& cross_positions = scratch.cross_positions;
+    alignCrossPositions(cross_sizes, cross_positions, cross_area, flex_gap);
 
-    std::vector<IBounds> results;
-    results.reserve(children.size());
     for (int i = 0; i < breaks.size(); ++i) {
       IBounds group_bounds;
       if (flex_rows_)
@@ -231,18 +278,13 @@ namespace visage {
       else
         group_bounds = { bounds.x(), bounds.y() + cross_positions[i], bounds.width(), cross_sizes[i] };
 
-      auto group = std::vector<const Layout*>(children.begin() + group_index,
-                                              children.begin() + breaks[i]);
+      flexChildGroup(children.data() + group_index, breaks[i] - group_index, group_bounds, dpi_scale);
       group_index = breaks[i];
-      std::vector<IBounds> children_bounds = flexChildGroup(group, group_bounds, dpi_scale);
-      results.insert(results.end(), children_bounds.begin(), children_bounds.end());
     }
 
     if (flex_wrap_ < 0) {
-      for (IBounds& result : results)
+      for (IBounds& result : results_)
         result.setX(bounds.x() + bounds.right() - result.right());
     }
-
-    return results;
   }
-}
\ No newline at end of file
+}
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <visage_utils/dimension.h>
 #include <visage_utils/space.h>
@@ -47,8 +48,14 @@ namespace visage {
       SpaceEvenly
     };
 
-    std::vector<IBounds> flexPositions(const std::vector<const Layout*>& children,
-                                       const IBounds& bounds, float dpi_scale) {
+    // Results are cached and only recomputed when the bounds, the dpi scale, this layout or one of
+    // the children's layouts changed since the last call. Layouts whose Dimensions, or whose
+    // children's Dimensions, use custom functions are recomputed every call.
+    const std::vector<IBounds>& flexPositions(const std::vector<const Layout*>& children,
+                                              const IBounds& bounds, float dpi_scale) {
+      if (isCached(children, bounds, dpi_scale))
+        return results_;
+
       int pad_left = padding_before_[0].computeInt(dpi_scale, bounds.width(), bounds.height());
       int pad_right = padding_after_[0].computeInt(dpi_scale, bounds.width(), bounds.height());
       int pad_top = padding_before_[1].computeInt(dpi_scale, bounds.width(), bounds.height());
@@ -58,13 +65,22 @@ namespace visage {
                               bounds.width() - pad_left - pad_right,
                               bounds.height() - pad_top - pad_bottom };
 
+      results_.clear();
       if (flex_wrap_)
-        return flexChildWrap(children, flex_bounds, dpi_scale);
+        flexChildWrap(children, flex_bounds, dpi_scale);
+      else
+        flexChildGroup(children.data(), children.size(), flex_bounds, dpi_scale);
 
-      return flexChildGroup(children, flex_bounds, dpi_scale);
+      cacheKey(children, bounds, dpi_scale);
+      return results_;
     }
 
-    void setFlex(bool flex) { flex_ = flex; }
+    uint64_t version() const { return version_; }
+
+    void setFlex(bool flex) {
+      flex_ = flex;
+      changed();
+    }
     bool flex() const { return flex_; }
 
     void setMargin(const Dimension& margin) {
@@ -72,12 +88,25 @@ namespace visage {
       margin_before_[1] = margin;
       margin_after_[0] = margin;
       margin_after_[1] = margin;
+      changed();
     }
 
-    void setMarginLeft(const Dimension& margin) { margin_before_[0] = margin; }
-    void setMarginRight(const Dimension& margin) { margin_after_[0] = margin; }
-    void setMarginTop(const Dimension& margin) { margin_before_[1] = margin; }
-    void setMarginBottom(const Dimension& margin) { margin_after_[1] = margin; }
+    void setMarginLeft(const Dimension& margin) {
+      margin_before_[0] = margin;
+      changed();
+    }
+    void setMarginRight(const Dimension& margin) {
+      margin_after_[0] = margin;
+      changed();
+    }
+    void setMarginTop(const Dimension& margin) {
+      margin_before_[1] = margin;
+      changed();
+    }
+    void setMarginBottom(const Dimension& margin) {
+      margin_after_[1] = margin;
+      changed();
+    }
     const Dimension& marginLeft() { return margin_before_[0]; }
     const Dimension& marginRight() { return margin_after_[0]; }
     const Dimension& marginTop() { return margin_before_[1]; }
@@ -88,12 +117,25 @@ namespace visage {
       padding_before_[1] = padding;
       padding_after_[0] = padding;
       padding_after_[1] = padding;
+      changed();
     }
 
-    void setPaddingLeft(const Dimension& padding) { padding_before_[0] = padding; }
-    void setPaddingRight(const Dimension& padding) { padding_after_[0] = padding; }
-    void setPaddingTop(const Dimension& padding) { padding_before_[1] = padding; }
-    void setPaddingBottom(const Dimension& padding) { padding_after_[1] = padding; }
+    void setPaddingLeft(const Dimension& padding) {
+      padding_before_[0] = padding;
+      changed();
+    }
+    void setPaddingRight(const Dimension& padding) {
+      padding_after_[0] = padding;
+      changed();
+    }
+    void setPaddingTop(const Dimension& padding) {
+      padding_before_[1] = padding;
+      changed();
+    }
+    void setPaddingBottom(const Dimension& padding) {
+      padding_after_[1] = padding;
+      changed();
+    }
     const Dimension& paddingLeft() { return padding_before_[0]; }
     const Dimension& paddingRight() { return padding_after_[0]; }
     const Dimension& paddingTop() { return padding_before_[1]; }
@@ -102,32 +144,80 @@ namespace visage {
     void setDimensions(const Dimension& width, const Dimension& height) {
       dimensions_[0] = width;
       dimensions_[1] = height;
+      changed();
     }
 
-    void setWidth(const Dimension& width) { dimensions_[0] = width; }
-    void setHeight(const Dimension& height) { dimensions_[1] = height; }
+    void setWidth(const Dimension& width) {
+      dimensions_[0] = width;
+      changed();
+    }
+    void setHeight(const Dimension& height) {
+      dimensions_[1] = height;
+      changed();
+    }
     const Dimension& width() { return dimensions_[0]; }
     const Dimension& height() { return dimensions_[1]; }
 
-    void setFlexGrow(float grow) { flex_grow_ = grow; }
-    void setFlexShrink(float shrink) { flex_shrink_ = shrink; }
-    void setFlexRows(bool rows) { flex_rows_ = rows; }
-    void setFlexReverseDirection(bool reverse) { flex_reverse_direction_ = reverse; }
-    void setFlexWrap(bool wrap) { flex_wrap_ = wrap ? 1 : 0; }
-    void setFlexItemAlignment(ItemAlignment alignment) { item_alignment_ = alignment; }
-    void setFlexSelfAlignment(ItemAlignment alignment) { self_alignment_ = alignment; }
-    void setFlexWrapAlignment(WrapAlignment alignment) { wrap_alignment_ = alignment; }
-    void setFlexWrapReverse(bool wrap) { flex_wrap_ = wrap ? -1 : 0; }
-    void setFlexGap(Dimension gap) { flex_gap_ = std::move(gap); }
+    void setFlexGrow(float grow) {
+      flex_grow_ = grow;
+      changed();
+    }
+    void setFlexShrink(float shrink) {
+      flex_shrink_ = shrink;
+      changed();
+    }
+    void setFlexRows(bool rows) {
+      flex_rows_ = rows;
+      changed();
+    }
+    void setFlexReverseDirection(bool reverse) {
+      flex_reverse_direction_ = reverse;
+      changed();
+    }
+    void setFlexWrap(bool wrap) {
+      flex_wrap_ = wrap ? 1 : 0;
+      changed();
+    }
+    void setFlexItemAlignment(ItemAlignment alignment) {
+      item_alignment_ = alignment;
+      changed();
+    }
+    void setFlexSelfAlignment(ItemAlignment alignment) {
+      self_alignment_ = alignment;
+      changed();
+    }
+    void setFlexWrapAlignment(WrapAlignment alignment) {
+      wrap_alignment_ = alignment;
+      changed();
+    }
+    void setFlexWrapReverse(bool wrap) {
+      flex_wrap_ = wrap ? -1 : 0;
+      changed();
+    }
+    void setFlexGap(Dimension gap) {
+      flex_gap_ = std::move(gap);
+      changed();
+    }
 
   private:
-    std::vector<IBounds> flexChildGroup(const std::vector<const Layout*>& children, IBounds bounds,
-                                        float dpi_scale) const;
+    struct CachedChild {
+      const Layout* layout = nullptr;
+      uint64_t version = 0;
+    };
+
+    static uint64_t nextVersion() {
+      static std::atomic<uint64_t> version = 0;
+      return ++version;
+    }
 
-    std::vector<int> alignCrossPositions(std::vector<int>& cross_sizes, int cross_area, int gap) const;
+    void changed();
+    bool isCached(const std::vector<const Layout*>& children, const IBounds& bounds, float dpi_scale) const;
+    void cacheKey(const std::vector<const Layout*>& children, const IBounds& bounds, float dpi_scale);
 
-    std::vector<IBounds> flexChildWrap(const std::vector<const Layout*>& children, IBounds bounds,
-                                       float dpi_scale) const;
+    void flexChildGroup(const Layout* const* children, int num_children, IBounds bounds, float dpi_scale);
+    void alignCrossPositions(std::vector<int>& cross_sizes, std::vector<int>& cross_positions,
+                             int cross_area, int gap) const;
+    void flexChildWrap(const std::vector<const Layout*>& children, IBounds bounds, float dpi_scale);
 
     bool flex_ = false;
     Dimension margin_before_[2];
@@ -145,5 +235,13 @@ namespace visage {
     bool flex_reverse_direction_ = false;
     int flex_wrap_ = 0;
     Dimension flex_gap_;
+
+    uint64_t version_ = nextVersion();
+    bool custom_functions_ = false;
+    uint64_t cached_version_ = 0;
+    IBounds cached_bounds_;
+    float cached_dpi_scale_ = 0.0f;
+    std::vector<CachedChild> cached_children_;
+    std::vector<IBounds> results_;
   };
 }
\ No newline at end of file
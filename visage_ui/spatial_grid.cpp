@@ -0,0 +1,105 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace visage {
+  void SpatialGrid::build(const std::vector<Bounds>& entries) {
+    clear();
+    if (entries.empty())
+      return;
+
+    float left = entries[0].x();
+    float top = entries[0].y();
+    float right = entries[0].right();
+    float bottom = entries[0].bottom();
+    for (const Bounds& bounds : entries) {
+      left = std::min(left, bounds.x());
+      top = std::min(top, bounds.y());
+      right = std::max(right, bounds.right());
+      bottom = std::max(bottom, bounds.bottom());
+    }
+
+    int side = std::ceil(std::sqrt(static_cast<float>(entries.size())));
+    side = std::clamp(side, 1, kMaxCellsPerSide);
+    left_ = left;
+    top_ = top;
+    columns_ = side;
+    rows_ = side;
+    cell_width_ = std::max(right - left, 1.0f) / columns_;
+    cell_height_ = std::max(bottom - top, 1.0f) / rows_;
+
+    std::vector<int> counts(numCells() + 1, 0);
+    for (const Bounds& bounds : entries) {
+      if (bounds.width() <= 0.0f || bounds.height() <= 0.0f)
+        continue;
+
+      for (int r = row(bounds.y()); r <= row(bounds.bottom()); ++r) {
+        for (int c = column(bounds.x()); c <= column(bounds.right()); ++c)
+          counts[r * columns_ + c + 1]++;
+      }
+    }
+
+    cell_starts_.resize(numCells() + 1);
+    cell_starts_[0] = 0;
+    for (int i = 1; i <= numCells(); ++i)
+      cell_starts_[i] = cell_starts_[i - 1] + counts[i];
+
+    cell_entries_.resize(cell_starts_.back());
+    std::vector<int> positions(cell_starts_.begin(), cell_starts_.end() - 1);
+    for (int i = 0; i < entries.size(); ++i) {
+      const Bounds& bounds = entries[i];
+      if (bounds.width() <= 0.0f || bounds.height() <= 0.0f)
+        continue;
+
+      for (int r = row(bounds.y()); r <= row(bounds.bottom()); ++r) {
+        for (int c = column(bounds.x()); c <= column(bounds.right()); ++c)
+          cell_entries_[positions[r * columns_ + c]++] = i;
+      }
+    }
+  }
+
+  void SpatialGrid::clear() {
+    columns_ = 0;
+    rows_ = 0;
+    cell_starts_.clear();
+    cell_entries_.clear();
+  }
+
+  int SpatialGrid::column(float x) const {
+    return std::clamp(static_cast<int>((x - left_) / cell_width_), 0, columns_ - 1);
+  }
+
+  int SpatialGrid::row(float y) const {
+    return std::clamp(static_cast<int>((y - top_) / cell_height_), 0, rows_ - 1);
+  }
+
+  int SpatialGrid::cellIndex(Point point) const {
+    if (numCells() == 0 || point.x < left_ || point.y < top_ ||
+        point.x >= left_ + columns_ * cell_width_ || point.y >= top_ + rows_ * cell_height_)
+      return -1;
+
+    return row(point.y) * columns_ + column(point.x);
+  }
+}
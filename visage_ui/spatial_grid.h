@@ -0,0 +1,66 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "visage_utils/space.h"
+
+#include <vector>
+
+namespace visage {
+  // Uniform grid over a set of bounds. Each cell lists the indices of the bounds overlapping it in
+  // ascending order, so a point query only has to test the entries of a single cell.
+  class SpatialGrid {
+  public:
+    static constexpr int kMaxCellsPerSide = 64;
+
+    void build(const std::vector<Bounds>& entries);
+    void clear();
+
+    template<typename F>
+    void forEachCandidateReversed(Point point, F&& callback) const {
+      int cell = cellIndex(point);
+      if (cell < 0)
+        return;
+
+      for (int i = cell_starts_[cell + 1] - 1; i >= cell_starts_[cell]; --i) {
+        if (callback(cell_entries_[i]))
+          return;
+      }
+    }
+
+    int numCells() const { return columns_ * rows_; }
+
+  private:
+    int cellIndex(Point point) const;
+    int column(float x) const;
+    int row(float y) const;
+
+    float left_ = 0.0f;
+    float top_ = 0.0f;
+    float cell_width_ = 1.0f;
+    float cell_height_ = 1.0f;
+    int columns_ = 0;
+    int rows_ = 0;
+    std::vector<int> cell_starts_;
+    std::vector<int> cell_entries_;
+  };
+}
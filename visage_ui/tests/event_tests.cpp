@@ -0,0 +1,78 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/events.h"
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+using namespace visage;
+
+namespace {
+  class CountingTimer : public EventTimer {
+  public:
+    void timerCallback() override { count++; }
+
+    int count = 0;
+  };
+}
+
+TEST_CASE("Queued callbacks wake event loops from other threads", "[ui]") {
+  EventManager& events = EventManager::instance();
+  std::atomic<int> wakes = 0;
+  int owner = 0;
+  events.addWakeCallback(&owner, [&wakes] { wakes++; });
+
+  bool ran = false;
+  std::thread worker([&ran] { runOnEventThread([&ran] { ran = true; }); });
+  worker.join();
+  REQUIRE(wakes == 1);
+  REQUIRE(events.hasPendingCallbacks());
+
+  events.checkEventTimers();
+  REQUIRE(ran);
+  REQUIRE_FALSE(events.hasPendingCallbacks());
+
+  events.removeWakeCallback(&owner);
+  runOnEventThread([] { });
+  REQUIRE(wakes == 1);
+  events.checkEventTimers();
+}
+
+TEST_CASE("Next timer deadline", "[ui]") {
+  EventManager& events = EventManager::instance();
+  REQUIRE(events.millisecondsUntilNextTimer() == -1);
+
+  CountingTimer slow;
+  CountingTimer fast;
+  slow.startTimer(10000);
+  fast.startTimer(5000);
+  long long milliseconds = events.millisecondsUntilNextTimer();
+  REQUIRE(milliseconds > 4000);
+  REQUIRE(milliseconds <= 5000);
+
+  fast.stopTimer();
+  REQUIRE(events.millisecondsUntilNextTimer() > 5000);
+  slow.stopTimer();
+  REQUIRE(events.millisecondsUntilNextTimer() == -1);
+  REQUIRE_FALSE(events.hasPendingEvents());
+}
@@ -0,0 +1,119 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/frame.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+using namespace visage::dimension;
+
+namespace {
+  void addFlexChildren(Frame* parent, int fan_out, int depth, std::vector<std::unique_ptr<Frame>>& frames) {
+    parent->setFlexLayout(true);
+    parent->layout().setFlexRows(depth % 2 == 0);
+    parent->layout().setFlexGap(1_px);
+    for (int i = 0; i < fan_out; ++i) {
+      frames.push_back(std::make_unique<Frame>());
+      Frame* child = frames.back().get();
+      child->layout().setFlexGrow(1.0f + i % 3);
+      child->layout().setMargin(1_px);
+      parent->addChild(child);
+      if (depth > 1)
+        addFlexChildren(child, fan_out, depth - 1, frames);
+    }
+  }
+}
+
+TEST_CASE("Layout cache picks up child style changes", "[ui]") {
+  Frame root;
+  std::vector<std::unique_ptr<Frame>> frames;
+  addFlexChildren(&root, 3, 2, frames);
+  root.setBounds(0, 0, 300, 300);
+
+  Frame* row = frames[0].get();
+  Frame* leaf = frames[1].get();
+  REQUIRE(row->height() == 49);
+  REQUIRE(leaf->width() == 48);
+
+  root.setBounds(10, 10, 300, 300);
+  REQUIRE(leaf->width() == 48);
+
+  leaf->layout().setFlexGrow(0.0f);
+  leaf->layout().setWidth(20_px);
+  row->computeLayout();
+  REQUIRE(leaf->width() == 20);
+
+  root.setBounds(0, 0, 600, 300);
+  REQUIRE(leaf->width() == 20);
+  REQUIRE(frames[2]->width() > 96);
+}
+
+TEST_CASE("Moving a frame picks up layout changes", "[ui]") {
+  Frame root;
+  std::vector<std::unique_ptr<Frame>> frames;
+  addFlexChildren(&root, 3, 2, frames);
+  root.setBounds(0, 0, 300, 300);
+
+  Frame* leaf = frames[1].get();
+  leaf->layout().setFlexGrow(0.0f);
+  leaf->layout().setWidth(20_px);
+  REQUIRE(leaf->width() == 48);
+
+  Frame* row = frames[0].get();
+  row->setBounds(row->x() + 1, row->y(), row->width(), row->height());
+  REQUIRE(leaf->width() == 20);
+
+  root.layout().setPadding(10_px);
+  root.setBounds(10, 10, 300, 300);
+  REQUIRE(row->x() == 11);
+}
+
+TEST_CASE("Nested flex layout benchmark", "[.benchmark][ui]") {
+  Frame root;
+  std::vector<std::unique_ptr<Frame>> frames;
+  addFlexChildren(&root, 10, 4, frames);
+  REQUIRE(frames.size() == 11110);
+  root.setBounds(0, 0, 2000, 2000);
+
+  BENCHMARK("Resize 10k node flex tree 100 times") {
+    for (int i = 0; i < 100; ++i)
+      root.setBounds(0, 0, 2000 + (i % 2) * 10, 2000);
+    return root.width();
+  };
+
+  BENCHMARK("Move 10k node flex tree 100 times") {
+    for (int i = 0; i < 100; ++i)
+      root.setBounds(i, i, 2000, 2000);
+    return root.width();
+  };
+
+  Frame* leaf_parent = frames[frames.size() - 11].get();
+  Frame* leaf = frames.back().get();
+  BENCHMARK("Relayout after leaf style change") {
+    for (int i = 0; i < 100; ++i) {
+      leaf->layout().setFlexGrow(1.0f + i % 2);
+      leaf_parent->computeLayout();
+    }
+    return leaf->width();
+  };
+}
@@ -579,4 +579,39 @@ TEST_CASE("Layout flex alignment", "[ui]") {
   REQUIRE(results[7] == IBounds(320, 170, 160, 80));
   REQUIRE(results[8] == IBounds(610, 10, 180, 90));
   REQUIRE(results[9] == IBounds(590, 110, 200, 100));
+}
+
+TEST_CASE("Layout recomputes custom function dimensions", "[ui]") {
+  Layout layout;
+  layout.setFlex(true);
+  layout.setFlexRows(false);
+
+  int child_width = 100;
+  Layout child;
+  child.setWidth(Dimension(1.0f, [&child_width](float amount, float, float, float) {
+    return amount * child_width;
+  }));
+  child.setHeight(50_npx);
+
+  auto results = layout.flexPositions({ &child }, { 0, 0, 1000, 500 }, 1.0f);
+  REQUIRE(results[0] == IBounds(0, 0, 100, 50));
+
+  child_width = 200;
+  results = layout.flexPositions({ &child }, { 0, 0, 1000, 500 }, 1.0f);
+  REQUIRE(results[0] == IBounds(0, 0, 200, 50));
+
+  int padding = 10;
+  Layout parent;
+  parent.setFlex(true);
+  parent.setPadding(Dimension(1.0f, [&padding](float amount, float, float, float) {
+    return amount * padding;
+  }));
+  Layout sized_child;
+  sized_child.setDimensions(100_npx, 100_npx);
+  results = parent.flexPositions({ &sized_child }, { 0, 0, 1000, 500 }, 1.0f);
+  REQUIRE(results[0] == IBounds(10, 10, 100, 100));
+
+  padding = 20;
+  results = parent.flexPositions({ &sized_child }, { 0, 0, 1000, 500 }, 1.0f);
+  REQUIRE(results[0] == IBounds(20, 20, 100, 100));
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_ui/frame.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+namespace {
+  class GridFrame : public Frame {
+  public:
+    static constexpr int kCellSize = 10;
+
+    explicit GridFrame(int cells_per_side) {
+      setBounds(0, 0, cells_per_side * kCellSize, cells_per_side * kCellSize);
+      for (int y = 0; y < cells_per_side; ++y) {
+        for (int x = 0; x < cells_per_side; ++x) {
+          auto cell = std::make_unique<Frame>();
+          cell->setBounds(x * kCellSize, y * kCellSize, kCellSize, kCellSize);
+          addChild(std::move(cell));
+        }
+      }
+    }
+  };
+}
+
+TEST_CASE("Spatial index matches linear hit testing", "[ui]") {
+  static constexpr int kCellsPerSide = 20;
+  GridFrame grid(kCellsPerSide);
+
+  Frame overlay;
+  overlay.setBounds(15, 15, 30, 30);
+  grid.addChild(&overlay);
+
+  Frame on_top;
+  on_top.setBounds(0, 0, 12, 12);
+  on_top.setOnTop(true);
+  grid.addChild(&on_top);
+  grid.children()[0]->setVisible(false);
+  grid.children()[50]->setIgnoresMouseEvents(true, false);
+
+  std::vector<Frame*> linear;
+  for (int y = -5; y < kCellsPerSide * GridFrame::kCellSize + 5; y += 3) {
+    for (int x = -5; x < kCellsPerSide * GridFrame::kCellSize + 5; x += 3)
+      linear.push_back(grid.frameAtPoint({ x + 0.5f, y + 0.5f }));
+  }
+
+  grid.setSpatialIndexEnabled(true);
+  REQUIRE(grid.spatialIndexEnabled());
+  int index = 0;
+  for (int y = -5; y < kCellsPerSide * GridFrame::kCellSize + 5; y += 3) {
+    for (int x = -5; x < kCellsPerSide * GridFrame::kCellSize + 5; x += 3)
+      REQUIRE(grid.frameAtPoint({ x + 0.5f, y + 0.5f }) == linear[index++]);
+  }
+
+  REQUIRE(grid.frameAtPoint({ 5.0f, 5.0f }) == &on_top);
+  REQUIRE(grid.frameAtPoint({ 20.0f, 20.0f }) == &overlay);
+
+  overlay.setBounds(100, 100, 10, 10);
+  REQUIRE(grid.frameAtPoint({ 20.0f, 20.0f }) == grid.children()[kCellsPerSide * 2 + 2]);
+  REQUIRE(grid.frameAtPoint({ 105.0f, 105.0f }) == &overlay);
+
+  grid.removeChild(&overlay);
+  REQUIRE(grid.frameAtPoint({ 105.0f, 105.0f }) == grid.children()[kCellsPerSide * 10 + 10]);
+  grid.removeChild(&on_top);
+}
+
+TEST_CASE("Spatial index hit testing benchmark", "[.benchmark][ui]") {
+  static constexpr int kCellsPerSide = 64;
+  GridFrame grid(kCellsPerSide);
+  float size = kCellsPerSide * GridFrame::kCellSize;
+
+  auto sweep = [&] {
+    Frame* result = nullptr;
+    for (float y = 0.5f; y < size; y += 37.0f) {
+      for (float x = 0.5f; x < size; x += 37.0f)
+        result = grid.frameAtPoint({ x, y });
+    }
+    return result;
+  };
+
+  BENCHMARK("Linear frameAtPoint") {
+    return sweep();
+  };
+
+  grid.setSpatialIndexEnabled(true);
+  BENCHMARK("Spatial index frameAtPoint") {
+    return sweep();
+  };
+}
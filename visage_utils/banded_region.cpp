@@ -0,0 +1,287 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "banded_region.h"
+
+#include <algorithm>
+#include <climits>
+
+namespace visage {
+  static void appendSpan(std::vector<BandedRegion::Span>& spans, int left, int right) {
+    if (!spans.empty() && spans.back().right == left)
+      spans.back().right = right;
+    else
+      spans.push_back({ left, right });
+  }
+
+  void BandedRegion::combineSpans(const std::vector<Span>& first, const std::vector<Span>& second,
+                                  Operation operation, std::vector<Span>& result) {
+    result.clear();
+    size_t index_first = 0;
+    size_t index_second = 0;
+    bool in_first = false;
+    bool in_second = false;
+    bool inside = false;
+    int start = 0;
+
+    while (true) {
+      int next_first = INT_MAX;
+      if (index_first < first.size())
+        next_first = in_first ? first[index_first].right : first[index_first].left;
+      int next_second = INT_MAX;
+      if (index_second < second.size())
+        next_second = in_second ? second[index_second].right : second[index_second].left;
+
+      int x = std::min(next_first, next_second);
+      if (x == INT_MAX)
+        break;
+
+      if (next_first == x) {
+        index_first += in_first;
+        in_first = !in_first;
+      }
+      if (next_second == x) {
+        index_second += in_second;
+        in_second = !in_second;
+      }
+
+      bool now_inside = in_first && !in_second;
+      if (operation == kUnion)
+        now_inside = in_first || in_second;
+      else if (operation == kIntersect)
+        now_inside = in_first && in_second;
+      if (now_inside == inside)
+        continue;
+
+      if (now_inside)
+        start = x;
+      else if (x > start)
+        appendSpan(result, start, x);
+      inside = now_inside;
+    }
+  }
+
+  static void appendBand(std::vector<BandedRegion::Band>& bands, int top, int bottom,
+                         const std::vector<BandedRegion::Span>& spans) {
+    if (!bands.empty() && bands.back().bottom == top && bands.back().spans == spans)
+      bands.back().bottom = bottom;
+    else
+      bands.push_back({ top, bottom, spans });
+  }
+
+  static long long bandArea(const BandedRegion::Band& band) {
+    long long width = 0;
+    for (const BandedRegion::Span& span : band.spans)
+      width += span.right - span.left;
+    return width * (band.bottom - band.top);
+  }
+
+  static long long closeGaps(BandedRegion::Band& band, int piece_cost) {
+    long long added = 0;
+    long long height = band.bottom - band.top;
+    std::vector<BandedRegion::Span> spans;
+    for (const BandedRegion::Span& span : band.spans) {
+      long long gap_area = spans.empty() ? 0 : (span.left - spans.back().right) * height;
+      if (!spans.empty() && gap_area < piece_cost) {
+        spans.back().right = span.right;
+        added += gap_area;
+      }
+      else
+        spans.push_back(span);
+    }
+    band.spans = std::move(spans);
+    return added;
+  }
+
+  void BandedRegion::combine(const BandedRegion& other, Operation operation) {
+    if (operation == kUnion && other.isEmpty())
+      return;
+    if (operation == kSubtract && (isEmpty() || other.isEmpty()))
+      return;
+    if (operation == kIntersect && (isEmpty() || other.isEmpty())) {
+      bands_.clear();
+      return;
+    }
+    if (operation == kUnion && isEmpty()) {
+      bands_ = other.bands_;
+      return;
+    }
+    if (operation == kUnion && other.bands_.size() == 1 && other.bands_[0].spans.size() == 1) {
+      const Band& band = other.bands_[0];
+      IBounds rect(band.spans[0].left, band.top, band.spans[0].right - band.spans[0].left,
+                   band.bottom - band.top);
+      if (contains(rect))
+        return;
+    }
+
+    static const std::vector<Span> kNoSpans;
+    const std::vector<Band>& first = bands_;
+    const std::vector<Band>& second = other.bands_;
+    std::vector<Band> result;
+    std::vector<Span> spans;
+    size_t index_first = 0;
+    size_t index_second = 0;
+
+    int y = INT_MAX;
+    if (!first.empty())
+      y = first[0].top;
+    if (!second.empty())
+      y = std::min(y, second[0].top);
+
+    while (true) {
+      while (index_first < first.size() && first[index_first].bottom <= y)
+        ++index_first;
+      while (index_second < second.size() && second[index_second].bottom <= y)
+        ++index_second;
+      if (index_first == first.size() && index_second == second.size())
+        break;
+
+      int next = INT_MAX;
+      const std::vector<Span>* first_spans = &kNoSpans;
+      if (index_first < first.size()) {
+        const Band& band = first[index_first];
+        if (band.top <= y)
+          first_spans = &band.spans;
+        next = std::min(next, band.top > y ? band.top : band.bottom);
+      }
+      const std::vector<Span>* second_spans = &kNoSpans;
+      if (index_second < second.size()) {
+        const Band& band = second[index_second];
+        if (band.top <= y)
+          second_spans = &band.spans;
+        next = std::min(next, band.top > y ? band.top : band.bottom);
+      }
+
+      if (!first_spans->empty() || !second_spans->empty()) {
+        combineSpans(*first_spans, *second_spans, operation, spans);
+        if (!spans.empty())
+          appendBand(result, y, next, spans);
+      }
+      y = next;
+    }
+
+    bands_ = std::move(result);
+  }
+
+  bool BandedRegion::contains(const IBounds& rect) const {
+    if (!rect.hasArea())
+      return true;
+
+    int y = rect.y();
+    for (const Band& band : bands_) {
+      if (band.bottom <= y)
+        continue;
+      if (band.top > y)
+        return false;
+
+      bool covered = std::any_of(band.spans.begin(), band.spans.end(), [&rect](const Span& span) {
+        return span.left <= rect.x() && span.right >= rect.right();
+      });
+      if (!covered)
+        return false;
+
+      y = band.bottom;
+      if (y >= rect.bottom())
+        return true;
+    }
+    return false;
+  }
+
+  bool BandedRegion::overlaps(const IBounds& rect) const {
+    for (const Band& band : bands_) {
+      if (band.top >= rect.bottom())
+        break;
+      if (band.bottom <= rect.y())
+        continue;
+
+      for (const Span& span : band.spans) {
+        if (span.left < rect.right() && span.right > rect.x())
+          return true;
+      }
+    }
+    return false;
+  }
+
+  IBounds BandedRegion::boundingBox() const {
+    if (bands_.empty())
+      return {};
+
+    int left = INT_MAX;
+    int right = INT_MIN;
+    for (const Band& band : bands_) {
+      left = std::min(left, band.spans.front().left);
+      right = std::max(right, band.spans.back().right);
+    }
+    return { left, bands_.front().top, right - left, bands_.back().bottom - bands_.front().top };
+  }
+
+  long long BandedRegion::area() const {
+    long long result = 0;
+    for (const Band& band : bands_)
+      result += bandArea(band);
+    return result;
+  }
+
+  int BandedRegion::numRects() const {
+    int result = 0;
+    for (const Band& band : bands_)
+      result += band.spans.size();
+    return result;
+  }
+
+  void BandedRegion::appendRects(std::vector<IBounds>& rects) const {
+    for (const Band& band : bands_) {
+      for (const Span& span : band.spans)
+        rects.emplace_back(span.left, band.top, span.right - span.left, band.bottom - band.top);
+    }
+  }
+
+  long long BandedRegion::coalesce(int piece_cost) {
+    long long added = 0;
+    std::vector<Band> result;
+    std::vector<Span> spans;
+    for (Band& band : bands_) {
+      added += closeGaps(band, piece_cost);
+      if (result.empty()) {
+        result.push_back(std::move(band));
+        continue;
+      }
+
+      Band& last = result.back();
+      combineSpans(last.spans, band.spans, kUnion, spans);
+      Band merged = { last.top, band.bottom, spans };
+      closeGaps(merged, piece_cost);
+      long long extra = bandArea(merged) - bandArea(last) - bandArea(band);
+      long long saved = static_cast<long long>(last.spans.size() + band.spans.size()) -
+                        merged.spans.size();
+
+      if (saved > 0 && extra < saved * piece_cost) {
+        added += extra;
+        last = std::move(merged);
+      }
+      else
+        result.push_back(std::move(band));
+    }
+
+    bands_ = std::move(result);
+    return added;
+  }
+}
@@ -0,0 +1,97 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "space.h"
+
+#include <vector>
+
+namespace visage {
+  // Set of pixels stored as y-sorted bands of sorted, disjoint x-spans. Touching bands with
+  // identical spans are merged, so the rectangle decomposition stays small and never overlaps.
+  class BandedRegion {
+  public:
+    struct Span {
+      int left = 0;
+      int right = 0;
+
+      bool operator==(const Span& other) const {
+        return left == other.left && right == other.right;
+      }
+    };
+
+    struct Band {
+      int top = 0;
+      int bottom = 0;
+      std::vector<Span> spans;
+    };
+
+    // Extra overdrawn pixels accepted by coalesce() to save one rectangle
+    static constexpr int kDefaultPieceCost = 4096;
+
+    BandedRegion() = default;
+    explicit BandedRegion(const IBounds& rect) {
+      if (rect.hasArea())
+        bands_.push_back({ rect.y(), rect.bottom(), { { rect.x(), rect.right() } } });
+    }
+
+    bool isEmpty() const { return bands_.empty(); }
+    void clear() { bands_.clear(); }
+    const std::vector<Band>& bands() const { return bands_; }
+
+    void add(const IBounds& rect) { combine(BandedRegion(rect), kUnion); }
+    void add(const BandedRegion& other) { combine(other, kUnion); }
+    void intersect(const IBounds& rect) { combine(BandedRegion(rect), kIntersect); }
+    void intersect(const BandedRegion& other) { combine(other, kIntersect); }
+    void subtract(const IBounds& rect) { combine(BandedRegion(rect), kSubtract); }
+    void subtract(const BandedRegion& other) { combine(other, kSubtract); }
+
+    bool contains(const IBounds& rect) const;
+    bool overlaps(const IBounds& rect) const;
+    IBounds boundingBox() const;
+    long long area() const;
+    int numRects() const;
+    void appendRects(std::vector<IBounds>& rects) const;
+    std::vector<IBounds> rects() const {
+      std::vector<IBounds> result;
+      appendRects(result);
+      return result;
+    }
+
+    // Grows the region to cut down its rectangle count. Neighboring pieces merge whenever the
+    // pixels added are fewer than piece_cost per rectangle saved. Returns the pixels added.
+    long long coalesce(int piece_cost = kDefaultPieceCost);
+
+  private:
+    enum Operation {
+      kUnion,
+      kIntersect,
+      kSubtract
+    };
+
+    static void combineSpans(const std::vector<Span>& first, const std::vector<Span>& second,
+                             Operation operation, std::vector<Span>& result);
+    void combine(const BandedRegion& other, Operation operation);
+
+    std::vector<Band> bands_;
+  };
+}
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdarg>
 
 namespace visage {
@@ -69,7 +70,7 @@ namespace visage {
     void remove() { count_--; }
 
   private:
-    int count_ = 0;
+    std::atomic<int> count_ = 0;
   };
 
   template<typename T>
@@ -0,0 +1,145 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "dimension.h"
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace visage {
+  namespace {
+    struct CustomComputeFunctions {
+      // Index 0 is an empty function that custom units fall back to once the table is full
+      std::mutex mutex;
+      std::deque<Dimension::ComputeFunction> functions { Dimension::ComputeFunction() };
+      std::unordered_map<Dimension::RawFunction, uint32_t> raw_functions;
+      std::unordered_map<std::string, uint32_t> expressions;
+    };
+
+    CustomComputeFunctions& customComputeFunctions() {
+      static CustomComputeFunctions functions;
+      return functions;
+    }
+
+    uint32_t addFunction(CustomComputeFunctions& custom, Dimension::ComputeFunction compute) {
+      if (custom.functions.size() >= Dimension::Function::kMaxCustomFunctions) {
+        VISAGE_LOG("Dimension custom function table is full");
+        VISAGE_ASSERT(false);
+        return 0;
+      }
+
+      custom.functions.push_back(std::move(compute));
+      return custom.functions.size() - 1;
+    }
+
+    template<typename T>
+    void appendKey(std::string& key, T value) {
+      char bytes[sizeof(value)];
+      std::memcpy(bytes, &value, sizeof(value));
+      key.append(bytes, sizeof(bytes));
+    }
+  }
+
+  uint32_t Dimension::Function::registerFunction(RawFunction compute) {
+    if (compute == nullptr)
+      return 0;
+
+    CustomComputeFunctions& custom = customComputeFunctions();
+    std::lock_guard<std::mutex> lock(custom.mutex);
+    auto found = custom.raw_functions.find(compute);
+    if (found != custom.raw_functions.end())
+      return found->second;
+
+    uint32_t index = addFunction(custom, compute);
+    if (index)
+      custom.raw_functions[compute] = index;
+    return index;
+  }
+
+  uint32_t Dimension::Function::registerFunction(ComputeFunction compute) {
+    if (!compute)
+      return 0;
+    if (const RawFunction* raw_function = compute.target<RawFunction>())
+      return registerFunction(*raw_function);
+
+    CustomComputeFunctions& custom = customComputeFunctions();
+    std::lock_guard<std::mutex> lock(custom.mutex);
+    return addFunction(custom, std::move(compute));
+  }
+
+  float Dimension::Function::computeCustom(uint32_t index, float amount, float dpi_scale,
+                                           float parent_width, float parent_height) {
+    CustomComputeFunctions& custom = customComputeFunctions();
+    const ComputeFunction* compute = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(custom.mutex);
+      VISAGE_ASSERT(index < custom.functions.size());
+      if (index >= custom.functions.size())
+        return 0.0f;
+      compute = &custom.functions[index];
+    }
+    if (*compute)
+      return (*compute)(amount, dpi_scale, parent_width, parent_height);
+    return 0.0f;
+  }
+
+  Dimension Dimension::collapse(const Dimension& a, const Dimension& b, Operation operation) {
+    std::string key;
+    for (const Dimension* dimension : { &a, &b }) {
+      appendKey(key, dimension->num_nodes_);
+      appendKey(key, dimension->amount);
+      appendKey(key, dimension->compute_function.value_);
+      for (int i = 0; i < dimension->num_nodes_; ++i) {
+        appendKey(key, dimension->nodes_[i].amount);
+        appendKey(key, dimension->nodes_[i].function.value_);
+      }
+    }
+    appendKey(key, operation);
+
+    Operation type = a.hasCustomFunctions() || b.hasCustomFunctions() ? Operation::Custom :
+                                                                         Operation::Expression;
+    CustomComputeFunctions& custom = customComputeFunctions();
+    std::lock_guard<std::mutex> lock(custom.mutex);
+    auto found = custom.expressions.find(key);
+    if (found != custom.expressions.end())
+      return Dimension(0.0f, Function(type, found->second));
+
+    uint32_t index = addFunction(custom, [a, b, operation](float, float dpi_scale, float width,
+                                                           float height) {
+      float value_a = a.compute(dpi_scale, width, height);
+      float value_b = b.compute(dpi_scale, width, height);
+      switch (operation) {
+      case Operation::Add: return value_a + value_b;
+      case Operation::Subtract: return value_a - value_b;
+      case Operation::Min: return std::min(value_a, value_b);
+      case Operation::Max: return std::max(value_a, value_b);
+      case Operation::Scale: return value_a * value_b;
+      default: return value_a;
+      }
+    });
+    if (index)
+      custom.expressions[key] = index;
+    return Dimension(0.0f, Function(type, index));
+  }
+}
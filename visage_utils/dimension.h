@@ -21,192 +21,319 @@
 
 #pragma once
 
+#include "defines.h"
+
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <type_traits>
 
 namespace visage {
 
+  // Dimensions are literal values: a single unit or custom function in amount and
+  // compute_function, or a small expression stored inline in postfix order. Copying and
+  // computing them never allocates. Custom functions live in a process-wide table. Function
+  // pointers and captureless lambdas get one entry per function, and expressions that grow past
+  // kMaxNodes one per distinct expression, so rebuilt layouts reuse their entries. Callables with
+  // captured state get a new entry each time, so create those once and copy the Dimension.
   struct Dimension {
-    float amount = 0.0f;
-    std::function<float(float, float, float, float)> compute_function = nullptr;
+    static constexpr int kMaxNodes = 5;
+
+    using ComputeFunction = std::function<float(float, float, float, float)>;
+    using RawFunction = float (*)(float, float, float, float);
+
+    enum class Operation : uint8_t {
+      None,
+      NativePixels,
+      LogicalPixels,
+      WidthPercent,
+      HeightPercent,
+      ViewMinPercent,
+      ViewMaxPercent,
+      Custom,
+      Expression,
+      Add,
+      Subtract,
+      Min,
+      Max,
+      Scale,
+    };
+
+    // Unit or index into the custom function table, packed into four bytes
+    class Function {
+    public:
+      static constexpr uint32_t kMaxCustomFunctions = 1 << 24;
+
+      constexpr Function() = default;
+      constexpr Function(std::nullptr_t) { }
+
+      template<typename F, typename = std::enable_if_t<
+                               !std::is_same_v<std::decay_t<F>, Function> &&
+                               std::is_invocable_r_v<float, F&, float, float, float, float>>>
+      Function(F&& compute) :
+          Function(Operation::Custom, registerCallable(std::forward<F>(compute))) { }
+
+      constexpr float operator()(float amount, float dpi_scale, float parent_width,
+                                 float parent_height) const {
+        switch (operation()) {
+        case Operation::NativePixels: return amount;
+        case Operation::LogicalPixels: return amount * dpi_scale;
+        case Operation::WidthPercent: return amount * parent_width;
+        case Operation::HeightPercent: return amount * parent_height;
+        case Operation::ViewMinPercent: return amount * std::min(parent_width, parent_height);
+        case Operation::ViewMaxPercent: return amount * std::max(parent_width, parent_height);
+        case Operation::Custom:
+        case Operation::Expression:
+          return computeCustom(index(), amount, dpi_scale, parent_width, parent_height);
+        default: return 0.0f;
+        }
+      }
+
+      constexpr explicit operator bool() const { return operation() != Operation::None; }
+      constexpr bool operator==(const Function& other) const { return value_ == other.value_; }
+      constexpr bool operator!=(const Function& other) const { return value_ != other.value_; }
+
+      constexpr Operation operation() const { return static_cast<Operation>(value_ & 0xff); }
+      constexpr bool isUnit() const {
+        return operation() >= Operation::NativePixels && operation() <= Operation::ViewMaxPercent;
+      }
+
+    private:
+      friend struct Dimension;
+
+      constexpr Function(Operation operation, uint32_t index = 0) :
+          value_((index << 8) | static_cast<uint32_t>(operation)) { }
+
+      constexpr uint32_t index() const { return value_ >> 8; }
+
+      template<typename F>
+      static uint32_t registerCallable(F&& compute) {
+        if constexpr (std::is_convertible_v<F, RawFunction>)
+          return registerFunction(static_cast<RawFunction>(compute));
+        else
+          return registerFunction(ComputeFunction(std::forward<F>(compute)));
+      }
+
+      static uint32_t registerFunction(RawFunction compute);
+      static uint32_t registerFunction(ComputeFunction compute);
+      static float computeCustom(uint32_t index, float amount, float dpi_scale, float parent_width,
+                                 float parent_height);
+
+      uint32_t value_ = 0;
+    };
+
+    struct Node {
+      float amount = 0.0f;
+      Function function;
+    };
 
-    float compute(float dpi_scale, float parent_width, float parent_height, float default_value = 0.0f) const {
-      if (compute_function)
-        return compute_function(amount, dpi_scale, parent_width, parent_height);
-      return default_value;
+    float amount = 0.0f;
+    Function compute_function;
+
+    constexpr float compute(float dpi_scale, float parent_width, float parent_height,
+                            float default_value = 0.0f) const {
+      if (num_nodes_ == 0) {
+        if (compute_function)
+          return compute_function(amount, dpi_scale, parent_width, parent_height);
+        return default_value;
+      }
+
+      float stack[kMaxNodes] {};
+      int top = 0;
+      for (int i = 0; i < num_nodes_; ++i) {
+        const Node& node = nodes_[i];
+        switch (node.function.operation()) {
+        case Operation::Add: top--; stack[top - 1] += stack[top]; break;
+        case Operation::Subtract: top--; stack[top - 1] -= stack[top]; break;
+        case Operation::Min: top--; stack[top - 1] = std::min(stack[top - 1], stack[top]); break;
+        case Operation::Max: top--; stack[top - 1] = std::max(stack[top - 1], stack[top]); break;
+        case Operation::Scale: stack[top - 1] *= node.amount; break;
+        default:
+          stack[top++] = node.function(node.amount, dpi_scale, parent_width, parent_height);
+          break;
+        }
+      }
+      return stack[0];
     }
 
     int computeInt(float dpi_scale, float parent_width, float parent_height, int default_value = 0) const {
-      if (compute_function)
-        return std::round(compute_function(amount, dpi_scale, parent_width, parent_height));
-      return default_value;
+      if (num_nodes_ == 0 && !compute_function)
+        return default_value;
+      return std::round(compute(dpi_scale, parent_width, parent_height));
     }
 
-    Dimension() = default;
-    Dimension(float amount) { *this = logicalPixels(amount); }
-    Dimension(float amount, std::function<float(float, float, float, float)> compute) :
-        amount(amount), compute_function(std::move(compute)) { }
+    constexpr Dimension() = default;
+    constexpr Dimension(float amount) : Dimension(amount, Operation::LogicalPixels) { }
+    constexpr Dimension(float amount, Function compute) :
+        amount(amount), compute_function(compute) { }
 
-    static Dimension nativePixels(float pixels) {
-      return Dimension(pixels, [](float amount, float, float, float) { return amount; });
+    static constexpr Dimension nativePixels(float pixels) {
+      return Dimension(pixels, Operation::NativePixels);
     }
 
-    static Dimension logicalPixels(float pixels) {
-      return Dimension(pixels, [](float amount, float scale, float, float) { return scale * amount; });
+    static constexpr Dimension logicalPixels(float pixels) {
+      return Dimension(pixels, Operation::LogicalPixels);
     }
 
-    static Dimension widthPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float parent_width, float) {
-        return amount * parent_width;
-      });
+    static constexpr Dimension widthPercent(float percent) {
+      return Dimension(percent * 0.01f, Operation::WidthPercent);
     }
 
-    static Dimension heightPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float, float parent_height) {
-        return amount * parent_height;
-      });
+    static constexpr Dimension heightPercent(float percent) {
+      return Dimension(percent * 0.01f, Operation::HeightPercent);
     }
 
-    static Dimension viewMinPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float parent_width, float parent_height) {
-        return amount * std::min(parent_width, parent_height);
-      });
+    static constexpr Dimension viewMinPercent(float percent) {
+      return Dimension(percent * 0.01f, Operation::ViewMinPercent);
     }
 
-    static Dimension viewMaxPercent(float percent) {
-      float ratio = percent * 0.01f;
-      return Dimension(ratio, [](float amount, float, float parent_width, float parent_height) {
-        return amount * std::max(parent_width, parent_height);
-      });
+    static constexpr Dimension viewMaxPercent(float percent) {
+      return Dimension(percent * 0.01f, Operation::ViewMaxPercent);
     }
 
-    static Dimension min(const Dimension& a, const Dimension& b) {
-      auto amount1 = a.amount;
-      auto amount2 = b.amount;
-      auto compute1 = a.compute_function;
-      auto compute2 = b.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return std::min(compute1(amount1, dpi_scale, parent_width, parent_height),
-                        compute2(amount2, dpi_scale, parent_width, parent_height));
-      });
+    static constexpr Dimension min(const Dimension& a, const Dimension& b) {
+      return combine(a, b, Operation::Min);
     }
 
-    static Dimension max(const Dimension& a, const Dimension& b) {
-      auto amount1 = a.amount;
-      auto amount2 = b.amount;
-      auto compute1 = a.compute_function;
-      auto compute2 = b.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return std::max(compute1(amount1, dpi_scale, parent_width, parent_height),
-                        compute2(amount2, dpi_scale, parent_width, parent_height));
-      });
+    static constexpr Dimension max(const Dimension& a, const Dimension& b) {
+      return combine(a, b, Operation::Max);
     }
 
-    Dimension operator+(const Dimension& other) const {
-      auto amount1 = amount;
-      auto amount2 = other.amount;
-      auto compute1 = compute_function;
-      auto compute2 = other.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return compute1(amount1, dpi_scale, parent_width, parent_height) +
-               compute2(amount2, dpi_scale, parent_width, parent_height);
-      });
+    constexpr Dimension operator+(const Dimension& other) const {
+      return combine(*this, other, Operation::Add);
     }
 
-    Dimension& operator+=(const Dimension& other) {
+    constexpr Dimension& operator+=(const Dimension& other) {
       *this = *this + other;
       return *this;
     }
 
-    Dimension operator-(const Dimension& other) const {
-      auto amount1 = amount;
-      auto amount2 = other.amount;
-      auto compute1 = compute_function;
-      auto compute2 = other.compute_function;
-      return Dimension(0.0f, [amount1, amount2, compute1,
-                              compute2](float, float dpi_scale, float parent_width, float parent_height) {
-        return compute1(amount1, dpi_scale, parent_width, parent_height) -
-               compute2(amount2, dpi_scale, parent_width, parent_height);
-      });
+    constexpr Dimension operator-(const Dimension& other) const {
+      return combine(*this, other, Operation::Subtract);
     }
 
-    Dimension& operator-=(const Dimension& other) {
+    constexpr Dimension& operator-=(const Dimension& other) {
       *this = *this - other;
       return *this;
     }
 
-    Dimension operator*(float scalar) const {
-      auto amount1 = amount;
-      auto compute1 = compute_function;
-      return Dimension(amount1, [compute1, scalar](float amount, float dpi_scale,
-                                                   float parent_width, float parent_height) {
-        return scalar * compute1(amount, dpi_scale, parent_width, parent_height);
-      });
+    constexpr Dimension operator*(float scalar) const {
+      if (num_nodes_ == 0 && (compute_function.isUnit() || !compute_function))
+        return Dimension(amount * scalar, compute_function);
+      if (numNodes() == kMaxNodes)
+        return collapse(*this, nativePixels(scalar), Operation::Scale);
+
+      Dimension result;
+      result.appendNodes(*this);
+      result.nodes_[result.num_nodes_++] = { scalar, Function(Operation::Scale) };
+      return result;
     }
 
-    friend Dimension operator*(float scalar, const Dimension& dimension) {
+    friend constexpr Dimension operator*(float scalar, const Dimension& dimension) {
       return dimension * scalar;
     }
 
-    Dimension operator/(float scalar) const { return *this * (1.0f / scalar); }
+    constexpr Dimension operator/(float scalar) const { return *this * (1.0f / scalar); }
+
+    constexpr Dimension min(const Dimension& other) const { return min(*this, other); }
+
+    constexpr Dimension max(const Dimension& other) const { return max(*this, other); }
+
+    constexpr int numNodes() const { return num_nodes_ ? num_nodes_ : 1; }
+
+    // Custom functions can read state outside the Dimension, so their results can't be cached
+    constexpr bool hasCustomFunctions() const {
+      if (compute_function.operation() == Operation::Custom)
+        return true;
+      for (int i = 0; i < num_nodes_; ++i) {
+        if (nodes_[i].function.operation() == Operation::Custom)
+          return true;
+      }
+      return false;
+    }
+
+  private:
+    constexpr Dimension(float amount, Operation operation) :
+        amount(amount), compute_function(operation) { }
+
+    constexpr void appendNodes(const Dimension& other) {
+      if (other.num_nodes_ == 0) {
+        Function function = other.compute_function ? other.compute_function :
+                                                     Function(Operation::NativePixels);
+        nodes_[num_nodes_++] = { other.amount, function };
+        return;
+      }
+
+      for (int i = 0; i < other.num_nodes_; ++i)
+        nodes_[num_nodes_++] = other.nodes_[i];
+    }
+
+    static constexpr Dimension combine(const Dimension& a, const Dimension& b,
+                                       Operation operation) {
+      if (a.numNodes() + b.numNodes() + 1 > kMaxNodes)
+        return collapse(a, b, operation);
+
+      Dimension result;
+      result.appendNodes(a);
+      result.appendNodes(b);
+      result.nodes_[result.num_nodes_++] = { 0.0f, Function(operation) };
+      return result;
+    }
 
-    Dimension min(const Dimension& other) const { return min(*this, other); }
+    static Dimension collapse(const Dimension& a, const Dimension& b, Operation operation);
 
-    Dimension max(const Dimension& other) const { return max(*this, other); }
+    Node nodes_[kMaxNodes] {};
+    uint8_t num_nodes_ = 0;
   };
 
   namespace dimension {
-    inline Dimension operator""_npx(long double pixels) {
+    constexpr Dimension operator""_npx(long double pixels) {
       return Dimension::nativePixels(pixels);
     }
 
-    inline Dimension operator""_npx(unsigned long long pixels) {
+    constexpr Dimension operator""_npx(unsigned long long pixels) {
       return Dimension::nativePixels(pixels);
     }
 
-    inline Dimension operator""_px(long double pixels) {
+    constexpr Dimension operator""_px(long double pixels) {
       return Dimension::logicalPixels(pixels);
     }
 
-    inline Dimension operator""_px(unsigned long long pixels) {
+    constexpr Dimension operator""_px(unsigned long long pixels) {
       return Dimension::logicalPixels(pixels);
     }
 
-    inline Dimension operator""_vw(long double percent) {
+    constexpr Dimension operator""_vw(long double percent) {
       return Dimension::widthPercent(percent);
     }
 
-    inline Dimension operator""_vw(unsigned long long percent) {
+    constexpr Dimension operator""_vw(unsigned long long percent) {
       return Dimension::widthPercent(percent);
     }
 
-    inline Dimension operator""_vh(long double percent) {
+    constexpr Dimension operator""_vh(long double percent) {
       return Dimension::heightPercent(percent);
     }
 
-    inline Dimension operator""_vh(unsigned long long percent) {
+    constexpr Dimension operator""_vh(unsigned long long percent) {
       return Dimension::heightPercent(percent);
     }
 
-    inline Dimension operator""_vmin(long double percent) {
+    constexpr Dimension operator""_vmin(long double percent) {
       return Dimension::viewMinPercent(percent);
     }
 
-    inline Dimension operator""_vmin(unsigned long long percent) {
+    constexpr Dimension operator""_vmin(unsigned long long percent) {
       return Dimension::viewMinPercent(percent);
     }
 
-    inline Dimension operator""_vmax(long double percent) {
+    constexpr Dimension operator""_vmax(long double percent) {
       return Dimension::viewMaxPercent(percent);
     }
 
-    inline Dimension operator""_vmax(unsigned long long percent) {
+    constexpr Dimension operator""_vmax(unsigned long long percent) {
       return Dimension::viewMaxPercent(percent);
     }
   }
@@ -30,19 +30,32 @@
 #include <ShlObj.h>
 #include <windows.h>
 #elif VISAGE_MAC
+#include <cstdlib>
 #include <dlfcn.h>
 #include <mach-o/dyld.h>
 #else
 #include <cstdlib>
 #include <dlfcn.h>
 #include <unistd.h>
+#endif
+
+#if !VISAGE_WINDOWS
+static visage::File homeFolder(const char* folder) {
+  const char* home = getenv("HOME");
+  if (home == nullptr)
+    return {};
+
+  return visage::File(home) / folder;
+}
+#endif
 
+#if !VISAGE_WINDOWS && !VISAGE_MAC
 static visage::File xdgFolder(const char* env_var, const char* default_folder) {
   const char* xdg_folder = getenv(env_var);
   if (xdg_folder)
     return xdg_folder;
 
-  return default_folder;
+  return homeFolder(default_folder);
 }
 #endif
 
@@ -154,9 +167,9 @@ namespace visage {
     }
     return path;
 #elif VISAGE_MAC
-    return "~/Library";
+    return homeFolder("Library");
 #elif VISAGE_LINUX
-    return xdgFolder("XDG_DATA_HOME", "~/.config");
+    return xdgFolder("XDG_DATA_HOME", ".config");
 #else
     return {};
 #endif
@@ -172,9 +185,9 @@ namespace visage {
     }
     return path;
 #elif VISAGE_MAC
-    return "~/Documents";
+    return homeFolder("Documents");
 #elif VISAGE_LINUX
-    return xdgFolder("XDG_DOCUMENTS_DIR", "~/Documents");
+    return xdgFolder("XDG_DOCUMENTS_DIR", "Documents");
 #else
     return {};
 #endif
@@ -0,0 +1,77 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace visage {
+  // Bump allocator for objects of a single type. clear() destroys the objects but keeps the chunks,
+  // so refilling the arena to its previous size does not touch the heap. Pointers stay valid until
+  // the next clear().
+  template<typename T, int kChunkSize = 64>
+  class ObjectArena {
+  public:
+    ObjectArena() = default;
+    ~ObjectArena() { clear(); }
+
+    ObjectArena(const ObjectArena&) = delete;
+    ObjectArena& operator=(const ObjectArena&) = delete;
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+      int chunk = size_ / kChunkSize;
+      if (chunk == chunks_.size())
+        chunks_.push_back(std::make_unique<Chunk>());
+
+      T* result = new (chunks_[chunk]->slot(size_ % kChunkSize)) T(std::forward<Args>(args)...);
+      size_++;
+      return result;
+    }
+
+    void clear() {
+      for (int i = size_ - 1; i >= 0; --i)
+        chunks_[i / kChunkSize]->slot(i % kChunkSize)->~T();
+      size_ = 0;
+    }
+
+    void swap(ObjectArena& other) noexcept {
+      chunks_.swap(other.chunks_);
+      std::swap(size_, other.size_);
+    }
+
+    int size() const { return size_; }
+    int capacity() const { return chunks_.size() * kChunkSize; }
+
+  private:
+    struct Chunk {
+      T* slot(int index) { return std::launder(reinterpret_cast<T*>(storage + index * sizeof(T))); }
+
+      alignas(T) unsigned char storage[sizeof(T) * kChunkSize];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    int size_ = 0;
+  };
+}
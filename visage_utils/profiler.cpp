@@ -0,0 +1,202 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+namespace visage {
+  static int profilerThreadId() {
+    static std::atomic<int> next_id = 0;
+    static thread_local int id = next_id++;
+    return id;
+  }
+
+  static void appendJsonString(std::ostringstream& stream, const char* string) {
+    stream << '"';
+    for (const char* c = string; *c; ++c) {
+      if (*c == '"' || *c == '\\')
+        stream << '\\' << *c;
+      else if (static_cast<unsigned char>(*c) >= 0x20)
+        stream << *c;
+    }
+    stream << '"';
+  }
+
+  Profiler::Profiler() {
+    events_ = std::make_unique<EventSlot[]>(kMaxEvents);
+    frames_ = std::make_unique<FrameStats[]>(kMaxFrames);
+  }
+
+  long long Profiler::microseconds() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+  }
+
+  void Profiler::beginFrame() {
+    if (!enabled())
+      return;
+
+    frame_start_ = microseconds();
+    for (auto& counter : counters_)
+      counter.store(0, std::memory_order_relaxed);
+  }
+
+  void Profiler::endFrame() {
+    if (!enabled() || frame_start_ == 0)
+      return;
+
+    FrameStats& stats = frames_[frame_index_.load(std::memory_order_relaxed) % kMaxFrames];
+    stats.frame = frame_count_++;
+    stats.start = frame_start_;
+    stats.duration = microseconds() - frame_start_;
+    for (int i = 0; i < kNumCounters; ++i)
+      stats.counters[i] = counters_[i].load(std::memory_order_relaxed);
+
+    frame_index_.fetch_add(1, std::memory_order_release);
+    frame_start_ = 0;
+  }
+
+  void Profiler::addEvent(const char* name, long long start, long long end) {
+    unsigned int index = event_index_.fetch_add(1, std::memory_order_relaxed);
+    EventSlot& slot = events_[index % kMaxEvents];
+    slot.stamp.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    char name_buffer[kMaxNameLength] {};
+    std::strncpy(name_buffer, name, kMaxNameLength - 1);
+    for (int i = 0; i < kNameWords; ++i) {
+      uint64_t word = 0;
+      std::memcpy(&word, name_buffer + i * sizeof(uint64_t), sizeof(uint64_t));
+      slot.name[i].store(word, std::memory_order_relaxed);
+    }
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(end - start, std::memory_order_relaxed);
+    slot.thread.store(profilerThreadId(), std::memory_order_relaxed);
+    slot.stamp.store(2 * index + 2, std::memory_order_release);
+  }
+
+  bool Profiler::readEvent(unsigned int index, Event& event) const {
+    const EventSlot& slot = events_[index % kMaxEvents];
+    unsigned int stamp = 2 * index + 2;
+    if (slot.stamp.load(std::memory_order_acquire) != stamp)
+      return false;
+
+    uint64_t name[kNameWords];
+    for (int i = 0; i < kNameWords; ++i)
+      name[i] = slot.name[i].load(std::memory_order_relaxed);
+    long long start = slot.start.load(std::memory_order_relaxed);
+    long long duration = slot.duration.load(std::memory_order_relaxed);
+    int thread = slot.thread.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.stamp.load(std::memory_order_relaxed) != stamp)
+      return false;
+
+    std::memcpy(event.name, name, kMaxNameLength);
+    event.name[kMaxNameLength - 1] = '\0';
+    event.start = start;
+    event.duration = duration;
+    event.thread = thread;
+    return true;
+  }
+
+  int Profiler::numEvents() const {
+    unsigned int first = first_event_index_.load(std::memory_order_acquire);
+    return std::min<unsigned int>(event_index_.load(std::memory_order_acquire) - first, kMaxEvents);
+  }
+
+  int Profiler::numFrames() const {
+    return std::min<unsigned int>(frame_index_.load(std::memory_order_acquire), kMaxFrames);
+  }
+
+  Profiler::Event Profiler::event(int index) const {
+    unsigned int cleared = first_event_index_.load(std::memory_order_acquire);
+    unsigned int end = event_index_.load(std::memory_order_acquire);
+    unsigned int count = std::min<unsigned int>(end - cleared, kMaxEvents);
+    Event event;
+    if (index < 0 || static_cast<unsigned int>(index) >= count ||
+        !readEvent(end - count + index, event))
+      return {};
+    return event;
+  }
+
+  Profiler::FrameStats Profiler::frame(int index) const {
+    unsigned int first = frame_index_.load(std::memory_order_acquire) - numFrames();
+    return frames_[(first + index) % kMaxFrames];
+  }
+
+  Profiler::FrameStats Profiler::lastFrame() const {
+    if (numFrames() == 0)
+      return {};
+    return frame(numFrames() - 1);
+  }
+
+  void Profiler::clear() {
+    // Event indices keep counting so slot stamps stay unique and in flight writers can't
+    // publish stale events into the cleared range
+    first_event_index_ = event_index_.load();
+    frame_index_ = 0;
+    frame_count_ = 0;
+    frame_start_ = 0;
+  }
+
+  std::string Profiler::chromeTrace() const {
+    static constexpr const char* kCounterNames[kNumCounters] = {
+      "shapes", "batches", "vertices", "cached_vertices", "shape_instances", "invalid_rects",
+      "invalid_rect_fragments", "invalid_rect_overdraw", "text_layout_hits", "text_layout_misses"
+    };
+
+    std::ostringstream stream;
+    stream << "{\"traceEvents\":[";
+    bool first = true;
+    int num_frames = numFrames();
+    for (int i = 0; i < num_frames; ++i) {
+      FrameStats stats = frame(i);
+      stream << (first ? "" : ",") << "{\"name\":\"Frame " << stats.frame
+             << "\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":" << stats.start
+             << ",\"dur\":" << stats.duration << "}";
+      stream << ",{\"name\":\"Counters\",\"ph\":\"C\",\"pid\":0,\"ts\":" << stats.start
+             << ",\"args\":{";
+      for (int c = 0; c < kNumCounters; ++c)
+        stream << (c ? "," : "") << '"' << kCounterNames[c] << "\":" << stats.counters[c];
+      stream << "}}";
+      first = false;
+    }
+
+    int num_events = numEvents();
+    for (int i = 0; i < num_events; ++i) {
+      Event event = this->event(i);
+      if (event.name[0] == '\0')
+        continue;
+
+      stream << (first ? "" : ",") << "{\"name\":";
+      appendJsonString(stream, event.name);
+      stream << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread << ",\"ts\":" << event.start
+             << ",\"dur\":" << event.duration << "}";
+      first = false;
+    }
+    stream << "]}";
+    return stream.str();
+  }
+}
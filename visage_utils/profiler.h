@@ -0,0 +1,155 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "file_system.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace visage {
+  // Records timed scopes and per frame counters into fixed size ring buffers that can be written
+  // from any thread without locking. Disabled by default, in which case scopes cost one atomic load.
+  class Profiler {
+  public:
+    static constexpr int kMaxEvents = 1 << 14;
+    static constexpr int kMaxFrames = 512;
+    static constexpr int kMaxNameLength = 48;
+
+    enum Counter {
+      kShapes,
+      kBatches,
+      kVertices,
+      kCachedVertices,
+      kShapeInstances,
+      kInvalidRects,
+      kInvalidRectFragments,
+      kInvalidRectOverdraw,
+      kTextLayoutHits,
+      kTextLayoutMisses,
+      kNumCounters
+    };
+
+    struct Event {
+      char name[kMaxNameLength] {};
+      long long start = 0;
+      long long duration = 0;
+      int thread = 0;
+    };
+
+    struct FrameStats {
+      int frame = 0;
+      long long start = 0;
+      long long duration = 0;
+      long long counters[kNumCounters] {};
+    };
+
+    static Profiler& instance() {
+      static Profiler instance;
+      return instance;
+    }
+
+    static long long microseconds();
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void beginFrame();
+    void endFrame();
+    void addEvent(const char* name, long long start, long long end);
+    void addCount(Counter counter, long long amount) {
+      if (enabled())
+        counters_[counter].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    int numEvents() const;
+    int numFrames() const;
+    // Events that are still being written, or get overwritten while they are read, come back
+    // with an empty name
+    Event event(int index) const;
+    FrameStats frame(int index) const;
+    FrameStats lastFrame() const;
+    // Safe while other threads add events. Call it from the thread that begins and ends frames.
+    void clear();
+
+    std::string chromeTrace() const;
+    bool writeChromeTrace(const File& file) const { return replaceFileWithText(file, chromeTrace()); }
+
+  private:
+    static constexpr int kNameWords = kMaxNameLength / sizeof(uint64_t);
+
+    // The stamp is odd while a writer fills the slot and 2 * index + 2 once the event at index is
+    // published. Readers check it before and after copying and skip the slot if it changed.
+    struct EventSlot {
+      std::atomic<unsigned int> stamp = 0;
+      std::atomic<uint64_t> name[kNameWords] {};
+      std::atomic<long long> start = 0;
+      std::atomic<long long> duration = 0;
+      std::atomic<int> thread = 0;
+    };
+
+    Profiler();
+
+    bool readEvent(unsigned int index, Event& event) const;
+
+    std::atomic<bool> enabled_ = false;
+    std::unique_ptr<EventSlot[]> events_;
+    std::unique_ptr<FrameStats[]> frames_;
+    std::atomic<unsigned int> event_index_ = 0;
+    std::atomic<unsigned int> first_event_index_ = 0;
+    std::atomic<unsigned int> frame_index_ = 0;
+    std::atomic<long long> counters_[kNumCounters] {};
+    long long frame_start_ = 0;
+    int frame_count_ = 0;
+  };
+
+  class ProfileScope {
+  public:
+    explicit ProfileScope(const char* name) {
+      if (Profiler::instance().enabled()) {
+        name_ = name;
+        start_ = Profiler::microseconds();
+      }
+    }
+
+    explicit ProfileScope(const std::string& name) : ProfileScope(name.c_str()) { }
+
+    ~ProfileScope() {
+      if (name_)
+        Profiler::instance().addEvent(name_, start_, Profiler::microseconds());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+  private:
+    const char* name_ = nullptr;
+    long long start_ = 0;
+  };
+}
+
+#define VISAGE_PROFILE_CONCAT_INNER(a, b) a##b
+#define VISAGE_PROFILE_CONCAT(a, b) VISAGE_PROFILE_CONCAT_INNER(a, b)
+#define VISAGE_PROFILE_SCOPE(name) visage::ProfileScope VISAGE_PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define VISAGE_PROFILE_COUNT(counter, amount) visage::Profiler::instance().addCount(counter, amount)
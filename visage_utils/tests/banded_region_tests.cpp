@@ -0,0 +1,154 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_utils/banded_region.h"
+
+#include <catch2/catch_test_macros.hpp>
+#include <random>
+
+using namespace visage;
+
+namespace {
+  constexpr int kMaskSize = 64;
+
+  struct Mask {
+    bool pixels[kMaskSize][kMaskSize] {};
+
+    void set(const IBounds& rect, bool value) {
+      for (int y = std::max(0, rect.y()); y < std::min(kMaskSize, rect.bottom()); ++y) {
+        for (int x = std::max(0, rect.x()); x < std::min(kMaskSize, rect.right()); ++x)
+          pixels[y][x] = value;
+      }
+    }
+
+    void intersect(const IBounds& rect) {
+      for (int y = 0; y < kMaskSize; ++y) {
+        for (int x = 0; x < kMaskSize; ++x)
+          pixels[y][x] = pixels[y][x] && rect.contains(x, y);
+      }
+    }
+  };
+
+  Mask regionMask(const BandedRegion& region, int* overlaps) {
+    Mask mask;
+    *overlaps = 0;
+    for (const IBounds& rect : region.rects()) {
+      for (int y = rect.y(); y < rect.bottom(); ++y) {
+        for (int x = rect.x(); x < rect.right(); ++x) {
+          *overlaps += mask.pixels[y][x];
+          mask.pixels[y][x] = true;
+        }
+      }
+    }
+    return mask;
+  }
+
+  IBounds randomRect(std::mt19937& random) {
+    std::uniform_int_distribution<int> position(0, kMaskSize - 1);
+    std::uniform_int_distribution<int> size(1, kMaskSize / 3);
+    int x = position(random);
+    int y = position(random);
+    return { x, y, std::min(size(random), kMaskSize - x), std::min(size(random), kMaskSize - y) };
+  }
+}
+
+TEST_CASE("Banded region matches pixel set operations", "[utils]") {
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int> operation(0, 5);
+
+  for (int trial = 0; trial < 20; ++trial) {
+    BandedRegion region;
+    Mask expected;
+    for (int i = 0; i < 40; ++i) {
+      IBounds rect = randomRect(random);
+      int op = operation(random);
+      if (op == 0) {
+        region.subtract(rect);
+        expected.set(rect, false);
+      }
+      else if (op == 1 && i % 10 == 9) {
+        region.intersect(rect);
+        expected.intersect(rect);
+      }
+      else {
+        region.add(rect);
+        expected.set(rect, true);
+      }
+    }
+
+    int overlaps = 0;
+    Mask result = regionMask(region, &overlaps);
+    REQUIRE(overlaps == 0);
+    long long area = 0;
+    for (int y = 0; y < kMaskSize; ++y) {
+      for (int x = 0; x < kMaskSize; ++x) {
+        REQUIRE(result.pixels[y][x] == expected.pixels[y][x]);
+        area += expected.pixels[y][x];
+      }
+    }
+    REQUIRE(region.area() == area);
+  }
+}
+
+TEST_CASE("Banded region merges touching bands", "[utils]") {
+  BandedRegion region;
+  region.add(IBounds(0, 0, 10, 10));
+  region.add(IBounds(0, 10, 10, 10));
+  REQUIRE(region.numRects() == 1);
+  REQUIRE(region.boundingBox() == IBounds(0, 0, 10, 20));
+  REQUIRE(region.contains(IBounds(2, 5, 5, 10)));
+
+  region.add(IBounds(5, 5, 10, 10));
+  REQUIRE(region.numRects() == 3);
+  REQUIRE(region.area() == 10 * 20 + 5 * 10);
+  REQUIRE(region.overlaps(IBounds(14, 14, 5, 5)));
+  REQUIRE_FALSE(region.overlaps(IBounds(15, 0, 5, 5)));
+  REQUIRE_FALSE(region.contains(IBounds(0, 0, 15, 15)));
+
+  region.subtract(IBounds(0, 0, 20, 20));
+  REQUIRE(region.isEmpty());
+}
+
+TEST_CASE("Banded region coalescing trades overdraw for pieces", "[utils]") {
+  BandedRegion region;
+  for (int i = 0; i < 8; ++i)
+    region.add(IBounds(i * 6, 0, 4, 4));
+  REQUIRE(region.numRects() == 8);
+
+  BandedRegion expensive = region;
+  REQUIRE(expensive.coalesce(1) == 0);
+  REQUIRE(expensive.numRects() == 8);
+
+  long long area = region.area();
+  long long added = region.coalesce(16);
+  REQUIRE(region.numRects() == 1);
+  REQUIRE(region.area() == area + added);
+  REQUIRE(added == 7 * 2 * 4);
+
+  BandedRegion stacked;
+  stacked.add(IBounds(0, 0, 10, 4));
+  stacked.add(IBounds(2, 4, 6, 4));
+  stacked.add(IBounds(0, 100, 10, 4));
+  long long stacked_added = stacked.coalesce(20);
+  REQUIRE(stacked.numRects() == 2);
+  REQUIRE(stacked_added == 16);
+  REQUIRE(stacked.contains(IBounds(0, 0, 10, 8)));
+}
@@ -23,6 +23,8 @@
 
 #include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <functional>
+#include <memory>
 
 using namespace visage;
 using namespace visage::dimension;
@@ -88,4 +90,77 @@ TEST_CASE("Dimension combination", "[utils]") {
   REQUIRE((view_max - view_min).compute(2, 198, 100) == 98.0f);
   REQUIRE((logical_pixels - device_pixels + zero).compute(2, 198, 100) == 99.0f);
   REQUIRE((2.0f * (logical_pixels - view_min)).compute(2, 198, 100) == 196.0f);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Dimension units are constexpr", "[utils]") {
+  constexpr Dimension logical_pixels = 10_px;
+  constexpr Dimension view_min = 50_vmin;
+  static_assert(logical_pixels.compute(2, 100, 100) == 20.0f);
+  static_assert(view_min.compute(1, 300, 100) == 50.0f);
+  static_assert(Dimension().compute(1, 100, 100, 7.0f) == 7.0f);
+  static_assert((100_vw - 2.0f * 10_px).compute(2, 300, 100) == 260.0f);
+  REQUIRE(logical_pixels.numNodes() == 1);
+}
+
+TEST_CASE("Dimension nested expressions", "[utils]") {
+  Dimension expression = Dimension::min(100_vw - 20_px, 50_vh) * 2.0f +
+                         Dimension::max(10_npx, 5_px);
+  REQUIRE(expression.numNodes() == Dimension::kMaxNodes);
+  REQUIRE(expression.compute(2, 100, 400) == 130.0f);
+  REQUIRE(expression.compute(1, 100, 100) == 110.0f);
+
+  Dimension custom(3.0f, [](float amount, float scale, float width, float) {
+    return amount * scale + width;
+  });
+  REQUIRE((custom - 10_npx).compute(2, 100, 100) == 96.0f);
+
+  Dimension long_sum = 1_npx;
+  float expected = 1.0f;
+  for (int i = 0; i < 3 * Dimension::kMaxNodes; ++i) {
+    long_sum += 1_px;
+    expected += 2.0f;
+  }
+  REQUIRE(long_sum.compute(2, 100, 100) == expected);
+  REQUIRE((long_sum / 2.0f).compute(2, 100, 100) == expected / 2.0f);
+}
+
+TEST_CASE("Dimension custom function members", "[utils]") {
+  Dimension custom(3.0f, [](float amount, float scale, float, float) { return amount * scale; });
+  REQUIRE(custom.amount == 3.0f);
+  REQUIRE(custom.compute_function(custom.amount, 2, 100, 100) == 6.0f);
+
+  custom.amount = 4.0f;
+  REQUIRE(custom.compute(2, 100, 100) == 8.0f);
+
+  auto offset = std::make_shared<float>(5.0f);
+  custom.compute_function = [offset](float amount, float, float, float) {
+    return amount + *offset;
+  };
+  REQUIRE(custom.compute(2, 100, 100) == 9.0f);
+
+  std::function<float(float, float, float, float)> width = [](float amount, float, float w, float) {
+    return amount * w;
+  };
+  REQUIRE(Dimension(0.5f, width).compute(1, 300, 100) == 150.0f);
+  REQUIRE_FALSE(Dimension(1.0f, nullptr).compute_function);
+  REQUIRE((10_px).compute_function);
+}
+
+TEST_CASE("Dimension custom functions are shared when rebuilt", "[utils]") {
+  Dimension first_custom;
+  Dimension first_expression;
+  for (int i = 0; i < 100; ++i) {
+    Dimension custom(2.0f, [](float amount, float scale, float, float) { return amount * scale; });
+    Dimension expression = custom;
+    for (int n = 0; n < 3 * Dimension::kMaxNodes; ++n)
+      expression = Dimension::max(expression, 1_px) + 10_npx;
+
+    if (i == 0) {
+      first_custom = custom;
+      first_expression = expression;
+    }
+    REQUIRE(custom.compute_function == first_custom.compute_function);
+    REQUIRE(expression.compute_function == first_expression.compute_function);
+  }
+  REQUIRE(first_expression.compute(3, 100, 100) == 156.0f);
+}
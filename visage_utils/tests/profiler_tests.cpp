@@ -0,0 +1,115 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_utils/profiler.h"
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+#include <vector>
+
+using namespace visage;
+
+TEST_CASE("Profiler records scopes and frame counters", "[utils]") {
+  Profiler& profiler = Profiler::instance();
+  profiler.clear();
+  profiler.setEnabled(true);
+
+  profiler.beginFrame();
+  {
+    VISAGE_PROFILE_SCOPE("Outer \"scope\"");
+    VISAGE_PROFILE_COUNT(Profiler::kShapes, 5);
+    VISAGE_PROFILE_COUNT(Profiler::kShapes, 2);
+    VISAGE_PROFILE_COUNT(Profiler::kVertices, 28);
+  }
+  profiler.endFrame();
+  profiler.setEnabled(false);
+
+  REQUIRE(profiler.numFrames() == 1);
+  REQUIRE(profiler.lastFrame().counters[Profiler::kShapes] == 7);
+  REQUIRE(profiler.lastFrame().counters[Profiler::kVertices] == 28);
+  REQUIRE(profiler.numEvents() == 1);
+  REQUIRE(std::string(profiler.event(0).name) == "Outer \"scope\"");
+
+  std::string trace = profiler.chromeTrace();
+  REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(trace.find("Outer \\\"scope\\\"") != std::string::npos);
+  REQUIRE(trace.find("\"shapes\":7") != std::string::npos);
+
+  { VISAGE_PROFILE_SCOPE("Disabled"); }
+  REQUIRE(profiler.numEvents() == 1);
+  profiler.clear();
+}
+
+TEST_CASE("Profiler ring buffer keeps the latest events", "[utils]") {
+  Profiler& profiler = Profiler::instance();
+  profiler.clear();
+
+  for (int i = 0; i < Profiler::kMaxEvents + 10; ++i)
+    profiler.addEvent(std::to_string(i).c_str(), i, i + 1);
+
+  REQUIRE(profiler.numEvents() == Profiler::kMaxEvents);
+  REQUIRE(std::string(profiler.event(0).name) == "10");
+  REQUIRE(std::string(profiler.event(Profiler::kMaxEvents - 1).name) ==
+          std::to_string(Profiler::kMaxEvents + 9));
+  profiler.clear();
+}
+
+TEST_CASE("Profiler events read while other threads record them", "[utils]") {
+  Profiler& profiler = Profiler::instance();
+  profiler.clear();
+
+  std::atomic<bool> done = false;
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&profiler, t] {
+      std::string name = "Writer " + std::to_string(t);
+      for (int i = 0; i < 4 * Profiler::kMaxEvents; ++i)
+        profiler.addEvent(name.c_str(), i, i + t);
+    });
+  }
+
+  int torn = 0;
+  std::thread reader([&] {
+    while (!done) {
+      for (int i = 0; i < profiler.numEvents(); i += 61) {
+        Profiler::Event event = profiler.event(i);
+        std::string name = event.name;
+        if (name.empty())
+          continue;
+        if (name.size() != 8 || name.compare(0, 7, "Writer ") != 0 ||
+            event.duration != name[7] - '0')
+          torn++;
+      }
+      profiler.clear();
+    }
+  });
+
+  for (auto& writer : writers)
+    writer.join();
+  done = true;
+  reader.join();
+
+  REQUIRE(torn == 0);
+  profiler.clear();
+  REQUIRE(profiler.numEvents() == 0);
+  REQUIRE(profiler.event(0).name[0] == '\0');
+}
@@ -0,0 +1,70 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_utils/thread_pool.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("Thread pool runs every index once", "[utils]") {
+  static constexpr int kCount = 1000;
+  ThreadPool pool(4);
+  REQUIRE(pool.numThreads() == 4);
+
+  std::unique_ptr<std::atomic<int>[]> runs = std::make_unique<std::atomic<int>[]>(kCount);
+  for (int i = 0; i < kCount; ++i)
+    runs[i] = 0;
+
+  std::atomic<bool> ran_on_worker = false;
+  std::atomic<bool> valid_threads = true;
+  for (int pass = 0; pass < 3; ++pass) {
+    pool.parallelFor(kCount, [&](int index, int thread) {
+      if (thread < 0 || thread >= pool.numThreads())
+        valid_threads = false;
+      if (thread > 0 && ThreadPool::isWorkerThread())
+        ran_on_worker = true;
+      if (index < 10)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      runs[index]++;
+    });
+  }
+
+  bool all_three = true;
+  for (int i = 0; i < kCount; ++i)
+    all_three = all_three && runs[i] == 3;
+  REQUIRE(all_three);
+  REQUIRE(valid_threads);
+  REQUIRE(ran_on_worker);
+  REQUIRE_FALSE(ThreadPool::isWorkerThread());
+}
+
+TEST_CASE("Thread pool with one thread runs on the caller", "[utils]") {
+  ThreadPool pool(1);
+  int sum = 0;
+  int max_thread = 0;
+  pool.parallelFor(10, [&](int index, int thread) {
+    max_thread = std::max(max_thread, thread);
+    sum += index;
+  });
+  REQUIRE(sum == 45);
+  REQUIRE(max_thread == 0);
+}
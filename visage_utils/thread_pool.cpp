@@ -0,0 +1,145 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace visage {
+  static thread_local bool is_pool_worker = false;
+
+  bool ThreadPool::isWorkerThread() {
+    return is_pool_worker;
+  }
+
+  ThreadPool::ThreadPool(int num_threads) {
+    num_threads = std::max(1, num_threads);
+    ranges_ = std::make_unique<std::atomic<uint64_t>[]>(num_threads);
+    for (int i = 0; i < num_threads; ++i)
+      ranges_[i] = 0;
+
+    for (int i = 1; i < num_threads; ++i)
+      workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_condition_.notify_all();
+    for (std::thread& worker : workers_)
+      worker.join();
+  }
+
+  void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& task) {
+    if (count <= 0)
+      return;
+
+    if (workers_.empty() || count == 1) {
+      for (int i = 0; i < count; ++i)
+        task(i, 0);
+      return;
+    }
+
+    int num_threads = numThreads();
+    for (int i = 0; i < num_threads; ++i) {
+      uint32_t begin = static_cast<int64_t>(count) * i / num_threads;
+      uint32_t end = static_cast<int64_t>(count) * (i + 1) / num_threads;
+      ranges_[i] = packRange(begin, end);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      num_active_ = workers_.size();
+      generation_++;
+    }
+    start_condition_.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_condition_.wait(lock, [this] { return num_active_ == 0; });
+    task_ = nullptr;
+  }
+
+  void ThreadPool::workerLoop(int thread) {
+    is_pool_worker = true;
+    int generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_condition_.wait(lock, [&] { return stop_ || generation_ != generation; });
+        if (stop_)
+          return;
+        generation = generation_;
+      }
+
+      runTasks(thread);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--num_active_ == 0)
+        done_condition_.notify_one();
+    }
+  }
+
+  void ThreadPool::runTasks(int thread) {
+    int index = 0;
+    while (popFront(thread, index) || steal(thread, index))
+      (*task_)(index, thread);
+  }
+
+  bool ThreadPool::popFront(int thread, int& index) {
+    uint64_t range = ranges_[thread].load();
+    while (true) {
+      uint32_t begin = range & 0xffffffff;
+      uint32_t end = range >> 32;
+      if (begin >= end)
+        return false;
+
+      if (ranges_[thread].compare_exchange_weak(range, packRange(begin + 1, end))) {
+        index = begin;
+        return true;
+      }
+    }
+  }
+
+  bool ThreadPool::steal(int thread, int& index) {
+    int num_threads = numThreads();
+    for (int offset = 1; offset < num_threads; ++offset) {
+      std::atomic<uint64_t>& victim = ranges_[(thread + offset) % num_threads];
+      uint64_t range = victim.load();
+      while (true) {
+        uint32_t begin = range & 0xffffffff;
+        uint32_t end = range >> 32;
+        if (begin >= end)
+          break;
+
+        if (victim.compare_exchange_weak(range, packRange(begin, end - 1))) {
+          index = end - 1;
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+}
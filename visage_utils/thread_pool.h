@@ -0,0 +1,72 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace visage {
+  // Fixed set of worker threads that run index ranges in parallel. Each thread starts on its own
+  // contiguous slice of the range and steals from the back of other slices when it runs out.
+  class ThreadPool {
+  public:
+    static bool isWorkerThread();
+
+    explicit ThreadPool(int num_threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Includes the thread calling parallelFor, which always runs as thread 0.
+    int numThreads() const { return workers_.size() + 1; }
+
+    // Calls task(index, thread) for every index in [0, count) and returns when all have finished.
+    void parallelFor(int count, const std::function<void(int index, int thread)>& task);
+
+  private:
+    static uint64_t packRange(uint32_t begin, uint32_t end) {
+      return begin | (static_cast<uint64_t>(end) << 32);
+    }
+
+    void workerLoop(int thread);
+    void runTasks(int thread);
+    bool popFront(int thread, int& index);
+    bool steal(int thread, int& index);
+
+    std::vector<std::thread> workers_;
+    std::unique_ptr<std::atomic<uint64_t>[]> ranges_;
+
+    std::mutex mutex_;
+    std::condition_variable start_condition_;
+    std::condition_variable done_condition_;
+    const std::function<void(int, int)>* task_ = nullptr;
+    int generation_ = 0;
+    int num_active_ = 0;
+    bool stop_ = false;
+  };
+}
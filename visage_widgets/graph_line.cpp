@@ -55,10 +55,27 @@ namespace visage {
     return height() / 2;
   }
 
+  void GraphLine::setStreaming(int capacity, float min_value, float max_value) {
+    streaming_ = capacity > 0;
+    stream_min_ = min_value;
+    stream_max_ = max_value;
+    stream_.setCapacity(capacity);
+    redraw();
+  }
+
   void GraphLine::draw(Canvas& canvas) {
     if (canvas.totallyClamped())
       return;
 
+    if (streaming_) {
+      float range = stream_max_ - stream_min_;
+      float y_scale = range ? -height() / range : 0.0f;
+      int columns = std::ceil(width() * canvas.dpiScale());
+      stream_.decimate(line_, width(), columns, height() - stream_min_ * y_scale, y_scale);
+      if (line_.num_points < 2)
+        return;
+    }
+
     if (fill_)
       drawFill(canvas, active_ ? LineFillColor : LineDisabledFillColor);
     drawLine(canvas, active_ ? LineColor : LineDisabledColor);
@@ -92,6 +92,17 @@ namespace visage {
 
     int numPoints() const { return line_.num_points; }
 
+    // Streaming mode replaces the fixed points with the newest `capacity` pushed samples, drawn
+    // left to right and reduced to at most two points per pixel column. Samples between
+    // min_value and max_value span the height.
+    void setStreaming(int capacity, float min_value = -1.0f, float max_value = 1.0f);
+    bool streaming() const { return streaming_; }
+    void pushSamples(const float* samples, int count) {
+      VISAGE_ASSERT(streaming_);
+      stream_.push(samples, count);
+      redraw();
+    }
+
     bool active() const { return active_; }
     void setActive(bool active) { active_ = active; }
     void setFillAlphaMult(float mult) { fill_alpha_mult_ = mult; }
@@ -101,6 +112,7 @@ namespace visage {
     void drawFill(Canvas& canvas, theme::ColorId color_id);
 
     Line line_;
+    LineStream stream_;
     Dimension line_width_;
 
     bool fill_ = false;
@@ -110,6 +122,9 @@ namespace visage {
 
     bool active_ = true;
     bool loop_ = false;
+    bool streaming_ = false;
+    float stream_min_ = -1.0f;
+    float stream_max_ = 1.0f;
 
     VISAGE_LEAK_CHECKER(GraphLine)
   };
@@ -0,0 +1,53 @@
+/* Copyright Vital Audio, LLC
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "visage_widgets/text_editor.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace visage;
+
+TEST_CASE("Text editor undo and redo typing", "[widgets]") {
+  TextEditor editor;
+  editor.insertTextAtCaret("hello");
+  editor.insertTextAtCaret(" world");
+  REQUIRE(editor.text() == "hello world");
+
+  REQUIRE(editor.undo());
+  REQUIRE(editor.text() == "");
+  REQUIRE(editor.redo());
+  REQUIRE(editor.text() == "hello world");
+}
+
+TEST_CASE("Text editor setText clears undo history", "[widgets]") {
+  TextEditor editor;
+  editor.insertTextAtCaret("hello world");
+  editor.setText("");
+  REQUIRE_FALSE(editor.undo());
+  REQUIRE(editor.text() == "");
+
+  editor.insertTextAtCaret("abc");
+  REQUIRE(editor.undo());
+  REQUIRE(editor.text() == "");
+  editor.setText("replaced");
+  REQUIRE_FALSE(editor.redo());
+  REQUIRE(editor.text() == "replaced");
+}
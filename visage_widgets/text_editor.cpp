@@ -99,9 +99,6 @@ namespace visage {
   }
 
   TextEditor::TextEditor(const std::string& name) : ScrollableFrame(name) {
-    undo_history_.reserve(kMaxUndoHistory);
-    undone_history_.reserve(kMaxUndoHistory);
-
     setAcceptsKeystrokes(true);
     text_.setFont(Font(10, fonts::Lato_Regular_ttf, 1.0f));
     default_text_.setFont(Font(10, fonts::Lato_Regular_ttf, 1.0f));
@@ -135,7 +132,7 @@ namespace visage {
     else if (justification() & Font::kBottom)
       y_offset = yPosition();
     else {
-      int num_lines = line_breaks_.size() + 1;
+      int num_lines = document_.numLines();
       y_offset = (height() - num_lines * line_height) * 0.5f - yPosition();
     }
 
@@ -178,7 +175,7 @@ namespace visage {
       drawSelection(canvas);
 
     canvas.setPosition(0, yMargin());
-    if (text_.text().isEmpty()) {
+    if (document_.isEmpty()) {
       bool center = (justification() & Font::kLeft) == 0 && (justification() & Font::kRight) == 0;
       if (!default_text_.text().isEmpty() && (!center || !hasKeyboardFocus())) {
         canvas.setColor(TextEditorDefaultText);
@@ -188,36 +185,64 @@ namespace visage {
     }
     else {
       canvas.setColor(TextEditorText);
+      float expansion = std::abs(x_position_);
+      float text_x = -expansion;
+      float text_width = text_bounds.width() + 2 * expansion;
       if (justification() & Font::kLeft) {
-        canvas.text(&text_, x_margin - x_position_, -yPosition(), x_position_ + text_bounds.width(),
-                    text_bounds.height());
+        text_x = x_margin - x_position_;
+        text_width = x_position_ + text_bounds.width();
       }
       else if (justification() & Font::kRight) {
-        canvas.text(&text_, 0, -yPosition(), x_margin + text_bounds.width() - x_position_,
-                    text_bounds.height());
+        text_x = 0.0f;
+        text_width = x_margin + text_bounds.width() - x_position_;
       }
-      else {
+      else
         canvas.setPosition(-x_position_, 0.0f);
-        float expansion = std::abs(x_position_);
-        canvas.text(&text_, -expansion, -yPosition(), text_bounds.width() + 2 * expansion,
-                    text_bounds.height());
+
+      if (text_.multiLine())
+        drawLines(canvas, text_x, text_width, text_bounds.height());
+      else {
+        text_.setText(document_.text());
+        canvas.text(&text_, text_x, -yPosition(), text_width, text_bounds.height());
       }
     }
   }
 
-  std::pair<float, float> TextEditor::indexToPosition(int index) const {
-    int line = 0;
-    float line_height = font().lineHeight();
+  void TextEditor::drawLines(Canvas& canvas, float x, float text_width, float text_height) const {
+    Font::Justification line_justification = Font::kTop;
+    if (justification() & Font::kLeft)
+      line_justification = Font::kTopLeft;
+    else if (justification() & Font::kRight)
+      line_justification = Font::kTopRight;
 
-    while (line < line_breaks_.size() && index >= line_breaks_[line])
-      line++;
+    float line_height = font().lineHeight();
+    int num_lines = document_.numLines();
+    float lines_y = -yPosition() + (text_height - num_lines * line_height) * 0.5f;
+    if (justification() & Font::kTop)
+      lines_y = -yPosition();
+    else if (justification() & Font::kBottom)
+      lines_y = -yPosition() + text_height - num_lines * line_height;
+
+    int first_line = std::max(0, static_cast<int>((-yMargin() - lines_y) / line_height));
+    int last_line = std::ceil((height() - yMargin() - lines_y) / line_height);
+    last_line = std::min(num_lines - 1, last_line);
+    for (int line = first_line; line <= last_line; ++line) {
+      std::pair<int, int> range = lineRange(line);
+      String line_text = document_.substring(range.first, range.second - range.first);
+      float line_y = lines_y + line * line_height;
+      canvas.text(line_text, font(), line_justification, x, line_y, text_width, line_height);
+    }
+  }
 
+  std::pair<float, float> TextEditor::indexToPosition(int index) const {
+    float line_height = font().lineHeight();
+    int line = document_.lineAtIndex(index);
     std::pair<int, int> range = lineRange(line);
+    std::u32string line_text = document_.substring(range.first, range.second - range.first);
 
-    float pre_width = font().stringWidth(text_.text().c_str() + range.first, index - range.first,
+    float pre_width = font().stringWidth(line_text.c_str(), index - range.first,
                                          text_.characterOverride());
-    float full_width = font().stringWidth(text_.text().c_str() + range.first,
-                                          range.second - range.first, text_.characterOverride());
+    float full_width = font().stringWidth(line_text, text_.characterOverride());
 
     float line_x = (width() - full_width) / 2.0f;
     float x_margin = xMargin();
@@ -234,12 +259,13 @@ namespace visage {
     int end_index = textLength();
     line = std::max(line, 0);
 
+    const std::vector<int>& line_breaks = document_.lineBreaks();
     if (line > 0)
-      start_index = line_breaks_[line - 1];
-    if (line < line_breaks_.size()) {
-      end_index = line_breaks_[line];
+      start_index = line_breaks[line - 1];
+    if (line < line_breaks.size()) {
+      end_index = line_breaks[line];
 
-      if (Font::isNewLine(text_.text()[end_index - 1]))
+      if (Font::isNewLine(document_.at(end_index - 1)))
         end_index--;
     }
 
@@ -248,11 +274,11 @@ namespace visage {
 
   int TextEditor::positionToIndex(const std::pair<float, float>& position) const {
     float line_height = font().lineHeight();
-    int line = std::min<int>(line_breaks_.size(), (position.second - yMargin()) / line_height);
+    int line = std::min<int>(document_.numLines() - 1, (position.second - yMargin()) / line_height);
     std::pair<int, int> range = lineRange(line);
+    std::u32string line_text = document_.substring(range.first, range.second - range.first);
 
-    float full_width = font().stringWidth(text_.text().c_str() + range.first,
-                                          range.second - range.first, text_.characterOverride());
+    float full_width = font().stringWidth(line_text, text_.characterOverride());
 
     float line_x = (width() - full_width) * 0.5f;
     float x_margin = xMargin();
@@ -261,7 +287,7 @@ namespace visage {
     else if (justification() & Font::kRight)
       line_x = width() - x_margin - full_width;
 
-    int index = font().widthOverflowIndex(text_.text().c_str() + range.first, range.second - range.first,
+    int index = font().widthOverflowIndex(line_text.c_str(), line_text.size(),
                                           position.first - line_x, true, text_.characterOverride());
     return std::min(range.first + index, range.second);
   }
@@ -301,17 +327,15 @@ namespace visage {
   }
 
   void TextEditor::deleteSelected() {
-    undone_history_.clear();
+    clearRedoHistory();
 
     if (action_state_ != kDeleting)
       addUndoPosition();
     action_state_ = kDeleting;
 
-    String before = text_.text().substring(0, selectionStart());
-    String after = text_.text().substring(selectionEnd());
-    text_.setText(before + after);
-    setLineBreaks();
-    caret_position_ = selectionStart();
+    int start = selectionStart();
+    replaceText(start, selectionEnd(), U"");
+    caret_position_ = start;
     selection_position_ = caret_position_;
     makeCaretVisible();
 
@@ -333,7 +357,7 @@ namespace visage {
         setYPosition(caret_location.second - height() + font().lineHeight());
     }
     else {
-      float line_width = font().stringWidth(text_.text().c_str(), textLength(), text_.characterOverride());
+      float line_width = font().stringWidth(text().c_str(), textLength(), text_.characterOverride());
       float x_margin = xMarginSize();
       float min_view = x_position_ + x_margin;
       float max_view = x_position_ + width() - x_margin;
@@ -372,7 +396,7 @@ namespace visage {
   }
 
   void TextEditor::setViewBounds() {
-    int num_lines = line_breaks_.size() + 1;
+    int num_lines = document_.numLines();
     float total_height = num_lines * font().lineHeight() + 2 * yMargin();
     setScrollableHeight(total_height);
   }
@@ -380,12 +404,12 @@ namespace visage {
   String TextEditor::selection() const {
     int start = selectionStart();
     int end = selectionEnd();
-    return text_.text().substring(start, end - start);
+    return document_.substring(start, end - start);
   }
 
   int TextEditor::beginningOfWord() const {
     int index = caret_position_ - 1;
-    while (index > 0 && isVariableCharacter(text_.text()[index - 1]))
+    while (index > 0 && isVariableCharacter(document_.at(index - 1)))
       --index;
     return std::max(0, index);
   }
@@ -393,7 +417,7 @@ namespace visage {
   int TextEditor::endOfWord() const {
     int string_length = textLength();
     int index = caret_position_ + 1;
-    while (index < string_length && isVariableCharacter(text_.text()[index]))
+    while (index < string_length && isVariableCharacter(document_.at(index)))
       ++index;
     return std::min(string_length, index);
   }
@@ -451,7 +475,7 @@ namespace visage {
   }
 
   void TextEditor::tripleClick(const MouseEvent& e) {
-    int line = std::min<int>(line_breaks_.size(),
+    int line = std::min<int>(document_.numLines() - 1,
                              (e.position.y - yMargin() + yPosition()) / font().lineHeight());
     std::pair<int, int> range = lineRange(line);
     selection_position_ = range.first;
@@ -801,16 +825,18 @@ namespace visage {
   }
 
   bool TextEditor::undo() {
+    while (!undo_history_.empty() && undo_history_.back().edits.empty())
+      undo_history_.pop_back();
     if (undo_history_.empty())
       return false;
 
-    undone_history_.emplace_back(text_.text(), caret_position_);
-    std::pair<String, int> state = undo_history_.back();
+    UndoStep step = std::move(undo_history_.back());
     undo_history_.pop_back();
-    text_.setText(state.first);
-    caret_position_ = state.second;
-    selection_position_ = state.second;
-    setLineBreaks();
+    applyEdits(step, false);
+    caret_position_ = step.caret_before;
+    selection_position_ = step.caret_before;
+    undone_history_.push_back(std::move(step));
+    action_state_ = kNone;
     makeCaretVisible();
     on_text_change_.callback();
     return true;
@@ -820,20 +846,20 @@ namespace visage {
     if (undone_history_.empty())
       return false;
 
-    addUndoPosition();
-    std::pair<String, int> state = undone_history_.back();
+    UndoStep step = std::move(undone_history_.back());
     undone_history_.pop_back();
-    text_.setText(state.first);
-    caret_position_ = state.second;
-    selection_position_ = state.second;
-    setLineBreaks();
+    applyEdits(step, true);
+    caret_position_ = step.caret_after;
+    selection_position_ = step.caret_after;
+    undo_history_.push_back(std::move(step));
+    action_state_ = kNone;
     makeCaretVisible();
     on_text_change_.callback();
     return true;
   }
 
   void TextEditor::insertTextAtCaret(const String& insert_text) {
-    undone_history_.clear();
+    clearRedoHistory();
     String text = translateDeadKeyText(insert_text);
     if (dead_key_entry_ != DeadKey::None && text == insert_text)
       selection_position_ = caret_position_;
@@ -847,16 +873,14 @@ namespace visage {
       addUndoPosition();
     action_state_ = kInserting;
 
-    String before = text_.text().substring(0, selectionStart());
-    String after = text_.text().substring(selectionEnd());
+    int start = selectionStart();
+    int end = selectionEnd();
     int max_text = text.length();
     if (max_characters_)
-      max_text = std::max(0, std::min<int>(max_text, max_characters_ - before.length() - after.length()));
+      max_text = std::max(0, std::min(max_text, max_characters_ - textLength() + end - start));
 
-    String trimmed = text.substring(0, max_text);
-    text_.setText(before + trimmed + after);
-    setLineBreaks();
-    caret_position_ = before.length() + max_text;
+    replaceText(start, end, text.substring(0, max_text).toUtf32());
+    caret_position_ = start + max_text;
     selection_position_ = caret_position_;
     makeCaretVisible();
 
@@ -864,6 +888,74 @@ namespace visage {
     redraw();
   }
 
+  void TextEditor::addUndoPosition() {
+    if (!undo_history_.empty() && undo_history_.back().edits.empty())
+      undo_history_.back().caret_before = caret_position_;
+    else {
+      undo_history_.emplace_back();
+      undo_history_.back().caret_before = caret_position_;
+      trimUndoHistory();
+    }
+  }
+
+  void TextEditor::replaceText(int start, int end, const std::u32string& text) {
+    if (start == end && text.empty())
+      return;
+
+    if (undo_history_.empty())
+      addUndoPosition();
+
+    UndoStep& step = undo_history_.back();
+    std::u32string removed = document_.substring(start, end - start);
+    int memory = (removed.size() + text.size()) * sizeof(char32_t);
+    Edit* last = step.edits.empty() ? nullptr : &step.edits.back();
+
+    int last_end = last ? last->position + static_cast<int>(last->inserted.size()) : 0;
+    if (last && removed.empty() && start == last_end)
+      last->inserted += text;
+    else if (last && text.empty() && last->inserted.empty() && end == last->position) {
+      last->removed = removed + last->removed;
+      last->position = start;
+    }
+    else if (last && text.empty() && last->inserted.empty() && start == last->position)
+      last->removed += removed;
+    else {
+      step.edits.push_back({ start, std::move(removed), text });
+      memory += sizeof(Edit);
+    }
+
+    step.caret_after = start + text.size();
+    step.memory += memory;
+    undo_memory_ += memory;
+    document_.replace(start, end - start, text);
+    trimUndoHistory();
+  }
+
+  void TextEditor::applyEdits(const UndoStep& step, bool forward) {
+    if (forward) {
+      for (const Edit& edit : step.edits)
+        document_.replace(edit.position, edit.removed.size(), edit.inserted);
+    }
+    else {
+      for (auto edit = step.edits.rbegin(); edit != step.edits.rend(); ++edit)
+        document_.replace(edit->position, edit->inserted.size(), edit->removed);
+    }
+  }
+
+  void TextEditor::clearRedoHistory() {
+    for (const UndoStep& step : undone_history_)
+      undo_memory_ -= step.memory;
+    undone_history_.clear();
+  }
+
+  void TextEditor::trimUndoHistory() {
+    while (undo_history_.size() > 1 &&
+           (undo_history_.size() > kMaxUndoHistory || undo_memory_ > kMaxUndoMemory)) {
+      undo_memory_ -= undo_history_.front().memory;
+      undo_history_.pop_front();
+    }
+  }
+
   void TextEditor::setNumberEntry() {
     setMultiLine(false);
     setSelectOnFocus(true);
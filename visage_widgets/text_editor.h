@@ -23,14 +23,18 @@
 
 #include "visage_graphics/color.h"
 #include "visage_graphics/font.h"
+#include "visage_graphics/text_document.h"
 #include "visage_ui/frame.h"
 #include "visage_ui/scroll_bar.h"
 
+#include <deque>
+
 namespace visage {
   class TextEditor : public ScrollableFrame {
   public:
     static constexpr int kDefaultPasswordCharacter = '*';
     static constexpr int kMaxUndoHistory = 1000;
+    static constexpr int kMaxUndoMemory = 8 * 1024 * 1024;
 
     static constexpr char32_t kAcuteAccentCharacter = U'\u00B4';
     static constexpr char32_t kGraveAccentCharacter = U'\u0060';
@@ -184,18 +188,22 @@ namespace visage {
     }
 
     void setLineBreaks() {
-      if (text_.multiLine() && text_.font().packedFont()) {
-        line_breaks_ = text_.font().lineBreaks(text_.text().c_str(), text_.text().length(),
-                                               width() - 2 * xMargin());
-      }
+      if (text_.multiLine() && text_.font().packedFont())
+        document_.setWrap(text_.font(), width() - 2 * xMargin());
+      else
+        document_.clearWrap();
     }
 
     void setText(const String& text) {
       if (max_characters_)
-        text_.setText(text.substring(0, max_characters_));
+        document_.setText(text.substring(0, max_characters_));
       else
-        text_.setText(text);
-      caret_position_ = text_.text().length();
+        document_.setText(text);
+      undo_history_.clear();
+      undone_history_.clear();
+      undo_memory_ = 0;
+      action_state_ = kNone;
+      caret_position_ = document_.length();
       selection_position_ = caret_position_;
       setLineBreaks();
       makeCaretVisible();
@@ -226,8 +234,9 @@ namespace visage {
     void setNumberEntry();
     void setTextFieldEntry();
 
-    const String& text() const { return text_.text(); }
-    int textLength() const { return text_.text().length(); }
+    const String& text() const { return document_.text(); }
+    int textLength() const { return document_.length(); }
+    const TextDocument& document() const { return document_; }
     const Font& font() const { return text_.font(); }
     Font::Justification justification() const { return text_.justification(); }
     void setBackgroundColorId(theme::ColorId color_id) { background_color_id_ = color_id; }
@@ -236,7 +245,25 @@ namespace visage {
     float xMarginSize() const {
       return set_x_margin_ ? set_x_margin_ : paletteValue(TextEditorMarginX);
     }
-    void addUndoPosition() { undo_history_.emplace_back(text_.text(), caret_position_); }
+    struct Edit {
+      int position = 0;
+      std::u32string removed;
+      std::u32string inserted;
+    };
+
+    struct UndoStep {
+      std::vector<Edit> edits;
+      int caret_before = 0;
+      int caret_after = 0;
+      int memory = 0;
+    };
+
+    void addUndoPosition();
+    void replaceText(int start, int end, const std::u32string& text);
+    void applyEdits(const UndoStep& step, bool forward);
+    void clearRedoHistory();
+    void trimUndoHistory();
+    void drawLines(Canvas& canvas, float x, float text_width, float text_height) const;
 
     CallbackList<void()> on_text_change_;
     CallbackList<void()> on_enter_key_;
@@ -245,8 +272,8 @@ namespace visage {
     DeadKey dead_key_entry_ = DeadKey::None;
     Text text_;
     Text default_text_;
+    TextDocument document_;
     std::string filtered_characters_;
-    std::vector<int> line_breaks_;
     int caret_position_ = 0;
     int selection_position_ = 0;
     std::pair<float, float> selection_start_point_;
@@ -264,8 +291,9 @@ namespace visage {
     float x_position_ = 0.0f;
 
     ActionState action_state_ = kNone;
-    std::vector<std::pair<String, int>> undo_history_;
-    std::vector<std::pair<String, int>> undone_history_;
+    std::deque<UndoStep> undo_history_;
+    std::vector<UndoStep> undone_history_;
+    int undo_memory_ = 0;
 
     VISAGE_LEAK_CHECKER(TextEditor)
   };
@@ -24,8 +24,13 @@
 
 #include "visage_utils/thread_utils.h"
 
+#include <cerrno>
 #include <cstring>
 #include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include <X11/cursorfont.h>
 #include <X11/extensions/Xrandr.h>
 #include <X11/Xutil.h>
@@ -548,15 +553,164 @@ namespace visage {
 
     XSelectInput(display, window_handle_, kEventMask);
     start_draw_microseconds_ = time::microseconds();
+    frame_scheduler_.setRefreshRate(monitor_info_.refresh_rate);
     setDpiScale(monitor_info_.dpi / kDefaultDpi);
     XFlush(display);
     NativeWindowLookup::instance().addWindow(this);
   }
 
-  static void threadTimerCallback(WindowX11* window) {
-    while (window->timerThreadRunning()) {
-      Thread::sleep(window->timerMs());
+  static long long monotonicNanoseconds() {
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+  }
+
+  static void drainFd(int fd) {
+    uint64_t count = 0;
+    while (read(fd, &count, sizeof(count)) > 0) { }
+  }
+
+  static void signalFd(int fd) {
+    uint64_t count = 1;
+    // Only fails when the counter is about to overflow, in which case the loop is already awake
+    if (write(fd, &count, sizeof(count)) != sizeof(count))
+      VISAGE_ASSERT(errno == EAGAIN);
+  }
+
+  FrameScheduler::FrameScheduler() {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    VISAGE_ASSERT(epoll_fd_ >= 0 && timer_fd_ >= 0 && wake_fd_ >= 0);
+
+    for (int fd : { timer_fd_, wake_fd_ }) {
+      epoll_event event {};
+      event.events = EPOLLIN;
+      event.data.fd = fd;
+      epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    start_nanoseconds_ = monotonicNanoseconds();
+    last_frame_nanoseconds_ = start_nanoseconds_ - frame_nanoseconds_.load();
+  }
+
+  FrameScheduler::~FrameScheduler() {
+    for (int fd : { epoll_fd_, timer_fd_, wake_fd_ }) {
+      if (fd >= 0)
+        close(fd);
+    }
+  }
+
+  void FrameScheduler::watchFd(int fd) {
+    VISAGE_ASSERT(watch_fd_ < 0);
+    watch_fd_ = fd;
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  }
+
+  void FrameScheduler::setRefreshRate(double refresh_rate) {
+    if (refresh_rate > 0.0)
+      frame_nanoseconds_ = std::round(1000000000.0 / refresh_rate);
+  }
 
+  void FrameScheduler::requestFrame() {
+    if (!frame_requested_.exchange(true))
+      signalFd(wake_fd_);
+  }
+
+  void FrameScheduler::requestFrameIn(long long milliseconds) {
+    long long deadline = 0;
+    if (milliseconds >= 0)
+      deadline = monotonicNanoseconds() + milliseconds * 1000000LL;
+
+    if (deadline_nanoseconds_.exchange(deadline) != deadline)
+      signalFd(wake_fd_);
+  }
+
+  void FrameScheduler::stop() {
+    stopped_ = true;
+    signalFd(wake_fd_);
+  }
+
+  long long FrameScheduler::nextFrameTime() const {
+    // Frames land on a grid of refresh periods so pacing stays steady. After an idle stretch the
+    // next slot has already passed and the requested frame draws right away.
+    long long period = frame_nanoseconds_.load();
+    long long slot = (last_frame_nanoseconds_ - start_nanoseconds_) / period + 1;
+    return std::max(start_nanoseconds_ + slot * period, monotonicNanoseconds());
+  }
+
+  void FrameScheduler::armTimer(long long nanoseconds) {
+    if (nanoseconds == armed_nanoseconds_)
+      return;
+
+    armed_nanoseconds_ = nanoseconds;
+    itimerspec timer {};
+    timer.it_value.tv_sec = nanoseconds / 1000000000LL;
+    timer.it_value.tv_nsec = nanoseconds % 1000000000LL;
+    timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &timer, nullptr);
+  }
+
+  FrameScheduler::Wake FrameScheduler::wait() {
+    static constexpr int kMaxEvents = 3;
+
+    while (!stopped_.load()) {
+      long long deadline = deadline_nanoseconds_.load();
+      if (frame_requested_.load())
+        armTimer(nextFrameTime());
+      else if (deadline)
+        armTimer(std::max(deadline, nextFrameTime()));
+      else
+        armTimer(0);
+
+      epoll_event events[kMaxEvents];
+      int num_events = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+      if (num_events < 0) {
+        if (errno == EINTR)
+          continue;
+        return Wake::Error;
+      }
+
+      bool frame_due = false;
+      bool fd_ready = false;
+      for (int i = 0; i < num_events; ++i) {
+        if (events[i].data.fd == wake_fd_)
+          drainFd(wake_fd_);
+        else if (events[i].data.fd == timer_fd_) {
+          drainFd(timer_fd_);
+          armed_nanoseconds_ = 0;
+          frame_due = true;
+        }
+        else if (events[i].data.fd == watch_fd_)
+          fd_ready = true;
+      }
+
+      if (stopped_.load())
+        break;
+
+      if (frame_due) {
+        long long now = monotonicNanoseconds();
+        deadline = deadline_nanoseconds_.load();
+        bool deadline_passed = deadline && deadline <= now;
+        if (deadline_passed)
+          deadline_nanoseconds_.compare_exchange_strong(deadline, 0);
+
+        if (frame_requested_.exchange(false) || deadline_passed) {
+          last_frame_nanoseconds_ = now;
+          return Wake::Frame;
+        }
+      }
+      if (fd_ready)
+        return Wake::Fd;
+    }
+
+    return Wake::Stopped;
+  }
+
+  static void frameThreadCallback(WindowX11* window) {
+    while (window->frameScheduler().wait() == FrameScheduler::Wake::Frame) {
       X11Connection* x11 = window->x11Connection();
       X11Connection::DisplayLock lock(x11);
       ::Window window_handle = (::Window)window->nativeHandle();
@@ -604,8 +758,9 @@ namespace visage {
     XSelectInput(display, window_handle_, kEventMask);
     XFlush(display);
 
-    timer_thread_running_ = true;
-    timer_thread_ = std::make_unique<std::thread>(threadTimerCallback, this);
+    frame_scheduler_.setRefreshRate(monitor_info_.refresh_rate);
+    frame_scheduler_.requestFrame();
+    frame_thread_ = std::make_unique<std::thread>(frameThreadCallback, this);
     start_draw_microseconds_ = time::microseconds();
     setDpiScale(monitor_info_.dpi / kDefaultDpi);
     NativeWindowLookup::instance().addWindow(this);
@@ -614,11 +769,11 @@ namespace visage {
   WindowX11::~WindowX11() {
     NativeWindowLookup::instance().removeWindow(this);
 
-    timer_thread_running_ = false;
-    if (timer_thread_ && timer_thread_->joinable())
-      timer_thread_->join();
+    frame_scheduler_.stop();
+    if (frame_thread_ && frame_thread_->joinable())
+      frame_thread_->join();
 
-    timer_thread_.reset();
+    frame_thread_.reset();
 
     X11Connection::DisplayLock lock(x11_);
     if (window_handle_)
@@ -1082,6 +1237,11 @@ namespace visage {
       else if (event.xany.window == window_handle_ || event.xany.window == parent_handle_)
         processEvent(event);
     }
+
+    if (needsDraw())
+      frame_scheduler_.requestFrame();
+    else
+      frame_scheduler_.requestFrameIn(millisecondsUntilNextEvent());
   }
 
   void WindowX11::processMessageWindowEvent(XEvent& event) {
@@ -1429,60 +1589,53 @@ namespace visage {
 
   void WindowX11::runEventLoop() {
     Display* display = x11_->display();
-
-    timeval timeout {};
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0;
-    fd_set read_fds;
-    unsigned int fd = ConnectionNumber(display);
-
+    frame_scheduler_.watchFd(ConnectionNumber(display));
+    frame_scheduler_.requestFrame();
     start_microseconds_ = time::microseconds();
-    long long last_timer_microseconds = start_microseconds_;
 
     XEvent event;
     bool running = true;
     while (running) {
-      FD_ZERO(&read_fds);
-      FD_SET(fd, &read_fds);
-
-      timeout.tv_sec = 0;
-      long long us_to_timer = timer_microseconds_ - (time::microseconds() - last_timer_microseconds);
-      int result = 0;
-      if (us_to_timer > 0) {
-        timeout.tv_usec = us_to_timer;
-        result = select(fd + 1, &read_fds, nullptr, nullptr, &timeout);
+      while (running && XPending(display)) {
+        XNextEvent(display, &event);
+        WindowX11* window = NativeWindowLookup::instance().findWindow(event.xany.window);
+        if (window == nullptr)
+          continue;
+
+        if (event.type == Expose) {
+          int height = clientHeight();
+          window->handleResized(clientWidth(), height + 1);
+          window->handleResized(clientWidth(), height);
+        }
+
+        if (event.type == DestroyNotify ||
+            (event.type == ClientMessage && event.xclient.data.l[0] == x11_->deleteMessage())) {
+          NativeWindowLookup::instance().removeWindow(window);
+          window->hide();
+          if (!NativeWindowLookup::instance().anyWindowOpen())
+            running = false;
+        }
+        else
+          window->processEvent(event);
       }
-      if (result == -1)
+
+      if (!running)
+        break;
+
+      // Input handlers can queue callbacks without redrawing anything, and running timers need a
+      // frame at their next deadline
+      if (needsDraw())
+        frame_scheduler_.requestFrame();
+      else
+        frame_scheduler_.requestFrameIn(millisecondsUntilNextEvent());
+
+      FrameScheduler::Wake wake = frame_scheduler_.wait();
+      if (wake == FrameScheduler::Wake::Error || wake == FrameScheduler::Wake::Stopped)
         running = false;
-      else if (result == 0) {
-        last_timer_microseconds = time::microseconds();
-        long long us_time = last_timer_microseconds - start_microseconds_;
+      else if (wake == FrameScheduler::Wake::Frame) {
+        long long us_time = time::microseconds() - start_microseconds_;
         drawCallback(us_time / 1000000.0);
       }
-      else if (FD_ISSET(fd, &read_fds)) {
-        while (running && XPending(x11_->display())) {
-          XNextEvent(x11_->display(), &event);
-          WindowX11* window = NativeWindowLookup::instance().findWindow(event.xany.window);
-          if (window == nullptr)
-            continue;
-
-          if (event.type == Expose) {
-            int height = clientHeight();
-            window->handleResized(clientWidth(), height + 1);
-            window->handleResized(clientWidth(), height);
-          }
-
-          if (event.type == DestroyNotify ||
-              (event.type == ClientMessage && event.xclient.data.l[0] == x11_->deleteMessage())) {
-            NativeWindowLookup::instance().removeWindow(window);
-            window->hide();
-            if (!NativeWindowLookup::instance().anyWindowOpen())
-              running = false;
-          }
-          else
-            window->processEvent(event);
-        }
-      }
     }
   }
 
@@ -193,6 +193,47 @@ namespace visage {
     float dpi = Window::kDefaultDpi;
   };
 
+  // Paces frames to the monitor refresh with a timerfd in an epoll set. Frames are only scheduled
+  // after requestFrame() so an idle window blocks until input arrives or something goes stale.
+  class FrameScheduler {
+  public:
+    enum class Wake {
+      Frame,
+      Fd,
+      Stopped,
+      Error
+    };
+
+    FrameScheduler();
+    ~FrameScheduler();
+    FrameScheduler(const FrameScheduler&) = delete;
+
+    void watchFd(int fd);
+    void setRefreshRate(double refresh_rate);
+    void requestFrame();
+    // Schedules a frame for a timer deadline without marking anything stale. A negative delay
+    // cancels the deadline.
+    void requestFrameIn(long long milliseconds);
+    void stop();
+    Wake wait();
+
+  private:
+    long long nextFrameTime() const;
+    void armTimer(long long nanoseconds);
+
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    int wake_fd_ = -1;
+    int watch_fd_ = -1;
+    long long start_nanoseconds_ = 0;
+    long long last_frame_nanoseconds_ = 0;
+    long long armed_nanoseconds_ = 0;
+    std::atomic<long long> frame_nanoseconds_ = 16666667;
+    std::atomic<long long> deadline_nanoseconds_ = 0;
+    std::atomic<bool> frame_requested_ = false;
+    std::atomic<bool> stopped_ = false;
+  };
+
   class WindowX11 : public Window {
   public:
     static constexpr long kEventMask = ExposureMask | KeyPressMask | KeyReleaseMask |
@@ -216,6 +257,7 @@ namespace visage {
     void processPluginFdEvents() override;
     void processMessageWindowEvent(XEvent& event);
     void processEvent(XEvent& event);
+    void requestDraw() override { frame_scheduler_.requestFrame(); }
 
     void* nativeHandle() const override { return (void*)window_handle_; }
 
@@ -238,8 +280,7 @@ namespace visage {
     IPoint minWindowDimensions() const override;
     MonitorInfo monitorInfo() { return monitor_info_; }
     X11Connection* x11Connection() { return x11_; }
-    bool timerThreadRunning() { return timer_thread_running_.load(); }
-    int timerMs() const { return timer_microseconds_.load() / 1000; }
+    FrameScheduler& frameScheduler() { return frame_scheduler_; }
 
   private:
     static WindowX11* last_active_window_;
@@ -287,9 +328,8 @@ namespace visage {
     ::Window parent_handle_ = 0;
     std::map<KeySym, bool> pressed_;
     long long start_microseconds_ = 0;
-    std::atomic<long long> timer_microseconds_ = 16667;
-    std::atomic<bool> timer_thread_running_ = false;
-    std::unique_ptr<std::thread> timer_thread_;
+    FrameScheduler frame_scheduler_;
+    std::unique_ptr<std::thread> frame_thread_;
   };
 }
 
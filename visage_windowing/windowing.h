@@ -124,6 +124,24 @@ namespace visage {
         draw_callback_(time);
     }
 
+    // Lets event loops that schedule frames on demand ask whether another frame is needed
+    void setNeedsDrawCallback(std::function<bool()> callback) {
+      needs_draw_callback_ = std::move(callback);
+    }
+
+    bool needsDraw() const { return !needs_draw_callback_ || needs_draw_callback_(); }
+    virtual void requestDraw() { }
+
+    // Milliseconds until a frame is needed for a scheduled event even if nothing is stale, or a
+    // negative value when nothing is scheduled
+    void setNextEventCallback(std::function<long long()> callback) {
+      next_event_callback_ = std::move(callback);
+    }
+
+    long long millisecondsUntilNextEvent() const {
+      return next_event_callback_ ? next_event_callback_() : -1;
+    }
+
     void setMinimumWindowScale(float scale) { min_window_scale_ = scale; }
     float minimumWindowScale() const { return min_window_scale_; }
     virtual void setFixedAspectRatio(bool fixed) { fixed_aspect_ratio_ = fixed; }
@@ -200,6 +218,8 @@ namespace visage {
     RepeatClick mouse_repeat_clicks_;
 
     std::function<void(double)> draw_callback_ = nullptr;
+    std::function<bool()> needs_draw_callback_ = nullptr;
+    std::function<long long()> next_event_callback_ = nullptr;
     CallbackList<void()> on_show_;
     CallbackList<void()> on_hide_;
     CallbackList<void()> on_contents_resized_;